@@ -0,0 +1,306 @@
+#include <frm/AabbTree.h>
+
+#include <EASTL/utility.h> // eastl::swap
+
+using namespace frm;
+using namespace apt;
+
+/*******************************************************************************
+
+                                 AabbTree
+
+*******************************************************************************/
+
+void frm::swap(AabbTree& _a, AabbTree& _b)
+{
+	eastl::swap(_a.m_nodes,      _b.m_nodes);
+	eastl::swap(_a.m_root,       _b.m_root);
+	eastl::swap(_a.m_freeList,   _b.m_freeList);
+	eastl::swap(_a.m_proxyCount, _b.m_proxyCount);
+	eastl::swap(_a.m_margin,     _b.m_margin);
+}
+
+// PUBLIC
+
+AabbTree::AabbTree(float _margin, uint32 _capacity)
+	: m_root(kInvalidProxy)
+	, m_freeList(kInvalidProxy)
+	, m_proxyCount(0)
+	, m_margin(_margin)
+{
+	m_nodes.reserve(_capacity);
+}
+
+AabbTree::ProxyId AabbTree::insert(const AlignedBox& _box, void* _userData)
+{
+	uint32 leaf = allocNode();
+	Node& node = m_nodes[leaf];
+	node.m_box.m_min = _box.m_min - vec3(m_margin);
+	node.m_box.m_max = _box.m_max + vec3(m_margin);
+	node.m_userData  = _userData;
+	node.m_height    = 0;
+	insertLeaf(leaf);
+	++m_proxyCount;
+	return (ProxyId)leaf;
+}
+
+void AabbTree::remove(ProxyId _id)
+{
+	APT_ASSERT(isProxy(_id));
+	removeLeaf(_id);
+	freeNode(_id);
+	--m_proxyCount;
+}
+
+bool AabbTree::move(ProxyId _id, const AlignedBox& _box, const vec3& _displacement)
+{
+	APT_ASSERT(isProxy(_id));
+	if (Contains(m_nodes[_id].m_box, _box)) {
+		return false;
+	}
+
+	removeLeaf(_id);
+	AlignedBox fat(_box.m_min - vec3(m_margin), _box.m_max + vec3(m_margin));
+	fat.m_min += APT_MIN(_displacement, vec3(0.0f));
+	fat.m_max += APT_MAX(_displacement, vec3(0.0f));
+	m_nodes[_id].m_box = fat;
+	insertLeaf(_id);
+	return true;
+}
+
+void AabbTree::clear()
+{
+	m_nodes.clear();
+	m_root       = kInvalidProxy;
+	m_freeList   = kInvalidProxy;
+	m_proxyCount = 0;
+}
+
+float AabbTree::getAreaRatio() const
+{
+	if (m_root == kInvalidProxy) {
+		return 0.0f;
+	}
+	float area = 0.0f;
+	for (auto& node : m_nodes) {
+		if (node.m_height > 0) {
+			area += SurfaceArea(node.m_box);
+		}
+	}
+	return area / SurfaceArea(m_nodes[m_root].m_box);
+}
+
+void AabbTree::validate() const
+{
+	if (m_root != kInvalidProxy) {
+		APT_ASSERT(m_nodes[m_root].m_parent == kInvalidProxy);
+		validate(m_root);
+	}
+	uint32 freeCount = 0;
+	for (uint32 i = m_freeList; i != kInvalidProxy; i = m_nodes[i].m_parent) {
+		APT_ASSERT(m_nodes[i].m_height == -1);
+		++freeCount;
+	}
+	APT_ASSERT(freeCount + m_proxyCount * 2 - (m_proxyCount ? 1 : 0) == (uint32)m_nodes.size());
+	APT_UNUSED(freeCount);
+}
+
+// PRIVATE
+
+uint32 AabbTree::allocNode()
+{
+	uint32 ret;
+	if (m_freeList != kInvalidProxy) {
+		ret = m_freeList;
+		m_freeList = m_nodes[ret].m_parent;
+	} else {
+		ret = (uint32)m_nodes.size();
+		m_nodes.push_back();
+	}
+	Node& node = m_nodes[ret];
+	node.m_userData = nullptr;
+	node.m_parent   = kInvalidProxy;
+	node.m_child0   = kInvalidProxy;
+	node.m_child1   = kInvalidProxy;
+	node.m_height   = 0;
+	return ret;
+}
+
+void AabbTree::freeNode(uint32 _i)
+{
+	m_nodes[_i].m_parent = m_freeList;
+	m_nodes[_i].m_height = -1;
+	m_freeList = _i;
+}
+
+void AabbTree::insertLeaf(uint32 _leaf)
+{
+	if (m_root == kInvalidProxy) {
+		m_root = _leaf;
+		m_nodes[_leaf].m_parent = kInvalidProxy;
+		return;
+	}
+
+ // descend to find the best sibling; cost is the area of the new parent plus the increase in area of the ancestors
+	AlignedBox leafBox = m_nodes[_leaf].m_box;
+	uint32 i = m_root;
+	while (!m_nodes[i].isLeaf()) {
+		const Node& node = m_nodes[i];
+		float area         = SurfaceArea(node.m_box);
+		float combinedArea = SurfaceArea(Union(node.m_box, leafBox));
+		float cost         = 2.0f * combinedArea;           // cost of creating a new parent for this node and the leaf
+		float inheritCost  = 2.0f * (combinedArea - area);  // minimum cost of pushing the leaf further down
+
+		float childCost[2];
+		uint32 children[2] = { node.m_child0, node.m_child1 };
+		for (int j = 0; j < 2; ++j) {
+			const Node& child = m_nodes[children[j]];
+			float unionArea = SurfaceArea(Union(child.m_box, leafBox));
+			if (child.isLeaf()) {
+				childCost[j] = unionArea + inheritCost;
+			} else {
+				childCost[j] = unionArea - SurfaceArea(child.m_box) + inheritCost;
+			}
+		}
+
+		if (cost < childCost[0] && cost < childCost[1]) {
+			break;
+		}
+		i = childCost[0] < childCost[1] ? children[0] : children[1];
+	}
+
+ // create a new parent for the sibling and the leaf
+	uint32 sibling   = i;
+	uint32 oldParent = m_nodes[sibling].m_parent;
+	uint32 newParent = allocNode();
+	m_nodes[newParent].m_parent = oldParent;
+	m_nodes[newParent].m_box    = Union(leafBox, m_nodes[sibling].m_box);
+	m_nodes[newParent].m_height = m_nodes[sibling].m_height + 1;
+	m_nodes[newParent].m_child0 = sibling;
+	m_nodes[newParent].m_child1 = _leaf;
+	m_nodes[sibling].m_parent   = newParent;
+	m_nodes[_leaf].m_parent     = newParent;
+	if (oldParent != kInvalidProxy) {
+		if (m_nodes[oldParent].m_child0 == sibling) {
+			m_nodes[oldParent].m_child0 = newParent;
+		} else {
+			m_nodes[oldParent].m_child1 = newParent;
+		}
+	} else {
+		m_root = newParent;
+	}
+
+	refitAncestors(m_nodes[_leaf].m_parent);
+}
+
+void AabbTree::removeLeaf(uint32 _leaf)
+{
+	if (_leaf == m_root) {
+		m_root = kInvalidProxy;
+		return;
+	}
+
+ // replace the parent with the sibling
+	uint32 parent      = m_nodes[_leaf].m_parent;
+	uint32 grandParent = m_nodes[parent].m_parent;
+	uint32 sibling     = m_nodes[parent].m_child0 == _leaf ? m_nodes[parent].m_child1 : m_nodes[parent].m_child0;
+	if (grandParent != kInvalidProxy) {
+		if (m_nodes[grandParent].m_child0 == parent) {
+			m_nodes[grandParent].m_child0 = sibling;
+		} else {
+			m_nodes[grandParent].m_child1 = sibling;
+		}
+		m_nodes[sibling].m_parent = grandParent;
+		freeNode(parent);
+		refitAncestors(grandParent);
+	} else {
+		m_root = sibling;
+		m_nodes[sibling].m_parent = kInvalidProxy;
+		freeNode(parent);
+	}
+}
+
+uint32 AabbTree::balance(uint32 _a)
+{
+	Node& a = m_nodes[_a];
+	if (a.isLeaf() || a.m_height < 2) {
+		return _a;
+	}
+
+	uint32 ib = a.m_child0;
+	uint32 ic = a.m_child1;
+	int heightDiff = m_nodes[ic].m_height - m_nodes[ib].m_height;
+	if (heightDiff > 1) {
+	 // c is taller, rotate it up
+		eastl::swap(ib, ic);
+	} else if (heightDiff >= -1) {
+		return _a;
+	}
+
+ // b is the taller child of a, promote b and move the taller grandchild (f) to be a child of b, the shorter (g) replaces b under a
+	Node& b = m_nodes[ib];
+	uint32 ifc = b.m_child0;
+	uint32 igc = b.m_child1;
+	if (m_nodes[igc].m_height > m_nodes[ifc].m_height) {
+		eastl::swap(ifc, igc);
+	}
+
+	b.m_parent = a.m_parent;
+	a.m_parent = ib;
+	if (b.m_parent != kInvalidProxy) {
+		Node& p = m_nodes[b.m_parent];
+		if (p.m_child0 == _a) {
+			p.m_child0 = ib;
+		} else {
+			p.m_child1 = ib;
+		}
+	} else {
+		m_root = ib;
+	}
+
+	b.m_child0 = _a;
+	b.m_child1 = ifc;
+	if (a.m_child0 == ib) {
+		a.m_child0 = igc;
+	} else {
+		a.m_child1 = igc;
+	}
+	m_nodes[igc].m_parent = _a;
+
+	const Node& ac0 = m_nodes[a.m_child0];
+	const Node& ac1 = m_nodes[a.m_child1];
+	a.m_box    = Union(ac0.m_box, ac1.m_box);
+	a.m_height = 1 + APT_MAX(ac0.m_height, ac1.m_height);
+	const Node& f = m_nodes[ifc];
+	b.m_box    = Union(a.m_box, f.m_box);
+	b.m_height = 1 + APT_MAX(a.m_height, f.m_height);
+	return ib;
+}
+
+void AabbTree::refitAncestors(uint32 _i)
+{
+	while (_i != kInvalidProxy) {
+		_i = balance(_i);
+		Node& node = m_nodes[_i];
+		const Node& c0 = m_nodes[node.m_child0];
+		const Node& c1 = m_nodes[node.m_child1];
+		node.m_box    = Union(c0.m_box, c1.m_box);
+		node.m_height = 1 + APT_MAX(c0.m_height, c1.m_height);
+		_i = node.m_parent;
+	}
+}
+
+int AabbTree::validate(uint32 _i) const
+{
+	const Node& node = m_nodes[_i];
+	if (node.isLeaf()) {
+		APT_ASSERT(node.m_height == 0);
+		return 1;
+	}
+	const Node& c0 = m_nodes[node.m_child0];
+	const Node& c1 = m_nodes[node.m_child1];
+	APT_ASSERT(c0.m_parent == _i && c1.m_parent == _i);
+	APT_ASSERT(node.m_height == 1 + APT_MAX(c0.m_height, c1.m_height));
+	APT_ASSERT(Contains(node.m_box, c0.m_box) && Contains(node.m_box, c1.m_box));
+	return validate(node.m_child0) + validate(node.m_child1) + 1;
+}
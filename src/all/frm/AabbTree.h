@@ -0,0 +1,280 @@
+#pragma once
+#ifndef frm_AabbTree_h
+#define frm_AabbTree_h
+
+#include <frm/def.h>
+#include <frm/geom.h>
+#include <frm/math.h>
+
+#include <EASTL/vector.h>
+
+namespace frm {
+
+////////////////////////////////////////////////////////////////////////////////
+// AabbTree
+// Dynamic bounding volume hierarchy for moving objects. Each proxy (leaf)
+// stores a 'fat' box, enlarged by a margin plus a predicted displacement, so
+// that small movements don't require the tree to be modified. When a proxy
+// leaves its fat box it is removed and reinserted; the tree is kept balanced
+// via rotations during insertion/removal.
+//
+// Queries test the fat boxes and call a callback for each proxy, signature
+// void(ProxyId _id). Ray queries take an intersection callback with the
+// signature bool(ProxyId _id, float& t_) to test the object itself.
+////////////////////////////////////////////////////////////////////////////////
+class AabbTree
+{
+public:
+	typedef uint32 ProxyId;
+	static const ProxyId kInvalidProxy = ~0u;
+	static const int     kMaxDepth     = 64;
+
+	AabbTree(float _margin = 0.1f, uint32 _capacity = 64);
+
+	// Create a proxy for _box, return the proxy id.
+	ProxyId insert(const AlignedBox& _box, void* _userData);
+	void    remove(ProxyId _id);
+
+	// Update the proxy bounds. If _box is still contained by the fat box this is a no-op, else the proxy is
+	// reinserted with a fat box extended by _displacement (the predicted movement). Return true if reinserted.
+	bool    move(ProxyId _id, const AlignedBox& _box, const vec3& _displacement = vec3(0.0f));
+
+	void    clear();
+
+	// Find all proxies whose fat box is inside _frustum.
+	template <typename tCallback>
+	void    findInside(const Frustum& _frustum, tCallback _callback) const;
+
+	// Find all proxies whose fat box intersects _sphere/_box.
+	template <typename tCallback>
+	void    findIntersecting(const Sphere& _sphere, tCallback _callback) const;
+	template <typename tCallback>
+	void    findIntersecting(const AlignedBox& _box, tCallback _callback) const;
+
+	// Find the proxy closest to the ray origin for which _intersect returns true.
+	template <typename tIntersect>
+	bool    findClosest(const Ray& _ray, tIntersect _intersect, ProxyId& id_, float& t_, float _tmax = FLT_MAX) const;
+
+	void*             getUserData(ProxyId _id) const { APT_ASSERT(isProxy(_id)); return m_nodes[_id].m_userData; }
+	const AlignedBox& getFatBox(ProxyId _id) const   { APT_ASSERT(isProxy(_id)); return m_nodes[_id].m_box; }
+	uint32            getProxyCount() const          { return m_proxyCount; }
+	int               getHeight() const              { return m_root == kInvalidProxy ? 0 : m_nodes[m_root].m_height; }
+	float             getMargin() const              { return m_margin; }
+	void              setMargin(float _margin)       { m_margin = _margin; }
+
+	// Sum of the surface area of all interior nodes divided by the area of the root; a measure of the tree quality.
+	float   getAreaRatio() const;
+
+	// Check tree invariants (debug).
+	void    validate() const;
+
+	friend void swap(AabbTree& _a, AabbTree& _b);
+
+private:
+	struct Node
+	{
+		AlignedBox m_box;
+		void*      m_userData;
+		uint32     m_parent;    // next free node if m_height == -1
+		uint32     m_child0;    // kInvalidProxy for leaves
+		uint32     m_child1;
+		int        m_height;    // leaf = 0, free = -1
+
+		bool isLeaf() const { return m_child0 == kInvalidProxy; }
+	};
+
+	eastl::vector<Node> m_nodes;
+	uint32              m_root;
+	uint32              m_freeList;
+	uint32              m_proxyCount;
+	float               m_margin;
+
+	bool    isProxy(ProxyId _id) const { return _id < m_nodes.size() && m_nodes[_id].m_height == 0; }
+
+	uint32  allocNode();
+	void    freeNode(uint32 _i);
+
+	void    insertLeaf(uint32 _leaf);
+	void    removeLeaf(uint32 _leaf);
+
+	// Rotate the subtree rooted at _i if it is imbalanced, return the new subtree root.
+	uint32  balance(uint32 _i);
+
+	// Walk from _i to the root, recompute heights/boxes and rebalance.
+	void    refitAncestors(uint32 _i);
+
+	int     validate(uint32 _i) const;
+
+	static AlignedBox Union(const AlignedBox& _a, const AlignedBox& _b)
+	{
+		return AlignedBox(APT_MIN(_a.m_min, _b.m_min), APT_MAX(_a.m_max, _b.m_max));
+	}
+
+	static float SurfaceArea(const AlignedBox& _box)
+	{
+		vec3 e = _box.m_max - _box.m_min;
+		return 2.0f * (e.x * e.y + e.y * e.z + e.z * e.x);
+	}
+
+	static bool Contains(const AlignedBox& _outer, const AlignedBox& _inner)
+	{
+		return _outer.m_min.x <= _inner.m_min.x && _outer.m_min.y <= _inner.m_min.y && _outer.m_min.z <= _inner.m_min.z
+		    && _outer.m_max.x >= _inner.m_max.x && _outer.m_max.y >= _inner.m_max.y && _outer.m_max.z >= _inner.m_max.z
+		    ;
+	}
+
+	// Slab test against a node box given the reciprocal ray direction, t0_ is the entry distance (0 if the origin is inside).
+	static bool IntersectNode(const AlignedBox& _box, const vec3& _origin, const vec3& _rcpDirection, float _tmax, float& t0_)
+	{
+		vec3 ta = (_box.m_min - _origin) * _rcpDirection;
+		vec3 tb = (_box.m_max - _origin) * _rcpDirection;
+		vec3 tn = APT_MIN(ta, tb);
+		vec3 tf = APT_MAX(ta, tb);
+		t0_      = APT_MAX(APT_MAX(tn.x, tn.y), APT_MAX(tn.z, 0.0f));
+		float t1 = APT_MIN(APT_MIN(tf.x, tf.y), APT_MIN(tf.z, _tmax));
+		return t0_ <= t1;
+	}
+
+}; // class AabbTree
+
+
+template <typename tCallback>
+inline void AabbTree::findInside(const Frustum& _frustum, tCallback _callback) const
+{
+	if (m_root == kInvalidProxy) {
+		return;
+	}
+	struct Entry { uint32 m_node; uint32 m_planeMask; };
+	Entry stack[kMaxDepth];
+	int top = 0;
+	stack[top++] = { m_root, (1u << Frustum::Plane_Count) - 1 };
+	while (top > 0) {
+		Entry e = stack[--top];
+		const Node& node = m_nodes[e.m_node];
+		if (e.m_planeMask && !_frustum.inside(node.m_box, e.m_planeMask)) {
+			continue;
+		}
+		if (node.isLeaf()) {
+			_callback((ProxyId)e.m_node);
+			continue;
+		}
+		APT_ASSERT(top + 2 <= kMaxDepth);
+		stack[top++] = { node.m_child1, e.m_planeMask };
+		stack[top++] = { node.m_child0, e.m_planeMask };
+	}
+}
+
+template <typename tCallback>
+inline void AabbTree::findIntersecting(const Sphere& _sphere, tCallback _callback) const
+{
+	if (m_root == kInvalidProxy) {
+		return;
+	}
+	uint32 stack[kMaxDepth];
+	int top = 0;
+	stack[top++] = m_root;
+	while (top > 0) {
+		uint32 i = stack[--top];
+		const Node& node = m_nodes[i];
+		if (!Intersects(_sphere, node.m_box)) {
+			continue;
+		}
+		if (node.isLeaf()) {
+			_callback((ProxyId)i);
+			continue;
+		}
+		APT_ASSERT(top + 2 <= kMaxDepth);
+		stack[top++] = node.m_child1;
+		stack[top++] = node.m_child0;
+	}
+}
+
+template <typename tCallback>
+inline void AabbTree::findIntersecting(const AlignedBox& _box, tCallback _callback) const
+{
+	if (m_root == kInvalidProxy) {
+		return;
+	}
+	uint32 stack[kMaxDepth];
+	int top = 0;
+	stack[top++] = m_root;
+	while (top > 0) {
+		uint32 i = stack[--top];
+		const Node& node = m_nodes[i];
+		if (!Intersects(_box, node.m_box)) {
+			continue;
+		}
+		if (node.isLeaf()) {
+			_callback((ProxyId)i);
+			continue;
+		}
+		APT_ASSERT(top + 2 <= kMaxDepth);
+		stack[top++] = node.m_child1;
+		stack[top++] = node.m_child0;
+	}
+}
+
+template <typename tIntersect>
+inline bool AabbTree::findClosest(const Ray& _ray, tIntersect _intersect, ProxyId& id_, float& t_, float _tmax) const
+{
+	if (m_root == kInvalidProxy) {
+		return false;
+	}
+	vec3 rcpDirection;
+	for (int i = 0; i < 3; ++i) {
+	 // clamp to avoid inf * 0 = nan for axis-aligned rays
+		float d = _ray.m_direction[i];
+		rcpDirection[i] = 1.0f / (fabs(d) < 1e-20f ? (d < 0.0f ? -1e-20f : 1e-20f) : d);
+	}
+
+	bool ret = false;
+	struct Entry { uint32 m_node; float m_t; };
+	Entry stack[kMaxDepth];
+	int top = 0;
+	float t0;
+	if (!IntersectNode(m_nodes[m_root].m_box, _ray.m_origin, rcpDirection, _tmax, t0)) {
+		return false;
+	}
+	stack[top++] = { m_root, t0 };
+	while (top > 0) {
+		Entry e = stack[--top];
+		if (e.m_t > _tmax) {
+			continue;
+		}
+		const Node& node = m_nodes[e.m_node];
+		if (node.isLeaf()) {
+			float t;
+			if (_intersect((ProxyId)e.m_node, t) && t >= 0.0f && t < _tmax) {
+				_tmax = t;
+				id_   = (ProxyId)e.m_node;
+				ret   = true;
+			}
+			continue;
+		}
+	 // visit the nearest child first
+		uint32 c0 = node.m_child0;
+		uint32 c1 = node.m_child1;
+		float t1;
+		bool hit0 = IntersectNode(m_nodes[c0].m_box, _ray.m_origin, rcpDirection, _tmax, t0);
+		bool hit1 = IntersectNode(m_nodes[c1].m_box, _ray.m_origin, rcpDirection, _tmax, t1);
+		if (hit0 && hit1) {
+			if (t1 < t0) {
+				eastl::swap(c0, c1);
+				eastl::swap(t0, t1);
+			}
+			APT_ASSERT(top + 2 <= kMaxDepth);
+			stack[top++] = { c1, t1 };
+			stack[top++] = { c0, t0 };
+		} else if (hit0) {
+			stack[top++] = { c0, t0 };
+		} else if (hit1) {
+			stack[top++] = { c1, t1 };
+		}
+	}
+	t_ = _tmax;
+	return ret;
+}
+
+} // namespace frm
+
+#endif // frm_AabbTree_h
@@ -5,6 +5,7 @@
 #include <frm/Framebuffer.h>
 #include <frm/GlContext.h>
 #include <frm/Input.h>
+#include <frm/JobSystem.h>
 #include <frm/Log.h>
 #include <frm/Mesh.h>
 #include <frm/Profiler.h>
@@ -94,6 +95,8 @@ bool AppSample::init(const apt::ArgList& _args)
  	m_propsPath.setf("%s.json", (const char*)m_name);
 	readProps((const char*)m_propsPath);
 
+	JobSystem::Init(*m_props.findProperty("JobWorkerCount")->asInt());
+
 	ivec2 windowSize     = *m_props.findProperty("WindowSize")->asInt2();
 	m_window             = Window::Create(windowSize.x, windowSize.y, (const char*)m_name);
 	m_windowSize         = ivec2(m_window->getWidth(), m_window->getHeight());
@@ -183,12 +186,15 @@ void AppSample::shutdown()
 	
 	writeProps((const char*)m_propsPath);
 
+	JobSystem::Shutdown();
+
 	App::shutdown();
 }
 
 bool AppSample::update()
 {
 	App::update();
+	JobSystem::NextFrame();
 
 	PROFILER_MARKER_CPU("#AppSample::update");
 
@@ -310,6 +316,7 @@ AppSample::AppSample(const char* _name)
 	propGroupAppSample.addBool ("ShowProfiler",          false,                                               &m_showProfilerViewer);
 	propGroupAppSample.addBool ("ShowTextureViewer",     false,                                               &m_showTextureViewer);
 	propGroupAppSample.addBool ("ShowShaderViewer",      false,                                               &m_showShaderViewer);
+	propGroupAppSample.addInt  ("JobWorkerCount",        -1,             -1,     63,                          nullptr); // -1 = hardware thread count - 1
 
 	PropertyGroup& propGroupFont = m_props.addGroup("Font");
 	propGroupFont.addPath      ("Font",                  "",                                                  nullptr);
@@ -0,0 +1,216 @@
+#include <frm/Bvh.h>
+
+#include <EASTL/algorithm.h>
+
+using namespace frm;
+using namespace apt;
+
+static const int kBinCount = 16;
+
+static float SurfaceArea(const vec3& _min, const vec3& _max)
+{
+	vec3 e = _max - _min;
+	return 2.0f * (e.x * e.y + e.y * e.z + e.z * e.x);
+}
+
+/*******************************************************************************
+
+                                   Bvh
+
+*******************************************************************************/
+
+struct Bvh::BuildPrim
+{
+	vec3   m_min;
+	vec3   m_max;
+	vec3   m_centroid;
+	uint32 m_index;
+};
+
+void Bvh::build(const AlignedBox* _boxes, uint32 _count, uint32 _maxLeafSize)
+{
+	APT_ASSERT(_maxLeafSize > 0);
+	clear();
+	if (_count == 0) {
+		return;
+	}
+
+	m_boxes.assign(_boxes, _boxes + _count);
+	eastl::vector<BuildPrim> prims(_count);
+	for (uint32 i = 0; i < _count; ++i) {
+		prims[i].m_min      = _boxes[i].m_min;
+		prims[i].m_max      = _boxes[i].m_max;
+		prims[i].m_centroid = (_boxes[i].m_min + _boxes[i].m_max) * 0.5f;
+		prims[i].m_index    = i;
+	}
+	m_nodes.reserve(_count * 2 / _maxLeafSize + 1);
+	buildNode(prims.data(), 0, _count, _maxLeafSize, 0);
+
+	m_indices.resize(_count);
+	for (uint32 i = 0; i < _count; ++i) {
+		m_indices[i] = prims[i].m_index;
+	}
+}
+
+void Bvh::clear()
+{
+	m_nodes.clear();
+	m_indices.clear();
+	m_boxes.clear();
+	m_depth = 0;
+}
+
+bool Bvh::findClosest(const Ray& _ray, uint32& index_, float& t_, float _tmax) const
+{
+	vec3 invDirection = SafeInverse(_ray.m_direction);
+	return findClosest(_ray,
+		[&](uint32 _index, float& t_) {
+			return IntersectSlab(m_boxes[_index].m_min, m_boxes[_index].m_max, _ray.m_origin, invDirection, _tmax, t_);
+		},
+		index_, t_, _tmax
+		);
+}
+
+bool Bvh::findAny(const Ray& _ray, float _tmax) const
+{
+	vec3 invDirection = SafeInverse(_ray.m_direction);
+	return findAny(_ray,
+		[&](uint32 _index, float& t_) {
+			return IntersectSlab(m_boxes[_index].m_min, m_boxes[_index].m_max, _ray.m_origin, invDirection, _tmax, t_);
+		},
+		_tmax
+		);
+}
+
+void Bvh::findInside(const Frustum& _frustum, eastl::vector<uint32>& results_) const
+{
+	findInside(_frustum, [&](uint32 _index) { results_.push_back(_index); });
+}
+
+void Bvh::findIntersecting(const AlignedBox& _box, eastl::vector<uint32>& results_) const
+{
+	findIntersecting(_box, [&](uint32 _index) { results_.push_back(_index); });
+}
+
+// PRIVATE
+
+uint32 Bvh::buildNode(BuildPrim* _prims, uint32 _first, uint32 _count, uint32 _maxLeafSize, int _depth)
+{
+	uint32 ret = (uint32)m_nodes.size();
+	m_nodes.push_back();
+	m_depth = APT_MAX(m_depth, _depth);
+
+	vec3 bmin(FLT_MAX), bmax(-FLT_MAX);
+	vec3 cmin(FLT_MAX), cmax(-FLT_MAX);
+	for (uint32 i = _first, n = _first + _count; i < n; ++i) {
+		bmin = APT_MIN(bmin, _prims[i].m_min);
+		bmax = APT_MAX(bmax, _prims[i].m_max);
+		cmin = APT_MIN(cmin, _prims[i].m_centroid);
+		cmax = APT_MAX(cmax, _prims[i].m_centroid);
+	}
+	m_nodes[ret].m_min = bmin;
+	m_nodes[ret].m_max = bmax;
+
+ // the traversal stack size limits the depth, force a leaf if we get too deep
+	if (_count <= _maxLeafSize || _depth >= kMaxDepth - 2) {
+		m_nodes[ret].m_index = _first;
+		m_nodes[ret].m_count = _count;
+		return ret;
+	}
+
+ // bin centroids along each axis, evaluate the SAH at each bin boundary
+	int   bestAxis  = -1;
+	int   bestSplit = -1;
+	float bestCost  = FLT_MAX;
+	for (int axis = 0; axis < 3; ++axis) {
+		float extent = cmax[axis] - cmin[axis];
+		if (extent <= 0.0f) {
+			continue;
+		}
+		float binScale = (float)kBinCount / extent;
+
+		struct Bin { vec3 m_min, m_max; uint32 m_count; };
+		Bin bins[kBinCount];
+		for (auto& bin : bins) {
+			bin.m_min   = vec3(FLT_MAX);
+			bin.m_max   = vec3(-FLT_MAX);
+			bin.m_count = 0;
+		}
+		for (uint32 i = _first, n = _first + _count; i < n; ++i) {
+			int b = APT_MIN((int)((_prims[i].m_centroid[axis] - cmin[axis]) * binScale), kBinCount - 1);
+			bins[b].m_min = APT_MIN(bins[b].m_min, _prims[i].m_min);
+			bins[b].m_max = APT_MAX(bins[b].m_max, _prims[i].m_max);
+			++bins[b].m_count;
+		}
+
+	 // sweep from the right to get the area/count to the right of each split, then from the left to evaluate the cost
+		float  rightArea[kBinCount];
+		uint32 rightCount[kBinCount];
+		vec3   rmin(FLT_MAX), rmax(-FLT_MAX);
+		uint32 rcount = 0;
+		for (int b = kBinCount - 1; b > 0; --b) {
+			rmin = APT_MIN(rmin, bins[b].m_min);
+			rmax = APT_MAX(rmax, bins[b].m_max);
+			rcount += bins[b].m_count;
+			rightArea[b]  = rcount ? SurfaceArea(rmin, rmax) : 0.0f;
+			rightCount[b] = rcount;
+		}
+		vec3   lmin(FLT_MAX), lmax(-FLT_MAX);
+		uint32 lcount = 0;
+		for (int b = 0; b < kBinCount - 1; ++b) {
+			lmin = APT_MIN(lmin, bins[b].m_min);
+			lmax = APT_MAX(lmax, bins[b].m_max);
+			lcount += bins[b].m_count;
+			if (lcount == 0 || rightCount[b + 1] == 0) {
+				continue;
+			}
+			float cost = SurfaceArea(lmin, lmax) * (float)lcount + rightArea[b + 1] * (float)rightCount[b + 1];
+			if (cost < bestCost) {
+				bestCost  = cost;
+				bestAxis  = axis;
+				bestSplit = b;
+			}
+		}
+	}
+
+	uint32 mid;
+	if (bestAxis >= 0) {
+		float binScale = (float)kBinCount / (cmax[bestAxis] - cmin[bestAxis]);
+		float binMin   = cmin[bestAxis];
+		BuildPrim* pmid = eastl::partition(_prims + _first, _prims + _first + _count,
+			[=](const BuildPrim& _prim) {
+				int b = APT_MIN((int)((_prim.m_centroid[bestAxis] - binMin) * binScale), kBinCount - 1);
+				return b <= bestSplit;
+			});
+		mid = (uint32)(pmid - _prims);
+	} else {
+	 // all centroids coincide, split by count
+		mid = _first + _count / 2;
+	}
+	if (mid == _first || mid == _first + _count) {
+		mid = _first + _count / 2;
+	}
+
+	uint32 left = buildNode(_prims, _first, mid - _first, _maxLeafSize, _depth + 1);
+	APT_ASSERT(left == ret + 1);
+	APT_UNUSED(left);
+	uint32 right = buildNode(_prims, mid, _first + _count - mid, _maxLeafSize, _depth + 1);
+	m_nodes[ret].m_index = right;
+	m_nodes[ret].m_count = 0;
+	return ret;
+}
+
+vec3 Bvh::SafeInverse(const vec3& _v)
+{
+ // avoid inf * 0 = nan in the slab test for axis-aligned rays
+	const float kEpsilon = 1e-20f;
+	vec3 ret;
+	for (int i = 0; i < 3; ++i) {
+		float v = _v[i];
+		if (fabs(v) < kEpsilon) {
+			v = v < 0.0f ? -kEpsilon : kEpsilon;
+		}
+		ret[i] = 1.0f / v;
+	}
+	return ret;
+}
@@ -0,0 +1,260 @@
+#pragma once
+#ifndef frm_Bvh_h
+#define frm_Bvh_h
+
+#include <frm/def.h>
+#include <frm/geom.h>
+#include <frm/math.h>
+
+#include <EASTL/vector.h>
+
+namespace frm {
+
+////////////////////////////////////////////////////////////////////////////////
+// Bvh
+// Static bounding volume hierarchy over a set of AlignedBox primitives, built
+// using a binned SAH. Nodes are stored in a flat array in depth-first order,
+// the left child of an interior node immediately follows its parent. Leaves
+// reference a contiguous range of m_indices, which is stored in leaf order.
+//
+// Queries return the index of the primitive in the array passed to build().
+// Ray queries optionally take a callback to test the primitive itself (e.g. a
+// triangle), the signature is bool(uint32 _index, float& t_). Other queries
+// call a callback for each result, signature void(uint32 _index).
+////////////////////////////////////////////////////////////////////////////////
+class Bvh
+{
+public:
+	struct Node
+	{
+		vec3   m_min;
+		uint32 m_index;  // leaf: first primitive, interior: right child
+		vec3   m_max;
+		uint32 m_count;  // leaf: primitive count, interior: 0
+
+		bool isLeaf() const { return m_count != 0; }
+	};
+
+	static const int kMaxDepth = 64;
+
+	Bvh() {}
+
+	// Build from _count boxes, leaves contain at most _maxLeafSize primitives.
+	void build(const AlignedBox* _boxes, uint32 _count, uint32 _maxLeafSize = 4);
+	void clear();
+
+	// Find the primitive box closest to the ray origin; t_ is the distance to the box.
+	bool findClosest(const Ray& _ray, uint32& index_, float& t_, float _tmax = FLT_MAX) const;
+	template <typename tIntersect>
+	bool findClosest(const Ray& _ray, tIntersect _intersect, uint32& index_, float& t_, float _tmax = FLT_MAX) const;
+
+	// Return true if any primitive is hit within _tmax (early out on the first hit).
+	bool findAny(const Ray& _ray, float _tmax = FLT_MAX) const;
+	template <typename tIntersect>
+	bool findAny(const Ray& _ray, tIntersect _intersect, float _tmax = FLT_MAX) const;
+
+	// Find all primitives whose box is inside _frustum.
+	void findInside(const Frustum& _frustum, eastl::vector<uint32>& results_) const;
+	template <typename tCallback>
+	void findInside(const Frustum& _frustum, tCallback _callback) const;
+
+	// Find all primitives whose box intersects _box.
+	void findIntersecting(const AlignedBox& _box, eastl::vector<uint32>& results_) const;
+	template <typename tCallback>
+	void findIntersecting(const AlignedBox& _box, tCallback _callback) const;
+
+	AlignedBox  getBounds() const                 { return m_nodes.empty() ? AlignedBox(vec3(0.0f), vec3(0.0f)) : AlignedBox(m_nodes[0].m_min, m_nodes[0].m_max); }
+	uint32      getNodeCount() const              { return (uint32)m_nodes.size(); }
+	const Node& getNode(uint32 _i) const          { APT_ASSERT(_i < getNodeCount()); return m_nodes[_i]; }
+	uint32      getPrimitiveCount() const         { return (uint32)m_indices.size(); }
+	int         getDepth() const                  { return m_depth; }
+
+private:
+	eastl::vector<Node>       m_nodes;
+	eastl::vector<uint32>     m_indices;  // original primitive index, in leaf order
+	eastl::vector<AlignedBox> m_boxes;    // primitive bounds, copied from build()
+	int                       m_depth = 0;
+
+	struct BuildPrim;
+	uint32 buildNode(BuildPrim* _prims, uint32 _first, uint32 _count, uint32 _maxLeafSize, int _depth);
+
+	// Slab test, return true if the ray overlaps [_min, _max] within [0, _tmax]. t0_ is the entry distance.
+	static bool IntersectSlab(const vec3& _min, const vec3& _max, const vec3& _origin, const vec3& _invDirection, float _tmax, float& t0_)
+	{
+		vec3 tn = (_min - _origin) * _invDirection;
+		vec3 tf = (_max - _origin) * _invDirection;
+		vec3 tmin = APT_MIN(tn, tf);
+		vec3 tmax = APT_MAX(tn, tf);
+		float t0 = APT_MAX(APT_MAX(tmin.x, tmin.y), APT_MAX(tmin.z, 0.0f));
+		float t1 = APT_MIN(APT_MIN(tmax.x, tmax.y), APT_MIN(tmax.z, _tmax));
+		t0_ = t0;
+		return t0 <= t1;
+	}
+
+	static bool Overlaps(const vec3& _min0, const vec3& _max0, const vec3& _min1, const vec3& _max1)
+	{
+		return _min0.x <= _max1.x && _max0.x >= _min1.x
+		    && _min0.y <= _max1.y && _max0.y >= _min1.y
+		    && _min0.z <= _max1.z && _max0.z >= _min1.z
+		    ;
+	}
+
+	static vec3 SafeInverse(const vec3& _v);
+
+}; // class Bvh
+
+
+template <typename tIntersect>
+inline bool Bvh::findClosest(const Ray& _ray, tIntersect _intersect, uint32& index_, float& t_, float _tmax) const
+{
+	if (m_nodes.empty()) {
+		return false;
+	}
+	vec3 invDirection = SafeInverse(_ray.m_direction);
+	float tnear;
+	if (!IntersectSlab(m_nodes[0].m_min, m_nodes[0].m_max, _ray.m_origin, invDirection, _tmax, tnear)) {
+		return false;
+	}
+
+	bool ret = false;
+	struct Entry { uint32 m_node; float m_t; };
+	Entry stack[kMaxDepth];
+	int top = 0;
+	stack[top++] = { 0, tnear };
+	while (top > 0) {
+		Entry e = stack[--top];
+		if (e.m_t > _tmax) {
+			continue; // found a closer hit since this was pushed
+		}
+		const Node& node = m_nodes[e.m_node];
+		if (node.isLeaf()) {
+			for (uint32 i = node.m_index, n = node.m_index + node.m_count; i < n; ++i) {
+				float t;
+				if (_intersect(m_indices[i], t) && t >= 0.0f && t < _tmax) {
+					_tmax  = t;
+					index_ = m_indices[i];
+					ret = true;
+				}
+			}
+			continue;
+		}
+	 // push the farthest child first so that the nearest is visited first
+		uint32 c0 = e.m_node + 1;
+		uint32 c1 = node.m_index;
+		float t0, t1;
+		bool hit0 = IntersectSlab(m_nodes[c0].m_min, m_nodes[c0].m_max, _ray.m_origin, invDirection, _tmax, t0);
+		bool hit1 = IntersectSlab(m_nodes[c1].m_min, m_nodes[c1].m_max, _ray.m_origin, invDirection, _tmax, t1);
+		if (hit0 && hit1) {
+			if (t1 < t0) {
+				eastl::swap(c0, c1);
+				eastl::swap(t0, t1);
+			}
+			APT_ASSERT(top + 2 <= kMaxDepth);
+			stack[top++] = { c1, t1 };
+			stack[top++] = { c0, t0 };
+		} else if (hit0) {
+			stack[top++] = { c0, t0 };
+		} else if (hit1) {
+			stack[top++] = { c1, t1 };
+		}
+	}
+	t_ = _tmax;
+	return ret;
+}
+
+template <typename tIntersect>
+inline bool Bvh::findAny(const Ray& _ray, tIntersect _intersect, float _tmax) const
+{
+	if (m_nodes.empty()) {
+		return false;
+	}
+	vec3 invDirection = SafeInverse(_ray.m_direction);
+	uint32 stack[kMaxDepth];
+	int top = 0;
+	stack[top++] = 0;
+	while (top > 0) {
+		const Node& node = m_nodes[stack[--top]];
+		float t;
+		if (!IntersectSlab(node.m_min, node.m_max, _ray.m_origin, invDirection, _tmax, t)) {
+			continue;
+		}
+		if (node.isLeaf()) {
+			for (uint32 i = node.m_index, n = node.m_index + node.m_count; i < n; ++i) {
+				if (_intersect(m_indices[i], t) && t >= 0.0f && t < _tmax) {
+					return true;
+				}
+			}
+			continue;
+		}
+		APT_ASSERT(top + 2 <= kMaxDepth);
+		stack[top++] = node.m_index;
+		stack[top++] = (uint32)(&node - m_nodes.data()) + 1;
+	}
+	return false;
+}
+
+template <typename tCallback>
+inline void Bvh::findInside(const Frustum& _frustum, tCallback _callback) const
+{
+	if (m_nodes.empty()) {
+		return;
+	}
+ // the plane mask tracks which planes still need testing, once a node is fully inside a plane its children are too
+	struct Entry { uint32 m_node; uint32 m_planeMask; };
+	Entry stack[kMaxDepth];
+	int top = 0;
+	stack[top++] = { 0, (1u << Frustum::Plane_Count) - 1 };
+	while (top > 0) {
+		Entry e = stack[--top];
+		const Node& node = m_nodes[e.m_node];
+		if (!_frustum.inside(AlignedBox(node.m_min, node.m_max), e.m_planeMask)) {
+			continue;
+		}
+		if (node.isLeaf()) {
+			for (uint32 i = node.m_index, n = node.m_index + node.m_count; i < n; ++i) {
+				uint32 planeMask = e.m_planeMask;
+				if (planeMask == 0 || _frustum.inside(m_boxes[m_indices[i]], planeMask)) {
+					_callback(m_indices[i]);
+				}
+			}
+			continue;
+		}
+		APT_ASSERT(top + 2 <= kMaxDepth);
+		stack[top++] = { node.m_index, e.m_planeMask };
+		stack[top++] = { e.m_node + 1, e.m_planeMask };
+	}
+}
+
+template <typename tCallback>
+inline void Bvh::findIntersecting(const AlignedBox& _box, tCallback _callback) const
+{
+	if (m_nodes.empty()) {
+		return;
+	}
+	uint32 stack[kMaxDepth];
+	int top = 0;
+	stack[top++] = 0;
+	while (top > 0) {
+		uint32 nodeIndex = stack[--top];
+		const Node& node = m_nodes[nodeIndex];
+		if (!Overlaps(_box.m_min, _box.m_max, node.m_min, node.m_max)) {
+			continue;
+		}
+		if (node.isLeaf()) {
+			for (uint32 i = node.m_index, n = node.m_index + node.m_count; i < n; ++i) {
+				const AlignedBox& box = m_boxes[m_indices[i]];
+				if (Overlaps(_box.m_min, _box.m_max, box.m_min, box.m_max)) {
+					_callback(m_indices[i]);
+				}
+			}
+			continue;
+		}
+		APT_ASSERT(top + 2 <= kMaxDepth);
+		stack[top++] = node.m_index;
+		stack[top++] = nodeIndex + 1;
+	}
+}
+
+} // namespace frm
+
+#endif // frm_Bvh_h
@@ -42,11 +42,17 @@ void GlContext::draw(GLsizei _instances)
 	const MeshData::Submesh& submesh = m_currentMesh->getSubmesh(m_currentSubmesh);
 
 	if (m_currentMesh->getIndexBufferHandle() != 0) {
+		uint indexOffset = submesh.m_indexOffset;
+		uint indexCount  = submesh.m_indexCount;
+		if (m_currentLod > 0 && m_currentLod < (int)submesh.m_lodCount) {
+			indexOffset = submesh.m_lods[m_currentLod].m_indexOffset;
+			indexCount  = submesh.m_lods[m_currentLod].m_indexCount;
+		}
 		glAssert(glDrawElementsInstanced(
 			m_currentMesh->getPrimitive(), 
-			(GLsizei)submesh.m_indexCount, 
+			(GLsizei)indexCount, 
 			m_currentMesh->getIndexDataType(), 
-			(GLvoid*)submesh.m_indexOffset, 
+			(GLvoid*)indexOffset, 
 			_instances
 			));
 	} else {
@@ -318,10 +324,11 @@ void GlContext::setUniformArray<mat4>(const char* _name, const mat4* _val, GLsiz
 }
 
 
-void GlContext::setMesh(const Mesh* _mesh, int _submeshId)
+void GlContext::setMesh(const Mesh* _mesh, int _submeshId, int _lod)
 {
 	APT_ASSERT(_submeshId < _mesh->getSubmeshCount());
 	m_currentSubmesh = _submeshId;
+	m_currentLod = _lod;
 	if (_mesh == m_currentMesh) {
 		return;
 	}
@@ -496,6 +503,7 @@ GlContext::GlContext()
 	, m_currentFramebuffer(nullptr)
 	, m_currentShader(nullptr)
 	, m_currentMesh(nullptr)
+	, m_currentLod(0)
 	, m_ndcQuadMesh(nullptr)
 {
 }
@@ -113,7 +113,8 @@ public:
 
  // MESH
 
-	void setMesh(const Mesh* _mesh, int _submeshId = 0);
+	// Set the current mesh/submesh. _lod is ignored if the submesh has fewer LODs (see MeshData::createLods()).
+	void setMesh(const Mesh* _mesh, int _submeshId = 0, int _lod = 0);
 	const Mesh* getMesh() { return m_currentMesh; }
 
  // BUFFER
@@ -167,6 +168,7 @@ private:
 	const Shader*       m_currentShader;
 	const Mesh*         m_currentMesh;
 	int                 m_currentSubmesh;
+	int                 m_currentLod;
 
 	// Tracking state for all targets is redundant as only a subset use an indexed binding model
 	static const int    kBufferSlotCount  = 16;
@@ -0,0 +1,345 @@
+#include <frm/JobSystem.h>
+
+#include <frm/Profiler.h>
+
+#include <apt/log.h>
+#include <apt/String.h>
+#include <apt/Time.h>
+
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+using namespace frm;
+using namespace apt;
+
+/*******************************************************************************
+
+                                  JobSystem
+
+*******************************************************************************/
+
+namespace {
+
+struct Job
+{
+	JobSystem::JobFunc*  m_func;
+	void*                m_data;
+	uint32               m_begin;
+	uint32               m_end;
+	uint32               m_grainSize;
+	JobSystem::Counter*  m_counter;
+	JobSystem::Counter*  m_dependency;
+	const char*          m_name;
+};
+
+// Max jobs in each thread's deque (must be a power of 2). If the deque is full, PushJob() executes the job
+// immediately and Execute() stops splitting.
+static const sint64 kMaxJobsPerThread = 4096;
+
+// Chase-Lev work stealing deque, see "Correct and Efficient Work-Stealing for Weak Memory Models" (Le et al., 2013).
+// Jobs are stored by value; a thief may read a slot which is concurrently overwritten by the owner only if top has
+// already moved, in which case the CAS fails and the copy is discarded.
+// push()/pop() may only be called by the owning thread, steal() by any thread.
+class JobDeque
+{
+	std::atomic<sint64> m_top;
+	std::atomic<sint64> m_bottom;
+	Job                 m_jobs[kMaxJobsPerThread];
+
+public:
+	JobDeque()
+		: m_top(0)
+		, m_bottom(0)
+	{
+	}
+
+	// Thieves only remove jobs, hence if this returns false when called by the owner push() will succeed.
+	bool isFull() const
+	{
+		return m_bottom.load(std::memory_order_relaxed) - m_top.load(std::memory_order_acquire) >= kMaxJobsPerThread;
+	}
+
+	void push(const Job& _job)
+	{
+		sint64 b = m_bottom.load(std::memory_order_relaxed);
+		APT_ASSERT(b - m_top.load(std::memory_order_acquire) < kMaxJobsPerThread); // deque full, check isFull() first
+		m_jobs[b & (kMaxJobsPerThread - 1)] = _job;
+		m_bottom.store(b + 1, std::memory_order_release);
+	}
+
+	bool pop(Job& job_)
+	{
+		sint64 b = m_bottom.load(std::memory_order_relaxed) - 1;
+		m_bottom.store(b, std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+		sint64 t = m_top.load(std::memory_order_relaxed);
+		if (t > b) {
+		 // empty
+			m_bottom.store(b + 1, std::memory_order_relaxed);
+			return false;
+		}
+		job_ = m_jobs[b & (kMaxJobsPerThread - 1)];
+		if (t == b) {
+		 // last job, race against steal()
+			bool ret = m_top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed);
+			m_bottom.store(b + 1, std::memory_order_relaxed);
+			return ret;
+		}
+		return true;
+	}
+
+	bool steal(Job& job_)
+	{
+		sint64 t = m_top.load(std::memory_order_acquire);
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+		sint64 b = m_bottom.load(std::memory_order_acquire);
+		if (t >= b) {
+			return false;
+		}
+		job_ = m_jobs[t & (kMaxJobsPerThread - 1)];
+		return m_top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed); // false if we lost the race to another thief or pop()
+	}
+};
+
+struct ThreadData
+{
+	JobDeque             m_deque;
+	uint32               m_rand = 0;  // xorshift state for choosing a victim
+	std::thread          m_thread;
+	std::atomic<uint64>  m_busyTicks; // since the last NextFrame()
+	std::atomic<uint32>  m_jobCount;
+
+	ThreadData()
+		: m_busyTicks(0)
+		, m_jobCount(0)
+	{
+	}
+};
+
+static const int                 kMaxThreads    = 64;
+static ThreadData*               s_threads      = nullptr;
+static int                       s_threadCount  = 0;
+static std::atomic<bool>         s_quit(false);
+static std::atomic<int>          s_pendingCount(0);  // approximate number of jobs waiting in the deques
+static std::atomic<int>          s_sleepingCount(0); // number of workers waiting on s_sleepCondition
+static std::mutex                s_sleepMutex;
+static std::condition_variable   s_sleepCondition;
+static APT_THREAD_LOCAL int      s_threadIndex  = -1;
+
+// Profiler value names must persist.
+static String<32>                s_busyValueNames[kMaxThreads];
+static String<32>                s_countValueNames[kMaxThreads];
+
+void Execute(ThreadData& _thread_, Job& _job);
+
+void PushJob(ThreadData& _thread_, const Job& _job)
+{
+	if (_job.m_counter) {
+		_job.m_counter->m_value.fetch_add(1, std::memory_order_relaxed);
+	}
+	if (_thread_.m_deque.isFull()) {
+	 // execute immediately, Execute() doesn't split while the deque is full
+		Job job = _job;
+		Execute(_thread_, job);
+		return;
+	}
+	_thread_.m_deque.push(_job);
+
+ // wake a sleeping worker; s_pendingCount/s_sleepingCount are seq_cst such that either we see the sleeping worker or
+ // it sees the pending job before it waits
+	s_pendingCount.fetch_add(1);
+	if (s_sleepingCount.load() > 0) {
+	 // lock such that the notification can't arrive between the worker checking the predicate and blocking
+		{ std::lock_guard<std::mutex> lock(s_sleepMutex); }
+		s_sleepCondition.notify_one();
+	}
+}
+
+bool GetJob(ThreadData& _thread_, Job& job_)
+{
+	bool ret = _thread_.m_deque.pop(job_);
+	if (!ret) {
+	 // steal, starting from a random victim
+		_thread_.m_rand ^= _thread_.m_rand << 13;
+		_thread_.m_rand ^= _thread_.m_rand >> 17;
+		_thread_.m_rand ^= _thread_.m_rand << 5;
+		int victim = (int)(_thread_.m_rand % (uint32)s_threadCount);
+		for (int i = 0; i < s_threadCount && !ret; ++i, victim = (victim + 1) % s_threadCount) {
+			if (&s_threads[victim] != &_thread_) {
+				ret = s_threads[victim].m_deque.steal(job_);
+			}
+		}
+	}
+	if (ret) {
+		s_pendingCount.fetch_sub(1, std::memory_order_relaxed);
+	}
+	return ret;
+}
+
+void Execute(ThreadData& _thread_, Job& _job)
+{
+	if (_job.m_dependency) {
+		JobSystem::Wait(_job.m_dependency);
+	}
+
+	PROFILER_MARKER_CPU(_job.m_name);
+	uint64 startTicks = Time::GetTimestamp().getRaw();
+
+ // split the range, push the upper half for other threads to steal
+	while (_job.m_end - _job.m_begin > _job.m_grainSize && !_thread_.m_deque.isFull()) {
+		uint32 mid = _job.m_begin + (_job.m_end - _job.m_begin) / 2;
+		Job split = _job;
+		split.m_begin      = mid;
+		split.m_dependency = nullptr;
+		PushJob(_thread_, split);
+		_job.m_end = mid;
+	}
+	_job.m_func(_job.m_data, _job.m_begin, _job.m_end);
+
+	_thread_.m_busyTicks.fetch_add(Time::GetTimestamp().getRaw() - startTicks, std::memory_order_relaxed);
+	_thread_.m_jobCount.fetch_add(1, std::memory_order_relaxed);
+	if (_job.m_counter) {
+		_job.m_counter->m_value.fetch_sub(1, std::memory_order_release);
+	}
+}
+
+void WorkerMain(int _threadIndex)
+{
+	s_threadIndex = _threadIndex;
+	ThreadData& thread = s_threads[_threadIndex];
+	while (!s_quit.load(std::memory_order_relaxed)) {
+		Job job;
+		if (GetJob(thread, job)) {
+			Execute(thread, job);
+			continue;
+		}
+	 // sleep until more jobs are pushed, see PushJob()
+		std::unique_lock<std::mutex> lock(s_sleepMutex);
+		s_sleepingCount.fetch_add(1);
+		s_sleepCondition.wait(lock, [] {
+				return s_pendingCount.load() > 0 || s_quit.load(std::memory_order_relaxed);
+			});
+		s_sleepingCount.fetch_sub(1);
+	}
+}
+
+} // namespace
+
+// PUBLIC
+
+bool JobSystem::Init(int _workerCount)
+{
+	APT_ASSERT(s_threads == nullptr); // Init() called twice?
+	if (_workerCount < 0) {
+		_workerCount = APT_MAX((int)std::thread::hardware_concurrency() - 1, 0);
+	}
+	_workerCount = APT_MIN(_workerCount, kMaxThreads - 1);
+	s_threadCount = _workerCount + 1;
+	s_threads = new ThreadData[s_threadCount];
+	s_quit = false;
+	s_pendingCount = 0;
+	for (int i = 0; i < s_threadCount; ++i) {
+		ThreadData& thread = s_threads[i];
+		thread.m_rand = 0x9e3779b9u * (uint32)(i + 1);
+		s_busyValueNames[i].setf("#Job Thread %02d", i);
+		s_countValueNames[i].setf("#Job Thread %02d Count", i);
+	}
+
+	s_threadIndex = 0; // calling thread is the main thread
+	for (int i = 1; i < s_threadCount; ++i) {
+		s_threads[i].m_thread = std::thread(WorkerMain, i);
+	}
+
+	APT_LOG("JobSystem: %d worker threads", _workerCount);
+	return true;
+}
+
+void JobSystem::Shutdown()
+{
+	if (!s_threads) {
+		return;
+	}
+	{	std::lock_guard<std::mutex> lock(s_sleepMutex);
+		s_quit = true;
+	}
+	s_sleepCondition.notify_all();
+	for (int i = 1; i < s_threadCount; ++i) {
+		s_threads[i].m_thread.join();
+	}
+	delete[] s_threads;
+	s_threads = nullptr;
+	s_threadCount = 0;
+	s_threadIndex = -1;
+}
+
+int JobSystem::GetThreadCount()
+{
+	return s_threads ? s_threadCount : 1;
+}
+
+int JobSystem::GetThreadIndex()
+{
+	return s_threadIndex;
+}
+
+void JobSystem::Run(JobFunc* _func, void* _data, uint32 _count, uint32 _grainSize, Counter* _counter_, Counter* _dependency, const char* _name)
+{
+	APT_ASSERT(_func);
+	if (_count == 0) {
+		return;
+	}
+	Job job;
+	job.m_func       = _func;
+	job.m_data       = _data;
+	job.m_begin      = 0;
+	job.m_end        = _count;
+	job.m_grainSize  = APT_MAX(_grainSize, 1u);
+	job.m_counter    = _counter_;
+	job.m_dependency = _dependency;
+	job.m_name       = _name;
+
+	if (!s_threads) {
+	 // not initialized, execute immediately
+		if (_dependency) {
+			APT_ASSERT(_dependency->isDone());
+		}
+		_func(_data, 0, _count);
+		return;
+	}
+
+	APT_ASSERT(s_threadIndex >= 0); // only job system threads may push jobs
+	PushJob(s_threads[s_threadIndex], job);
+}
+
+void JobSystem::Wait(const Counter* _counter)
+{
+	if (!s_threads) {
+		return;
+	}
+	APT_ASSERT(s_threadIndex >= 0); // only job system threads may wait
+	ThreadData& thread = s_threads[s_threadIndex];
+	while (!_counter->isDone()) {
+		Job job;
+		if (GetJob(thread, job)) {
+			Execute(thread, job);
+		} else {
+			std::this_thread::yield();
+		}
+	}
+}
+
+void JobSystem::NextFrame()
+{
+	if (!s_threads) {
+		return;
+	}
+	APT_ASSERT(s_threadIndex == 0);
+	for (int i = 0; i < s_threadCount; ++i) {
+		ThreadData& thread = s_threads[i];
+		uint64 busyTicks = thread.m_busyTicks.exchange(0, std::memory_order_relaxed);
+		uint32 jobCount  = thread.m_jobCount.exchange(0, std::memory_order_relaxed);
+		PROFILER_VALUE_CPU((const char*)s_busyValueNames[i], Timestamp(busyTicks).asMilliseconds(), Profiler::kFormatTimeMs);
+		PROFILER_VALUE_CPU((const char*)s_countValueNames[i], jobCount, "%.0f");
+	}
+}
@@ -0,0 +1,98 @@
+#pragma once
+#ifndef frm_JobSystem_h
+#define frm_JobSystem_h
+
+#include <frm/def.h>
+
+#include <atomic>
+
+namespace frm {
+
+////////////////////////////////////////////////////////////////////////////////
+// JobSystem
+// Work stealing job scheduler. Each thread (the main thread plus N workers)
+// owns a lock-free Chase-Lev deque; jobs are pushed/popped at the bottom of
+// the owner's deque and stolen from the top by idle threads.
+//
+// A job calls a function for a range [0, count). Ranges larger than the
+// grain size are recursively split in half by the executing thread, pushing
+// the upper half for other threads to steal.
+//
+// Completion is tracked via Counters, which are incremented when a job is
+// pushed and decremented when it completes. Wait() executes pending jobs on
+// the calling thread until the counter reaches 0, hence it's safe to wait
+// from within a job. A job may also depend on a counter, in which case it
+// waits on it before running.
+//
+// Usage:
+//   JobSystem::ParallelFor(count, 64, [&](uint32 _begin, uint32 _end) { ... });
+//
+//   JobSystem::Counter counter;
+//   JobSystem::Run(Func, data, count, 64, &counter);
+//   JobSystem::Wait(&counter);
+//
+// Only threads created by the job system plus the thread which called Init()
+// may push jobs or call Wait(). If Init() was not called, jobs execute
+// immediately on the calling thread.
+//
+// Each job pushes a profiler marker on the thread which executes it, hence
+// jobs appear in a separate timeline lane per thread. Per-thread busy time and
+// job counts are also reported as values ("#Job*").
+////////////////////////////////////////////////////////////////////////////////
+class JobSystem
+{
+public:
+	// Job function, called for the sub-range [_begin, _end) of the job.
+	typedef void (JobFunc)(void* _data, uint32 _begin, uint32 _end);
+
+	struct Counter
+	{
+		std::atomic<uint32> m_value;
+
+		Counter(): m_value(0) {}
+		bool isDone() const { return m_value.load(std::memory_order_acquire) == 0; }
+	};
+
+	// Create _workerCount worker threads (-1 = hardware thread count - 1). The calling thread becomes the main thread.
+	static bool Init(int _workerCount = -1);
+	static void Shutdown();
+
+	// Number of threads which execute jobs (workers + main thread), 1 if not initialized.
+	static int  GetThreadCount();
+	// Index of the calling thread (main thread is 0), -1 if not a job system thread.
+	static int  GetThreadIndex();
+
+	// Push a job which calls _func for [0, _count), split into sub-ranges of at most _grainSize. If _dependency is
+	// not null the job waits for it to complete before running.
+	static void Run(JobFunc* _func, void* _data, uint32 _count, uint32 _grainSize, Counter* _counter_, Counter* _dependency = nullptr, const char* _name = "#Job");
+
+	// Execute jobs on the calling thread until _counter reaches 0.
+	static void Wait(const Counter* _counter);
+
+	// Call _func(_begin, _end) for sub-ranges of [0, _count) in parallel, return when all have completed.
+	template <typename tFunc>
+	static void ParallelFor(uint32 _count, uint32 _grainSize, const tFunc& _func, const char* _name = "#ParallelFor")
+	{
+		if (_count == 0) {
+			return;
+		}
+		Counter counter;
+		Run(&ParallelForThunk<tFunc>, (void*)&_func, _count, _grainSize, &counter, nullptr, _name);
+		Wait(&counter);
+	}
+
+	// Update the profiler values; call once per frame from the main thread.
+	static void NextFrame();
+
+private:
+	template <typename tFunc>
+	static void ParallelForThunk(void* _data, uint32 _begin, uint32 _end)
+	{
+		(*(const tFunc*)_data)(_begin, _end);
+	}
+
+}; // class JobSystem
+
+} // namespace frm
+
+#endif // frm_JobSystem_h
@@ -206,14 +206,14 @@ void Mesh::load(const MeshData& _data)
 	unload();
 	load(_data.m_desc);
 	m_path = _data.m_path;
-	m_submeshes = _data.m_submeshes;
 
 	if (_data.m_vertexData) {
 		setVertexData(_data.m_vertexData, _data.getVertexCount(), GL_STATIC_DRAW);
 	}
 	if (_data.m_indexData) {
-		setIndexData((DataType)_data.m_indexDataType, _data.m_indexData, _data.getIndexCount(), GL_STATIC_DRAW);
+		setIndexData((DataType)_data.m_indexDataType, _data.m_indexData, _data.getIndexDataCount(), GL_STATIC_DRAW);
 	}
+	m_submeshes = _data.m_submeshes; // after set*Data(), which overwrite the counts for submesh 0 (the index data may include LODs)
 	if (_data.m_bindPose) {
 		m_bindPose = new Skeleton;
 		*m_bindPose = *_data.m_bindPose;
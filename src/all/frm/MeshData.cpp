@@ -1,5 +1,7 @@
 #include <frm/MeshData.h>
 
+#include <frm/Bvh.h>
+
 #include <apt/log.h>
 #include <apt/hash.h>
 #include <apt/FileSystem.h>
@@ -41,6 +43,16 @@ static inline DataType GetIndexDataType(uint _vertexCount)
 	return DataType_Uint16;
 }
 
+static inline uint32 GetIndex(const char* _indexData, DataType _indexDataType, uint _i)
+{
+	switch (_indexDataType) {
+		case DataType_Uint8:  return ((const uint8*)_indexData)[_i];
+		case DataType_Uint16: return ((const uint16*)_indexData)[_i];
+		case DataType_Uint32: return ((const uint32*)_indexData)[_i];
+		default:              APT_ASSERT(false); return 0;
+	};
+}
+
 /*******************************************************************************
 
                                    VertexAttr
@@ -162,6 +174,7 @@ MeshData::Submesh::Submesh()
 	, m_vertexCount(0)
 	, m_vertexOffset(0)
 	, m_materialId(0)
+	, m_lodCount(0)
 {
 }
 
@@ -283,7 +296,9 @@ MeshData* MeshData::CreatePlane(
 	mesh.transform(_transform);
 	mesh.m_boundingBox.m_min = mesh.m_vertices.front().m_position;
 	mesh.m_boundingBox.m_max = mesh.m_vertices.back().m_position;
-	mesh.m_boundingSphere = Sphere(mesh.m_boundingBox);
+	mesh.m_boundingSphere = Sphere(&mesh.m_vertices[0].m_position, mesh.getVertexCount(), sizeof(MeshBuilder::Vertex));
+	mesh.m_orientedBox = OrientedBox(&mesh.m_vertices[0].m_position, mesh.getVertexCount(), sizeof(MeshBuilder::Vertex));
+	mesh.optimizeVertexCache();
 
 	return Create(_desc, mesh);
 }
@@ -309,6 +324,7 @@ MeshData* MeshData::CreateSphere(
 		mesh.generateTangents();
 	}
 	mesh.updateBounds();
+	mesh.optimizeVertexCache();
 	return Create(_desc, mesh);
 }
 
@@ -327,12 +343,18 @@ void frm::swap(MeshData& _a, MeshData& _b)
 	swap(_a.m_indexDataType,  _b.m_indexDataType);
 	swap(_a.m_submeshes,      _b.m_submeshes);
 	swap(_a.m_bindPose,       _b.m_bindPose);
+	swap(_a.m_triangleBvh,    _b.m_triangleBvh);
+	swap(_a.m_meshlets,       _b.m_meshlets);
+	swap(_a.m_meshletSpheres, _b.m_meshletSpheres);
 }
 
 void MeshData::setVertexData(const void* _src)
 {
 	APT_ASSERT(_src);
 	APT_ASSERT(m_vertexData);
+	releaseTriangleBvh();
+	releaseMeshlets();
+	releaseLods();
 	memcpy(m_vertexData, _src, m_desc.getVertexSize() * getVertexCount());
 }
 
@@ -342,6 +364,12 @@ void MeshData::setVertexData(VertexAttr::Semantic _semantic, DataType _srcType,
 	APT_ASSERT(m_vertexData);
 	APT_ASSERT(_srcCount <= 4);
 	
+	if (_semantic == VertexAttr::Semantic_Positions) {
+		releaseTriangleBvh();
+		releaseMeshlets();
+		releaseLods();
+	}
+
 	const VertexAttr* attr = m_desc.findVertexAttr(_semantic);
 	APT_ASSERT(attr);
 	APT_ASSERT(attr->getCount() == _srcCount); // \todo implement count conversion (trim or pad with 0s)
@@ -372,6 +400,9 @@ void MeshData::setIndexData(const void* _src)
 {
 	APT_ASSERT(_src);
 	APT_ASSERT(m_indexData);
+	releaseTriangleBvh();
+	releaseMeshlets();
+	releaseLods();
 	memcpy(m_indexData, _src, DataTypeSizeBytes(m_indexDataType) * getIndexCount());
 }
 
@@ -383,6 +414,9 @@ void MeshData::setIndexData(DataType _srcType, const void* _src)
 		setIndexData(_src);
 
 	} else {
+		releaseTriangleBvh();
+		releaseMeshlets();
+		releaseLods();
 		const char* src = (char*)_src;
 		char* dst = (char*)m_indexData;
 		for (auto i = 0; i < getIndexCount(); ++i) {
@@ -411,6 +445,9 @@ void MeshData::addSubmeshVertexData(const void* _src, uint _vertexCount)
 {
 	APT_ASSERT(!m_submeshes.empty());
 	APT_ASSERT(_src && _vertexCount > 0);
+	releaseTriangleBvh();
+	releaseMeshlets();
+	releaseLods();
 	uint vertexSize = m_desc.getVertexSize();
 	m_submeshes[0].m_vertexCount += _vertexCount;
 	m_vertexData = (char*)realloc(m_vertexData, vertexSize * m_submeshes[0].m_vertexCount);
@@ -422,6 +459,9 @@ void MeshData::addSubmeshIndexData(const void* _src, uint _indexCount)
 {
 	APT_ASSERT(!m_submeshes.empty());
 	APT_ASSERT(_src && _indexCount > 0);
+	releaseTriangleBvh();
+	releaseMeshlets();
+	releaseLods();
 	uint indexSize = DataTypeSizeBytes(m_indexDataType);
 	m_submeshes[0].m_indexCount += _indexCount;
 	m_indexData = (char*)realloc(m_indexData, indexSize * m_submeshes[0].m_indexCount);
@@ -465,12 +505,80 @@ void MeshData::setBindPose(const Skeleton& _skel)
 	*m_bindPose = _skel;
 }
 
+struct MeshData::TriangleBvh
+{
+	Bvh                 m_bvh;
+	eastl::vector<vec3> m_positions; // 3 per triangle
+};
+
+void MeshData::buildTriangleBvh() const
+{
+	if (m_triangleBvh) {
+		return;
+	}
+	APT_ASSERT(m_desc.getPrimitive() == MeshDesc::Primitive_Triangles);
+	const VertexAttr* posAttr = m_desc.findVertexAttr(VertexAttr::Semantic_Positions);
+	APT_ASSERT(posAttr); // no positions
+
+	eastl::vector<vec3> positions(getVertexCount(), vec3(0.0f));
+	const char* src = m_vertexData + posAttr->getOffset();
+	for (uint i = 0; i < getVertexCount(); ++i) {
+		DataTypeConvert(posAttr->getDataType(), DataType_Float32, src, &positions[i], APT_MIN((uint)posAttr->getCount(), 3u));
+		src += m_desc.getVertexSize();
+	}
+
+	m_triangleBvh = new TriangleBvh;
+	uint triangleCount = getIndexCount() / 3;
+	m_triangleBvh->m_positions.resize(triangleCount * 3);
+	eastl::vector<AlignedBox> boxes(triangleCount);
+	for (uint i = 0; i < triangleCount; ++i) {
+		vec3* tri = &m_triangleBvh->m_positions[i * 3];
+		for (uint j = 0; j < 3; ++j) {
+			uint32 index = GetIndex(m_indexData, m_indexDataType, i * 3 + j);
+			APT_ASSERT(index < getVertexCount());
+			tri[j] = positions[index];
+		}
+		boxes[i].m_min = min(tri[0], min(tri[1], tri[2]));
+		boxes[i].m_max = max(tri[0], max(tri[1], tri[2]));
+	}
+	m_triangleBvh->m_bvh.build(boxes.data(), (uint32)triangleCount);
+}
+
+const Bvh* MeshData::getTriangleBvh() const
+{
+	return m_triangleBvh ? &m_triangleBvh->m_bvh : nullptr;
+}
+
+bool frm::Intersect(const Ray& _ray, const MeshData& _mesh, MeshData::RayHit& hit_)
+{
+	_mesh.buildTriangleBvh();
+	const vec3* positions = _mesh.m_triangleBvh->m_positions.data();
+	uint32 triangle;
+	float t;
+	bool ret = _mesh.m_triangleBvh->m_bvh.findClosest(_ray, 
+		[positions, &_ray](uint32 _triangle, float& t_) {
+			const vec3* tri = positions + _triangle * 3;
+			float u, v;
+			return Intersect(_ray, tri[0], tri[1], tri[2], t_, u, v);
+		},
+		triangle, t
+		);
+	if (ret) {
+	 // re-test the closest triangle to get the barycentrics
+		const vec3* tri = positions + triangle * 3;
+		hit_.m_triangle = triangle;
+		Intersect(_ray, tri[0], tri[1], tri[2], hit_.m_t, hit_.m_barycentrics.x, hit_.m_barycentrics.y);
+	}
+	return ret;
+}
+
 // PRIVATE
 
 MeshData::MeshData()
 	: m_bindPose(nullptr)
 	, m_vertexData(nullptr)
 	, m_indexData(nullptr)
+	, m_triangleBvh(nullptr)
 {
 }
 
@@ -479,6 +587,7 @@ MeshData::MeshData(const MeshDesc& _desc)
 	, m_bindPose(nullptr)
 	, m_vertexData(nullptr)
 	, m_indexData(nullptr)
+	, m_triangleBvh(nullptr)
 {
 	m_submeshes.push_back(Submesh());
 }
@@ -488,6 +597,7 @@ MeshData::MeshData(const MeshDesc& _desc, const MeshBuilder& _meshBuilder)
 	, m_bindPose(nullptr)
 	, m_vertexData(nullptr)
 	, m_indexData(nullptr)
+	, m_triangleBvh(nullptr)
 {
 	const VertexAttr* positionsAttr   = m_desc.findVertexAttr(VertexAttr::Semantic_Positions);
 	const VertexAttr* texcoordsAttr   = m_desc.findVertexAttr(VertexAttr::Semantic_Texcoords);
@@ -530,6 +640,7 @@ MeshData::MeshData(const MeshDesc& _desc, const MeshBuilder& _meshBuilder)
 	m_submeshes.back().m_indexCount     = _meshBuilder.getIndexCount();
 	m_submeshes.back().m_boundingBox    = _meshBuilder.getBoundingBox();
 	m_submeshes.back().m_boundingSphere = _meshBuilder.getBoundingSphere();
+	m_submeshes.back().m_orientedBox    = _meshBuilder.getOrientedBox();
 
 	for (auto& submesh : _meshBuilder.m_submeshes) {
 		m_submeshes.push_back(submesh);
@@ -545,33 +656,56 @@ MeshData::~MeshData()
 	if (m_bindPose) {
 		delete m_bindPose;
 	}
+	releaseTriangleBvh();
 	free(m_vertexData);
 	free(m_indexData);
 }
 
+void MeshData::releaseTriangleBvh()
+{
+	delete m_triangleBvh;
+	m_triangleBvh = nullptr;
+}
+
+void MeshData::releaseMeshlets()
+{
+	m_meshlets.clear();
+	m_meshletSpheres.clear();
+}
+
+void MeshData::releaseLods()
+{
+	if (m_submeshes.empty() || m_submeshes[0].m_lodCount == 0) {
+		return;
+	}
+ // LOD indices are at the end of the index data
+	m_indexData = (char*)realloc(m_indexData, DataTypeSizeBytes(m_indexDataType) * getIndexCount());
+	for (auto& submesh : m_submeshes) {
+		submesh.m_lodCount = 0;
+	}
+}
+
 void MeshData::updateSubmeshBounds(Submesh& _submesh)
 {
 	const VertexAttr* posAttr = m_desc.findVertexAttr(VertexAttr::Semantic_Positions);
 	APT_ASSERT(posAttr); // no positions
 	
 	const char* data = m_vertexData + posAttr->getOffset() + _submesh.m_vertexOffset;
+	eastl::vector<vec3> positions(_submesh.m_vertexCount, vec3(0.0f));
 	_submesh.m_boundingBox.m_min = vec3(FLT_MAX);
 	_submesh.m_boundingBox.m_max = vec3(-FLT_MAX);
-	for (auto i = 0; i < _submesh.m_vertexCount; ++i) {
-		vec3 v;
-		for (auto j = 0; j < APT_MIN(posAttr->getCount(), (uint8)3); ++j) {
-			DataTypeConvert(
-				posAttr->getDataType(),
-				DataType_Float32,
-				data + j * DataTypeSizeBytes(posAttr->getDataType()) * j,
-				&v[j]
-				);
-		}
+	for (auto& v : positions) {
+		DataTypeConvert(posAttr->getDataType(), DataType_Float32, data, &v, APT_MIN((uint)posAttr->getCount(), 3u));
 		_submesh.m_boundingBox.m_min = min(_submesh.m_boundingBox.m_min, v);
 		_submesh.m_boundingBox.m_max = max(_submesh.m_boundingBox.m_max, v);
 		data += m_desc.getVertexSize();
 	}
-	_submesh.m_boundingSphere = Sphere(_submesh.m_boundingBox);
+	if (!positions.empty()) {
+		_submesh.m_boundingSphere = Sphere(positions.data(), (uint)positions.size());
+		_submesh.m_orientedBox    = OrientedBox(positions.data(), (uint)positions.size());
+	} else {
+		_submesh.m_boundingSphere = Sphere(_submesh.m_boundingBox);
+	}
 }
 
 /*******************************************************************************
@@ -695,7 +829,8 @@ void MeshBuilder::updateBounds()
 		m_boundingBox.m_min = min(m_boundingBox.m_min, vert->m_position);
 		m_boundingBox.m_max = max(m_boundingBox.m_max, vert->m_position);
 	}
-	m_boundingSphere = Sphere(m_boundingBox);
+	m_boundingSphere = Sphere(&m_vertices[0].m_position, getVertexCount(), sizeof(Vertex));
+	m_orientedBox = OrientedBox(&m_vertices[0].m_position, getVertexCount(), sizeof(Vertex));
 }
 
 uint32 MeshBuilder::addTriangle(uint32 _a, uint32 _b, uint32 _c)
@@ -810,5 +945,6 @@ void MeshBuilder::endSubmesh()
 		submesh.m_boundingBox.m_min = min(submesh.m_boundingBox.m_min, m_vertices[i].m_position);
 		submesh.m_boundingBox.m_max = max(submesh.m_boundingBox.m_max, m_vertices[i].m_position);
 	}
-	submesh.m_boundingSphere = Sphere(submesh.m_boundingBox);
+	submesh.m_boundingSphere = Sphere(&m_vertices[submesh.m_vertexOffset].m_position, submesh.m_vertexCount, sizeof(Vertex));
+	submesh.m_orientedBox = OrientedBox(&m_vertices[submesh.m_vertexOffset].m_position, submesh.m_vertexCount, sizeof(Vertex));
 }
@@ -148,6 +148,16 @@ class MeshData: private apt::non_copyable<MeshData>
 	friend class Mesh;
 public:
 
+	static const int kMaxLods = 8;
+
+	// Index range of a simplified version of a submesh, see createLods().
+	struct Lod
+	{
+		uint       m_indexOffset;  // bytes
+		uint       m_indexCount;
+		float      m_error;        // max deviation from LOD 0, relative to the submesh bounding sphere radius
+	};
+
 	struct Submesh
 	{ 
 		uint       m_indexOffset;  // bytes
@@ -155,12 +165,50 @@ public:
 		uint       m_vertexOffset; // bytes
 		uint       m_vertexCount;
 		uint       m_materialId;
-		AlignedBox m_boundingBox;
-		Sphere     m_boundingSphere;
+		AlignedBox  m_boundingBox;
+		Sphere      m_boundingSphere;
+		OrientedBox m_orientedBox;
+		uint       m_lodCount;     // 0 if no LODs were generated, else the LOD count including LOD 0
+		Lod        m_lods[kMaxLods]; // m_lods[0] is the submesh's own index range
 
 		Submesh();
 	};
 
+	// Result of Intersect(const Ray&, const MeshData&, RayHit&).
+	struct RayHit
+	{
+		uint32     m_triangle;     // first index is at m_triangle * 3
+		float      m_t;            // distance along the ray
+		vec2       m_barycentrics; // relative to the 2nd/3rd triangle vertices, as per Intersect(const Ray&, const vec3&, const vec3&, const vec3&, ...)
+	};
+
+	// Cluster of adjacent triangles within a submesh, see buildMeshlets(). A meshlet is back facing from eye position
+	// e if dot(normalize(m_coneApex - e), m_coneAxis) >= m_coneCutoff.
+	struct Meshlet
+	{
+		uint32     m_indexOffset;  // first index (not bytes), the meshlet's indices are contiguous
+		uint32     m_indexCount;
+		uint32     m_vertexCount;  // unique vertices
+		uint32     m_submesh;
+		Sphere     m_boundingSphere;
+		vec3       m_coneApex;
+		vec3       m_coneAxis;     // 0 if the meshlet can't be back face culled
+		float      m_coneCutoff;   // sin of the normal cone half angle
+	};
+	static const uint32 kMaxMeshletVertices  = 64;
+	static const uint32 kMaxMeshletTriangles = 124;
+
+	// Indexed draw command, see cullMeshlets(). The layout matches the GL DrawElementsIndirectCommand such that an
+	// array of commands can be copied directly to an indirect draw buffer.
+	struct DrawCommand
+	{
+		uint32     m_indexCount;
+		uint32     m_instanceCount;
+		uint32     m_firstIndex;
+		uint32     m_baseVertex;
+		uint32     m_baseInstance;
+	};
+
 	static MeshData* Create(const char* _path);
 	static MeshData* Create(
 		const MeshDesc& _desc, 
@@ -214,10 +262,47 @@ public:
 	uint            getIndexCount() const         { return m_submeshes[0].m_indexCount; }
 	const void*     getIndexData() const          { return m_indexData; }
 	apt::DataType   getIndexDataType() const      { return m_indexDataType; }
+	uint            getSubmeshCount() const       { return (uint)m_submeshes.size(); }
+	const Submesh&  getSubmesh(uint _i) const     { APT_ASSERT(_i < getSubmeshCount()); return m_submeshes[_i]; }
 
 	const Skeleton* getBindPose() const                { return m_bindPose; }
 	void            setBindPose(const Skeleton& _skel);
 
+	// Build the triangle BVH used by Intersect(). This happens automatically on the first call to Intersect(), the BVH is
+	// released if the vertex or index data are modified.
+	// \note Not thread safe.
+	void            buildTriangleBvh() const;
+	const Bvh*      getTriangleBvh() const;
+
+	// Split each submesh into meshlets and reorder the triangles within each submesh such that the indices of each
+	// meshlet are contiguous (submesh ranges remain valid). Create any Mesh from the MeshData after calling this. The
+	// meshlets are released if the vertex or index data are modified.
+	void            buildMeshlets();
+	uint32          getMeshletCount() const             { return (uint32)m_meshlets.size(); }
+	const Meshlet&  getMeshlet(uint32 _i) const         { APT_ASSERT(_i < getMeshletCount()); return m_meshlets[_i]; }
+	// Generate up to _count LODs per submesh (including LOD 0) via MeshBuilder::Simplify(), each with _ratio times
+	// the triangles of the previous LOD. LOD indices are appended to the index data and share the vertex data; LOD i of
+	// submesh 0 covers LOD i of all submeshes. Fewer LODs are generated if the simplifier can't reduce the triangle
+	// count further. The LODs are released if the vertex or index data are modified.
+	void            createLods(int _count, float _ratio = 0.5f);
+	// Index count including any LOD indices.
+	uint            getIndexDataCount() const;
+	// Select the lowest detail LOD of _submesh whose error projected by _camera is within _maxError, as a fraction of
+	// the viewport height (e.g. 1/1080 for 1 pixel at 1080p). _worldSphere is the submesh bounding sphere in world space.
+	static int      SelectLod(const Submesh& _submesh, const Sphere& _worldSphere, const Camera& _camera, float _maxError);
+
+	// Frustum and back face cull the meshlets against _camera with the mesh transformed by _world (which should have
+	// uniform scale). Append a draw command for each visible meshlet to out_ (m_baseInstance is the meshlet index),
+	// return the number of commands appended.
+	uint32          cullMeshlets(const Camera& _camera, eastl::vector<DrawCommand>& out_, const mat4& _world = identity) const;
+
+	// Split the triangles in _indices_ into meshlets of at most kMaxMeshletVertices/kMaxMeshletTriangles, appended to
+	// meshlets_. Meshlets are grown across shared vertices, _indices_ is reordered such that each meshlet is contiguous
+	// and m_indexOffset is relative to _indices_. _positions is indexed by _indices_.
+	static void     BuildMeshlets(uint32* _indices_, uint32 _indexCount, const vec3* _positions, eastl::vector<Meshlet>& meshlets_);
+
+	friend bool Intersect(const Ray& _ray, const MeshData& _mesh, RayHit& hit_);
+
 protected:
 	apt::String<32> m_path; // empty if not from a file
 	Skeleton*       m_bindPose;
@@ -228,6 +313,16 @@ protected:
 
 	eastl::vector<Submesh> m_submeshes;
 
+	struct TriangleBvh;
+	mutable TriangleBvh* m_triangleBvh; // built on demand by buildTriangleBvh()
+	void releaseTriangleBvh();
+
+	eastl::vector<Meshlet> m_meshlets;       // built by buildMeshlets()
+	eastl::vector<float>   m_meshletSpheres; // meshlet bounding spheres as 4 arrays (x, y, z, radius) for Frustum::cull()
+	void releaseMeshlets();
+
+	void releaseLods();
+
 	// \todo 
 	void beginSubmesh(uint _materialId);
 	void addSubmeshVertexData(const void* _src, uint _vertexCount);
@@ -247,6 +342,9 @@ protected:
 
 }; // class MeshData
 
+// Find the closest triangle hit by _ray (triangles mode only). The first call builds the triangle BVH.
+bool Intersect(const Ray& _ray, const MeshData& _mesh, MeshData::RayHit& hit_);
+
 
 ////////////////////////////////////////////////////////////////////////////////
 // MeshBuilder
@@ -294,6 +392,63 @@ public:
 	void               generateTangents();
 	void               updateBounds();
 
+	// Reorder triangles within each submesh (or the whole mesh if there are no submeshes) to improve the post-transform
+	// vertex cache efficiency (Forsyth's algorithm). Applied by the file loaders and MeshData::CreatePlane()/CreateSphere();
+	// MeshData::Create(_desc, _meshBuilder) copies the index order unchanged. The input order is kept if it simulates
+	// better, e.g. for strip ordered meshes.
+	void               optimizeVertexCache();
+	static void        OptimizeVertexCache(uint32* _indices_, uint32 _indexCount);
+
+	struct VertexCacheStats
+	{
+		float m_acmr; // Average cache miss ratio (transformed vertices per triangle), in [0.5, 3].
+		float m_atvr; // Average transformed vertex ratio (transformed vertices per referenced vertex), 1 is optimal.
+	};
+	// Simulate a FIFO post-transform vertex cache with _cacheSize entries.
+	VertexCacheStats   analyzeVertexCache(uint32 _cacheSize = 16) const;
+	static VertexCacheStats AnalyzeVertexCache(const uint32* _indices, uint32 _indexCount, uint32 _cacheSize = 16);
+
+	// Reorder triangles within each submesh to reduce overdraw. The current order (call optimizeVertexCache() first)
+	// is split into clusters which are sorted such that outward facing clusters are drawn first. _threshold is the
+	// ACMR increase allowed to create more clusters, e.g. 1.05 allows a 5% increase.
+	void               optimizeOverdraw(float _threshold = 1.05f);
+	// Rasterize the mesh from 6 axis-aligned directions with back faces culled, return the average number of times
+	// each covered pixel is shaded (1 is optimal).
+	float              analyzeOverdraw() const;
+
+	// Renumber vertices in the order of first use by the triangles such that the vertex fetch is sequential. Vertices
+	// are reordered within each submesh's vertex range (hence the submesh ranges remain valid), unreferenced vertices
+	// are moved to the end of the range.
+	void               optimizeVertexFetch();
+
+	struct VertexFetchStats
+	{
+		float m_bytesPerVertex; // Bytes fetched per referenced vertex.
+		float m_overfetch;      // Bytes fetched relative to the size of the referenced vertices, 1 is optimal.
+	};
+	// Simulate the vertex fetch for vertices of _vertexSize bytes which miss a 16 entry post-transform cache, via a
+	// direct mapped 16kb cache of 64 byte lines.
+	VertexFetchStats   analyzeVertexFetch(uint32 _vertexSize) const;
+	static VertexFetchStats AnalyzeVertexFetch(const uint32* _indices, uint32 _indexCount, uint32 _vertexSize);
+
+	// Merge duplicate vertices within each submesh's vertex range and remap the triangles, via a hash grid (O(n)).
+	// Vertices are duplicates if each component of the position and of the attributes in _attributeMask (bits are
+	// 1 << VertexAttr::Semantic_*) differ by at most _epsilon; bone indices must match exactly. The first vertex of
+	// each duplicate set is kept. Only include attributes which are initialized in _attributeMask. Applied by
+	// MeshData::ReadObj() and MeshData::ReadMd5().
+	void               weld(float _epsilon = 0.0f, uint32 _attributeMask = ~0u);
+
+	// Reduce the triangle count of each submesh (or the whole mesh) to _targetRatio times the current count via quadric
+	// edge collapse, or until the error would exceed _maxError (relative to the bounding sphere radius). Vertices are
+	// not modified (unreferenced vertices remain), submesh index ranges are updated. Return the max error.
+	float              simplify(float _targetRatio, float _maxError = 1.0f);
+	// Simplify the triangles in _indices_ in place, return the new index count. Vertices are collapsed onto their
+	// neighbors (they never move), hence the result can share _vertices with the input. Collapse costs combine the
+	// position quadric error with the normal/texcoord difference; mesh borders and attribute seams only collapse along
+	// the border/seam. Stop at _targetIndexCount or when the error would exceed _maxError (in mesh units), the error
+	// reached is written to error_. Only the range of vertices referenced by _indices_ is processed.
+	static uint32      Simplify(uint32* _indices_, uint32 _indexCount, const Vertex* _vertices, uint32 _vertexCount, uint32 _targetIndexCount, float _maxError, float* error_ = nullptr);
+
 	uint32             addTriangle(uint32 _a, uint32 _b, uint32 _c);
 	uint32             addTriangle(const Triangle& _triangle);
 	uint32             addVertex(const Vertex& _vertex);
@@ -315,9 +470,10 @@ public:
 	uint32             getTriangleCount() const     { return (uint32)m_triangles.size(); }
 	uint32             getIndexCount() const        { return (uint32)m_triangles.size() * 3; }
 	MeshData::Submesh& getSubmesh(uint32 _i)        { APT_ASSERT(_i < getSubmeshCount()); return m_submeshes[_i]; }
-	uint32             getSubmeshCount() const      { (uint32)m_submeshes.size(); }
+	uint32             getSubmeshCount() const      { return (uint32)m_submeshes.size(); }
 	const AlignedBox&  getBoundingBox() const       { return m_boundingBox; }
 	const Sphere&      getBoundingSphere() const    { return m_boundingSphere; }
+	const OrientedBox& getOrientedBox() const       { return m_orientedBox; }
 
 
 private:
@@ -325,8 +481,9 @@ private:
 	eastl::vector<Triangle>          m_triangles;
 	eastl::vector<MeshData::Submesh> m_submeshes;  // vertex/index offsets are not bytes here
 
-	AlignedBox m_boundingBox;
-	Sphere     m_boundingSphere;
+	AlignedBox  m_boundingBox;
+	Sphere      m_boundingSphere;
+	OrientedBox m_orientedBox;
 
 }; // class MeshBuilder
 
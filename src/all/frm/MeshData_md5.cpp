@@ -111,9 +111,16 @@ bool MeshData::ReadMd5(MeshData& mesh_, const char* _srcData, uint _srcDataSize)
 		tmpMesh.endSubmesh();
 	}
 
+	tmpMesh.weld(0.0f,
+		(1 << VertexAttr::Semantic_Positions)   |
+		(1 << VertexAttr::Semantic_Texcoords)   |
+		(1 << VertexAttr::Semantic_BoneWeights) |
+		(1 << VertexAttr::Semantic_BoneIndices)
+		);
 	tmpMesh.generateNormals();
 	tmpMesh.generateTangents();
 	tmpMesh.updateBounds();
+	tmpMesh.optimizeVertexCache();
 
  // \todo use _mesh desc as a conversion target
 	if (ret) {
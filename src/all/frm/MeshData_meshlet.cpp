@@ -0,0 +1,299 @@
+#include <frm/MeshData.h>
+
+#include <frm/Camera.h>
+
+#include <EASTL/vector.h>
+
+#include <cmath>
+#include <cstring>
+
+using namespace frm;
+using namespace apt;
+
+/*******************************************************************************
+
+                                    Meshlets
+
+  Meshlets are grown greedily from a seed triangle (the first remaining in the
+  input order). The next triangle is the one adjacent to the meshlet which
+  shares the most vertices with it, ties are broken by the triangle normal
+  closest to the meshlet's average normal which keeps the normal cones narrow.
+  If no adjacent triangle fits, the next triangle in the input order is added
+  if it fits (the input order is assumed to be vertex cache optimized and
+  hence spatially coherent), else the meshlet is complete.
+
+  Bounding cones are as per meshoptimizer (Kapoulkine): the cone axis is the
+  average triangle normal and the apex is placed such that all triangles
+  are in front of it.
+
+*******************************************************************************/
+
+void MeshData::buildMeshlets()
+{
+	APT_ASSERT(m_desc.getPrimitive() == MeshDesc::Primitive_Triangles);
+	const VertexAttr* posAttr = m_desc.findVertexAttr(VertexAttr::Semantic_Positions);
+	APT_ASSERT(posAttr); // no positions
+
+	releaseMeshlets();
+	if (getIndexCount() == 0) {
+		return;
+	}
+
+	eastl::vector<vec3> positions(getVertexCount(), vec3(0.0f));
+	const char* src = m_vertexData + posAttr->getOffset();
+	for (uint i = 0; i < getVertexCount(); ++i) {
+		DataTypeConvert(posAttr->getDataType(), DataType_Float32, src, &positions[i], APT_MIN((uint)posAttr->getCount(), 3u));
+		src += m_desc.getVertexSize();
+	}
+	eastl::vector<uint32> indices(getIndexCount());
+	DataTypeConvert(m_indexDataType, DataType_Uint32, m_indexData, indices.data(), getIndexCount());
+
+ // submesh 0 represents the whole mesh, only use it if there are no other submeshes
+	uint indexSize = DataTypeSizeBytes(m_indexDataType);
+	for (uint32 i = m_submeshes.size() > 1 ? 1 : 0; i < (uint32)m_submeshes.size(); ++i) {
+		const Submesh& submesh = m_submeshes[i];
+		uint32 indexOffset  = submesh.m_indexOffset / indexSize;
+		uint32 firstMeshlet = (uint32)m_meshlets.size();
+		BuildMeshlets(indices.data() + indexOffset, submesh.m_indexCount, positions.data(), m_meshlets);
+		for (uint32 j = firstMeshlet; j < (uint32)m_meshlets.size(); ++j) {
+			m_meshlets[j].m_indexOffset += indexOffset;
+			m_meshlets[j].m_submesh = i;
+		}
+	}
+	releaseTriangleBvh();
+	DataTypeConvert(DataType_Uint32, m_indexDataType, indices.data(), m_indexData, getIndexCount());
+
+	uint32 meshletCount = getMeshletCount();
+	m_meshletSpheres.resize(meshletCount * 4);
+	for (uint32 i = 0; i < meshletCount; ++i) {
+		const Sphere& sphere = m_meshlets[i].m_boundingSphere;
+		m_meshletSpheres[meshletCount * 0 + i] = sphere.m_origin.x;
+		m_meshletSpheres[meshletCount * 1 + i] = sphere.m_origin.y;
+		m_meshletSpheres[meshletCount * 2 + i] = sphere.m_origin.z;
+		m_meshletSpheres[meshletCount * 3 + i] = sphere.m_radius;
+	}
+}
+
+uint32 MeshData::cullMeshlets(const Camera& _camera, eastl::vector<DrawCommand>& out_, const mat4& _world) const
+{
+	uint32 meshletCount = getMeshletCount();
+	if (meshletCount == 0) {
+		return 0;
+	}
+
+ // cull in mesh space
+	mat4 worldInverse = inverse(_world);
+	Frustum frustum = _camera.m_worldFrustum;
+	frustum.transform(worldInverse);
+	bool isOrtho = _camera.getProjFlag(Camera::ProjFlag_Orthographic);
+	vec3 eye     = TransformPosition(worldInverse, _camera.getPosition());
+	vec3 viewDir = normalize(TransformDirection(worldInverse, _camera.getViewVector()));
+
+	uint32 ret = 0;
+	const float* spheres = m_meshletSpheres.data();
+	const uint32 kChunkSize = 256; // frustum cull in chunks to keep the visibility mask on the stack
+	uint32 visibleMask[kChunkSize / 32];
+	for (uint32 chunk = 0; chunk < meshletCount; chunk += kChunkSize) {
+		uint32 chunkCount = APT_MIN(meshletCount - chunk, kChunkSize);
+		frustum.cull(
+			spheres + meshletCount * 0 + chunk,
+			spheres + meshletCount * 1 + chunk,
+			spheres + meshletCount * 2 + chunk,
+			spheres + meshletCount * 3 + chunk,
+			(int)chunkCount,
+			visibleMask
+			);
+		for (uint32 j = 0; j < chunkCount; ++j) {
+			if ((visibleMask[j / 32] & (1u << (j % 32))) == 0) {
+				continue;
+			}
+			uint32 i = chunk + j;
+			const Meshlet& meshlet = m_meshlets[i];
+			vec3 v = isOrtho ? viewDir : normalize(meshlet.m_coneApex - eye);
+			if (dot(v, meshlet.m_coneAxis) >= meshlet.m_coneCutoff) {
+				continue;
+			}
+			DrawCommand cmd;
+			cmd.m_indexCount    = meshlet.m_indexCount;
+			cmd.m_instanceCount = 1;
+			cmd.m_firstIndex    = meshlet.m_indexOffset;
+			cmd.m_baseVertex    = 0;
+			cmd.m_baseInstance  = i;
+			out_.push_back(cmd);
+			++ret;
+		}
+	}
+	return ret;
+}
+
+void MeshData::BuildMeshlets(uint32* _indices_, uint32 _indexCount, const vec3* _positions, eastl::vector<Meshlet>& meshlets_)
+{
+	uint32 triangleCount = _indexCount / 3;
+	if (triangleCount == 0) {
+		return;
+	}
+
+ // remap to the referenced vertex range
+	uint32 minIndex = _indices_[0], maxIndex = _indices_[0];
+	for (uint32 i = 1; i < _indexCount; ++i) {
+		minIndex = APT_MIN(minIndex, _indices_[i]);
+		maxIndex = APT_MAX(maxIndex, _indices_[i]);
+	}
+	uint32 vertexCount = maxIndex - minIndex + 1;
+
+ // vertex -> triangle adjacency
+	eastl::vector<uint32> adjacencyOffsets(vertexCount + 1, 0);
+	for (uint32 i = 0; i < _indexCount; ++i) {
+		++adjacencyOffsets[_indices_[i] - minIndex + 1];
+	}
+	for (uint32 i = 0; i < vertexCount; ++i) {
+		adjacencyOffsets[i + 1] += adjacencyOffsets[i];
+	}
+	eastl::vector<uint32> adjacency(_indexCount);
+	{	eastl::vector<uint32> fill(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+		for (uint32 i = 0; i < _indexCount; ++i) {
+			adjacency[fill[_indices_[i] - minIndex]++] = i / 3;
+		}
+	}
+
+	eastl::vector<vec3> normals(triangleCount);
+	for (uint32 i = 0; i < triangleCount; ++i) {
+		const vec3& p0 = _positions[_indices_[i * 3 + 0]];
+		const vec3& p1 = _positions[_indices_[i * 3 + 1]];
+		const vec3& p2 = _positions[_indices_[i * 3 + 2]];
+		vec3  n   = cross(p1 - p0, p2 - p0);
+		float len = length(n);
+		normals[i] = len > 0.0f ? n / len : vec3(0.0f);
+	}
+
+	eastl::vector<uint8>  emitted(triangleCount, 0);
+	eastl::vector<uint32> vertexMeshlet(vertexCount, ~0u); // last meshlet which referenced each vertex
+	eastl::vector<uint32> ret;
+	ret.reserve(_indexCount);
+	eastl::vector<uint32> meshletTriangles;
+	eastl::vector<uint32> meshletVertices;
+	eastl::vector<vec3>   meshletPositions;
+	uint32 nextInputTriangle = 0;
+	for (uint32 meshletIndex = 0; ; ++meshletIndex) {
+		while (nextInputTriangle < triangleCount && emitted[nextInputTriangle]) {
+			++nextInputTriangle;
+		}
+		if (nextInputTriangle == triangleCount) {
+			break;
+		}
+
+		meshletTriangles.clear();
+		meshletVertices.clear();
+		vec3 normalSum = vec3(0.0f);
+		uint32 next = nextInputTriangle;
+		while (next != ~0u) {
+			emitted[next] = 1;
+			meshletTriangles.push_back(next);
+			normalSum += normals[next];
+			for (uint32 j = 0; j < 3; ++j) {
+				uint32 v = _indices_[next * 3 + j] - minIndex;
+				if (vertexMeshlet[v] != meshletIndex) {
+					vertexMeshlet[v] = meshletIndex;
+					meshletVertices.push_back(v);
+				}
+			}
+			if (meshletTriangles.size() == kMaxMeshletTriangles) {
+				break;
+			}
+
+		 // best adjacent triangle which fits
+			next = ~0u;
+			int   bestShared = 0;
+			float bestDot    = -FLT_MAX;
+			for (uint32 v : meshletVertices) {
+				for (uint32 k = adjacencyOffsets[v]; k < adjacencyOffsets[v + 1]; ++k) {
+					uint32 t = adjacency[k];
+					if (emitted[t]) {
+						continue;
+					}
+					int shared = 0;
+					for (uint32 j = 0; j < 3; ++j) {
+						shared += vertexMeshlet[_indices_[t * 3 + j] - minIndex] == meshletIndex ? 1 : 0;
+					}
+					if (meshletVertices.size() + (3 - shared) > kMaxMeshletVertices) {
+						continue;
+					}
+					float d = dot(normals[t], normalSum);
+					if (shared > bestShared || (shared == bestShared && d > bestDot)) {
+						next       = t;
+						bestShared = shared;
+						bestDot    = d;
+					}
+				}
+			}
+
+			if (next == ~0u) {
+			 // no adjacent triangle, take the next in the input order if it fits
+				while (nextInputTriangle < triangleCount && emitted[nextInputTriangle]) {
+					++nextInputTriangle;
+				}
+				if (nextInputTriangle < triangleCount) {
+					uint32 newVertices = 0;
+					for (uint32 j = 0; j < 3; ++j) {
+						newVertices += vertexMeshlet[_indices_[nextInputTriangle * 3 + j] - minIndex] == meshletIndex ? 0 : 1;
+					}
+					if (meshletVertices.size() + newVertices <= kMaxMeshletVertices) {
+						next = nextInputTriangle;
+					}
+				}
+			}
+		}
+
+		Meshlet meshlet;
+		meshlet.m_indexOffset = (uint32)ret.size();
+		meshlet.m_indexCount  = (uint32)meshletTriangles.size() * 3;
+		meshlet.m_vertexCount = (uint32)meshletVertices.size();
+		meshlet.m_submesh     = 0;
+		for (uint32 t : meshletTriangles) {
+			ret.push_back(_indices_[t * 3 + 0]);
+			ret.push_back(_indices_[t * 3 + 1]);
+			ret.push_back(_indices_[t * 3 + 2]);
+		}
+
+		meshletPositions.clear();
+		for (uint32 v : meshletVertices) {
+			meshletPositions.push_back(_positions[v + minIndex]);
+		}
+		meshlet.m_boundingSphere = Sphere(meshletPositions.data(), (uint)meshletPositions.size());
+
+	 // normal cone, the meshlet can't be back face culled if any normal is more than 90 degrees from the axis
+		vec3  axis   = vec3(0.0f);
+		float minDot = -1.0f;
+		float len    = length(normalSum);
+		if (len > 0.0f) {
+			axis = normalSum / len;
+			minDot = 1.0f;
+			for (uint32 t : meshletTriangles) {
+				if (normals[t] != vec3(0.0f)) { // skip degenerate triangles
+					minDot = APT_MIN(minDot, dot(axis, normals[t]));
+				}
+			}
+		}
+		const vec3& center = meshlet.m_boundingSphere.m_origin;
+		if (minDot <= 0.0f) {
+			meshlet.m_coneApex   = center;
+			meshlet.m_coneAxis   = vec3(0.0f);
+			meshlet.m_coneCutoff = 1.0f;
+		} else {
+			float maxT = 0.0f;
+			for (uint32 t : meshletTriangles) {
+				if (normals[t] == vec3(0.0f)) {
+					continue;
+				}
+				const vec3& p0 = _positions[_indices_[t * 3]];
+				maxT = APT_MAX(maxT, dot(center - p0, normals[t]) / dot(axis, normals[t]));
+			}
+			meshlet.m_coneApex   = center - axis * maxT;
+			meshlet.m_coneAxis   = axis;
+			meshlet.m_coneCutoff = sqrtf(1.0f - minDot * minDot);
+		}
+		meshlets_.push_back(meshlet);
+	}
+
+	memcpy(_indices_, ret.data(), sizeof(uint32) * ret.size());
+}
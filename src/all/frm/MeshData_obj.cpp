@@ -76,6 +76,7 @@ bool MeshData::ReadObj(MeshData& mesh_, const char* _srcData, uint _srcDataSize)
 	 // vertex data
 		for (auto i = 0; i < pcount; ++i) {
 			MeshBuilder::Vertex vtx;
+			memset(&vtx, 0, sizeof(vtx));
 			
 			vtx.m_position.x = m.positions[i * 3 + 0];
 			vtx.m_position.y = m.positions[i * 3 + 1];
@@ -147,7 +148,13 @@ bool MeshData::ReadObj(MeshData& mesh_, const char* _srcData, uint _srcDataSize)
 		voffset += (uint32)pcount;
 	}
 
-	
+
+ // merge vertices with identical data, e.g. split by the exporter or duplicated between shapes
+	tmpMesh.weld(0.0f,
+		(1 << VertexAttr::Semantic_Positions) |
+		(hasNormals   ? (1 << VertexAttr::Semantic_Normals)   : 0) |
+		(hasTexcoords ? (1 << VertexAttr::Semantic_Texcoords) : 0)
+		);
 	if (normalAttr != 0 && !hasNormals) {
 		tmpMesh.generateNormals();
 	}
@@ -155,6 +162,7 @@ bool MeshData::ReadObj(MeshData& mesh_, const char* _srcData, uint _srcDataSize)
 		tmpMesh.generateTangents();
 	}
 	tmpMesh.updateBounds();
+	tmpMesh.optimizeVertexCache();
 
 MeshData_ReadObj_end:
 	if (!ret) {
@@ -0,0 +1,743 @@
+#include <frm/MeshData.h>
+
+#include <EASTL/sort.h>
+#include <EASTL/vector.h>
+
+#include <cmath>
+#include <cstring>
+
+using namespace frm;
+using namespace apt;
+
+/*******************************************************************************
+
+                           Vertex cache optimization
+
+  Forsyth, "Linear-Speed Vertex Cache Optimisation". Vertices are scored by
+  their position in a simulated LRU cache and the number of remaining
+  triangles which reference them; the highest scoring triangle adjacent to the
+  cache is emitted next. If no cached vertex has remaining triangles the next
+  triangle in the input order is emitted.
+
+*******************************************************************************/
+
+namespace {
+
+const int   kForsythCacheSize    = 16; // Simulated LRU size, 16 gives the best results for AnalyzeVertexCache() defaults.
+const float kCacheDecayPower     = 1.5f;
+const float kLastTriScore        = 0.75f;
+const float kValenceBoostScale   = 2.0f;
+const float kValenceBoostPower   = 0.5f;
+
+// FIFO post-transform vertex cache simulation. A vertex is in the cache if fewer than m_size misses occurred since it
+// was inserted.
+struct FifoCache
+{
+	eastl::vector<uint32> m_insertedAt; // Miss count after insertion per vertex, 0 if never transformed.
+	uint32                m_missCount;
+	uint32                m_size;
+
+	FifoCache(uint32 _vertexCount, uint32 _size)
+		: m_insertedAt(_vertexCount, 0)
+		, m_missCount(0)
+		, m_size(_size)
+	{
+	}
+
+	// Return 1 if _v missed the cache.
+	uint32 access(uint32 _v)
+	{
+		if (m_insertedAt[_v] != 0 && m_missCount - m_insertedAt[_v] < m_size) {
+			return 0;
+		}
+		m_insertedAt[_v] = ++m_missCount;
+		return 1;
+	}
+
+	void flush()
+	{
+		m_missCount += m_size;
+	}
+};
+
+uint32 GetMaxIndex(const uint32* _indices, uint32 _indexCount)
+{
+	uint32 ret = 0;
+	for (uint32 i = 0; i < _indexCount; ++i) {
+		ret = APT_MAX(ret, _indices[i]);
+	}
+	return ret;
+}
+
+float VertexScore(int _cachePosition, uint32 _remainingTriangles)
+{
+	if (_remainingTriangles == 0) {
+		return -1.0f; // no triangles left to emit
+	}
+	float ret = 0.0f;
+	if (_cachePosition >= 0) {
+		if (_cachePosition < 3) {
+		 // vertices of the last triangle get a fixed score to avoid favoring the triangle just emitted
+			ret = kLastTriScore;
+		} else {
+			const float scale = 1.0f / (float)(kForsythCacheSize - 3);
+			ret = powf(1.0f - (float)(_cachePosition - 3) * scale, kCacheDecayPower);
+		}
+	}
+	ret += kValenceBoostScale * powf((float)_remainingTriangles, -kValenceBoostPower);
+	return ret;
+}
+
+} // namespace
+
+void MeshBuilder::optimizeVertexCache()
+{
+	if (m_triangles.empty()) {
+		return;
+	}
+	uint32* indices = &m_triangles.data()->a;
+	if (m_submeshes.empty()) {
+		OptimizeVertexCache(indices, getIndexCount());
+	} else {
+		for (auto& submesh : m_submeshes) {
+			OptimizeVertexCache(indices + submesh.m_indexOffset, submesh.m_indexCount);
+		}
+	}
+}
+
+void MeshBuilder::OptimizeVertexCache(uint32* _indices_, uint32 _indexCount)
+{
+	uint32 triangleCount = _indexCount / 3;
+	if (triangleCount < 2) {
+		return;
+	}
+
+ // remap to the referenced vertex range
+	uint32 minIndex = _indices_[0], maxIndex = _indices_[0];
+	for (uint32 i = 1; i < _indexCount; ++i) {
+		minIndex = APT_MIN(minIndex, _indices_[i]);
+		maxIndex = APT_MAX(maxIndex, _indices_[i]);
+	}
+	uint32 vertexCount = maxIndex - minIndex + 1;
+
+ // vertex -> triangle adjacency
+	eastl::vector<uint32> remaining(vertexCount, 0); // remaining triangles per vertex
+	for (uint32 i = 0; i < _indexCount; ++i) {
+		++remaining[_indices_[i] - minIndex];
+	}
+	eastl::vector<uint32> adjacencyOffsets(vertexCount + 1);
+	adjacencyOffsets[0] = 0;
+	for (uint32 i = 0; i < vertexCount; ++i) {
+		adjacencyOffsets[i + 1] = adjacencyOffsets[i] + remaining[i];
+	}
+	eastl::vector<uint32> adjacency(_indexCount);
+	{	eastl::vector<uint32> fill(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+		for (uint32 i = 0; i < _indexCount; ++i) {
+			uint32 v = _indices_[i] - minIndex;
+			adjacency[fill[v]++] = i / 3;
+		}
+	}
+
+	eastl::vector<int>   cachePositions(vertexCount, -1);
+	eastl::vector<float> vertexScores(vertexCount);
+	for (uint32 i = 0; i < vertexCount; ++i) {
+		vertexScores[i] = VertexScore(-1, remaining[i]);
+	}
+	eastl::vector<float> triangleScores(triangleCount);
+	for (uint32 i = 0; i < triangleCount; ++i) {
+		triangleScores[i] = 0.0f;
+		for (uint32 j = 0; j < 3; ++j) {
+			triangleScores[i] += vertexScores[_indices_[i * 3 + j] - minIndex];
+		}
+	}
+	eastl::vector<uint8> emitted(triangleCount, 0);
+
+	eastl::vector<uint32> ret;
+	ret.reserve(_indexCount);
+	uint32 cache[kForsythCacheSize + 3];
+	int cacheCount = 0;
+	uint32 nextInputTriangle = 0;
+	uint32 bestTriangle = 0;
+	for (uint32 emitCount = 0; emitCount < triangleCount; ++emitCount) {
+		if (emitted[bestTriangle]) {
+		 // dead end, take the next triangle in the input order
+			while (emitted[nextInputTriangle]) {
+				++nextInputTriangle;
+			}
+			bestTriangle = nextInputTriangle;
+		}
+
+	 // emit, remove from the adjacency of its vertices
+		emitted[bestTriangle] = 1;
+		uint32 tri[3];
+		for (uint32 j = 0; j < 3; ++j) {
+			tri[j] = _indices_[bestTriangle * 3 + j] - minIndex;
+			ret.push_back(tri[j] + minIndex);
+			uint32* adj = adjacency.data() + adjacencyOffsets[tri[j]];
+			uint32 adjCount = remaining[tri[j]];
+			for (uint32 k = 0; k < adjCount; ++k) {
+				if (adj[k] == bestTriangle) {
+					adj[k] = adj[adjCount - 1];
+					break;
+				}
+			}
+			--remaining[tri[j]];
+		}
+
+	 // move the triangle's vertices to the front of the cache
+		uint32 newCache[kForsythCacheSize + 3];
+		int newCacheCount = 0;
+		for (uint32 j = 0; j < 3; ++j) {
+			if (j == 0 || (tri[j] != tri[0] && tri[j] != tri[1])) { // skip degenerate repeats
+				newCache[newCacheCount++] = tri[j];
+			}
+		}
+		for (int j = 0; j < cacheCount; ++j) {
+			uint32 v = cache[j];
+			if (v != tri[0] && v != tri[1] && v != tri[2]) {
+				newCache[newCacheCount++] = v;
+			}
+		}
+
+	 // update scores of the vertices in the (overflowing) cache and their triangles
+		for (int j = 0; j < newCacheCount; ++j) {
+			uint32 v = newCache[j];
+			cachePositions[v] = j < kForsythCacheSize ? j : -1;
+			float score = VertexScore(cachePositions[v], remaining[v]);
+			float delta = score - vertexScores[v];
+			vertexScores[v] = score;
+			const uint32* adj = adjacency.data() + adjacencyOffsets[v];
+			for (uint32 k = 0; k < remaining[v]; ++k) {
+				triangleScores[adj[k]] += delta;
+			}
+		}
+
+	 // best next triangle among those adjacent to the cache
+		float bestScore = -1.0f;
+		for (int j = 0; j < newCacheCount && j < kForsythCacheSize; ++j) {
+			uint32 v = newCache[j];
+			const uint32* adj = adjacency.data() + adjacencyOffsets[v];
+			for (uint32 k = 0; k < remaining[v]; ++k) {
+				uint32 t = adj[k];
+				if (triangleScores[t] > bestScore) {
+					bestScore = triangleScores[t];
+					bestTriangle = t;
+				}
+			}
+		}
+		cacheCount = APT_MIN(newCacheCount, kForsythCacheSize);
+		memcpy(cache, newCache, sizeof(uint32) * cacheCount);
+	}
+
+ // keep the input order if it was already better (e.g. strip ordered patches)
+	if (AnalyzeVertexCache(ret.data(), _indexCount).m_acmr >= AnalyzeVertexCache(_indices_, _indexCount).m_acmr) {
+		return;
+	}
+	memcpy(_indices_, ret.data(), sizeof(uint32) * _indexCount);
+}
+
+MeshBuilder::VertexCacheStats MeshBuilder::analyzeVertexCache(uint32 _cacheSize) const
+{
+	VertexCacheStats ret = {};
+	if (m_triangles.empty()) {
+		return ret;
+	}
+	return AnalyzeVertexCache(&m_triangles.data()->a, getIndexCount(), _cacheSize);
+}
+
+MeshBuilder::VertexCacheStats MeshBuilder::AnalyzeVertexCache(const uint32* _indices, uint32 _indexCount, uint32 _cacheSize)
+{
+	VertexCacheStats ret = {};
+	if (_indexCount < 3) {
+		return ret;
+	}
+	FifoCache cache(GetMaxIndex(_indices, _indexCount) + 1, _cacheSize);
+	uint32 vertexCount = 0;
+	for (uint32 i = 0; i < _indexCount; ++i) {
+		vertexCount += cache.m_insertedAt[_indices[i]] == 0 ? 1 : 0;
+		cache.access(_indices[i]);
+	}
+	ret.m_acmr = (float)cache.m_missCount / (float)(_indexCount / 3);
+	ret.m_atvr = (float)cache.m_missCount / (float)vertexCount;
+	return ret;
+}
+
+/*******************************************************************************
+
+                             Overdraw optimization
+
+  Sander et al., "Fast Triangle Reordering for Vertex Locality and Reduced
+  Overdraw". The triangle order is split into clusters at vertex cache dead
+  ends (hard boundaries), and within those wherever the ACMR of the cluster so
+  far is within the threshold of the whole (soft boundaries). Clusters are
+  then sorted by the dot product of their normal with the direction from the
+  mesh centroid, such that clusters on the outside of the mesh (which are
+  likely to occlude others) are drawn first.
+
+*******************************************************************************/
+
+namespace {
+
+const uint32 kOverdrawCacheSize = 16;
+const int    kOverdrawResolution = 256; // analyzeOverdraw() raster size.
+
+struct Cluster
+{
+	uint32 m_first;
+	uint32 m_count;
+	float  m_sortKey;
+};
+
+uint32 AccessTriangle(FifoCache& _cache_, const MeshBuilder::Triangle& _triangle)
+{
+	return _cache_.access(_triangle.a) + _cache_.access(_triangle.b) + _cache_.access(_triangle.c);
+}
+
+void OptimizeOverdraw(MeshBuilder::Triangle* _triangles_, uint32 _triangleCount, const MeshBuilder::Vertex* _vertices, uint32 _vertexCount, float _threshold)
+{
+	if (_triangleCount < 2) {
+		return;
+	}
+
+ // hard boundaries, all 3 vertices miss the cache
+	FifoCache cache(_vertexCount, kOverdrawCacheSize);
+	eastl::vector<uint32> hardBoundaries;
+	for (uint32 i = 0; i < _triangleCount; ++i) {
+		if (AccessTriangle(cache, _triangles_[i]) == 3 || i == 0) {
+			hardBoundaries.push_back(i);
+		}
+	}
+	hardBoundaries.push_back(_triangleCount);
+
+ // soft boundaries
+	eastl::vector<Cluster> clusters;
+	for (uint32 h = 0; h + 1 < (uint32)hardBoundaries.size(); ++h) {
+		uint32 first = hardBoundaries[h];
+		uint32 last  = hardBoundaries[h + 1];
+		cache.flush();
+		uint32 misses = 0;
+		for (uint32 i = first; i < last; ++i) {
+			misses += AccessTriangle(cache, _triangles_[i]);
+		}
+		float maxAcmr = (float)misses / (float)(last - first) * _threshold;
+
+		cache.flush();
+		misses = 0;
+		Cluster cluster = { first, 0, 0.0f };
+		for (uint32 i = first; i < last; ++i) {
+			misses += AccessTriangle(cache, _triangles_[i]);
+			++cluster.m_count;
+			if (i + 1 < last && (float)misses / (float)cluster.m_count <= maxAcmr) {
+				clusters.push_back(cluster);
+				cluster.m_first = i + 1;
+				cluster.m_count = 0;
+				misses = 0;
+				cache.flush();
+			}
+		}
+		clusters.push_back(cluster);
+	}
+	if (clusters.size() < 2) {
+		return;
+	}
+
+ // area-weighted cluster centroids/normals
+	eastl::vector<vec3> centroids(clusters.size());
+	eastl::vector<vec3> normals(clusters.size());
+	vec3  meshCentroid = vec3(0.0f);
+	float meshArea     = 0.0f;
+	for (uint32 c = 0; c < (uint32)clusters.size(); ++c) {
+		vec3  centroid = vec3(0.0f);
+		vec3  normal   = vec3(0.0f);
+		float area     = 0.0f;
+		for (uint32 i = clusters[c].m_first, n = clusters[c].m_first + clusters[c].m_count; i < n; ++i) {
+			const vec3& p0 = _vertices[_triangles_[i].a].m_position;
+			const vec3& p1 = _vertices[_triangles_[i].b].m_position;
+			const vec3& p2 = _vertices[_triangles_[i].c].m_position;
+			vec3  n2 = cross(p1 - p0, p2 - p0);
+			float a  = length(n2);
+			centroid += (p0 + p1 + p2) * (a / 3.0f);
+			normal   += n2;
+			area     += a;
+		}
+		meshCentroid += centroid;
+		meshArea     += area;
+		centroids[c] = area > 0.0f ? centroid / area : vec3(0.0f);
+		float len = length(normal);
+		normals[c] = len > 0.0f ? normal / len : vec3(0.0f);
+	}
+	if (meshArea <= 0.0f) {
+		return;
+	}
+	meshCentroid /= meshArea;
+	for (uint32 c = 0; c < (uint32)clusters.size(); ++c) {
+		clusters[c].m_sortKey = dot(centroids[c] - meshCentroid, normals[c]);
+	}
+	eastl::stable_sort(clusters.begin(), clusters.end(),
+		[](const Cluster& _a, const Cluster& _b) { return _a.m_sortKey > _b.m_sortKey; }
+		);
+
+	eastl::vector<MeshBuilder::Triangle> triangles;
+	triangles.reserve(_triangleCount);
+	for (auto& cluster : clusters) {
+		triangles.insert(triangles.end(), _triangles_ + cluster.m_first, _triangles_ + cluster.m_first + cluster.m_count);
+	}
+	memcpy(_triangles_, triangles.data(), sizeof(MeshBuilder::Triangle) * _triangleCount);
+}
+
+} // namespace
+
+void MeshBuilder::optimizeOverdraw(float _threshold)
+{
+	if (m_submeshes.empty()) {
+		OptimizeOverdraw(m_triangles.data(), getTriangleCount(), m_vertices.data(), getVertexCount(), _threshold);
+	} else {
+		for (auto& submesh : m_submeshes) {
+			OptimizeOverdraw(m_triangles.data() + submesh.m_indexOffset / 3, submesh.m_indexCount / 3, m_vertices.data(), getVertexCount(), _threshold);
+		}
+	}
+}
+
+float MeshBuilder::analyzeOverdraw() const
+{
+	if (m_triangles.empty()) {
+		return 0.0f;
+	}
+	vec3 boundsMin = m_vertices[0].m_position;
+	vec3 boundsMax = m_vertices[0].m_position;
+	for (auto& vertex : m_vertices) {
+		boundsMin = min(boundsMin, vertex.m_position);
+		boundsMax = max(boundsMax, vertex.m_position);
+	}
+	vec3 scale = vec3((float)kOverdrawResolution) / max(boundsMax - boundsMin, vec3(1e-6f));
+
+	eastl::vector<float> depthBuffer(kOverdrawResolution * kOverdrawResolution);
+	uint64 covered = 0;
+	uint64 shaded  = 0;
+	for (int view = 0; view < 6; ++view) {
+	 // view along +/- each axis, front faces are CCW for positive views and CW for negative views
+		int   axisZ = view / 2;
+		int   axisX = (axisZ + 1) % 3;
+		int   axisY = (axisZ + 2) % 3;
+		float sign  = (view & 1) ? -1.0f : 1.0f;
+		for (auto& d : depthBuffer) {
+			d = FLT_MAX;
+		}
+		for (auto& triangle : m_triangles) {
+			vec3 p[3];
+			for (int i = 0; i < 3; ++i) {
+				const vec3& position = m_vertices[(&triangle.a)[i]].m_position;
+				p[i].x = (position[axisX] - boundsMin[axisX]) * scale[axisX];
+				p[i].y = (position[axisY] - boundsMin[axisY]) * scale[axisY];
+				p[i].z = -sign * position[axisZ];
+			}
+			float area = (p[1].x - p[0].x) * (p[2].y - p[0].y) - (p[1].y - p[0].y) * (p[2].x - p[0].x);
+			if (area * sign <= 0.0f) {
+				continue; // back facing or degenerate
+			}
+			if (area < 0.0f) {
+				eastl::swap(p[1], p[2]);
+				area = -area;
+			}
+
+			int x0 = APT_MAX((int)floorf(APT_MIN(p[0].x, APT_MIN(p[1].x, p[2].x))), 0);
+			int y0 = APT_MAX((int)floorf(APT_MIN(p[0].y, APT_MIN(p[1].y, p[2].y))), 0);
+			int x1 = APT_MIN((int)ceilf(APT_MAX(p[0].x, APT_MAX(p[1].x, p[2].x))), kOverdrawResolution - 1);
+			int y1 = APT_MIN((int)ceilf(APT_MAX(p[0].y, APT_MAX(p[1].y, p[2].y))), kOverdrawResolution - 1);
+			for (int y = y0; y <= y1; ++y) {
+				for (int x = x0; x <= x1; ++x) {
+					float px = (float)x + 0.5f;
+					float py = (float)y + 0.5f;
+					float w0 = (p[2].x - p[1].x) * (py - p[1].y) - (p[2].y - p[1].y) * (px - p[1].x);
+					float w1 = (p[0].x - p[2].x) * (py - p[2].y) - (p[0].y - p[2].y) * (px - p[2].x);
+					float w2 = (p[1].x - p[0].x) * (py - p[0].y) - (p[1].y - p[0].y) * (px - p[0].x);
+					if (w0 < 0.0f || w1 < 0.0f || w2 < 0.0f) {
+						continue;
+					}
+					float z = (w0 * p[0].z + w1 * p[1].z + w2 * p[2].z) / area;
+					float& depth = depthBuffer[y * kOverdrawResolution + x];
+					if (z < depth) {
+						covered += depth == FLT_MAX ? 1 : 0;
+						depth = z;
+						++shaded;
+					}
+				}
+			}
+		}
+	}
+	return covered > 0 ? (float)((double)shaded / (double)covered) : 0.0f;
+}
+
+/*******************************************************************************
+
+                           Vertex fetch optimization
+
+*******************************************************************************/
+
+void MeshBuilder::optimizeVertexFetch()
+{
+	if (m_triangles.empty()) {
+		return;
+	}
+	uint32* indices = &m_triangles.data()->a;
+
+	struct Range
+	{
+		uint32 m_vertexOffset, m_vertexCount;
+		uint32 m_indexOffset, m_indexCount;
+	};
+	eastl::vector<Range> ranges;
+	if (m_submeshes.empty()) {
+		Range range = { 0, getVertexCount(), 0, getIndexCount() };
+		ranges.push_back(range);
+	} else {
+		for (auto& submesh : m_submeshes) {
+			Range range = { submesh.m_vertexOffset, submesh.m_vertexCount, submesh.m_indexOffset, submesh.m_indexCount };
+			ranges.push_back(range);
+		}
+	}
+
+ // first use order within each range, followed by unreferenced vertices; vertices outside any range don't move
+	eastl::vector<uint32> remap(getVertexCount(), ~0u);
+	for (auto& range : ranges) {
+		uint32 first = range.m_vertexOffset;
+		uint32 last  = range.m_vertexOffset + range.m_vertexCount;
+		uint32 next  = first;
+		for (uint32 i = range.m_indexOffset, n = range.m_indexOffset + range.m_indexCount; i < n; ++i) {
+			uint32 v = indices[i];
+			if (v >= first && v < last && remap[v] == ~0u) {
+				remap[v] = next++;
+			}
+		}
+		for (uint32 v = first; v < last; ++v) {
+			if (remap[v] == ~0u) {
+				remap[v] = next++;
+			}
+		}
+	}
+	for (uint32 v = 0; v < getVertexCount(); ++v) {
+		if (remap[v] == ~0u) {
+			remap[v] = v;
+		}
+	}
+
+	eastl::vector<Vertex> vertices(getVertexCount());
+	for (uint32 v = 0; v < getVertexCount(); ++v) {
+		vertices[remap[v]] = m_vertices[v];
+	}
+	m_vertices.swap(vertices);
+	for (uint32 i = 0; i < getIndexCount(); ++i) {
+		indices[i] = remap[indices[i]];
+	}
+}
+
+MeshBuilder::VertexFetchStats MeshBuilder::analyzeVertexFetch(uint32 _vertexSize) const
+{
+	VertexFetchStats ret = {};
+	if (m_triangles.empty()) {
+		return ret;
+	}
+	return AnalyzeVertexFetch(&m_triangles.data()->a, getIndexCount(), _vertexSize);
+}
+
+MeshBuilder::VertexFetchStats MeshBuilder::AnalyzeVertexFetch(const uint32* _indices, uint32 _indexCount, uint32 _vertexSize)
+{
+	const uint32 kLineSize  = 64;
+	const uint32 kLineCount = 16 * 1024 / kLineSize;
+
+	VertexFetchStats ret = {};
+	if (_indexCount == 0) {
+		return ret;
+	}
+	FifoCache cache(GetMaxIndex(_indices, _indexCount) + 1, 16);
+	uint64 lines[kLineCount];
+	for (auto& line : lines) {
+		line = ~0ull;
+	}
+	uint64 bytes = 0;
+	uint32 vertexCount = 0;
+	for (uint32 i = 0; i < _indexCount; ++i) {
+		uint32 v = _indices[i];
+		vertexCount += cache.m_insertedAt[v] == 0 ? 1 : 0;
+		if (!cache.access(v)) {
+			continue;
+		}
+		uint64 firstLine = (uint64)v * _vertexSize / kLineSize;
+		uint64 lastLine  = ((uint64)v * _vertexSize + _vertexSize - 1) / kLineSize;
+		for (uint64 line = firstLine; line <= lastLine; ++line) {
+			uint64& slot = lines[line % kLineCount];
+			if (slot != line) {
+				slot = line;
+				bytes += kLineSize;
+			}
+		}
+	}
+	ret.m_bytesPerVertex = (float)bytes / (float)vertexCount;
+	ret.m_overfetch      = ret.m_bytesPerVertex / (float)_vertexSize;
+	return ret;
+}
+
+/*******************************************************************************
+
+                                 Vertex welding
+
+  Vertices are hashed by their position into a grid with a cell size of
+  epsilon, duplicates are within the 3x3x3 cells around a vertex. If epsilon
+  is 0 the cell is the exact position (1 cell is searched). Each hash bucket
+  is a chain of kept vertices; the bucket count is at least twice the vertex
+  count, hence the search is O(1) on average.
+
+*******************************************************************************/
+
+namespace {
+
+bool IsNear(const float* _a, const float* _b, int _count, float _epsilon)
+{
+	for (int i = 0; i < _count; ++i) {
+		if (fabs(_a[i] - _b[i]) > _epsilon) {
+			return false;
+		}
+	}
+	return true;
+}
+
+bool IsDuplicate(const MeshBuilder::Vertex& _a, const MeshBuilder::Vertex& _b, float _epsilon, uint32 _attributeMask)
+{
+	if (!IsNear(&_a.m_position.x, &_b.m_position.x, 3, _epsilon)) {
+		return false;
+	}
+	if ((_attributeMask & (1 << VertexAttr::Semantic_Texcoords)) && !IsNear(&_a.m_texcoord.x, &_b.m_texcoord.x, 2, _epsilon)) {
+		return false;
+	}
+	if ((_attributeMask & (1 << VertexAttr::Semantic_Normals)) && !IsNear(&_a.m_normal.x, &_b.m_normal.x, 3, _epsilon)) {
+		return false;
+	}
+	if ((_attributeMask & (1 << VertexAttr::Semantic_Tangents)) && !IsNear(&_a.m_tangent.x, &_b.m_tangent.x, 4, _epsilon)) {
+		return false;
+	}
+	if ((_attributeMask & (1 << VertexAttr::Semantic_Colors)) && !IsNear(&_a.m_color.x, &_b.m_color.x, 4, _epsilon)) {
+		return false;
+	}
+	if ((_attributeMask & (1 << VertexAttr::Semantic_BoneWeights)) && !IsNear(&_a.m_boneWeights.x, &_b.m_boneWeights.x, 4, _epsilon)) {
+		return false;
+	}
+	if ((_attributeMask & (1 << VertexAttr::Semantic_BoneIndices)) && memcmp(&_a.m_boneIndices, &_b.m_boneIndices, sizeof(uvec4)) != 0) {
+		return false;
+	}
+	return true;
+}
+
+void GetWeldCell(const vec3& _position, float _epsilon, uint64 cell_[3])
+{
+	for (int i = 0; i < 3; ++i) {
+		if (_epsilon > 0.0f) {
+			cell_[i] = (uint64)(sint64)floor((double)_position[i] / (double)_epsilon);
+		} else {
+			float p = _position[i] + 0.0f; // -0 -> 0
+			uint32 bits;
+			memcpy(&bits, &p, sizeof(bits));
+			cell_[i] = bits;
+		}
+	}
+}
+
+uint32 HashWeldCell(uint64 _x, uint64 _y, uint64 _z)
+{
+ // Teschner et al., "Optimized Spatial Hashing for Collision Detection of Deformable Objects"
+	uint64 h = (_x * 73856093ull) ^ (_y * 19349663ull) ^ (_z * 83492791ull);
+	return (uint32)(h ^ (h >> 32));
+}
+
+} // namespace
+
+void MeshBuilder::weld(float _epsilon, uint32 _attributeMask)
+{
+	if (m_vertices.empty()) {
+		return;
+	}
+	_epsilon = APT_MAX(_epsilon, 0.0f);
+
+	struct Range
+	{
+		uint32 m_vertexOffset, m_vertexCount;
+	};
+	eastl::vector<Range> ranges;
+	if (m_submeshes.empty()) {
+		Range range = { 0, getVertexCount() };
+		ranges.push_back(range);
+	} else {
+		for (auto& submesh : m_submeshes) {
+			Range range = { submesh.m_vertexOffset, submesh.m_vertexCount };
+			ranges.push_back(range);
+		}
+	}
+
+	eastl::vector<uint32> remap(getVertexCount());
+	eastl::vector<Vertex> vertices;
+	eastl::vector<uint32> chain;   // next kept vertex in the same bucket, per kept vertex
+	eastl::vector<uint32> buckets; // first kept vertex per bucket
+	vertices.reserve(getVertexCount());
+	chain.reserve(getVertexCount());
+	int searchRadius = _epsilon > 0.0f ? 1 : 0;
+	uint32 src = 0;
+	for (uint32 i = 0; i <= (uint32)ranges.size(); ++i) {
+	 // vertices outside any range are kept as is
+		uint32 rangeBegin = i < (uint32)ranges.size() ? ranges[i].m_vertexOffset : getVertexCount();
+		APT_ASSERT(rangeBegin >= src); // ranges must be sorted and disjoint
+		for (; src < rangeBegin; ++src) {
+			remap[src] = (uint32)vertices.size();
+			vertices.push_back(m_vertices[src]);
+			chain.push_back(~0u);
+		}
+		if (i == (uint32)ranges.size()) {
+			break;
+		}
+
+		uint32 rangeEnd    = rangeBegin + ranges[i].m_vertexCount;
+		uint32 first       = (uint32)vertices.size();
+		uint32 bucketCount = 1;
+		while (bucketCount < ranges[i].m_vertexCount * 2) {
+			bucketCount *= 2;
+		}
+		buckets.assign(bucketCount, ~0u);
+		for (; src < rangeEnd; ++src) {
+			const Vertex& v = m_vertices[src];
+			uint64 cell[3];
+			GetWeldCell(v.m_position, _epsilon, cell);
+			uint32 dst = ~0u;
+			for (int z = -searchRadius; z <= searchRadius && dst == ~0u; ++z) {
+				for (int y = -searchRadius; y <= searchRadius && dst == ~0u; ++y) {
+					for (int x = -searchRadius; x <= searchRadius && dst == ~0u; ++x) {
+						uint32 bucket = HashWeldCell(cell[0] + x, cell[1] + y, cell[2] + z) & (bucketCount - 1);
+						for (uint32 k = buckets[bucket]; k != ~0u; k = chain[k]) {
+							if (IsDuplicate(v, vertices[k], _epsilon, _attributeMask)) {
+								dst = k;
+								break;
+							}
+						}
+					}
+				}
+			}
+			if (dst == ~0u) {
+				uint32 bucket = HashWeldCell(cell[0], cell[1], cell[2]) & (bucketCount - 1);
+				dst = (uint32)vertices.size();
+				vertices.push_back(v);
+				chain.push_back(buckets[bucket]);
+				buckets[bucket] = dst;
+			}
+			remap[src] = dst;
+		}
+
+		if (!m_submeshes.empty()) {
+			m_submeshes[i].m_vertexOffset = first;
+			m_submeshes[i].m_vertexCount  = (uint32)vertices.size() - first;
+		}
+	}
+
+	m_vertices.swap(vertices);
+	for (auto& triangle : m_triangles) {
+		triangle.a = remap[triangle.a];
+		triangle.b = remap[triangle.b];
+		triangle.c = remap[triangle.c];
+	}
+}
@@ -0,0 +1,659 @@
+#include <frm/MeshData.h>
+
+#include <frm/Camera.h>
+
+#include <EASTL/sort.h>
+#include <EASTL/vector.h>
+
+#include <cmath>
+#include <cstring>
+
+using namespace frm;
+using namespace apt;
+
+/*******************************************************************************
+
+                                 Simplification
+
+  Garland & Heckbert, "Surface Simplification Using Quadric Error Metrics",
+  with half edge collapses (a vertex is collapsed onto one of its neighbors)
+  as per meshoptimizer (Kapoulkine). Vertices are classified as:
+
+    Manifold - unique position, all edges shared by 2 triangles
+    Border   - unique position on a single open edge loop
+    Seam     - position shared by 2 vertices (e.g. a UV seam), each with a
+               single open edge loop which matches the other's
+    Locked   - anything else
+
+  Border and seam vertices only collapse along the border/seam onto a vertex
+  of the same kind (both vertices of a seam are collapsed), locked vertices
+  never collapse. Border/seam edges add a perpendicular plane to the quadrics
+  to preserve their shape.
+
+  Each pass sorts the candidate collapses by cost and performs them in order,
+  skipping collapses which touch a position already modified in the pass or
+  which would flip a triangle, until the target is reached or the cost
+  exceeds a per-pass limit (derived from the cost of the collapse which would
+  reach the target) which prevents expensive collapses being performed while
+  cheaper ones remain blocked by locking.
+
+*******************************************************************************/
+
+namespace {
+
+enum VertexKind
+{
+	VertexKind_Manifold,
+	VertexKind_Border,
+	VertexKind_Seam,
+	VertexKind_Locked,
+
+	VertexKind_Count
+};
+
+// Whether a vertex of kind [i] can collapse onto a vertex of kind [j].
+const bool kCanCollapse[VertexKind_Count][VertexKind_Count] =
+{
+	{ true,  true,  true,  true  },
+	{ false, true,  false, false },
+	{ false, false, true,  false },
+	{ false, false, false, false },
+};
+
+const float kBorderWeight   = 10.0f; // Border/seam plane quadric weight relative to the triangle quadrics.
+const float kNormalWeight   = 0.25f; // Attribute cost weights, scaled by the squared edge length.
+const float kTexcoordWeight = 1.0f;
+
+// Symmetric 4x4 matrix, the error at p is (p^T A p + 2 b.p + c) / weight.
+struct Quadric
+{
+	double m_a00, m_a01, m_a02, m_a11, m_a12, m_a22;
+	double m_b0, m_b1, m_b2;
+	double m_c;
+	double m_weight;
+};
+
+void QuadricAdd(Quadric& q_, const Quadric& _q)
+{
+	q_.m_a00 += _q.m_a00; q_.m_a01 += _q.m_a01; q_.m_a02 += _q.m_a02;
+	q_.m_a11 += _q.m_a11; q_.m_a12 += _q.m_a12; q_.m_a22 += _q.m_a22;
+	q_.m_b0  += _q.m_b0;  q_.m_b1  += _q.m_b1;  q_.m_b2  += _q.m_b2;
+	q_.m_c   += _q.m_c;
+	q_.m_weight += _q.m_weight;
+}
+
+// Plane through _origin with unit _normal.
+Quadric QuadricFromPlane(const vec3& _normal, const vec3& _origin, double _weight)
+{
+	double a = _normal.x, b = _normal.y, c = _normal.z;
+	double d = -dot(_normal, _origin);
+	Quadric ret;
+	ret.m_a00 = a * a * _weight; ret.m_a01 = a * b * _weight; ret.m_a02 = a * c * _weight;
+	ret.m_a11 = b * b * _weight; ret.m_a12 = b * c * _weight; ret.m_a22 = c * c * _weight;
+	ret.m_b0  = a * d * _weight; ret.m_b1  = b * d * _weight; ret.m_b2  = c * d * _weight;
+	ret.m_c   = d * d * _weight;
+	ret.m_weight = _weight;
+	return ret;
+}
+
+float QuadricError(const Quadric& _q, const vec3& _p)
+{
+	double x = _p.x, y = _p.y, z = _p.z;
+	double r = _q.m_a00 * x * x + _q.m_a11 * y * y + _q.m_a22 * z * z
+		+ 2.0 * (_q.m_a01 * x * y + _q.m_a02 * x * z + _q.m_a12 * y * z)
+		+ 2.0 * (_q.m_b0 * x + _q.m_b1 * y + _q.m_b2 * z)
+		+ _q.m_c;
+	return _q.m_weight > 0.0 ? (float)(fabs(r) / _q.m_weight) : 0.0f;
+}
+
+float AttributeCost(const MeshBuilder::Vertex& _v0, const MeshBuilder::Vertex& _v1)
+{
+	vec3 dn  = _v1.m_normal - _v0.m_normal;
+	vec2 duv = _v1.m_texcoord - _v0.m_texcoord;
+	return kNormalWeight * dot(dn, dn) + kTexcoordWeight * dot(duv, duv);
+}
+
+struct Collapse
+{
+	uint32 m_v0;   // collapse m_v0 onto m_v1
+	uint32 m_v1;
+	float  m_cost;
+};
+
+// Per pass topology, rebuilt from the current indices.
+struct Topology
+{
+	eastl::vector<uint32> m_edgeOffsets;     // half edges (v -> m_edges[i]) per vertex
+	eastl::vector<uint32> m_edges;
+	eastl::vector<uint32> m_openOut;         // target of the open half edge from each vertex, ~0 if none, the vertex itself if several
+	eastl::vector<uint32> m_openIn;          // as above for open half edges into each vertex
+	eastl::vector<uint32> m_wedge;           // ring of referenced vertices with the same position
+	eastl::vector<uint8>  m_kind;
+	eastl::vector<uint32> m_triangleOffsets; // triangles per position
+	eastl::vector<uint32> m_triangles;
+
+	bool hasEdge(uint32 _a, uint32 _b) const
+	{
+		for (uint32 i = m_edgeOffsets[_a]; i < m_edgeOffsets[_a + 1]; ++i) {
+			if (m_edges[i] == _b) {
+				return true;
+			}
+		}
+		return false;
+	}
+
+	// Whether _v1 is adjacent to _v0 along _v0's open edge loop.
+	bool isOpenEdge(uint32 _v0, uint32 _v1) const
+	{
+		return m_openOut[_v0] == _v1 || m_openIn[_v0] == _v1;
+	}
+
+	void build(const uint32* _indices, uint32 _indexCount, const uint32* _remap, uint32 _vertexCount);
+};
+
+void Topology::build(const uint32* _indices, uint32 _indexCount, const uint32* _remap, uint32 _vertexCount)
+{
+	m_edgeOffsets.assign(_vertexCount + 1, 0);
+	for (uint32 i = 0; i < _indexCount; ++i) {
+		++m_edgeOffsets[_indices[i] + 1];
+	}
+	for (uint32 i = 0; i < _vertexCount; ++i) {
+		m_edgeOffsets[i + 1] += m_edgeOffsets[i];
+	}
+	m_edges.resize(_indexCount);
+	{	eastl::vector<uint32> fill(m_edgeOffsets.begin(), m_edgeOffsets.end() - 1);
+		for (uint32 i = 0; i < _indexCount; i += 3) {
+			for (uint32 j = 0; j < 3; ++j) {
+				uint32 a = _indices[i + j];
+				uint32 b = _indices[i + (j + 1) % 3];
+				m_edges[fill[a]++] = b;
+			}
+		}
+	}
+
+	m_openOut.assign(_vertexCount, ~0u);
+	m_openIn.assign(_vertexCount, ~0u);
+	for (uint32 a = 0; a < _vertexCount; ++a) {
+		for (uint32 i = m_edgeOffsets[a]; i < m_edgeOffsets[a + 1]; ++i) {
+			uint32 b = m_edges[i];
+			if (!hasEdge(b, a)) {
+				m_openOut[a] = m_openOut[a] == ~0u ? b : a;
+				m_openIn[b]  = m_openIn[b]  == ~0u ? a : b;
+			}
+		}
+	}
+
+	m_wedge.assign(_vertexCount, ~0u);
+	eastl::vector<uint32> first(_vertexCount, ~0u);
+	for (uint32 i = 0; i < _indexCount; ++i) {
+		uint32 v = _indices[i];
+		if (m_wedge[v] != ~0u) {
+			continue;
+		}
+		uint32& f = first[_remap[v]];
+		if (f == ~0u) {
+			f = v;
+			m_wedge[v] = v;
+		} else {
+			m_wedge[v] = m_wedge[f];
+			m_wedge[f] = v;
+		}
+	}
+
+	m_kind.assign(_vertexCount, VertexKind_Locked);
+	for (uint32 v = 0; v < _vertexCount; ++v) {
+		if (m_wedge[v] == ~0u) {
+			continue; // unreferenced
+		}
+		uint32 out = m_openOut[v];
+		uint32 in  = m_openIn[v];
+		if (m_wedge[v] == v) {
+			if (out == ~0u && in == ~0u) {
+				m_kind[v] = VertexKind_Manifold;
+			} else if (out != ~0u && out != v && in != ~0u && in != v) {
+				m_kind[v] = VertexKind_Border;
+			}
+		} else if (m_wedge[m_wedge[v]] == v) {
+		 // the open edges of both vertices must form the same loop in opposite directions
+			uint32 w    = m_wedge[v];
+			uint32 wOut = m_openOut[w];
+			uint32 wIn  = m_openIn[w];
+			if (out != ~0u && out != v && in != ~0u && in != v && wOut != ~0u && wOut != w && wIn != ~0u && wIn != w) {
+				if (_remap[out] == _remap[wIn] && _remap[in] == _remap[wOut]) {
+					m_kind[v] = VertexKind_Seam;
+				}
+			}
+		}
+	}
+
+	m_triangleOffsets.assign(_vertexCount + 1, 0);
+	for (uint32 i = 0; i < _indexCount; ++i) {
+		++m_triangleOffsets[_remap[_indices[i]] + 1];
+	}
+	for (uint32 i = 0; i < _vertexCount; ++i) {
+		m_triangleOffsets[i + 1] += m_triangleOffsets[i];
+	}
+	m_triangles.resize(_indexCount);
+	{	eastl::vector<uint32> fill(m_triangleOffsets.begin(), m_triangleOffsets.end() - 1);
+		for (uint32 i = 0; i < _indexCount; ++i) {
+			m_triangles[fill[_remap[_indices[i]]]++] = i / 3;
+		}
+	}
+}
+
+// Whether moving position _r0 to _p1 flips (or nearly degenerates) any triangle which doesn't contain _r1.
+bool HasTriangleFlip(const Topology& _topology, const uint32* _indices, const uint32* _remap, const MeshBuilder::Vertex* _vertices, uint32 _r0, uint32 _r1, const vec3& _p1)
+{
+	for (uint32 i = _topology.m_triangleOffsets[_r0]; i < _topology.m_triangleOffsets[_r0 + 1]; ++i) {
+		const uint32* tri = _indices + _topology.m_triangles[i] * 3;
+		uint32 r[3] = { _remap[tri[0]], _remap[tri[1]], _remap[tri[2]] };
+		if (r[0] == _r1 || r[1] == _r1 || r[2] == _r1) {
+			continue; // collapses
+		}
+		vec3 p[3], q[3];
+		for (uint32 j = 0; j < 3; ++j) {
+			p[j] = _vertices[tri[j]].m_position;
+			q[j] = r[j] == _r0 ? _p1 : p[j];
+		}
+		vec3 np = cross(p[1] - p[0], p[2] - p[0]);
+		vec3 nq = cross(q[1] - q[0], q[2] - q[0]);
+		if (dot(np, nq) <= 1e-2f * length(np) * length(nq)) { // also reject near degenerate results
+			return true;
+		}
+	}
+	return false;
+}
+
+} // namespace
+
+float MeshBuilder::simplify(float _targetRatio, float _maxError)
+{
+	if (m_triangles.empty() || m_vertices.empty()) {
+		return 0.0f;
+	}
+
+	struct Range
+	{
+		uint32 m_indexOffset, m_indexCount;
+	};
+	eastl::vector<Range> ranges;
+	if (m_submeshes.empty()) {
+		Range range = { 0, getIndexCount() };
+		ranges.push_back(range);
+	} else {
+		for (auto& submesh : m_submeshes) {
+			Range range = { submesh.m_indexOffset, submesh.m_indexCount };
+			ranges.push_back(range);
+		}
+	}
+
+	float radius = Sphere(&m_vertices[0].m_position, getVertexCount(), sizeof(Vertex)).m_radius;
+	float maxError = _maxError * radius;
+	float ret = 0.0f;
+	eastl::vector<uint32> indices;
+	eastl::vector<Triangle> triangles;
+	triangles.reserve(m_triangles.size());
+	for (uint32 i = 0; i < (uint32)ranges.size(); ++i) {
+		const uint32* src = &m_triangles.data()->a + ranges[i].m_indexOffset;
+		indices.assign(src, src + ranges[i].m_indexCount);
+		uint32 targetIndexCount = (uint32)((float)(ranges[i].m_indexCount / 3) * _targetRatio) * 3;
+		float error = 0.0f;
+		uint32 indexCount = Simplify(indices.data(), (uint32)indices.size(), m_vertices.data(), getVertexCount(), targetIndexCount, maxError, &error);
+		ret = APT_MAX(ret, radius > 0.0f ? error / radius : 0.0f);
+
+		if (!m_submeshes.empty()) {
+			m_submeshes[i].m_indexOffset = (uint32)triangles.size() * 3;
+			m_submeshes[i].m_indexCount  = indexCount;
+		}
+		for (uint32 j = 0; j < indexCount; j += 3) {
+			triangles.push_back(Triangle(indices[j], indices[j + 1], indices[j + 2]));
+		}
+	}
+	m_triangles.swap(triangles);
+	return ret;
+}
+
+uint32 MeshBuilder::Simplify(uint32* _indices_, uint32 _indexCount, const Vertex* _vertices, uint32 _vertexCount, uint32 _targetIndexCount, float _maxError, float* error_)
+{
+	_indexCount = _indexCount / 3 * 3;
+	if (error_) {
+		*error_ = 0.0f;
+	}
+	if (_indexCount <= _targetIndexCount || _vertexCount == 0) {
+		return _indexCount;
+	}
+
+ // only process the referenced vertex range, e.g. a single submesh of a larger vertex array
+	uint32 minIndex = _indices_[0], maxIndex = _indices_[0];
+	for (uint32 i = 1; i < _indexCount; ++i) {
+		minIndex = APT_MIN(minIndex, _indices_[i]);
+		maxIndex = APT_MAX(maxIndex, _indices_[i]);
+	}
+	APT_ASSERT(maxIndex < _vertexCount);
+	if (minIndex > 0 || maxIndex + 1 < _vertexCount) {
+		for (uint32 i = 0; i < _indexCount; ++i) {
+			_indices_[i] -= minIndex;
+		}
+		uint32 ret = Simplify(_indices_, _indexCount, _vertices + minIndex, maxIndex - minIndex + 1, _targetIndexCount, _maxError, error_);
+		for (uint32 i = 0; i < _indexCount; ++i) {
+			_indices_[i] += minIndex;
+		}
+		return ret;
+	}
+
+ // remap each vertex to the first vertex with the same position
+	eastl::vector<uint32> remap(_vertexCount);
+	{	eastl::vector<uint32> order(_vertexCount);
+		for (uint32 i = 0; i < _vertexCount; ++i) {
+			order[i] = i;
+		}
+		eastl::sort(order.begin(), order.end(),
+			[_vertices](uint32 _a, uint32 _b) {
+				const vec3& a = _vertices[_a].m_position;
+				const vec3& b = _vertices[_b].m_position;
+				if (a.x != b.x) return a.x < b.x;
+				if (a.y != b.y) return a.y < b.y;
+				if (a.z != b.z) return a.z < b.z;
+				return _a < _b;
+			});
+		for (uint32 i = 0; i < _vertexCount; ++i) {
+			uint32 v = order[i];
+			remap[v] = (i > 0 && _vertices[order[i - 1]].m_position == _vertices[v].m_position) ? remap[order[i - 1]] : v;
+		}
+	}
+
+	Topology topology;
+	topology.build(_indices_, _indexCount, remap.data(), _vertexCount);
+
+ // quadrics per position, area weighted triangle planes + border/seam planes
+	eastl::vector<Quadric> quadrics(_vertexCount);
+	memset(quadrics.data(), 0, sizeof(Quadric) * _vertexCount);
+	for (uint32 i = 0; i < _indexCount; i += 3) {
+		const vec3& p0 = _vertices[_indices_[i + 0]].m_position;
+		const vec3& p1 = _vertices[_indices_[i + 1]].m_position;
+		const vec3& p2 = _vertices[_indices_[i + 2]].m_position;
+		vec3  n    = cross(p1 - p0, p2 - p0);
+		float area = length(n);
+		if (area <= 0.0f) {
+			continue;
+		}
+		n /= area;
+		Quadric q = QuadricFromPlane(n, p0, area * 0.5f);
+		for (uint32 j = 0; j < 3; ++j) {
+			QuadricAdd(quadrics[remap[_indices_[i + j]]], q);
+		}
+
+		for (uint32 j = 0; j < 3; ++j) {
+			uint32 a = _indices_[i + j];
+			uint32 b = _indices_[i + (j + 1) % 3];
+			if (topology.m_openOut[a] != b || topology.m_kind[a] == VertexKind_Manifold) {
+				continue;
+			}
+			const vec3& pa = _vertices[a].m_position;
+			const vec3& pb = _vertices[b].m_position;
+			vec3  edge = pb - pa;
+			float len  = length(edge);
+			if (len <= 0.0f) {
+				continue;
+			}
+			vec3 en = normalize(cross(edge, n));
+			Quadric eq = QuadricFromPlane(en, pa, len * len * kBorderWeight);
+			QuadricAdd(quadrics[remap[a]], eq);
+			QuadricAdd(quadrics[remap[b]], eq);
+		}
+	}
+
+	float maxErrorSq = _maxError * _maxError;
+	float maxCost    = 0.0f;
+	uint32 indexCount = _indexCount;
+	eastl::vector<Collapse> collapses;
+	eastl::vector<uint32>   collapseRemap(_vertexCount);
+	eastl::vector<uint8>    locked(_vertexCount);
+	while (indexCount > _targetIndexCount) {
+	 // candidate collapses, in the cheapest valid direction
+		collapses.clear();
+		for (uint32 i = 0; i < indexCount; ++i) {
+			uint32 a = _indices_[i];
+			uint32 b = _indices_[i - i % 3 + (i + 1) % 3];
+			if (remap[a] == remap[b] || (a > b && topology.hasEdge(b, a))) {
+				continue; // degenerate, or the reverse half edge is also a candidate
+			}
+			Collapse collapse = { 0, 0, FLT_MAX };
+			for (uint32 dir = 0; dir < 2; ++dir) {
+				uint32 v0 = dir ? b : a;
+				uint32 v1 = dir ? a : b;
+				uint8  k0 = topology.m_kind[v0];
+				uint8  k1 = topology.m_kind[v1];
+				if (!kCanCollapse[k0][k1]) {
+					continue;
+				}
+				float attributeCost = AttributeCost(_vertices[v0], _vertices[v1]);
+				if (k0 == VertexKind_Border || k0 == VertexKind_Seam) {
+					if (!topology.isOpenEdge(v0, v1)) {
+						continue; // not along the border/seam
+					}
+					if (k0 == VertexKind_Seam) {
+						uint32 w0 = topology.m_wedge[v0];
+						uint32 w1 = topology.m_wedge[v1];
+						if (!topology.isOpenEdge(w0, w1)) {
+							continue;
+						}
+						attributeCost = APT_MAX(attributeCost, AttributeCost(_vertices[w0], _vertices[w1]));
+					}
+				}
+				const vec3& p0 = _vertices[v0].m_position;
+				const vec3& p1 = _vertices[v1].m_position;
+				float cost = QuadricError(quadrics[remap[v0]], p1) + length2(p1 - p0) * attributeCost;
+				if (cost < collapse.m_cost) {
+					collapse.m_v0   = v0;
+					collapse.m_v1   = v1;
+					collapse.m_cost = cost;
+				}
+			}
+			if (collapse.m_v0 != collapse.m_v1 && collapse.m_cost <= maxErrorSq) {
+				collapses.push_back(collapse);
+			}
+		}
+		if (collapses.empty()) {
+			break;
+		}
+		eastl::sort(collapses.begin(), collapses.end(), [](const Collapse& _a, const Collapse& _b) { return _a.m_cost < _b.m_cost; });
+
+	 // perform independent collapses until the target is reached
+		for (uint32 i = 0; i < _vertexCount; ++i) {
+			collapseRemap[i] = i;
+		}
+		memset(locked.data(), 0, _vertexCount);
+		uint32 goal = (indexCount - _targetIndexCount) / 3;
+		uint32 removed = 0;
+	 // each collapse removes ~2 triangles, limit the error in this pass relative to the cost of the collapse which would reach the goal
+		uint32 edgeGoal  = goal / 2;
+		float  errorGoal = edgeGoal < (uint32)collapses.size() ? collapses[edgeGoal].m_cost * 1.5f : FLT_MAX;
+		for (auto& collapse : collapses) {
+			if (collapse.m_cost > errorGoal) {
+				break;
+			}
+			uint32 r0 = remap[collapse.m_v0];
+			uint32 r1 = remap[collapse.m_v1];
+			if (locked[r0] || locked[r1]) {
+				continue;
+			}
+			if (HasTriangleFlip(topology, _indices_, remap.data(), _vertices, r0, r1, _vertices[collapse.m_v1].m_position)) {
+				continue;
+			}
+			collapseRemap[collapse.m_v0] = collapse.m_v1;
+			if (topology.m_kind[collapse.m_v0] == VertexKind_Seam) {
+				collapseRemap[topology.m_wedge[collapse.m_v0]] = topology.m_wedge[collapse.m_v1];
+			}
+			QuadricAdd(quadrics[r1], quadrics[r0]);
+			locked[r0] = locked[r1] = 1;
+			maxCost = APT_MAX(maxCost, collapse.m_cost);
+
+			for (uint32 j = topology.m_triangleOffsets[r0]; j < topology.m_triangleOffsets[r0 + 1]; ++j) {
+				const uint32* tri = _indices_ + topology.m_triangles[j] * 3;
+				removed += (remap[tri[0]] == r1 || remap[tri[1]] == r1 || remap[tri[2]] == r1) ? 1 : 0;
+			}
+			if (removed >= goal) {
+				break;
+			}
+		}
+		if (removed == 0) {
+			break;
+		}
+
+	 // remap, remove degenerate triangles
+		uint32 n = 0;
+		for (uint32 i = 0; i < indexCount; i += 3) {
+			uint32 a = collapseRemap[_indices_[i + 0]];
+			uint32 b = collapseRemap[_indices_[i + 1]];
+			uint32 c = collapseRemap[_indices_[i + 2]];
+			if (remap[a] == remap[b] || remap[b] == remap[c] || remap[c] == remap[a]) {
+				continue;
+			}
+			_indices_[n++] = a;
+			_indices_[n++] = b;
+			_indices_[n++] = c;
+		}
+		indexCount = n;
+		topology.build(_indices_, indexCount, remap.data(), _vertexCount);
+	}
+
+	if (error_) {
+		*error_ = sqrtf(maxCost);
+	}
+	return indexCount;
+}
+
+/*******************************************************************************
+
+                                      LODs
+
+*******************************************************************************/
+
+void MeshData::createLods(int _count, float _ratio)
+{
+	APT_ASSERT(m_desc.getPrimitive() == MeshDesc::Primitive_Triangles);
+	const VertexAttr* posAttr = m_desc.findVertexAttr(VertexAttr::Semantic_Positions);
+	APT_ASSERT(posAttr); // no positions
+
+	releaseLods();
+	_count = APT_CLAMP(_count, 1, kMaxLods);
+	if (_count < 2 || getIndexCount() == 0) {
+		return;
+	}
+
+ // only positions/normals/texcoords are used by the simplifier
+	const VertexAttr* normalsAttr   = m_desc.findVertexAttr(VertexAttr::Semantic_Normals);
+	const VertexAttr* texcoordsAttr = m_desc.findVertexAttr(VertexAttr::Semantic_Texcoords);
+	MeshBuilder::Vertex zero;
+	memset(&zero, 0, sizeof(zero));
+	eastl::vector<MeshBuilder::Vertex> vertices(getVertexCount(), zero);
+	const char* src = m_vertexData;
+	for (auto& v : vertices) {
+		DataTypeConvert(posAttr->getDataType(), DataType_Float32, src + posAttr->getOffset(), &v.m_position, APT_MIN((uint)posAttr->getCount(), 3u));
+		if (normalsAttr) {
+			DataTypeConvert(normalsAttr->getDataType(), DataType_Float32, src + normalsAttr->getOffset(), &v.m_normal, APT_MIN((uint)normalsAttr->getCount(), 3u));
+		}
+		if (texcoordsAttr) {
+			DataTypeConvert(texcoordsAttr->getDataType(), DataType_Float32, src + texcoordsAttr->getOffset(), &v.m_texcoord, APT_MIN((uint)texcoordsAttr->getCount(), 2u));
+		}
+		src += m_desc.getVertexSize();
+	}
+	eastl::vector<uint32> indices(getIndexCount());
+	DataTypeConvert(m_indexDataType, DataType_Uint32, m_indexData, indices.data(), getIndexCount());
+
+ // submesh 0 represents the whole mesh, only simplify it directly if there are no other submeshes
+	uint   indexSize = DataTypeSizeBytes(m_indexDataType);
+	uint32 first     = m_submeshes.size() > 1 ? 1 : 0;
+	eastl::vector<eastl::vector<uint32> > current(m_submeshes.size());
+	for (uint32 i = first; i < (uint32)m_submeshes.size(); ++i) {
+		const Submesh& submesh = m_submeshes[i];
+		const uint32* begin = indices.data() + submesh.m_indexOffset / indexSize;
+		current[i].assign(begin, begin + submesh.m_indexCount);
+	}
+
+	eastl::vector<uint32> lodIndices; // appended to the index data
+	uint lodCount = 1;
+	for (; lodCount < (uint)_count; ++lodCount) {
+		uint32 lodOffset = (uint32)lodIndices.size();
+		bool reduced = false;
+		for (uint32 i = first; i < (uint32)m_submeshes.size(); ++i) {
+			Submesh& submesh = m_submeshes[i];
+			eastl::vector<uint32>& lod = current[i];
+			uint32 targetIndexCount = (uint32)((float)(lod.size() / 3) * _ratio) * 3;
+			float error = 0.0f;
+			uint32 indexCount = MeshBuilder::Simplify(lod.data(), (uint32)lod.size(), vertices.data(), getVertexCount(), targetIndexCount, FLT_MAX, &error);
+			reduced |= indexCount < (uint32)lod.size();
+			lod.resize(indexCount);
+
+		 // errors accumulate as each LOD is simplified from the previous one
+			float radius = APT_MAX(submesh.m_boundingSphere.m_radius, FLT_EPSILON);
+			Lod& dst = submesh.m_lods[lodCount];
+			dst.m_indexOffset = (getIndexCount() + (uint32)lodIndices.size()) * indexSize;
+			dst.m_indexCount  = indexCount;
+			dst.m_error       = (lodCount > 1 ? submesh.m_lods[lodCount - 1].m_error : 0.0f) + error / radius;
+			lodIndices.insert(lodIndices.end(), lod.begin(), lod.end());
+		}
+		if (!reduced) {
+			lodIndices.resize(lodOffset);
+			break;
+		}
+		if (first > 0) {
+			Lod& dst = m_submeshes[0].m_lods[lodCount];
+			dst.m_indexOffset = (getIndexCount() + lodOffset) * indexSize;
+			dst.m_indexCount  = (uint32)lodIndices.size() - lodOffset;
+			dst.m_error       = 0.0f;
+			for (uint32 i = 1; i < (uint32)m_submeshes.size(); ++i) {
+				dst.m_error = APT_MAX(dst.m_error, m_submeshes[i].m_lods[lodCount].m_error);
+			}
+		}
+	}
+	if (lodCount < 2) {
+		return;
+	}
+
+	for (auto& submesh : m_submeshes) {
+		submesh.m_lodCount = lodCount;
+		submesh.m_lods[0].m_indexOffset = submesh.m_indexOffset;
+		submesh.m_lods[0].m_indexCount  = submesh.m_indexCount;
+		submesh.m_lods[0].m_error       = 0.0f;
+	}
+	m_indexData = (char*)realloc(m_indexData, (getIndexCount() + lodIndices.size()) * indexSize);
+	DataTypeConvert(DataType_Uint32, m_indexDataType, lodIndices.data(), m_indexData + getIndexCount() * indexSize, (uint)lodIndices.size());
+}
+
+uint MeshData::getIndexDataCount() const
+{
+	uint ret = getIndexCount();
+	const Submesh& submesh = m_submeshes[0];
+	for (uint i = 1; i < submesh.m_lodCount; ++i) {
+		ret += submesh.m_lods[i].m_indexCount;
+	}
+	return ret;
+}
+
+int MeshData::SelectLod(const Submesh& _submesh, const Sphere& _worldSphere, const Camera& _camera, float _maxError)
+{
+	if (_submesh.m_lodCount < 2) {
+		return 0;
+	}
+
+ // scale from world units to a fraction of the viewport height at the nearest point on the sphere
+	float height = fabs(_camera.m_up - _camera.m_down);
+	float scale;
+	if (_camera.getProjFlag(Camera::ProjFlag_Orthographic)) {
+		scale = 1.0f / height;
+	} else {
+		float distance = length(_worldSphere.m_origin - _camera.getPosition()) - _worldSphere.m_radius;
+		if (distance <= 0.0f) {
+			return 0;
+		}
+		scale = 1.0f / (distance * height);
+	}
+	for (int i = (int)_submesh.m_lodCount - 1; i > 0; --i) {
+		if (_submesh.m_lods[i].m_error * _worldSphere.m_radius * scale <= _maxError) {
+			return i;
+		}
+	}
+	return 0;
+}
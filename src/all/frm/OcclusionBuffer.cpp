@@ -0,0 +1,378 @@
+#include <frm/OcclusionBuffer.h>
+
+#include <frm/Camera.h>
+#include <frm/MeshData.h>
+#include <frm/Profiler.h>
+
+#include <EASTL/algorithm.h>
+#include <EASTL/utility.h> // eastl::swap
+
+#if defined(_M_X64) || defined(__SSE2__)
+	#define OcclusionBuffer_SSE
+	#include <emmintrin.h>
+#endif
+
+using namespace frm;
+using namespace apt;
+
+// Triangles are clipped to a guard band around the viewport, this limits the magnitude of the screen space
+// coordinates and hence the precision loss when evaluating the edge functions.
+static const float kGuardBand = 2.0f;
+
+/*******************************************************************************
+
+                              OcclusionBuffer
+
+*******************************************************************************/
+
+OcclusionBuffer::Occluder::Occluder(const MeshData& _meshData)
+{
+	const MeshDesc& desc = _meshData.getDesc();
+	APT_ASSERT(desc.getPrimitive() == MeshDesc::Primitive_Triangles);
+	const VertexAttr* posAttr = desc.findVertexAttr(VertexAttr::Semantic_Positions);
+	APT_ASSERT(posAttr); // no positions
+
+	m_positions.resize(_meshData.getVertexCount(), vec3(0.0f));
+	m_boundingBox = AlignedBox(vec3(FLT_MAX), vec3(-FLT_MAX));
+	const char* src = (const char*)_meshData.getVertexData() + posAttr->getOffset();
+	for (auto& position : m_positions) {
+		DataTypeConvert(posAttr->getDataType(), DataType_Float32, src, &position, APT_MIN((uint)posAttr->getCount(), 3u));
+		m_boundingBox.m_min = min(m_boundingBox.m_min, position);
+		m_boundingBox.m_max = max(m_boundingBox.m_max, position);
+		src += desc.getVertexSize();
+	}
+
+	m_indices.resize(_meshData.getIndexCount());
+	DataTypeConvert(_meshData.getIndexDataType(), DataType_Uint32, _meshData.getIndexData(), m_indices.data(), (uint)m_indices.size());
+}
+
+// PUBLIC
+
+OcclusionBuffer::OcclusionBuffer(int _width, int _height)
+	: m_viewProj(identity)
+	, m_minW(0.0f)
+	, m_depthSign(1.0f)
+	, m_triangleCount(0)
+{
+	setResolution(_width, _height);
+}
+
+void OcclusionBuffer::setResolution(int _width, int _height)
+{
+	APT_ASSERT(_width > 0 && _height > 0);
+	m_width  = (_width + 3) & ~3;
+	m_height = _height;
+	m_depth.resize(m_width * m_height);
+
+	m_levels.clear();
+	int w = m_width;
+	int h = m_height;
+	while (w > 1 || h > 1) {
+		w = APT_MAX((w + 1) / 2, 1);
+		h = APT_MAX((h + 1) / 2, 1);
+		m_levels.push_back();
+		m_levels.back().m_width  = w;
+		m_levels.back().m_height = h;
+		m_levels.back().m_minMax.resize(w * h);
+	}
+}
+
+void OcclusionBuffer::begin(const Camera& _camera)
+{
+	PROFILER_MARKER_CPU("OcclusionBuffer::begin");
+
+	m_viewProj      = _camera.m_viewProj;
+	m_minW          = _camera.getProjFlag(Camera::ProjFlag_Orthographic) ? 0.0f : _camera.m_near;
+	m_depthSign     = _camera.getProjFlag(Camera::ProjFlag_Reversed) ? -1.0f : 1.0f;
+	m_triangleCount = 0;
+	eastl::fill(m_depth.begin(), m_depth.end(), FLT_MAX);
+}
+
+void OcclusionBuffer::rasterize(const Occluder& _occluder, const mat4& _world, bool _cullBackface)
+{
+	PROFILER_MARKER_CPU("OcclusionBuffer::rasterize");
+
+	mat4 worldViewProj = m_viewProj * _world;
+	m_clipPositions.resize(_occluder.m_positions.size());
+	vec4* clipPositions = m_clipPositions.data();
+	for (size_t i = 0; i < _occluder.m_positions.size(); ++i) {
+		clipPositions[i] = worldViewProj * vec4(_occluder.m_positions[i], 1.0f);
+	}
+
+ // clip planes as dot(plane, v) >= 0: near, then the guard band
+	const vec4 kClipPlanes[] =
+	{
+		vec4( 0.0f,  0.0f, 0.0f, 1.0f),
+		vec4(-1.0f,  0.0f, 0.0f, kGuardBand),
+		vec4( 1.0f,  0.0f, 0.0f, kGuardBand),
+		vec4( 0.0f, -1.0f, 0.0f, kGuardBand),
+		vec4( 0.0f,  1.0f, 0.0f, kGuardBand),
+	};
+	const int kClipPlaneCount = APT_ARRAY_COUNT(kClipPlanes);
+	float clipOffsets[kClipPlaneCount] = { -m_minW, 0.0f, 0.0f, 0.0f, 0.0f };
+
+	for (size_t i = 0; i + 2 < _occluder.m_indices.size(); i += 3) {
+		const vec4& v0 = clipPositions[_occluder.m_indices[i + 0]];
+		const vec4& v1 = clipPositions[_occluder.m_indices[i + 1]];
+		const vec4& v2 = clipPositions[_occluder.m_indices[i + 2]];
+
+	 // trivial accept/reject
+		uint32 outside[3] = { 0u, 0u, 0u };
+		for (int j = 0; j < kClipPlaneCount; ++j) {
+			outside[0] |= (dot(kClipPlanes[j], v0) + clipOffsets[j] < 0.0f) ? (1u << j) : 0u;
+			outside[1] |= (dot(kClipPlanes[j], v1) + clipOffsets[j] < 0.0f) ? (1u << j) : 0u;
+			outside[2] |= (dot(kClipPlanes[j], v2) + clipOffsets[j] < 0.0f) ? (1u << j) : 0u;
+		}
+		if (outside[0] & outside[1] & outside[2]) {
+			continue;
+		}
+		if ((outside[0] | outside[1] | outside[2]) == 0) {
+			rasterizeTriangle(v0, v1, v2, _cullBackface);
+			continue;
+		}
+
+	 // clip the polygon against each plane which has a vertex outside, then triangulate as a fan
+		vec4 polyA[3 + kClipPlaneCount];
+		vec4 polyB[3 + kClipPlaneCount];
+		vec4* poly = polyA;
+		vec4* clipped = polyB;
+		int count = 3;
+		poly[0] = v0; poly[1] = v1; poly[2] = v2;
+		uint32 clipMask = outside[0] | outside[1] | outside[2];
+		for (int j = 0; j < kClipPlaneCount && count >= 3; ++j) {
+			if ((clipMask & (1u << j)) == 0) {
+				continue;
+			}
+			int clippedCount = 0;
+			for (int k = 0; k < count; ++k) {
+				const vec4& a = poly[k];
+				const vec4& b = poly[(k + 1) % count];
+				float da = dot(kClipPlanes[j], a) + clipOffsets[j];
+				float db = dot(kClipPlanes[j], b) + clipOffsets[j];
+				if (da >= 0.0f) {
+					clipped[clippedCount++] = a;
+				}
+				if ((da >= 0.0f) != (db >= 0.0f)) {
+					clipped[clippedCount++] = a + (b - a) * (da / (da - db));
+				}
+			}
+			eastl::swap(poly, clipped);
+			count = clippedCount;
+		}
+		for (int k = 2; k < count; ++k) {
+			rasterizeTriangle(poly[0], poly[k - 1], poly[k], _cullBackface);
+		}
+	}
+}
+
+void OcclusionBuffer::end()
+{
+	PROFILER_MARKER_CPU("OcclusionBuffer::end");
+
+ // each level stores the min/max of a 2x2 footprint in the previous level, clamped at the edges for odd sizes
+	int srcWidth  = m_width;
+	int srcHeight = m_height;
+	for (int level = 0; level < (int)m_levels.size(); ++level) {
+		Level& dst = m_levels[level];
+		for (int y = 0; y < dst.m_height; ++y) {
+			int sy0 = y * 2;
+			int sy1 = APT_MIN(sy0 + 1, srcHeight - 1);
+			for (int x = 0; x < dst.m_width; ++x) {
+				int sx0 = x * 2;
+				int sx1 = APT_MIN(sx0 + 1, srcWidth - 1);
+				vec2 ret;
+				if (level == 0) {
+					const float* src = m_depth.data();
+					float s00 = src[sy0 * srcWidth + sx0];
+					float s10 = src[sy0 * srcWidth + sx1];
+					float s01 = src[sy1 * srcWidth + sx0];
+					float s11 = src[sy1 * srcWidth + sx1];
+					ret.x = APT_MIN(APT_MIN(s00, s10), APT_MIN(s01, s11));
+					ret.y = APT_MAX(APT_MAX(s00, s10), APT_MAX(s01, s11));
+				} else {
+					const vec2* src = m_levels[level - 1].m_minMax.data();
+					vec2 s00 = src[sy0 * srcWidth + sx0];
+					vec2 s10 = src[sy0 * srcWidth + sx1];
+					vec2 s01 = src[sy1 * srcWidth + sx0];
+					vec2 s11 = src[sy1 * srcWidth + sx1];
+					ret.x = APT_MIN(APT_MIN(s00.x, s10.x), APT_MIN(s01.x, s11.x));
+					ret.y = APT_MAX(APT_MAX(s00.y, s10.y), APT_MAX(s01.y, s11.y));
+				}
+				dst.m_minMax[y * dst.m_width + x] = ret;
+			}
+		}
+		srcWidth  = dst.m_width;
+		srcHeight = dst.m_height;
+	}
+}
+
+bool OcclusionBuffer::isOccluded(const AlignedBox& _box) const
+{
+ // project the box corners, find the screen rect + nearest depth
+	vec3 vertices[8];
+	_box.getVertices(vertices);
+	vec2  rectMin(FLT_MAX);
+	vec2  rectMax(-FLT_MAX);
+	float depth = FLT_MAX;
+	for (auto& v : vertices) {
+		vec4 p = m_viewProj * vec4(v, 1.0f);
+		if (p.w < m_minW) {
+			return false; // box intersects the near plane
+		}
+		float rw = 1.0f / p.w;
+		vec2 s = (p.xy() * rw * 0.5f + 0.5f) * vec2((float)m_width, (float)m_height);
+		rectMin = min(rectMin, s);
+		rectMax = max(rectMax, s);
+		depth = APT_MIN(depth, p.z * rw * m_depthSign);
+	}
+	int x0 = APT_MAX((int)floor(rectMin.x), 0);
+	int y0 = APT_MAX((int)floor(rectMin.y), 0);
+	int x1 = APT_MIN((int)floor(rectMax.x), m_width - 1);
+	int y1 = APT_MIN((int)floor(rectMax.y), m_height - 1);
+	if (x0 > x1 || y0 > y1) {
+		return false; // offscreen, leave it to frustum culling
+	}
+
+ // start at the level where the rect covers at most 2x2 texels
+	int level = 0;
+	while (level < getLevelCount() - 1 && ((x1 >> level) - (x0 >> level) > 1 || (y1 >> level) - (y0 >> level) > 1)) {
+		++level;
+	}
+	return isOccluded(level, x0, y0, x1, y1, depth);
+}
+
+vec2 OcclusionBuffer::getMinMax(int _level, int _x, int _y) const
+{
+	if (_level == 0) {
+		APT_ASSERT(_x < m_width && _y < m_height);
+		float d = m_depth[_y * m_width + _x];
+		return vec2(d);
+	}
+	const Level& level = m_levels[_level - 1];
+	APT_ASSERT(_x < level.m_width && _y < level.m_height);
+	return level.m_minMax[_y * level.m_width + _x];
+}
+
+// PRIVATE
+
+void OcclusionBuffer::rasterizeTriangle(const vec4& _v0, const vec4& _v1, const vec4& _v2, bool _cullBackface)
+{
+ // project to screen space, xy = pixel coordinates, z = depth
+	vec2 scale = vec2((float)m_width, (float)m_height) * 0.5f;
+	vec3 s[3];
+	const vec4* v[3] = { &_v0, &_v1, &_v2 };
+	for (int i = 0; i < 3; ++i) {
+		float rw = 1.0f / v[i]->w;
+		s[i] = vec3((v[i]->xy() * rw + 1.0f) * scale, v[i]->z * rw * m_depthSign);
+	}
+
+	float area = (s[1].x - s[0].x) * (s[2].y - s[0].y) - (s[2].x - s[0].x) * (s[1].y - s[0].y);
+	if (area == 0.0f) {
+		return;
+	}
+	if (area < 0.0f) {
+		if (_cullBackface) {
+			return;
+		}
+		eastl::swap(s[1], s[2]);
+		area = -area;
+	}
+
+	int xmin = APT_MAX((int)floor(APT_MIN(s[0].x, APT_MIN(s[1].x, s[2].x))), 0);
+	int ymin = APT_MAX((int)floor(APT_MIN(s[0].y, APT_MIN(s[1].y, s[2].y))), 0);
+	int xmax = APT_MIN((int)floor(APT_MAX(s[0].x, APT_MAX(s[1].x, s[2].x))), m_width - 1);
+	int ymax = APT_MIN((int)floor(APT_MAX(s[0].y, APT_MAX(s[1].y, s[2].y))), m_height - 1);
+	if (xmin > xmax || ymin > ymax) {
+		return;
+	}
+	xmin &= ~3; // align to the SIMD width
+	++m_triangleCount;
+
+ // edge functions E(x, y) = A * x + B * y + C, positive inside; edge i is opposite vertex i
+	float A[3], B[3], C[3];
+	for (int i = 0; i < 3; ++i) {
+		const vec3& a = s[(i + 1) % 3];
+		const vec3& b = s[(i + 2) % 3];
+		A[i] = a.y - b.y;
+		B[i] = b.x - a.x;
+		C[i] = -(A[i] * a.x + B[i] * a.y);
+	}
+ // depth plane, the normalized edge functions are the barycentrics
+	float rcpArea = 1.0f / area;
+	float dz1 = (s[1].z - s[0].z) * rcpArea;
+	float dz2 = (s[2].z - s[0].z) * rcpArea;
+	float zA  = A[1] * dz1 + A[2] * dz2;
+	float zB  = B[1] * dz1 + B[2] * dz2;
+	float zC  = C[1] * dz1 + C[2] * dz2 + s[0].z;
+
+	#ifdef OcclusionBuffer_SSE
+		const __m128 kZero = _mm_setzero_ps();
+		const __m128 laneX = _mm_setr_ps(0.5f, 1.5f, 2.5f, 3.5f);
+		__m128 a0 = _mm_set1_ps(A[0]), a1 = _mm_set1_ps(A[1]), a2 = _mm_set1_ps(A[2]);
+		__m128 za = _mm_set1_ps(zA);
+		for (int y = ymin; y <= ymax; ++y) {
+			float py = (float)y + 0.5f;
+			float* row = m_depth.data() + y * m_width;
+			__m128 px = _mm_add_ps(_mm_set1_ps((float)xmin), laneX);
+			__m128 e0 = _mm_add_ps(_mm_mul_ps(a0, px), _mm_set1_ps(B[0] * py + C[0]));
+			__m128 e1 = _mm_add_ps(_mm_mul_ps(a1, px), _mm_set1_ps(B[1] * py + C[1]));
+			__m128 e2 = _mm_add_ps(_mm_mul_ps(a2, px), _mm_set1_ps(B[2] * py + C[2]));
+			__m128 z  = _mm_add_ps(_mm_mul_ps(za, px), _mm_set1_ps(zB * py + zC));
+			__m128 e0Step = _mm_set1_ps(A[0] * 4.0f);
+			__m128 e1Step = _mm_set1_ps(A[1] * 4.0f);
+			__m128 e2Step = _mm_set1_ps(A[2] * 4.0f);
+			__m128 zStep  = _mm_set1_ps(zA * 4.0f);
+			for (int x = xmin; x <= xmax; x += 4) {
+				__m128 inside = _mm_and_ps(_mm_and_ps(_mm_cmpgt_ps(e0, kZero), _mm_cmpgt_ps(e1, kZero)), _mm_cmpgt_ps(e2, kZero));
+				if (_mm_movemask_ps(inside)) {
+					__m128 d = _mm_loadu_ps(row + x);
+					__m128 dmin = _mm_min_ps(d, z);
+					_mm_storeu_ps(row + x, _mm_or_ps(_mm_and_ps(inside, dmin), _mm_andnot_ps(inside, d)));
+				}
+				e0 = _mm_add_ps(e0, e0Step);
+				e1 = _mm_add_ps(e1, e1Step);
+				e2 = _mm_add_ps(e2, e2Step);
+				z  = _mm_add_ps(z,  zStep);
+			}
+		}
+	#else
+		for (int y = ymin; y <= ymax; ++y) {
+			float py = (float)y + 0.5f;
+			float* row = m_depth.data() + y * m_width;
+			for (int x = xmin; x <= xmax; ++x) {
+				float px = (float)x + 0.5f;
+				float e0 = A[0] * px + B[0] * py + C[0];
+				float e1 = A[1] * px + B[1] * py + C[1];
+				float e2 = A[2] * px + B[2] * py + C[2];
+				if (e0 > 0.0f && e1 > 0.0f && e2 > 0.0f) {
+					float z = zA * px + zB * py + zC;
+					row[x] = APT_MIN(row[x], z);
+				}
+			}
+		}
+	#endif
+}
+
+bool OcclusionBuffer::isOccluded(int _level, int _x0, int _y0, int _x1, int _y1, float _depth) const
+{
+	for (int ty = _y0 >> _level, ty1 = _y1 >> _level; ty <= ty1; ++ty) {
+		for (int tx = _x0 >> _level, tx1 = _x1 >> _level; tx <= tx1; ++tx) {
+			vec2 minMax = getMinMax(_level, tx, ty);
+			if (_depth > minMax.y) {
+				continue; // behind everything in this texel
+			}
+			if (_level == 0 || _depth <= minMax.x) {
+				return false; // in front of something in this texel
+			}
+		 // ambiguous, refine the part of the rect covered by this texel
+			int x0 = APT_MAX(_x0, tx << _level);
+			int y0 = APT_MAX(_y0, ty << _level);
+			int x1 = APT_MIN(_x1, ((tx + 1) << _level) - 1);
+			int y1 = APT_MIN(_y1, ((ty + 1) << _level) - 1);
+			if (!isOccluded(_level - 1, x0, y0, x1, y1, _depth)) {
+				return false;
+			}
+		}
+	}
+	return true;
+}
@@ -0,0 +1,96 @@
+#pragma once
+#ifndef frm_OcclusionBuffer_h
+#define frm_OcclusionBuffer_h
+
+#include <frm/def.h>
+#include <frm/geom.h>
+#include <frm/math.h>
+
+#include <EASTL/vector.h>
+
+namespace frm {
+
+////////////////////////////////////////////////////////////////////////////////
+// OcclusionBuffer
+// Low resolution CPU depth buffer for software occlusion culling. Occluders are
+// rasterized (4 pixels at a time with SSE) using the camera's view-projection
+// matrix, then a min/max depth pyramid is built (as per MinMax_cs.glsl) and
+// used to test bounding boxes before any draw calls are issued.
+//
+// Usage:
+//   occlusionBuffer.begin(*camera);
+//   occlusionBuffer.rasterize(occluder, worldMatrix); // for each occluder
+//   occlusionBuffer.end();
+//   if (!occlusionBuffer.isOccluded(worldBox)) { draw }
+//
+// Depth values are stored such that smaller = closer (NDC z is negated for
+// reversed projections), cleared to FLT_MAX. Rows are stored bottom-up, as
+// per GL textures. Tests are conservative: pixels on triangle edges aren't
+// written, boxes which intersect the near plane are never occluded.
+////////////////////////////////////////////////////////////////////////////////
+class OcclusionBuffer
+{
+public:
+	// Occluder geometry; positions are converted to float and indices to uint32 on init.
+	struct Occluder
+	{
+		eastl::vector<vec3>   m_positions;
+		eastl::vector<uint32> m_indices;
+		AlignedBox            m_boundingBox;
+
+		Occluder() {}
+		Occluder(const MeshData& _meshData);
+	};
+
+	// _width is rounded up to a multiple of 4.
+	OcclusionBuffer(int _width = 256, int _height = 128);
+
+	void setResolution(int _width, int _height);
+
+	// Clear the depth buffer, set the view-projection matrix from _camera.
+	void begin(const Camera& _camera);
+	// Rasterize _occluder transformed by _world.
+	void rasterize(const Occluder& _occluder, const mat4& _world, bool _cullBackface = true);
+	// Build the min/max pyramid. Call after all occluders are rasterized, before calling isOccluded().
+	void end();
+
+	// Return true if _box is entirely hidden by the rasterized occluders.
+	bool isOccluded(const AlignedBox& _box) const;
+
+	int          getWidth() const                   { return m_width;  }
+	int          getHeight() const                  { return m_height; }
+	const float* getDepth() const                   { return m_depth.data(); }
+	int          getLevelCount() const              { return (int)m_levels.size() + 1; }
+	// Min/max depth at texel _x,_y of pyramid level _level. Level 0 is the depth buffer.
+	vec2         getMinMax(int _level, int _x, int _y) const;
+
+	uint32       getTriangleCount() const           { return m_triangleCount; } // rasterized since begin()
+
+private:
+	struct Level
+	{
+		int                 m_width;
+		int                 m_height;
+		eastl::vector<vec2> m_minMax;
+	};
+
+	int                  m_width;
+	int                  m_height;
+	eastl::vector<float> m_depth;
+	eastl::vector<Level> m_levels;  // pyramid levels 1..n
+	mat4                 m_viewProj;
+	float                m_minW;      // clip space w at the near plane (perspective only)
+	float                m_depthSign;
+	uint32               m_triangleCount;
+	eastl::vector<vec4>  m_clipPositions; // rasterize() scratch, reused to avoid per call allocation
+
+	void rasterizeTriangle(const vec4& _v0, const vec4& _v1, const vec4& _v2, bool _cullBackface);
+
+	// Recursively test _level texels overlapping the pixel rect [_x0,_x1],[_y0,_y1] against _depth.
+	bool isOccluded(int _level, int _x0, int _y0, int _x1, int _y1, float _depth) const;
+
+}; // class OcclusionBuffer
+
+} // namespace frm
+
+#endif // frm_OcclusionBuffer_h
@@ -14,6 +14,9 @@
 #include <EASTL/vector.h>
 #include <EASTL/vector_map.h>
 
+#include <mutex>
+#include <thread>
+
 using namespace frm;
 using namespace apt;
 
@@ -360,6 +363,65 @@ auto          g_GpuMarkerStopQueries  = eastl::vector<GLuint>(kFrameCount * kMax
 uint32        g_GpuFrameGetBegin      = 0; // see NextFrame()
 uint32        g_GpuMarkerGetBegin     = 0; //      "
 
+// CPU markers from threads other than the main thread are recorded into a per-thread buffer (the ProfilerData marker stack
+// isn't thread safe) and copied into g_CpuData during NextFrame(). Thread data is never freed as there's no way to know when
+// a thread exits; index 0 is reserved for the main thread.
+struct CpuThreadData
+{
+	uint8                             m_threadIndex;
+	eastl::vector<Profiler::Marker>   m_markerStack; // only accessed by the owning thread
+	eastl::vector<Profiler::Marker>   m_markers;     // popped markers, waiting for NextFrame()
+	std::mutex                        m_mutex;       // protects m_markers
+
+	CpuThreadData(uint8 _threadIndex)
+		: m_threadIndex(_threadIndex)
+	{
+		m_markerStack.reserve(8);
+	}
+};
+const int                         kMaxCpuThreads    = 256; // Marker::m_threadIndex is a uint8
+CpuThreadData*                    g_CpuThreads[kMaxCpuThreads];
+int                               g_CpuThreadCount  = 1;
+std::mutex                        g_CpuThreadMutex;      // protects g_CpuThreads, g_CpuThreadCount
+static APT_THREAD_LOCAL CpuThreadData* s_cpuThread  = nullptr;
+
+// Static initialization runs on the main thread.
+static const std::thread::id s_mainThreadId = std::this_thread::get_id();
+static bool IsMainThread()
+{
+	return std::this_thread::get_id() == s_mainThreadId;
+}
+
+CpuThreadData* GetCpuThread()
+{
+	if_unlikely (!s_cpuThread) {
+		std::lock_guard<std::mutex> lock(g_CpuThreadMutex);
+		if (g_CpuThreadCount == kMaxCpuThreads) {
+			APT_ASSERT_MSG(false, "Profiler: too many threads pushed CPU markers (max %d)", kMaxCpuThreads);
+			return nullptr;
+		}
+		s_cpuThread = APT_NEW(CpuThreadData((uint8)g_CpuThreadCount));
+		g_CpuThreads[g_CpuThreadCount++] = s_cpuThread;
+	}
+	return s_cpuThread;
+}
+
+// Copy popped markers from all threads into g_CpuData, or discard them if _discard (profiler paused).
+void FlushCpuThreads(bool _discard)
+{
+	std::lock_guard<std::mutex> lock(g_CpuThreadMutex);
+	for (int i = 1; i < g_CpuThreadCount; ++i) {
+		CpuThreadData& thread = *g_CpuThreads[i];
+		std::lock_guard<std::mutex> threadLock(thread.m_mutex);
+		if (!_discard) {
+			for (auto& marker : thread.m_markers) {
+				g_CpuData.m_markers->push_back(marker);
+			}
+		}
+		thread.m_markers.clear();
+	}
+}
+
 uint64 GpuToSystemTicks(GLuint64 _gpuTime)
 {
 	return (uint64)_gpuTime * Time::GetSystemFrequency() / 1000000000ull; // nanoseconds -> system ticks
@@ -456,9 +518,12 @@ void Profiler::NextFrame()
 	++s_frameIndex;
 
 	if (s_pause && s_setPause) {
+		FlushCpuThreads(true);
 		return;
 	}
 
+ // markers from other threads go into the frame which ends here, regardless of when they were pushed
+	FlushCpuThreads(false);
 	g_CpuData.endFrame();
 	g_CpuData.trackMarkers(g_CpuData.m_frames->back());
 	g_CpuData.beginFrame();
@@ -481,14 +546,44 @@ void Profiler::NextFrame()
 
 void Profiler::PushCpuMarker(const char* _name)
 {
-	if (!s_pause) {
-		g_CpuData.pushMarker(_name).m_startTime = (uint64)Time::GetTimestamp().getRaw();
+	if (IsMainThread()) {
+		if (!s_pause) {
+			g_CpuData.pushMarker(_name).m_startTime = (uint64)Time::GetTimestamp().getRaw();
+		}
+		return;
+	}
+
+ // other threads ignore s_pause (which may change between a push and the matching pop), FlushCpuThreads() discards markers
+ // while paused
+	CpuThreadData* thread = GetCpuThread();
+	if (thread) {
+		APT_ASSERT(thread->m_markerStack.size() < APT_DATA_TYPE_MAX(decltype(Profiler::Marker::m_stackDepth)));
+		Marker newMarker;
+		newMarker.m_name        = _name;
+		newMarker.m_stackDepth  = (decltype(Marker::m_stackDepth))thread->m_markerStack.size();
+		newMarker.m_threadIndex = thread->m_threadIndex;
+		newMarker.m_startTime   = (uint64)Time::GetTimestamp().getRaw();
+		thread->m_markerStack.push_back(newMarker);
 	}
 }
 void Profiler::PopCpuMarker(const char* _name)
 {
-	if (!s_pause) {
-		g_CpuData.popMarker(_name).m_stopTime = (uint64)Time::GetTimestamp().getRaw();
+	if (IsMainThread()) {
+		if (!s_pause) {
+			g_CpuData.popMarker(_name).m_stopTime = (uint64)Time::GetTimestamp().getRaw();
+		}
+		return;
+	}
+
+	CpuThreadData* thread = GetCpuThread();
+	if (thread) {
+		Marker marker = thread->m_markerStack.back();
+		thread->m_markerStack.pop_back();
+		APT_ASSERT_MSG(strcmp(marker.m_name, _name) == 0, "Unmatched marker push/pop '%s'/'%s'", marker.m_name, _name);
+		marker.m_stopTime = (uint64)Time::GetTimestamp().getRaw();
+		{	std::lock_guard<std::mutex> lock(thread->m_mutex);
+			thread->m_markers.push_back(marker);
+		}
 	}
 }
 
@@ -607,6 +702,24 @@ static void DrawDataMarkers(ProfilerData& _data, ImU32 _color, float _begY, floa
 	_begY += kFrameBarHeight + 1.0f;
 	auto textColor   = ImGui::ColorInvertRGB(_color);
 
+ // each thread gets a lane, sized by the deepest marker stack currently in the buffer
+	int laneDepth[kMaxCpuThreads];
+	for (int i = 0; i < kMaxCpuThreads; ++i) {
+		laneDepth[i] = -1;
+	}
+	for (uint32 i = 0; i < _data.m_markers->capacity(); ++i) {
+		auto& marker = _data.m_markers->at_absolute(i);
+		if (marker.m_name) {
+			laneDepth[marker.m_threadIndex] = APT_MAX(laneDepth[marker.m_threadIndex], (int)marker.m_stackDepth);
+		}
+	}
+	float laneY[kMaxCpuThreads];
+	float y = _begY;
+	for (int i = 0; i < kMaxCpuThreads; ++i) {
+		laneY[i] = y;
+		y += (kMarkerHeight + 1.0f) * (float)(laneDepth[i] + 1);
+	}
+
  // draw markers
 	for (uint32 i = 0; i < _data.m_frames->capacity() - 1; ++i) {
 		auto& thisFrame = _data.m_frames->at_relative(i);
@@ -632,17 +745,14 @@ static void DrawDataMarkers(ProfilerData& _data, ImU32 _color, float _begY, floa
 			auto& marker    = _data.m_markers->at_absolute(j);
 			float markerBeg = ImGui::VirtualWindow::ToWindowX((float)Timestamp(marker.m_startTime - rangeStart).asMilliseconds());
 			float markerEnd = ImGui::VirtualWindow::ToWindowX((float)Timestamp(marker.m_stopTime  - rangeStart).asMilliseconds());
-			if (markerEnd < windowBeg.x) {
+			if (markerEnd < windowBeg.x || markerBeg > windowEnd.x) { // markers from other threads aren't sorted by time
 				continue;
 			}
-			if (markerBeg > windowEnd.x) {
-				break;
-			}
 			
 			markerBeg         = APT_MAX(markerBeg, windowBeg.x);        // clamp at window edge = keep label in view
 			markerEnd         = APT_MIN(markerEnd, windowEnd.x) - 1.0f; //                   "
 			float markerWidth = markerEnd - markerBeg;
-			float markerY     = _begY + (kMarkerHeight + 1.0f) * (float)marker.m_stackDepth;
+			float markerY     = laneY[marker.m_threadIndex] + (kMarkerHeight + 1.0f) * (float)marker.m_stackDepth;
 
 		 // apply filter
 			auto  nameLen     = strlen(marker.m_name);
@@ -683,6 +793,9 @@ static void DrawDataMarkers(ProfilerData& _data, ImU32 _color, float _begY, floa
 				ImGui::BeginTooltip();
 					ImGui::TextColored(ImGui::ColorConvertU32ToFloat4(_color), marker.m_name);
 					ImGui::Text("Duration: %s (%.3f%%)", markerDuration.asString(), markerPercent);
+					if (marker.m_threadIndex) {
+						ImGui::Text("Thread:   %u", (uint32)marker.m_threadIndex);
+					}
 					if (marker.m_issueTime) {
 						ImGui::Text("Latency:  %s", markerLatency.asString());
 					}
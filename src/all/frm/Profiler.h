@@ -42,6 +42,7 @@ public:
 		uint64      m_startTime   = 0;
 		uint64      m_stopTime    = 0;
 		uint8       m_stackDepth  = 0;
+		uint8       m_threadIndex = 0;        // 0 for the main thread, CPU markers from each thread are drawn in a separate lane
 	};
 
 	struct Frame
@@ -82,7 +83,8 @@ public:
 	// Get the index for the current frame (first frame is 1).
 	static uint64 GetFrameIndex() { return s_frameIndex; }
 	
-	// Push/pop a CPU marker. _name must point to a string literal.
+	// Push/pop a CPU marker. _name must point to a string literal. Markers pushed from threads other than the main thread are
+	// buffered per thread and appear in the timeline once popped, after the next call to NextFrame().
 	static void   PushCpuMarker(const char* _name);
 	static void   PopCpuMarker(const char* _name);
 
@@ -0,0 +1,319 @@
+#include <frm/RayPacket.h>
+
+#if defined(_M_X64) || defined(__SSE2__)
+	#define RayPacket_SSE
+	#include <emmintrin.h>
+#endif
+#if defined(__AVX__)
+	#define RayPacket_AVX
+	#include <immintrin.h>
+#endif
+
+using namespace frm;
+using namespace apt;
+
+#ifdef RayPacket_SSE
+
+namespace {
+
+// Thin wrappers over the SIMD types so that the intersection tests below can be written once for any packet size.
+// Comparisons return a lane mask (all bits set/clear).
+
+struct Float4
+{
+	__m128 v;
+
+	Float4() {}
+	Float4(__m128 _v): v(_v)                      {}
+	explicit Float4(float _f): v(_mm_set1_ps(_f)) {}
+
+	static Float4 Load(const float* _src)         { return _mm_loadu_ps(_src); }
+	void          store(float* dst_) const        { _mm_storeu_ps(dst_, v);    }
+	uint32        mask() const                    { return (uint32)_mm_movemask_ps(v); }
+};
+inline Float4 operator+(const Float4& _a, const Float4& _b)  { return _mm_add_ps(_a.v, _b.v); }
+inline Float4 operator-(const Float4& _a, const Float4& _b)  { return _mm_sub_ps(_a.v, _b.v); }
+inline Float4 operator*(const Float4& _a, const Float4& _b)  { return _mm_mul_ps(_a.v, _b.v); }
+inline Float4 operator/(const Float4& _a, const Float4& _b)  { return _mm_div_ps(_a.v, _b.v); }
+inline Float4 operator&(const Float4& _a, const Float4& _b)  { return _mm_and_ps(_a.v, _b.v); }
+inline Float4 operator|(const Float4& _a, const Float4& _b)  { return _mm_or_ps(_a.v, _b.v);  }
+inline Float4 operator< (const Float4& _a, const Float4& _b) { return _mm_cmplt_ps(_a.v, _b.v); }
+inline Float4 operator<=(const Float4& _a, const Float4& _b) { return _mm_cmple_ps(_a.v, _b.v); }
+inline Float4 operator> (const Float4& _a, const Float4& _b) { return _mm_cmpgt_ps(_a.v, _b.v); }
+inline Float4 operator>=(const Float4& _a, const Float4& _b) { return _mm_cmpge_ps(_a.v, _b.v); }
+inline Float4 Min(const Float4& _a, const Float4& _b)        { return _mm_min_ps(_a.v, _b.v); }
+inline Float4 Max(const Float4& _a, const Float4& _b)        { return _mm_max_ps(_a.v, _b.v); }
+inline Float4 Sqrt(const Float4& _a)                         { return _mm_sqrt_ps(_a.v); }
+inline Float4 AndNot(const Float4& _a, const Float4& _b)     { return _mm_andnot_ps(_a.v, _b.v); } // ~_a & _b
+inline Float4 Select(const Float4& _mask, const Float4& _a, const Float4& _b) { return (_mask & _a) | AndNot(_mask, _b); }
+
+#ifdef RayPacket_AVX
+	struct Float8
+	{
+		__m256 v;
+
+		Float8() {}
+		Float8(__m256 _v): v(_v)                         {}
+		explicit Float8(float _f): v(_mm256_set1_ps(_f)) {}
+
+		static Float8 Load(const float* _src)            { return _mm256_loadu_ps(_src); }
+		void          store(float* dst_) const           { _mm256_storeu_ps(dst_, v);    }
+		uint32        mask() const                       { return (uint32)_mm256_movemask_ps(v); }
+	};
+	inline Float8 operator+(const Float8& _a, const Float8& _b)  { return _mm256_add_ps(_a.v, _b.v); }
+	inline Float8 operator-(const Float8& _a, const Float8& _b)  { return _mm256_sub_ps(_a.v, _b.v); }
+	inline Float8 operator*(const Float8& _a, const Float8& _b)  { return _mm256_mul_ps(_a.v, _b.v); }
+	inline Float8 operator/(const Float8& _a, const Float8& _b)  { return _mm256_div_ps(_a.v, _b.v); }
+	inline Float8 operator&(const Float8& _a, const Float8& _b)  { return _mm256_and_ps(_a.v, _b.v); }
+	inline Float8 operator|(const Float8& _a, const Float8& _b)  { return _mm256_or_ps(_a.v, _b.v);  }
+	inline Float8 operator< (const Float8& _a, const Float8& _b) { return _mm256_cmp_ps(_a.v, _b.v, _CMP_LT_OQ); }
+	inline Float8 operator<=(const Float8& _a, const Float8& _b) { return _mm256_cmp_ps(_a.v, _b.v, _CMP_LE_OQ); }
+	inline Float8 operator> (const Float8& _a, const Float8& _b) { return _mm256_cmp_ps(_a.v, _b.v, _CMP_GT_OQ); }
+	inline Float8 operator>=(const Float8& _a, const Float8& _b) { return _mm256_cmp_ps(_a.v, _b.v, _CMP_GE_OQ); }
+	inline Float8 Min(const Float8& _a, const Float8& _b)        { return _mm256_min_ps(_a.v, _b.v); }
+	inline Float8 Max(const Float8& _a, const Float8& _b)        { return _mm256_max_ps(_a.v, _b.v); }
+	inline Float8 Sqrt(const Float8& _a)                         { return _mm256_sqrt_ps(_a.v); }
+	inline Float8 AndNot(const Float8& _a, const Float8& _b)     { return _mm256_andnot_ps(_a.v, _b.v); }
+	inline Float8 Select(const Float8& _mask, const Float8& _a, const Float8& _b) { return _mm256_blendv_ps(_b.v, _a.v, _mask.v); }
+#else
+ // without AVX, 8-wide packets are processed as 2 SSE halves
+	struct Float8
+	{
+		Float4 lo, hi;
+
+		Float8() {}
+		Float8(const Float4& _lo, const Float4& _hi): lo(_lo), hi(_hi) {}
+		explicit Float8(float _f): lo(_f), hi(_f)                      {}
+
+		static Float8 Load(const float* _src)  { return Float8(Float4::Load(_src), Float4::Load(_src + 4)); }
+		void          store(float* dst_) const { lo.store(dst_); hi.store(dst_ + 4); }
+		uint32        mask() const             { return lo.mask() | (hi.mask() << 4); }
+	};
+	inline Float8 operator+(const Float8& _a, const Float8& _b)  { return Float8(_a.lo + _b.lo,  _a.hi + _b.hi);  }
+	inline Float8 operator-(const Float8& _a, const Float8& _b)  { return Float8(_a.lo - _b.lo,  _a.hi - _b.hi);  }
+	inline Float8 operator*(const Float8& _a, const Float8& _b)  { return Float8(_a.lo * _b.lo,  _a.hi * _b.hi);  }
+	inline Float8 operator/(const Float8& _a, const Float8& _b)  { return Float8(_a.lo / _b.lo,  _a.hi / _b.hi);  }
+	inline Float8 operator&(const Float8& _a, const Float8& _b)  { return Float8(_a.lo & _b.lo,  _a.hi & _b.hi);  }
+	inline Float8 operator|(const Float8& _a, const Float8& _b)  { return Float8(_a.lo | _b.lo,  _a.hi | _b.hi);  }
+	inline Float8 operator< (const Float8& _a, const Float8& _b) { return Float8(_a.lo <  _b.lo, _a.hi <  _b.hi); }
+	inline Float8 operator<=(const Float8& _a, const Float8& _b) { return Float8(_a.lo <= _b.lo, _a.hi <= _b.hi); }
+	inline Float8 operator> (const Float8& _a, const Float8& _b) { return Float8(_a.lo >  _b.lo, _a.hi >  _b.hi); }
+	inline Float8 operator>=(const Float8& _a, const Float8& _b) { return Float8(_a.lo >= _b.lo, _a.hi >= _b.hi); }
+	inline Float8 Min(const Float8& _a, const Float8& _b)        { return Float8(Min(_a.lo, _b.lo), Min(_a.hi, _b.hi)); }
+	inline Float8 Max(const Float8& _a, const Float8& _b)        { return Float8(Max(_a.lo, _b.lo), Max(_a.hi, _b.hi)); }
+	inline Float8 Sqrt(const Float8& _a)                         { return Float8(Sqrt(_a.lo), Sqrt(_a.hi)); }
+	inline Float8 AndNot(const Float8& _a, const Float8& _b)     { return Float8(AndNot(_a.lo, _b.lo), AndNot(_a.hi, _b.hi)); }
+	inline Float8 Select(const Float8& _mask, const Float8& _a, const Float8& _b) { return Float8(Select(_mask.lo, _a.lo, _b.lo), Select(_mask.hi, _a.hi, _b.hi)); }
+#endif
+
+template <int kSize> struct PackType {};
+template <> struct PackType<4> { typedef Float4 Type; };
+template <> struct PackType<8> { typedef Float8 Type; };
+
+template <int kSize>
+uint32 IntersectsSphere(const RayPacket<kSize>& _packet, const Sphere& _sphere, uint32 _activeMask)
+{
+	typedef typename PackType<kSize>::Type Pack;
+ // as per Intersects(const Ray&, const Sphere&)
+	Pack px = Pack(_sphere.m_origin.x) - Pack::Load(_packet.m_originX);
+	Pack py = Pack(_sphere.m_origin.y) - Pack::Load(_packet.m_originY);
+	Pack pz = Pack(_sphere.m_origin.z) - Pack::Load(_packet.m_originZ);
+	Pack p2 = px * px + py * py + pz * pz;
+	Pack q  = px * Pack::Load(_packet.m_directionX) + py * Pack::Load(_packet.m_directionY) + pz * Pack::Load(_packet.m_directionZ);
+	Pack r2 = Pack(_sphere.m_radius * _sphere.m_radius);
+	Pack behind = (q < Pack(0.0f)) & (p2 > r2);
+	Pack hit = AndNot(behind, (p2 - q * q) <= r2);
+	return hit.mask() & _activeMask;
+}
+
+template <int kSize>
+uint32 IntersectSphere(const RayPacket<kSize>& _packet, const Sphere& _sphere, float* t0_, float* t1_, uint32 _activeMask)
+{
+	typedef typename PackType<kSize>::Type Pack;
+	Pack px = Pack(_sphere.m_origin.x) - Pack::Load(_packet.m_originX);
+	Pack py = Pack(_sphere.m_origin.y) - Pack::Load(_packet.m_originY);
+	Pack pz = Pack(_sphere.m_origin.z) - Pack::Load(_packet.m_originZ);
+	Pack p2 = px * px + py * py + pz * pz;
+	Pack q  = px * Pack::Load(_packet.m_directionX) + py * Pack::Load(_packet.m_directionY) + pz * Pack::Load(_packet.m_directionZ);
+	Pack d  = q * q - (p2 - Pack(_sphere.m_radius * _sphere.m_radius));
+	Pack s  = Sqrt(Max(d, Pack(0.0f)));
+	Pack t0 = q - s;
+	Pack t1 = q + s;
+	Pack hit = (d > Pack(0.0f)) & (t1 >= Pack(0.0f)); // miss if the sphere is behind the ray origin
+	t0 = Select(t0 < Pack(0.0f), t1, t0);              // ray origin inside the sphere
+	t0.store(t0_);
+	t1.store(t1_);
+	return hit.mask() & _activeMask;
+}
+
+template <int kSize>
+uint32 IntersectBox(const RayPacket<kSize>& _packet, const AlignedBox& _box, float* t0_, float* t1_, uint32 _activeMask)
+{
+	typedef typename PackType<kSize>::Type Pack;
+ // as per Intersect(const Ray&, const AlignedBox&, float&, float&)
+	Pack ox = Pack::Load(_packet.m_originX);
+	Pack oy = Pack::Load(_packet.m_originY);
+	Pack oz = Pack::Load(_packet.m_originZ);
+	Pack rx = Pack::Load(_packet.m_rcpDirectionX);
+	Pack ry = Pack::Load(_packet.m_rcpDirectionY);
+	Pack rz = Pack::Load(_packet.m_rcpDirectionZ);
+	Pack x0 = (Pack(_box.m_min.x) - ox) * rx;
+	Pack x1 = (Pack(_box.m_max.x) - ox) * rx;
+	Pack y0 = (Pack(_box.m_min.y) - oy) * ry;
+	Pack y1 = (Pack(_box.m_max.y) - oy) * ry;
+	Pack z0 = (Pack(_box.m_min.z) - oz) * rz;
+	Pack z1 = (Pack(_box.m_max.z) - oz) * rz;
+	Pack t0 = Max(Max(Min(x0, x1), Min(y0, y1)), Min(z0, z1));
+	Pack t1 = Min(Min(Max(x0, x1), Max(y0, y1)), Max(z0, z1));
+	Pack hit = (t0 < t1) & (t1 >= Pack(0.0f));
+	if (t0_) {
+		t0 = Select(t0 < Pack(0.0f), t1, t0);
+		t0.store(t0_);
+		t1.store(t1_);
+	}
+	return hit.mask() & _activeMask;
+}
+
+template <int kSize>
+uint32 IntersectPlane(const RayPacket<kSize>& _packet, const Plane& _plane, float* t0_, uint32 _activeMask)
+{
+	typedef typename PackType<kSize>::Type Pack;
+ // as per Intersect(const Ray&, const Plane&, float&)
+	Pack nx = Pack(_plane.m_normal.x);
+	Pack ny = Pack(_plane.m_normal.y);
+	Pack nz = Pack(_plane.m_normal.z);
+	Pack no = nx * Pack::Load(_packet.m_originX)    + ny * Pack::Load(_packet.m_originY)    + nz * Pack::Load(_packet.m_originZ);
+	Pack nd = nx * Pack::Load(_packet.m_directionX) + ny * Pack::Load(_packet.m_directionY) + nz * Pack::Load(_packet.m_directionZ);
+	Pack t0 = (Pack(_plane.m_offset) - no) / nd;
+	if (t0_) {
+		t0.store(t0_);
+	}
+	return (t0 >= Pack(0.0f)).mask() & _activeMask;
+}
+
+} // namespace
+
+#else // RayPacket_SSE
+
+// Scalar fallback, test each active ray individually.
+
+template <int kSize>
+static uint32 IntersectsSphere(const RayPacket<kSize>& _packet, const Sphere& _sphere, uint32 _activeMask)
+{
+	uint32 ret = 0;
+	for (int i = 0; i < kSize; ++i) {
+		if ((_activeMask & (1u << i)) && Intersects(_packet.get(i), _sphere)) {
+			ret |= 1u << i;
+		}
+	}
+	return ret;
+}
+
+template <int kSize>
+static uint32 IntersectSphere(const RayPacket<kSize>& _packet, const Sphere& _sphere, float* t0_, float* t1_, uint32 _activeMask)
+{
+	uint32 ret = 0;
+	for (int i = 0; i < kSize; ++i) {
+		if ((_activeMask & (1u << i)) && Intersect(_packet.get(i), _sphere, t0_[i], t1_[i])) {
+			ret |= 1u << i;
+		}
+	}
+	return ret;
+}
+
+template <int kSize>
+static uint32 IntersectBox(const RayPacket<kSize>& _packet, const AlignedBox& _box, float* t0_, float* t1_, uint32 _activeMask)
+{
+	uint32 ret = 0;
+	for (int i = 0; i < kSize; ++i) {
+		float t0, t1;
+		if ((_activeMask & (1u << i)) && Intersect(_packet.get(i), _box, t0, t1)) {
+			if (t0_) {
+				t0_[i] = t0;
+				t1_[i] = t1;
+			}
+			ret |= 1u << i;
+		}
+	}
+	return ret;
+}
+
+template <int kSize>
+static uint32 IntersectPlane(const RayPacket<kSize>& _packet, const Plane& _plane, float* t0_, uint32 _activeMask)
+{
+	uint32 ret = 0;
+	for (int i = 0; i < kSize; ++i) {
+		float t0;
+		if ((_activeMask & (1u << i)) && Intersect(_packet.get(i), _plane, t0)) {
+			if (t0_) {
+				t0_[i] = t0;
+			}
+			ret |= 1u << i;
+		}
+	}
+	return ret;
+}
+
+#endif // RayPacket_SSE
+
+/*******************************************************************************
+
+                                RayPacket4
+
+*******************************************************************************/
+
+uint32 frm::Intersects(const RayPacket4& _packet, const Sphere& _sphere, uint32 _activeMask)
+{
+	return _activeMask ? IntersectsSphere(_packet, _sphere, _activeMask) : 0;
+}
+uint32 frm::Intersect(const RayPacket4& _packet, const Sphere& _sphere, float t0_[4], float t1_[4], uint32 _activeMask)
+{
+	return _activeMask ? IntersectSphere(_packet, _sphere, t0_, t1_, _activeMask) : 0;
+}
+uint32 frm::Intersects(const RayPacket4& _packet, const AlignedBox& _box, uint32 _activeMask)
+{
+	return _activeMask ? IntersectBox(_packet, _box, nullptr, nullptr, _activeMask) : 0;
+}
+uint32 frm::Intersect(const RayPacket4& _packet, const AlignedBox& _box, float t0_[4], float t1_[4], uint32 _activeMask)
+{
+	return _activeMask ? IntersectBox(_packet, _box, t0_, t1_, _activeMask) : 0;
+}
+uint32 frm::Intersects(const RayPacket4& _packet, const Plane& _plane, uint32 _activeMask)
+{
+	return _activeMask ? IntersectPlane(_packet, _plane, nullptr, _activeMask) : 0;
+}
+uint32 frm::Intersect(const RayPacket4& _packet, const Plane& _plane, float t0_[4], uint32 _activeMask)
+{
+	return _activeMask ? IntersectPlane(_packet, _plane, t0_, _activeMask) : 0;
+}
+
+/*******************************************************************************
+
+                                RayPacket8
+
+*******************************************************************************/
+
+uint32 frm::Intersects(const RayPacket8& _packet, const Sphere& _sphere, uint32 _activeMask)
+{
+	return _activeMask ? IntersectsSphere(_packet, _sphere, _activeMask) : 0;
+}
+uint32 frm::Intersect(const RayPacket8& _packet, const Sphere& _sphere, float t0_[8], float t1_[8], uint32 _activeMask)
+{
+	return _activeMask ? IntersectSphere(_packet, _sphere, t0_, t1_, _activeMask) : 0;
+}
+uint32 frm::Intersects(const RayPacket8& _packet, const AlignedBox& _box, uint32 _activeMask)
+{
+	return _activeMask ? IntersectBox(_packet, _box, nullptr, nullptr, _activeMask) : 0;
+}
+uint32 frm::Intersect(const RayPacket8& _packet, const AlignedBox& _box, float t0_[8], float t1_[8], uint32 _activeMask)
+{
+	return _activeMask ? IntersectBox(_packet, _box, t0_, t1_, _activeMask) : 0;
+}
+uint32 frm::Intersects(const RayPacket8& _packet, const Plane& _plane, uint32 _activeMask)
+{
+	return _activeMask ? IntersectPlane(_packet, _plane, nullptr, _activeMask) : 0;
+}
+uint32 frm::Intersect(const RayPacket8& _packet, const Plane& _plane, float t0_[8], uint32 _activeMask)
+{
+	return _activeMask ? IntersectPlane(_packet, _plane, t0_, _activeMask) : 0;
+}
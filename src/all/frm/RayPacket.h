@@ -0,0 +1,91 @@
+#pragma once
+#ifndef frm_RayPacket_h
+#define frm_RayPacket_h
+
+#include <frm/def.h>
+#include <frm/geom.h>
+#include <frm/math.h>
+
+namespace frm {
+
+////////////////////////////////////////////////////////////////////////////////
+// RayPacket
+// kSize rays stored as SoA for SIMD intersection tests. Packets work best for
+// coherent rays (e.g. primary rays over a screen tile, shadow rays towards a
+// single light). The reciprocal direction is cached by set().
+//
+// Packet-primitive tests take an active mask (bit i = ray i) and return a mask
+// of the active rays which hit the primitive; t0_/t1_ follow the same rules as
+// the single ray versions in geom.h and are only valid for rays which hit.
+////////////////////////////////////////////////////////////////////////////////
+template <int kSize>
+struct RayPacket
+{
+	static const int    kCount   = kSize;
+	static const uint32 kAllMask = (1u << kSize) - 1;
+
+	float m_originX[kSize];
+	float m_originY[kSize];
+	float m_originZ[kSize];
+	float m_directionX[kSize]; // unit length
+	float m_directionY[kSize];
+	float m_directionZ[kSize];
+	float m_rcpDirectionX[kSize];
+	float m_rcpDirectionY[kSize];
+	float m_rcpDirectionZ[kSize];
+
+	RayPacket() {}
+
+	// Init from kSize rays.
+	RayPacket(const Ray* _rays)
+	{
+		for (int i = 0; i < kSize; ++i) {
+			set(i, _rays[i]);
+		}
+	}
+
+	void set(int _i, const Ray& _ray)
+	{
+		APT_ASSERT(_i < kSize);
+		m_originX[_i]       = _ray.m_origin.x;
+		m_originY[_i]       = _ray.m_origin.y;
+		m_originZ[_i]       = _ray.m_origin.z;
+		m_directionX[_i]    = _ray.m_direction.x;
+		m_directionY[_i]    = _ray.m_direction.y;
+		m_directionZ[_i]    = _ray.m_direction.z;
+		m_rcpDirectionX[_i] = 1.0f / _ray.m_direction.x;
+		m_rcpDirectionY[_i] = 1.0f / _ray.m_direction.y;
+		m_rcpDirectionZ[_i] = 1.0f / _ray.m_direction.z;
+	}
+
+	Ray get(int _i) const
+	{
+		APT_ASSERT(_i < kSize);
+		return Ray(
+			vec3(m_originX[_i], m_originY[_i], m_originZ[_i]),
+			vec3(m_directionX[_i], m_directionY[_i], m_directionZ[_i])
+			);
+	}
+
+}; // struct RayPacket
+
+typedef RayPacket<4> RayPacket4;
+typedef RayPacket<8> RayPacket8;
+
+uint32 Intersects(const RayPacket4& _packet, const Sphere& _sphere,   uint32 _activeMask = RayPacket4::kAllMask);
+uint32 Intersect (const RayPacket4& _packet, const Sphere& _sphere,   float t0_[4], float t1_[4], uint32 _activeMask = RayPacket4::kAllMask);
+uint32 Intersects(const RayPacket4& _packet, const AlignedBox& _box,  uint32 _activeMask = RayPacket4::kAllMask);
+uint32 Intersect (const RayPacket4& _packet, const AlignedBox& _box,  float t0_[4], float t1_[4], uint32 _activeMask = RayPacket4::kAllMask);
+uint32 Intersects(const RayPacket4& _packet, const Plane& _plane,     uint32 _activeMask = RayPacket4::kAllMask);
+uint32 Intersect (const RayPacket4& _packet, const Plane& _plane,     float t0_[4], uint32 _activeMask = RayPacket4::kAllMask);
+
+uint32 Intersects(const RayPacket8& _packet, const Sphere& _sphere,   uint32 _activeMask = RayPacket8::kAllMask);
+uint32 Intersect (const RayPacket8& _packet, const Sphere& _sphere,   float t0_[8], float t1_[8], uint32 _activeMask = RayPacket8::kAllMask);
+uint32 Intersects(const RayPacket8& _packet, const AlignedBox& _box,  uint32 _activeMask = RayPacket8::kAllMask);
+uint32 Intersect (const RayPacket8& _packet, const AlignedBox& _box,  float t0_[8], float t1_[8], uint32 _activeMask = RayPacket8::kAllMask);
+uint32 Intersects(const RayPacket8& _packet, const Plane& _plane,     uint32 _activeMask = RayPacket8::kAllMask);
+uint32 Intersect (const RayPacket8& _packet, const Plane& _plane,     float t0_[8], uint32 _activeMask = RayPacket8::kAllMask);
+
+} // namespace frm
+
+#endif // frm_RayPacket_h
@@ -1,15 +1,21 @@
 #include <frm/Scene.h>
 
 #include <frm/Camera.h>
+#include <frm/JobSystem.h>
 #include <frm/Light.h>
 #include <frm/Profiler.h>
 #include <frm/XForm.h>
 
+#include <apt/hash.h>
 #include <apt/log.h>
+#include <apt/File.h>
+#include <apt/FileSystem.h>
 #include <apt/Json.h>
 
 #include <EASTl/algorithm.h>
+#include <EASTL/sort.h>
 #include <EASTL/utility.h> // eastl::swap
+#include <EASTL/vector_map.h>
 
 using namespace frm;
 using namespace apt;
@@ -37,14 +43,150 @@ static Node::Type NodeTypeFromStr(const char* _str)
 	return Node::Type_Count;
 }
 
+// Construct a quaternion from xyzw components, independent of the constructor's argument order.
+static quat QuatXYZW(float _x, float _y, float _z, float _w)
+{
+	quat ret;
+	ret.x = _x;
+	ret.y = _y;
+	ret.z = _z;
+	ret.w = _w;
+	return ret;
+}
+
+// Compose position/orientation/uniform scale into out_, premultiplied by _parent if not nullptr. This avoids
+// composing the local matrix and a full matrix multiply; out_ must not alias _parent.
+static void ComposeTRS(const vec3& _position, const quat& _orientation, float _scale, const mat4* _parent, mat4& out_)
+{
+	APT_ASSERT(_parent != &out_);
+	const quat& q = _orientation;
+	float xx = q.x * q.x, yy = q.y * q.y, zz = q.z * q.z;
+	float xy = q.x * q.y, xz = q.x * q.z, yz = q.y * q.z;
+	float wx = q.w * q.x, wy = q.w * q.y, wz = q.w * q.z;
+	vec3 c0 = vec3(1.0f - 2.0f * (yy + zz), 2.0f * (xy + wz), 2.0f * (xz - wy)) * _scale;
+	vec3 c1 = vec3(2.0f * (xy - wz), 1.0f - 2.0f * (xx + zz), 2.0f * (yz + wx)) * _scale;
+	vec3 c2 = vec3(2.0f * (xz + wy), 2.0f * (yz - wx), 1.0f - 2.0f * (xx + yy)) * _scale;
+	if (_parent) {
+		const mat4& p = *_parent;
+		out_[0] = p[0] * c0.x + p[1] * c0.y + p[2] * c0.z;
+		out_[1] = p[0] * c1.x + p[1] * c1.y + p[2] * c1.z;
+		out_[2] = p[0] * c2.x + p[1] * c2.y + p[2] * c2.z;
+		out_[3] = p[0] * _position.x + p[1] * _position.y + p[2] * _position.z + p[3];
+	} else {
+		out_[0] = vec4(c0, 0.0f);
+		out_[1] = vec4(c1, 0.0f);
+		out_[2] = vec4(c2, 0.0f);
+		out_[3] = vec4(_position, 1.0f);
+	}
+}
+
+// Decompose _m into position/orientation/uniform scale. Return false if _m isn't exactly representable as such, i.e.
+// the matrix recomposed by ComposeTRS() differs from _m (rounding, shear, non-uniform or negative scale, projection).
+static bool DecomposeTRS(const mat4& _m, vec3& position_, quat& orientation_, float& scale_)
+{
+	scale_ = length(_m[0].xyz());
+	if (!(scale_ > 0.0f)) {
+		return false;
+	}
+	position_ = _m[3].xyz();
+
+ // rotation matrix to quaternion, branch on the largest diagonal element for precision
+	mat3 r(_m[0].xyz() / scale_, _m[1].xyz() / scale_, _m[2].xyz() / scale_);
+	float trace = r[0][0] + r[1][1] + r[2][2];
+	quat q;
+	if (trace > 0.0f) {
+		float s = sqrtf(trace + 1.0f) * 2.0f;
+		q = QuatXYZW((r[1][2] - r[2][1]) / s, (r[2][0] - r[0][2]) / s, (r[0][1] - r[1][0]) / s, 0.25f * s);
+	} else if (r[0][0] > r[1][1] && r[0][0] > r[2][2]) {
+		float s = sqrtf(1.0f + r[0][0] - r[1][1] - r[2][2]) * 2.0f;
+		q = QuatXYZW(0.25f * s, (r[1][0] + r[0][1]) / s, (r[2][0] + r[0][2]) / s, (r[1][2] - r[2][1]) / s);
+	} else if (r[1][1] > r[2][2]) {
+		float s = sqrtf(1.0f + r[1][1] - r[0][0] - r[2][2]) * 2.0f;
+		q = QuatXYZW((r[1][0] + r[0][1]) / s, 0.25f * s, (r[2][1] + r[1][2]) / s, (r[2][0] - r[0][2]) / s);
+	} else {
+		float s = sqrtf(1.0f + r[2][2] - r[0][0] - r[1][1]) * 2.0f;
+		q = QuatXYZW((r[2][0] + r[0][2]) / s, (r[2][1] + r[1][2]) / s, 0.25f * s, (r[0][1] - r[1][0]) / s);
+	}
+	orientation_ = normalize(q);
+
+	mat4 m;
+	ComposeTRS(position_, orientation_, scale_, nullptr, m);
+	return m == _m;
+}
+
 // PUBLIC
 
+void Node::setName(const char* _name)
+{
+	if (m_scene) {
+		m_scene->renameNode(this, _name);
+	} else {
+		m_name.set(_name);
+	}
+}
+
 void Node::setNamef(const char* _fmt, ...)
 {
 	va_list args;
 	va_start(args, _fmt);
-	m_name.setfv(_fmt, args);
+	NameStr name;
+	name.setfv(_fmt, args);
 	va_end(args);
+	setName((const char*)name);
+}
+
+mat4 Node::getLocalMatrix() const
+{
+	mat4 ret;
+	composeLocalMatrix(nullptr, ret);
+	return ret;
+}
+
+void Node::setLocalMatrix(const mat4& _mat)
+{
+	vec3  position;
+	quat  orientation;
+	float scale;
+	if (DecomposeTRS(_mat, position, orientation, scale)) {
+		setLocalTRS(position, orientation, scale);
+		return;
+	}
+	APT_ASSERT(m_scene);
+	if (m_localMatrixIndex == ~0u) {
+		m_localMatrixIndex = m_scene->allocLocalMatrix();
+	}
+	m_scene->m_localMatrices[m_localMatrixIndex] = _mat;
+	m_dirty = true;
+}
+
+void Node::setLocalTRS(const vec3& _position, const quat& _orientation, float _scale)
+{
+	if (m_localMatrixIndex != ~0u) {
+		m_scene->m_freeLocalMatrices.push_back(m_localMatrixIndex);
+		m_localMatrixIndex = ~0u;
+	}
+	m_localPosition    = _position;
+	m_localOrientation = _orientation;
+	m_localScale       = _scale;
+	m_dirty            = true;
+}
+
+vec3 Node::getLocalPosition() const
+{
+	if (m_localMatrixIndex != ~0u) {
+		return m_scene->m_localMatrices[m_localMatrixIndex][3].xyz();
+	}
+	return m_localPosition;
+}
+
+void Node::setLocalPosition(const vec3& _p)
+{
+	if (m_localMatrixIndex != ~0u) {
+		m_scene->m_localMatrices[m_localMatrixIndex][3] = vec4(_p, 1.0f);
+	} else {
+		m_localPosition = _p;
+	}
+	m_dirty = true;
 }
 
 void Node::addXForm(XForm* _xform)
@@ -52,28 +194,40 @@ void Node::addXForm(XForm* _xform)
 	APT_ASSERT(_xform);
 	APT_ASSERT(_xform->getNode() == nullptr);
 	_xform->setNode(this);
-	m_xforms.push_back(_xform);
+	linkXForm(_xform, (int)m_xformCount);
+	hierarchyChanged();
 }
 
 void Node::removeXForm(XForm* _xform)
 {
-	for (auto it = m_xforms.begin(); it != m_xforms.end(); ++it) {
-		XForm* x = *it;
+	for (XForm* x = m_firstXForm; x; x = x->m_next) {
 		if (x == _xform) {
 			APT_ASSERT(x->getNode() == this);
+			unlinkXForm(x);
 			x->setNode(nullptr);
-			m_xforms.erase(it);
+			hierarchyChanged();
 			return;
 		}
 	}
 }
 
+XForm* Node::getXForm(int _i)
+{
+	APT_ASSERT(_i >= 0 && _i < (int)m_xformCount);
+	XForm* ret = m_firstXForm;
+	for (; _i > 0; --_i) {
+		ret = ret->m_next;
+	}
+	return ret;
+}
+
 void Node::moveXForm(const XForm* _xform, int _dir)
 {
-	for (int i = 0, n = getXFormCount(); i < n; ++i) {
-		if (m_xforms[i] == _xform) {
-			int j = APT_CLAMP(i + _dir, 0, n - 1);
-			eastl::swap(m_xforms[i], m_xforms[j]);
+	int i = 0;
+	for (XForm* x = m_firstXForm; x; x = x->m_next, ++i) {
+		if (x == _xform) {
+			moveXForm(i, _dir);
+			hierarchyChanged(); // xform batches depend on the order
 			return;
 		}
 	}
@@ -91,15 +245,35 @@ void Node::setParent(Node* _node)
 	}
 }
 
+Node* Node::getChild(int _i)
+{
+	APT_ASSERT(_i >= 0 && _i < (int)m_childCount);
+ // walk from the nearest end
+	Node* ret;
+	if (_i < (int)m_childCount / 2) {
+		ret = m_firstChild;
+		for (; _i > 0; --_i) {
+			ret = ret->m_nextSibling;
+		}
+	} else {
+		ret = m_lastChild;
+		for (_i = (int)m_childCount - 1 - _i; _i > 0; --_i) {
+			ret = ret->m_prevSibling;
+		}
+	}
+	return ret;
+}
+
 void Node::addChild(Node* _node)
 {
 	APT_ASSERT(_node);
-	APT_ASSERT(eastl::find(m_children.begin(), m_children.end(), _node) == m_children.end()); // added the same child multiple times?
-	m_children.push_back(_node);
-	if (_node->m_parent && _node->m_parent != this) {
+	APT_ASSERT(_node->m_parent != this); // added the same child multiple times?
+	if (_node->m_parent) {
 		_node->m_parent->removeChild(_node);
 	}
-	_node->m_parent = this;
+	linkChild(_node);
+	_node->m_dirty  = true;
+	hierarchyChanged();
 
 	if (_node->isStatic()) {
 		Update(_node, 0.0f, Node::State_Any);
@@ -109,11 +283,23 @@ void Node::addChild(Node* _node)
 void Node::removeChild(Node* _node)
 {
 	APT_ASSERT(_node);
-	auto it = eastl::find(m_children.begin(), m_children.end(), _node);
-	if (it != m_children.end()) {
-		(*it)->m_parent = nullptr;
-		m_children.erase(it);
+	if (_node->m_parent != this) {
+		return;
+	}
+	if (_node->m_prevSibling) {
+		_node->m_prevSibling->m_nextSibling = _node->m_nextSibling;
+	} else {
+		m_firstChild = _node->m_nextSibling;
+	}
+	if (_node->m_nextSibling) {
+		_node->m_nextSibling->m_prevSibling = _node->m_prevSibling;
+	} else {
+		m_lastChild = _node->m_prevSibling;
 	}
+	_node->m_prevSibling = _node->m_nextSibling = nullptr;
+	_node->m_parent = nullptr;
+	--m_childCount;
+	hierarchyChanged();
 }
 
 
@@ -125,23 +311,49 @@ void Node::AutoName(Node::Type _type, Node::NameStr& out_)
 	out_.setf("%s_%03u", kNodeTypeStr[_type], s_typeCounters[_type]);
 }
 
-void Node::Update(Node* _node_, float _dt, uint8 _stateMask)
+void Node::Update(Node* _node_, float _dt, uint8 _stateMask, eastl::vector<Node*>* changedNodes_)
 {
 	if (!(_node_->m_state & _stateMask)) {
 		return;
 	}
 
- // reset world matrix
-	_node_->m_worldMatrix = _node_->m_localMatrix;
+	bool changed = UpdateSingle(_node_, _dt, _node_->m_parent ? &_node_->m_parent->getWorldMatrix() : nullptr);
+	if (changed && changedNodes_) {
+		changedNodes_->push_back(_node_);
+	}
 
- // apply xforms
-	for (auto& xform : _node_->m_xforms) {
-		xform->apply(_dt);
+ // update children
+	for (Node* child = _node_->m_firstChild; child; child = child->m_nextSibling) {
+		Update(child, _dt, _stateMask, changedNodes_);
 	}
+}
 
- // move to parent space
-	if (_node_->m_parent) {
-		_node_->m_worldMatrix = _node_->m_parent->m_worldMatrix * _node_->m_worldMatrix;
+bool Node::UpdateSingle(Node* _node_, float _dt, const mat4* _parentWorldMatrix, const mat4* _prevWorldMatrix)
+{
+	mat4& worldMatrix = _node_->worldMatrix();
+	mat4 prevWorldMatrix = _prevWorldMatrix ? *_prevWorldMatrix : worldMatrix;
+	if (!_prevWorldMatrix && !_node_->m_firstXForm) {
+	 // no xforms, compose the local matrix directly in parent space
+		_node_->composeLocalMatrix(_parentWorldMatrix, worldMatrix);
+	} else {
+		if (!_prevWorldMatrix) {
+		 // reset world matrix
+			_node_->composeLocalMatrix(nullptr, worldMatrix);
+
+		 // apply xforms
+			for (XForm* xform = _node_->m_firstXForm; xform; xform = xform->getNext()) {
+				xform->apply(_dt);
+			}
+		}
+
+	 // move to parent space
+		if (_parentWorldMatrix) {
+			worldMatrix = *_parentWorldMatrix * worldMatrix;
+		}
+	}
+	bool changed = worldMatrix != prevWorldMatrix;
+	if (changed && _node_->hasBounds()) {
+		_node_->m_boundsDirty = true;
 	}
 
  // type-specific update
@@ -157,17 +369,30 @@ void Node::Update(Node* _node_, float _dt, uint8 _stateMask)
 			break;
 	};
 
- // update children
-	for (auto& child : _node_->m_children) {
-		Update(child, _dt, _stateMask);
-	}
+	return changed;
 }
 
 Node::Node()
 	: m_id(kInvalidId)
 	, m_type(Type_Count)
 	, m_state(0)
+	, m_localPosition(0.0f)
+	, m_localScale(1.0f)
+	, m_localOrientation(QuatXYZW(0.0f, 0.0f, 0.0f, 1.0f))
+	, m_localMatrixIndex(~0u)
+	, m_worldMatrixIndex(~0u)
+	, m_scene(nullptr)
+	, m_firstXForm(nullptr)
+	, m_xformCount(0)
+	, m_dirty(true)
+	, m_aabbTreeProxy(AabbTree::kInvalidProxy)
+	, m_boundsDirty(false)
 	, m_parent(nullptr)
+	, m_firstChild(nullptr)
+	, m_lastChild(nullptr)
+	, m_prevSibling(nullptr)
+	, m_nextSibling(nullptr)
+	, m_childCount(0)
 {
 }
 
@@ -177,8 +402,23 @@ Node::Node(Type _type, Id _id, uint8 _state, const char* _name)
 	, m_state(_state)
 	, m_userData(0)
 	, m_sceneData(0)
-	, m_localMatrix(identity)
+	, m_localPosition(0.0f)
+	, m_localScale(1.0f)
+	, m_localOrientation(QuatXYZW(0.0f, 0.0f, 0.0f, 1.0f))
+	, m_localMatrixIndex(~0u)
+	, m_worldMatrixIndex(~0u)
+	, m_scene(nullptr)
+	, m_firstXForm(nullptr)
+	, m_xformCount(0)
+	, m_dirty(true)
+	, m_aabbTreeProxy(AabbTree::kInvalidProxy)
+	, m_boundsDirty(false)
 	, m_parent(nullptr)
+	, m_firstChild(nullptr)
+	, m_lastChild(nullptr)
+	, m_prevSibling(nullptr)
+	, m_nextSibling(nullptr)
+	, m_childCount(0)
 {
 	APT_ASSERT(_type < Type_Count);
 	if (_name) {
@@ -192,32 +432,104 @@ Node::Node(Type _type, Id _id, uint8 _state, const char* _name)
 Node::~Node()
 {
  // re-parent children
-	for (auto it = m_children.begin(); it != m_children.end(); ++it) {
-		Node* n = *it;
-		n->m_parent = nullptr; // prevent m_parent->addChild calling removeChild on this (invalidates it)
+	for (Node* n = m_firstChild; n; ) {
+		Node* next = n->m_nextSibling;
+		n->m_parent = nullptr; // prevent m_parent->addChild calling removeChild on this (addChild relinks n)
+		n->m_prevSibling = n->m_nextSibling = nullptr;
 		if (m_parent) {
 			m_parent->addChild(n);
 		}
+		n = next;
 	}
+	m_firstChild = m_lastChild = nullptr;
+	m_childCount = 0;
  // de-parent this
 	if (m_parent) {
 		m_parent->removeChild(this);
 	}
 
  // delete xforms
-	for (auto it = m_xforms.begin(); it != m_xforms.end(); ++it) {
-		delete *it;
+	for (XForm* x = m_firstXForm; x; ) {
+		XForm* next = x->m_next;
+		delete x;
+		x = next;
+	}
+	m_firstXForm = nullptr;
+	m_xformCount = 0;
+
+ // release the matrix slots (nodes are only owned by a scene once allocated via Scene::allocNode())
+	if (m_scene) {
+		m_scene->m_freeWorldMatrices.push_back(m_worldMatrixIndex);
+		if (m_localMatrixIndex != ~0u) {
+			m_scene->m_freeLocalMatrices.push_back(m_localMatrixIndex);
+		}
+	}
+}
+
+void Node::composeLocalMatrix(const mat4* _parentWorldMatrix, mat4& out_) const
+{
+	if (m_localMatrixIndex != ~0u) {
+		const mat4& localMatrix = m_scene->m_localMatrices[m_localMatrixIndex];
+		out_ = _parentWorldMatrix ? *_parentWorldMatrix * localMatrix : localMatrix;
+	} else {
+		ComposeTRS(m_localPosition, m_localOrientation, m_localScale, _parentWorldMatrix, out_);
 	}
-	m_xforms.clear();
 }
 
 int Node::moveXForm(int _i, int _dir)
 {
-	int j = APT_CLAMP(_i + _dir, 0, (int)(m_xforms.size() - 1));
-	eastl::swap(m_xforms[_i], m_xforms[j]);
+	int j = APT_CLAMP(_i + _dir, 0, (int)m_xformCount - 1);
+	XForm* x = getXForm(_i);
+	unlinkXForm(x);
+	linkXForm(x, j);
 	return j;
 }
 
+void Node::linkChild(Node* _node)
+{
+	APT_ASSERT(_node->m_parent == nullptr);
+	_node->m_prevSibling = m_lastChild;
+	_node->m_nextSibling = nullptr;
+	if (m_lastChild) {
+		m_lastChild->m_nextSibling = _node;
+	} else {
+		m_firstChild = _node;
+	}
+	m_lastChild = _node;
+	++m_childCount;
+	_node->m_parent = this;
+}
+
+void Node::linkXForm(XForm* _xform, int _i)
+{
+	XForm** link = &m_firstXForm;
+	for (; _i > 0 && *link; --_i) {
+		link = &(*link)->m_next;
+	}
+	_xform->m_next = *link;
+	*link = _xform;
+	++m_xformCount;
+}
+
+void Node::unlinkXForm(XForm* _xform)
+{
+	for (XForm** link = &m_firstXForm; *link; link = &(*link)->m_next) {
+		if (*link == _xform) {
+			*link = _xform->m_next;
+			_xform->m_next = nullptr;
+			--m_xformCount;
+			return;
+		}
+	}
+}
+
+void Node::hierarchyChanged()
+{
+	if (m_scene) {
+		++m_scene->m_hierarchyVersion;
+	}
+}
+
 
 /*******************************************************************************
 
@@ -226,18 +538,55 @@ int Node::moveXForm(int _i, int _dir)
 *******************************************************************************/
 Scene* Scene::s_currentScene;
 
+// Below this node count Scene::update() doesn't use the JobSystem.
+static const uint32 kMinParallelUpdateNodes = 1024;
+
 void frm::swap(Scene& _a, Scene& _b)
 {
 	eastl::swap(_a.m_nextNodeId, _b.m_nextNodeId);
 	eastl::swap(_a.m_root,       _b.m_root);
 	eastl::swap(_a.m_nodes,      _b.m_nodes);
 	apt::swap(_a.m_nodePool,   _b.m_nodePool);
+	eastl::swap(_a.m_nodesById,         _b.m_nodesById);
+	eastl::swap(_a.m_nodesByName,       _b.m_nodesByName);
+	eastl::swap(_a.m_worldMatrices,     _b.m_worldMatrices);
+	eastl::swap(_a.m_freeWorldMatrices, _b.m_freeWorldMatrices);
+	eastl::swap(_a.m_localMatrices,     _b.m_localMatrices);
+	eastl::swap(_a.m_freeLocalMatrices, _b.m_freeLocalMatrices);
+	eastl::swap(_a.m_flatNodes,         _b.m_flatNodes);
+	eastl::swap(_a.m_flatParents,       _b.m_flatParents);
+	eastl::swap(_a.m_flatState,         _b.m_flatState);
+	eastl::swap(_a.m_flatSubtrees,      _b.m_flatSubtrees);
+	eastl::swap(_a.m_flatDependentSubtrees, _b.m_flatDependentSubtrees);
+	eastl::swap(_a.m_flatVersion,       _b.m_flatVersion);
+	eastl::swap(_a.m_hierarchyVersion,  _b.m_hierarchyVersion);
+	eastl::swap(_a.m_parallelUpdate,    _b.m_parallelUpdate);
+	eastl::swap(_a.m_xformBatches,      _b.m_xformBatches);
+	eastl::swap(_a.m_flatBatchedNodes,  _b.m_flatBatchedNodes);
+	eastl::swap(_a.m_flatBatchIndices,  _b.m_flatBatchIndices);
+	eastl::swap(_a.m_batchPrevWorldMatrices, _b.m_batchPrevWorldMatrices);
+	eastl::swap(_a.m_batchXForms,       _b.m_batchXForms);
+	eastl::swap(_a.m_changedNodes,      _b.m_changedNodes);
+	swap(_a.m_aabbTree,        _b.m_aabbTree);
+	eastl::swap(_a.m_boundedNodes, _b.m_boundedNodes);
 	eastl::swap(_a.m_drawCamera, _b.m_drawCamera);
 	eastl::swap(_a.m_cullCamera, _b.m_cullCamera);
 	eastl::swap(_a.m_cameras,    _b.m_cameras);
 	apt::swap(_a.m_cameraPool, _b.m_cameraPool);
 	eastl::swap(_a.m_lights,    _b.m_lights);
 	apt::swap(_a.m_lightPool, _b.m_lightPool);
+
+ // the root nodes point back to the scene, all nodes point to the scene which stores their matrices
+	_a.m_root->setSceneDataScene(&_a);
+	_b.m_root->setSceneDataScene(&_b);
+	for (int i = 0; i < Node::Type_Count; ++i) {
+		for (Node* node : _a.m_nodes[i]) {
+			node->m_scene = &_a;
+		}
+		for (Node* node : _b.m_nodes[i]) {
+			node->m_scene = &_b;
+		}
+	}
 }
 
 
@@ -246,15 +595,29 @@ void frm::swap(Scene& _a, Scene& _b)
 bool Scene::Load(const char* _path, Scene& scene_)
 {
 	APT_LOG("Loading scene from '%s'", _path);
-	Json json;
-	if (!Json::Read(json, _path)) {
-		return false;
-	}
-	SerializerJson serializer(json, SerializerJson::Mode_Read);
 	Scene newScene;
-	
-	if (!Serialize(serializer, newScene)) {
-		return false;
+	if (FileSystem::CompareExtension("scnb", _path)) {
+		const char* err = nullptr;
+		BinaryScene* bin = ReadBinary(_path, err);
+		if (!bin) {
+			APT_LOG_ERR("Scene: Error reading '%s' (%s)", _path, err);
+			return false;
+		}
+		newScene.instantiateBinary(*bin, newScene.m_root, ~0u);
+		DestroyBinary(bin);
+		for (int i = 0; i < Node::Type_Count; ++i) {
+			s_typeCounters[i] = APT_MAX((unsigned int)newScene.m_nodes[i].size(), s_typeCounters[i]);
+		}
+
+	} else {
+		Json json;
+		if (!Json::Read(json, _path)) {
+			return false;
+		}
+		SerializerJson serializer(json, SerializerJson::Mode_Read);
+		if (!Serialize(serializer, newScene)) {
+			return false;
+		}
 	}
 	swap(newScene, scene_);
 	return true;
@@ -263,6 +626,16 @@ bool Scene::Load(const char* _path, Scene& scene_)
 bool Scene::Save(const char* _path, Scene& _scene)
 {
 	APT_LOG("Saving scene to '%s'", _path);
+	if (FileSystem::CompareExtension("scnb", _path)) {
+		eastl::vector<char> data;
+		if (!WriteBinary(_scene, _scene.m_root, data)) {
+			return false;
+		}
+		File f;
+		f.appendData(data.data(), data.size());
+		return FileSystem::Write(f, _path);
+	}
+
 	Json json;
 	SerializerJson serializer(json, SerializerJson::Mode_Write);
 	if (!Serialize(serializer, _scene)) {
@@ -271,9 +644,19 @@ bool Scene::Save(const char* _path, Scene& _scene)
 	return Json::Write(json, _path);
 }
 
+bool Scene::Convert(const char* _srcPath, const char* _dstPath)
+{
+	Scene scene;
+	return Load(_srcPath, scene) && Save(_dstPath, scene);
+}
+
 Scene::Scene()
 	: m_nextNodeId(0)
 	, m_nodePool(128)
+	, m_flatVersion(0)
+	, m_hierarchyVersion(0)
+	, m_parallelUpdate(true)
+	, m_batchXForms(true)
 	, m_cameraPool(8)
 	, m_lightPool(16)
 	, m_drawCamera(nullptr)
@@ -289,9 +672,9 @@ Scene::Scene()
 	, m_editLight(nullptr)
 #endif
 {
-	m_root = m_nodePool.alloc(Node(Node::Type_Root, m_nextNodeId++, Node::State_Any, "ROOT"));
+	m_root = allocNode(Node(Node::Type_Root, m_nextNodeId++, Node::State_Any, "ROOT"));
 	m_root->setSceneDataScene(this);
-	m_nodes[Node::Type_Root].push_back(m_root);
+	addNode(m_root);
 }
 
 Scene::~Scene()
@@ -316,7 +699,52 @@ void Scene::update(float _dt, uint8 _stateMask)
 {
 	PROFILER_MARKER_CPU("#Scene::update");
 	
-	Node::Update(m_root, _dt, _stateMask);
+	updateFlatHierarchy();
+	applyXFormBatches(_dt, _stateMask);
+
+ // root first, then the independent subtrees under it
+	updateFlatRange(0, 1, _dt, _stateMask);
+	uint32 subtreeCount = (uint32)m_flatSubtrees.size();
+	if (m_parallelUpdate && subtreeCount > 1 && m_flatNodes.size() >= kMinParallelUpdateNodes) {
+		uint32 grainSize = APT_MAX(subtreeCount / ((uint32)JobSystem::GetThreadCount() * 4), 1u);
+		JobSystem::ParallelFor(subtreeCount, grainSize, 
+			[this, _dt, _stateMask](uint32 _begin, uint32 _end) {
+				for (uint32 i = _begin; i < _end; ++i) {
+					updateFlatRange(m_flatSubtrees[i].m_first, m_flatSubtrees[i].m_last, _dt, _stateMask);
+				}
+			},
+			"#Scene::update subtrees"
+			);
+	} else {
+		for (auto& subtree : m_flatSubtrees) {
+			updateFlatRange(subtree.m_first, subtree.m_last, _dt, _stateMask);
+		}
+	}
+
+ // subtrees which read other nodes or contain cameras are updated serially after the independent subtrees, hence
+ // the result doesn't depend on whether the update was parallel
+	for (auto& subtree : m_flatDependentSubtrees) {
+		updateFlatRange(subtree.m_first, subtree.m_last, _dt, _stateMask);
+	}
+
+ // gather changed nodes serially to preserve the hierarchy order
+	m_changedNodes.clear();
+	for (uint32 i = 0, n = (uint32)m_flatNodes.size(); i < n; ++i) {
+		if (m_flatState[i] == FlatState_Changed) {
+			m_changedNodes.push_back(m_flatNodes[i]);
+		}
+	}
+
+	updateAabbTree();
+}
+
+void Scene::updateRecursive(float _dt, uint8 _stateMask)
+{
+	PROFILER_MARKER_CPU("#Scene::updateRecursive");
+	
+	m_changedNodes.clear();
+	Node::Update(m_root, _dt, _stateMask, &m_changedNodes);
+	updateAabbTree();
 }
 
 bool Scene::traverse(Node* _root_, uint8 _stateMask, OnVisit* _callback)
@@ -327,8 +755,8 @@ bool Scene::traverse(Node* _root_, uint8 _stateMask, OnVisit* _callback)
 		if (!_callback(_root_)) {
 			return false;
 		}
-		for (int i = 0; i < _root_->getChildCount(); ++i) {
-			if (!traverse(_root_->getChild(i), _stateMask, _callback)) {
+		for (Node* child = _root_->getFirstChild(); child; child = child->getNextSibling()) {
+			if (!traverse(child, _stateMask, _callback)) {
 				return false;
 			}
 		}
@@ -340,13 +768,13 @@ Node* Scene::createNode(Node::Type _type, Node* _parent)
 {
 	PROFILER_MARKER_CPU("#Scene::createNode");
 
-	Node* ret = m_nodePool.alloc(Node(_type, m_nextNodeId++, Node::State_Active));
+	Node* ret = allocNode(Node(_type, m_nextNodeId++, Node::State_Active));
 	if (_type == Node::Type_Camera || _type == Node::Type_Root) {
 		ret->setDynamic(true);
 	}
 	_parent = _parent ? _parent : m_root;
 	_parent->addChild(ret);
-	m_nodes[_type].push_back(ret);
+	addNode(ret);
 	return ret;
 }
 
@@ -384,9 +812,15 @@ void Scene::destroyNode(Node*& _node_)
 			break;
 	};
 
-	auto it = eastl::find(m_nodes[type].begin(), m_nodes[type].end(), _node_);
-	if (it != m_nodes[type].end()) {
-		m_nodes[type].erase(it);
+	if (_node_->hasBounds()) {
+		clearNodeBounds(_node_);
+	}
+
+	auto it = eastl::find(m_nodes[type].rbegin(), m_nodes[type].rend(), _node_); // most recently created nodes are likely to be destroyed first
+	if (it != m_nodes[type].rend()) {
+		m_nodes[type].erase(it.base() - 1);
+		m_nodesById.remove(_node_->m_id, _node_);
+		m_nodesByName.remove(HashString<uint64>(_node_->getName()), _node_);
 		m_nodePool.free(_node_);
 		_node_ = nullptr;
 	}
@@ -396,26 +830,13 @@ Node* Scene::findNode(Node::Id _id, Node::Type _typeHint)
 {
 	PROFILER_MARKER_CPU("#Scene::findNode");
 
+ // ids are unique, _typeHint isn't needed
+	APT_UNUSED(_typeHint);
 	Node* ret = nullptr;
-	if (_typeHint != Node::Type_Count) {
-		for (auto it = m_nodes[_typeHint].begin(); it != m_nodes[_typeHint].end(); ++it) {
-			if ((*it)->getId() == _id) {
-				ret = *it;
-				break;
-			}
-		}
-	}
-	for (int i = 0; ret == nullptr && i < Node::Type_Count; ++i) {
-		if (i == _typeHint) {
-			continue;
-		}
-		for (auto it = m_nodes[i].begin(); it != m_nodes[i].end(); ++it) {
-			if ((*it)->getId() == _id) {
-				ret = *it;
-				break;
-			}
-		}
-	}
+	m_nodesById.find(_id, [&ret](Node* _node) {
+			ret = _node;
+			return true;
+		});
 	return ret;
 }
 
@@ -423,26 +844,105 @@ Node* Scene::findNode(const char* _name, Node::Type _typeHint)
 {
 	PROFILER_MARKER_CPU("#Scene::findNode");
 
+ // names aren't unique, prefer a node matching _typeHint
 	Node* ret = nullptr;
-	if (_typeHint != Node::Type_Count) {
-		for (auto it = m_nodes[_typeHint].begin(); it != m_nodes[_typeHint].end(); ++it) {
-			if (strcmp((*it)->getName(), _name) == 0) {
-				ret = *it;
-				break;
+	m_nodesByName.find(HashString<uint64>(_name), [&ret, _name, _typeHint](Node* _node) {
+			if (strcmp(_node->getName(), _name) != 0) {
+				return false;
 			}
-		}
+			if (!ret || _node->getType() == _typeHint) {
+				ret = _node;
+			}
+			return _typeHint == Node::Type_Count || ret->getType() == _typeHint;
+		});
+	return ret;
+}
+
+void Scene::setNodeBounds(Node* _node_, const AlignedBox& _localBounds)
+{
+	_node_->m_localBounds = _localBounds;
+	_node_->m_worldBounds = _localBounds;
+	_node_->m_worldBounds.transform(_node_->getWorldMatrix());
+	_node_->m_boundsDirty = false;
+	if (_node_->hasBounds()) {
+		m_aabbTree.move(_node_->m_aabbTreeProxy, _node_->m_worldBounds);
+	} else {
+		_node_->m_aabbTreeProxy = m_aabbTree.insert(_node_->m_worldBounds, _node_);
+		m_boundedNodes.push_back(_node_);
 	}
-	for (int i = 0; ret == nullptr && i < Node::Type_Count; ++i) {
-		if (i == _typeHint) {
-			continue;
+}
+
+void Scene::clearNodeBounds(Node* _node_)
+{
+	if (!_node_->hasBounds()) {
+		return;
+	}
+	m_aabbTree.remove(_node_->m_aabbTreeProxy);
+	_node_->m_aabbTreeProxy = AabbTree::kInvalidProxy;
+	_node_->m_boundsDirty = false;
+	auto it = eastl::find(m_boundedNodes.begin(), m_boundedNodes.end(), _node_);
+	APT_ASSERT(it != m_boundedNodes.end());
+	*it = m_boundedNodes.back();
+	m_boundedNodes.pop_back();
+}
+
+void Scene::findNodes(const Frustum& _frustum, eastl::vector<Node*>& results_) const
+{
+	PROFILER_MARKER_CPU("#Scene::findNodes");
+
+	m_aabbTree.findInside(_frustum, [&](AabbTree::ProxyId _id) {
+		Node* node = (Node*)m_aabbTree.getUserData(_id);
+		if (_frustum.inside(node->m_worldBounds)) {
+			results_.push_back(node);
 		}
-		for (auto it = m_nodes[i].begin(); it != m_nodes[i].end(); ++it) {
-			if (strcmp((*it)->getName(), _name) == 0) {
-				ret = *it;
-				break;
-			}
+	});
+}
+
+void Scene::findNodes(const Sphere& _sphere, eastl::vector<Node*>& results_) const
+{
+	PROFILER_MARKER_CPU("#Scene::findNodes");
+
+	m_aabbTree.findIntersecting(_sphere, [&](AabbTree::ProxyId _id) {
+		Node* node = (Node*)m_aabbTree.getUserData(_id);
+		if (Intersects(_sphere, node->m_worldBounds)) {
+			results_.push_back(node);
 		}
+	});
+}
+
+Node* Scene::findNode(const Ray& _ray, float* t_) const
+{
+	PROFILER_MARKER_CPU("#Scene::findNode");
+
+	AabbTree::ProxyId id;
+	float t;
+	bool hit = m_aabbTree.findClosest(_ray,
+		[&](AabbTree::ProxyId _id, float& t_) {
+			float t1;
+			return Intersect(_ray, ((Node*)m_aabbTree.getUserData(_id))->m_worldBounds, t_, t1);
+		},
+		id, t
+		);
+	if (!hit) {
+		return nullptr;
 	}
+	if (t_) {
+		*t_ = t;
+	}
+	return (Node*)m_aabbTree.getUserData(id);
+}
+
+size_t Scene::getNodeMemoryUsage() const
+{
+	size_t ret = 0;
+	for (auto& nodes : m_nodes) {
+		ret += nodes.size() * sizeof(Node) + nodes.capacity() * sizeof(Node*);
+	}
+	ret += m_nodesById.getMemoryUsage() + m_nodesByName.getMemoryUsage();
+	ret += m_worldMatrices.capacity() * sizeof(mat4) + m_freeWorldMatrices.capacity() * sizeof(uint32);
+	ret += m_localMatrices.capacity() * sizeof(mat4) + m_freeLocalMatrices.capacity() * sizeof(uint32);
+	ret += m_flatNodes.capacity() * sizeof(Node*) + m_flatParents.capacity() * sizeof(uint32) + m_flatState.capacity() * sizeof(uint8);
+	ret += m_flatBatchedNodes.capacity() * sizeof(uint32) + m_flatBatchIndices.capacity() * sizeof(uint32) + m_batchPrevWorldMatrices.capacity() * sizeof(mat4);
 	return ret;
 }
 
@@ -514,6 +1014,7 @@ bool frm::Serialize(Serializer& _serializer_, Scene& _scene_)
 
 	ret &= Serialize(_serializer_, _scene_, *_scene_.m_root);
 	if (_serializer_.getMode() == Serializer::Mode_Read) {
+		_scene_.rebuildNodeMaps(); // nodes are added to m_nodes directly, ids/names are read from the file
 		#ifdef frm_Scene_ENABLE_EDIT
 			_scene_.m_editNode   = nullptr;
 			_scene_.m_editXForm  = nullptr;
@@ -534,27 +1035,16 @@ bool frm::Serialize(Serializer& _serializer_, Scene& _scene_)
 	ret &= Serialize(_serializer_, drawCameraId, "DrawCameraId");
 	ret &= Serialize(_serializer_, cullCameraId, "CullCameraId");
 	if (_serializer_.getMode() == Serializer::Mode_Read) {
-		if (drawCameraId != Node::kInvalidId) {
-			Node* n = _scene_.findNode(drawCameraId, Node::Type_Camera);
-			if (n != nullptr) {
-				_scene_.m_drawCamera = n->getSceneDataCamera();
-			}
-		}
-		if (cullCameraId != Node::kInvalidId) {
-			Node* n = _scene_.findNode(cullCameraId, Node::Type_Camera);
-			if (n != nullptr) {
-				_scene_.m_cullCamera = n->getSceneDataCamera();
-			}
-		}
+		_scene_.resolveCameras(drawCameraId, cullCameraId);
 
 		for (int i = 0; i < Node::Type_Count; ++i) {
 			s_typeCounters[i] = APT_MAX((unsigned int)_scene_.m_nodes[i].size(), s_typeCounters[i]);
 		}
-	}
-
-	APT_ASSERT(_scene_.m_drawCamera != nullptr);
-	if (_scene_.m_cullCamera == nullptr) {
-		_scene_.m_cullCamera = _scene_.m_drawCamera;
+	} else {
+		APT_ASSERT(_scene_.m_drawCamera != nullptr);
+		if (_scene_.m_cullCamera == nullptr) {
+			_scene_.m_cullCamera = _scene_.m_drawCamera;
+		}
 	}
 
 	return ret;
@@ -580,7 +1070,11 @@ bool frm::Serialize(Serializer& _serializer_, Scene& _scene_, Node& _node_)
 	}
 
 	ret &= Serialize(_serializer_, _node_.m_userData,    "UserData");
-	ret &= Serialize(_serializer_, _node_.m_localMatrix, "LocalMatrix");
+	mat4 localMatrix = _node_.getLocalMatrix();
+	ret &= Serialize(_serializer_, localMatrix, "LocalMatrix");
+	if (_serializer_.getMode() == Serializer::Mode_Read) {
+		_node_.setLocalMatrix(localMatrix);
+	}
 
 	String<64> typeStr = kNodeTypeStr[_node_.m_type];
 	ret &= Serialize(_serializer_, typeStr, "Type");
@@ -626,13 +1120,12 @@ bool frm::Serialize(Serializer& _serializer_, Scene& _scene_, Node& _node_)
 		uint childCount = (uint)_node_.getChildCount();
 		if (_serializer_.beginArray(childCount, "Children")) {
 			while (_serializer_.beginObject()) {
-				Node* child = _scene_.m_nodePool.alloc(Node());
+				Node* child = _scene_.allocNode(Node());
 				if (!Serialize(_serializer_, _scene_, *child)) {
 					_scene_.m_nodePool.free(child);
 					return false;
 				}
-				child->m_parent = &_node_;
-				_node_.m_children.push_back(child);
+				_node_.linkChild(child);
 				_scene_.m_nodes[child->m_type].push_back(child);
 				_serializer_.endObject();
 			}
@@ -649,8 +1142,7 @@ bool frm::Serialize(Serializer& _serializer_, Scene& _scene_, Node& _node_)
 				XForm* xform = XForm::Create(StringHash((const char*)className));
 				if (xform) {
 					xform->serialize(_serializer_);
-					xform->setNode(&_node_);
-					_node_.m_xforms.push_back(xform);
+					_node_.addXForm(xform);
 				} else {
 					APT_LOG_ERR("Scene: Invalid xform '%s'", (const char*)className);
 				}
@@ -681,9 +1173,9 @@ bool frm::Serialize(Serializer& _serializer_, Scene& _scene_, Node& _node_)
 
 	 // \todo childCount is incorrect as '#' nodes aren't serialized
 		uint childCount = (uint)_node_.getChildCount();
-		if (!_node_.m_children.empty()) {
+		if (_node_.m_firstChild) {
 			_serializer_.beginArray(childCount, "Children");
-				for (auto& child : _node_.m_children) {
+				for (Node* child = _node_.m_firstChild; child; child = child->m_nextSibling) {
 					if (child->getName()[0] == '#') {
 						continue;
 					}
@@ -695,9 +1187,9 @@ bool frm::Serialize(Serializer& _serializer_, Scene& _scene_, Node& _node_)
 		}
 
 		uint xformCount = (uint)_node_.getXFormCount();
-		if (!_node_.m_xforms.empty()) {
+		if (_node_.m_firstXForm) {
 			_serializer_.beginArray(xformCount, "XForms");
-				for (auto& xform : _node_.m_xforms) {
+				for (XForm* xform = _node_.m_firstXForm; xform; xform = xform->getNext()) {
 					_serializer_.beginObject();
 						String<64> className = xform->getClassRef()->getName();
 						Serialize(_serializer_, className, "Class");
@@ -711,6 +1203,377 @@ bool frm::Serialize(Serializer& _serializer_, Scene& _scene_, Node& _node_)
 	return true;
 }
 
+// PRIVATE
+
+void Scene::addNode(Node* _node_)
+{
+	m_nodes[_node_->m_type].push_back(_node_);
+	m_nodesById.insert(_node_->m_id, _node_);
+	m_nodesByName.insert(HashString<uint64>(_node_->getName()), _node_);
+}
+
+Node* Scene::allocNode(const Node& _node)
+{
+	Node* ret = m_nodePool.alloc(_node);
+	ret->m_scene = this;
+	if (m_freeWorldMatrices.empty()) {
+		ret->m_worldMatrixIndex = (uint32)m_worldMatrices.size();
+		m_worldMatrices.push_back(identity);
+	} else {
+		ret->m_worldMatrixIndex = m_freeWorldMatrices.back();
+		m_freeWorldMatrices.pop_back();
+		m_worldMatrices[ret->m_worldMatrixIndex] = identity;
+	}
+	return ret;
+}
+
+uint32 Scene::allocLocalMatrix()
+{
+	if (m_freeLocalMatrices.empty()) {
+		m_localMatrices.push_back();
+		return (uint32)m_localMatrices.size() - 1;
+	}
+	uint32 ret = m_freeLocalMatrices.back();
+	m_freeLocalMatrices.pop_back();
+	return ret;
+}
+
+void Scene::rebuildNodeMaps()
+{
+	PROFILER_MARKER_CPU("#Scene::rebuildNodeMaps");
+
+	m_nodesById.clear();
+	m_nodesByName.clear();
+	for (int i = 0; i < Node::Type_Count; ++i) {
+		for (Node* node : m_nodes[i]) {
+			m_nodesById.insert(node->m_id, node);
+			m_nodesByName.insert(HashString<uint64>(node->getName()), node);
+		}
+	}
+}
+
+void Scene::resolveCameras(Node::Id _drawCameraId, Node::Id _cullCameraId)
+{
+	if (_drawCameraId != Node::kInvalidId) {
+		Node* n = findNode(_drawCameraId, Node::Type_Camera);
+		if (n != nullptr && n->getType() == Node::Type_Camera) {
+			m_drawCamera = n->getSceneDataCamera();
+		}
+	}
+	if (_cullCameraId != Node::kInvalidId) {
+		Node* n = findNode(_cullCameraId, Node::Type_Camera);
+		if (n != nullptr && n->getType() == Node::Type_Camera) {
+			m_cullCamera = n->getSceneDataCamera();
+		}
+	}
+	APT_ASSERT(m_drawCamera != nullptr);
+	if (m_cullCamera == nullptr) {
+		m_cullCamera = m_drawCamera;
+	}
+}
+
+void Scene::renameNode(Node* _node_, const char* _name)
+{
+	m_nodesByName.remove(HashString<uint64>(_node_->getName()), _node_);
+	_node_->m_name.set(_name);
+	m_nodesByName.insert(HashString<uint64>(_node_->getName()), _node_);
+}
+
+void Scene::NodeMap::insert(uint64 _key, Node* _node)
+{
+	APT_ASSERT(_node);
+ // keep the load factor <= 0.5
+	if ((m_count + 1) * 2 > (uint32)m_slots.size()) {
+		rehash(APT_MAX((uint32)m_slots.size() * 2, 64u));
+	}
+	uint32 mask = (uint32)m_slots.size() - 1;
+	uint32 i = Hash(_key) & mask;
+	while (m_slots[i].m_node) {
+		i = (i + 1) & mask;
+	}
+	m_slots[i].m_key  = _key;
+	m_slots[i].m_node = _node;
+	++m_count;
+}
+
+void Scene::NodeMap::remove(uint64 _key, Node* _node)
+{
+	APT_ASSERT(!m_slots.empty()); // not found
+	if (m_slots.empty()) {
+		return;
+	}
+	uint32 mask = (uint32)m_slots.size() - 1;
+	uint32 i = Hash(_key) & mask;
+	while (m_slots[i].m_node != _node) {
+		if (!m_slots[i].m_node) {
+			APT_ASSERT(false); // not found, _key must match the key passed to insert()
+			return;
+		}
+		i = (i + 1) & mask;
+	}
+
+ // backward shift deletion: move subsequent entries in the probe sequence into the gap unless their home slot is
+ // cyclically in (i, j]
+	for (uint32 j = (i + 1) & mask; m_slots[j].m_node; j = (j + 1) & mask) {
+		uint32 home = Hash(m_slots[j].m_key) & mask;
+		bool inRange = i <= j ? (i < home && home <= j) : (i < home || home <= j);
+		if (!inRange) {
+			m_slots[i] = m_slots[j];
+			i = j;
+		}
+	}
+	m_slots[i].m_node = nullptr;
+	--m_count;
+}
+
+void Scene::NodeMap::clear()
+{
+	for (auto& slot : m_slots) {
+		slot.m_node = nullptr;
+	}
+	m_count = 0;
+}
+
+void Scene::NodeMap::rehash(uint32 _size)
+{
+	APT_ASSERT(APT_IS_POW2(_size));
+	eastl::vector<Slot> slots(_size);
+	for (auto& slot : slots) {
+		slot.m_node = nullptr;
+	}
+	eastl::swap(slots, m_slots);
+	m_count = 0;
+	for (auto& slot : slots) {
+		if (slot.m_node) {
+			insert(slot.m_key, slot.m_node);
+		}
+	}
+}
+
+void Scene::updateFlatHierarchy()
+{
+	if (!m_flatNodes.empty() && m_flatVersion == m_hierarchyVersion) {
+		return;
+	}
+	PROFILER_MARKER_CPU("#Scene::updateFlatHierarchy");
+
+	m_flatNodes.clear();
+	m_flatParents.clear();
+	
+ // pre-order traversal, push children in reverse to preserve the sibling order
+	eastl::vector<eastl::pair<Node*, uint32> > stack;
+	stack.push_back(eastl::make_pair(m_root, ~0u));
+	while (!stack.empty()) {
+		Node*  node   = stack.back().first;
+		uint32 parent = stack.back().second;
+		stack.pop_back();
+		uint32 index = (uint32)m_flatNodes.size();
+		m_flatNodes.push_back(node);
+		m_flatParents.push_back(parent);
+		for (Node* child = node->m_lastChild; child; child = child->m_prevSibling) {
+			stack.push_back(eastl::make_pair(child, index));
+		}
+	}
+ // reorder the world matrices to match, nodes which aren't reachable from the root (detached subtrees) follow
+	uint32 nodeCount = 0;
+	for (auto& nodes : m_nodes) {
+		nodeCount += (uint32)nodes.size();
+	}
+	eastl::vector<mat4> worldMatrices;
+	worldMatrices.reserve(nodeCount);
+	for (Node* node : m_flatNodes) {
+		worldMatrices.push_back(m_worldMatrices[node->m_worldMatrixIndex]);
+	}
+	if (m_flatNodes.size() < nodeCount) {
+		eastl::vector<uint8> reachable(m_worldMatrices.size(), 0);
+		for (Node* node : m_flatNodes) {
+			reachable[node->m_worldMatrixIndex] = 1;
+		}
+		for (auto& nodes : m_nodes) {
+			for (Node* node : nodes) {
+				if (!reachable[node->m_worldMatrixIndex]) {
+					worldMatrices.push_back(m_worldMatrices[node->m_worldMatrixIndex]);
+					node->m_worldMatrixIndex = (uint32)worldMatrices.size() - 1;
+				}
+			}
+		}
+	}
+	for (uint32 i = 0, n = (uint32)m_flatNodes.size(); i < n; ++i) {
+		m_flatNodes[i]->m_worldMatrixIndex = i;
+	}
+	eastl::swap(m_worldMatrices, worldMatrices);
+	m_freeWorldMatrices.clear();
+	m_flatState.resize(m_flatNodes.size());
+
+ // each child of the root begins a contiguous subtree
+	m_flatSubtrees.clear();
+	m_flatDependentSubtrees.clear();
+	for (uint32 i = 1, n = (uint32)m_flatNodes.size(); i < n;) {
+		FlatRange subtree;
+		subtree.m_first = i;
+		bool independent = true;
+		do {
+		 // camera updates may write to a GPU buffer, which must happen on the main thread
+			Node* node = m_flatNodes[i];
+			independent &= node->getType() != Node::Type_Camera;
+			for (XForm* xform = node->m_firstXForm; xform; xform = xform->getNext()) {
+				independent &= xform->isIndependent();
+			}
+			++i;
+		} while (i < n && m_flatParents[i] != 0);
+		subtree.m_last = i;
+		(independent ? m_flatSubtrees : m_flatDependentSubtrees).push_back(subtree);
+	}
+
+ // batch the xforms of nodes with only independent xforms by (slot, class)
+	m_xformBatches.clear();
+	m_flatBatchedNodes.clear();
+	eastl::vector_map<eastl::pair<uint32, const void*>, uint32> batchMap; // (slot, class) -> index in m_xformBatches
+	m_flatBatchIndices.clear();
+	m_flatBatchIndices.resize(m_flatNodes.size(), ~0u);
+	for (uint32 i = 0, n = m_batchXForms ? (uint32)m_flatNodes.size() : 0; i < n; ++i) {
+		Node* node = m_flatNodes[i];
+		if (!node->m_firstXForm) {
+			continue;
+		}
+		bool independent = true;
+		for (XForm* xform = node->m_firstXForm; xform; xform = xform->getNext()) {
+			independent &= xform->isIndependent();
+		}
+		if (!independent) {
+			continue;
+		}
+		uint32 slot = 0;
+		for (XForm* xform = node->m_firstXForm; xform; xform = xform->getNext(), ++slot) {
+			const void* cref = xform->getClassRef();
+			auto it = batchMap.find(eastl::make_pair(slot, cref));
+			if (it == batchMap.end()) {
+				it = batchMap.insert(eastl::make_pair(eastl::make_pair(slot, cref), (uint32)m_xformBatches.size())).first;
+				m_xformBatches.push_back();
+				m_xformBatches.back().m_class = cref;
+				m_xformBatches.back().m_slot  = slot;
+			}
+			XFormBatch& batch = m_xformBatches[it->second];
+			batch.m_xforms.push_back(xform);
+			batch.m_flatIndices.push_back(i);
+		}
+		m_flatBatchIndices[i] = (uint32)m_flatBatchedNodes.size();
+		m_flatBatchedNodes.push_back(i);
+	}
+	eastl::stable_sort(m_xformBatches.begin(), m_xformBatches.end(), 
+		[](const XFormBatch& _a, const XFormBatch& _b) {
+			return _a.m_slot < _b.m_slot;
+		});
+
+ // sort each batch by address, xforms of the same class are packed together in the slabs (see XForm::operator new())
+	eastl::vector<eastl::pair<XForm*, uint32> > sorted;
+	for (auto& batch : m_xformBatches) {
+		sorted.clear();
+		for (uint32 i = 0, n = (uint32)batch.m_xforms.size(); i < n; ++i) {
+			sorted.push_back(eastl::make_pair(batch.m_xforms[i], batch.m_flatIndices[i]));
+		}
+		eastl::sort(sorted.begin(), sorted.end());
+		for (uint32 i = 0, n = (uint32)sorted.size(); i < n; ++i) {
+			batch.m_xforms[i]      = sorted[i].first;
+			batch.m_flatIndices[i] = sorted[i].second;
+		}
+	}
+
+	m_batchPrevWorldMatrices.resize(m_flatBatchedNodes.size());
+
+	m_flatVersion = m_hierarchyVersion;
+}
+
+void Scene::applyXFormBatches(float _dt, uint8 _stateMask)
+{
+	if (m_xformBatches.empty()) {
+		return;
+	}
+	PROFILER_MARKER_CPU("#Scene::applyXFormBatches");
+
+ // flag skipped nodes (overwritten by updateFlatRange())
+	for (uint32 i = 0, n = (uint32)m_flatNodes.size(); i < n; ++i) {
+		uint32 parent = m_flatParents[i];
+		bool skipped = (parent != ~0u && m_flatState[parent] == FlatState_Skipped) || !(m_flatNodes[i]->m_state & _stateMask);
+		m_flatState[i] = skipped ? FlatState_Skipped : FlatState_Unchanged;
+	}
+
+ // reset world matrices, keep the previous world matrix for updateFlatRange()
+	for (uint32 i = 0, n = (uint32)m_flatBatchedNodes.size(); i < n; ++i) {
+		uint32 j = m_flatBatchedNodes[i];
+		if (m_flatState[j] != FlatState_Skipped) {
+			m_batchPrevWorldMatrices[i] = m_worldMatrices[j];
+			m_flatNodes[j]->composeLocalMatrix(nullptr, m_worldMatrices[j]);
+		}
+	}
+
+	for (auto& batch : m_xformBatches) {
+		m_xformBatchScratch.clear();
+		for (uint32 i = 0, n = (uint32)batch.m_xforms.size(); i < n; ++i) {
+			if (m_flatState[batch.m_flatIndices[i]] != FlatState_Skipped) {
+				m_xformBatchScratch.push_back(batch.m_xforms[i]);
+			}
+		}
+		if (m_xformBatchScratch.empty()) {
+			continue;
+		}
+		XForm::ApplyBatchFunc* applyBatch = m_xformBatchScratch[0]->getApplyBatch();
+		XForm* const* xforms = m_xformBatchScratch.data();
+		uint32 count = (uint32)m_xformBatchScratch.size();
+		if (m_parallelUpdate && count >= kMinParallelUpdateNodes) {
+			JobSystem::ParallelFor(count, 256, 
+				[applyBatch, xforms, _dt](uint32 _begin, uint32 _end) {
+					applyBatch(xforms + _begin, _end - _begin, _dt);
+				},
+				"#Scene::applyXFormBatches"
+				);
+		} else {
+			applyBatch(xforms, count, _dt);
+		}
+	}
+}
+
+void Scene::updateFlatRange(uint32 _first, uint32 _last, float _dt, uint8 _stateMask)
+{
+	for (uint32 i = _first; i < _last; ++i) {
+		Node* node = m_flatNodes[i];
+		uint32 parent = m_flatParents[i];
+		uint8 parentState = parent == ~0u ? (uint8)FlatState_Unchanged : m_flatState[parent];
+		if (parentState == FlatState_Skipped || !(node->m_state & _stateMask)) {
+		 // children of a node which doesn't match _stateMask aren't updated
+			m_flatState[i] = FlatState_Skipped;
+			continue;
+		}
+	 // cameras are always updated, their projection may change independently of the node (e.g. setAspectRatio())
+		if (parentState == FlatState_Changed || node->m_dirty || node->isDynamic() || node->m_firstXForm || node->m_type == Node::Type_Camera) {
+			uint32 batchIndex = m_flatBatchIndices[i];
+			bool changed = Node::UpdateSingle(node, _dt, parent == ~0u ? nullptr : &m_worldMatrices[parent], batchIndex == ~0u ? nullptr : &m_batchPrevWorldMatrices[batchIndex]);
+			node->m_dirty = false;
+			m_flatState[i] = changed ? FlatState_Changed : FlatState_Unchanged;
+		} else {
+			m_flatState[i] = FlatState_Unchanged;
+		}
+	}
+}
+
+void Scene::updateAabbTree()
+{
+	PROFILER_MARKER_CPU("#Scene::updateAabbTree");
+
+	for (Node* node : m_boundedNodes) {
+		if (!node->m_boundsDirty) {
+			continue;
+		}
+		node->m_boundsDirty = false;
+		AlignedBox worldBounds = node->m_localBounds;
+		worldBounds.transform(node->getWorldMatrix());
+	 // predict the next frame's movement from this frame's, avoids reinserting nodes which move every frame
+		vec3 displacement = worldBounds.getOrigin() - node->m_worldBounds.getOrigin();
+		node->m_worldBounds = worldBounds;
+		m_aabbTree.move(node->m_aabbTreeProxy, worldBounds, displacement);
+	}
+}
+
 #ifdef frm_Scene_ENABLE_EDIT
 
 #include <im3d/Im3d.h>
@@ -834,7 +1697,7 @@ void Scene::editNodes()
 			static Node::NameStr s_nameBuf;
 			s_nameBuf.set((const char*)m_editNode->m_name);
 			if (ImGui::InputText("Name", (char*)s_nameBuf, s_nameBuf.getCapacity(), ImGuiInputTextFlags_AutoSelectAll | ImGuiInputTextFlags_CharsNoBlank | ImGuiInputTextFlags_EnterReturnsTrue)) {
-				m_editNode->m_name.set((const char*)s_nameBuf);
+				m_editNode->setName((const char*)s_nameBuf);
 			}
 
 			bool active = m_editNode->isActive();
@@ -862,11 +1725,11 @@ void Scene::editNodes()
 
 			if (newParent != m_editNode->getParent()) {
 			 // maintain child world space position when changing parent
-				mat4 parentWorld = m_editNode->m_parent ? m_editNode->m_parent->m_worldMatrix : identity;
-				mat4 childWorld = parentWorld * m_editNode->m_localMatrix;
+				mat4 parentWorld = m_editNode->m_parent ? m_editNode->m_parent->getWorldMatrix() : identity;
+				mat4 childWorld = parentWorld * m_editNode->getLocalMatrix();
 				m_editNode->setParent(newParent);
-				parentWorld = m_editNode->m_parent ? m_editNode->m_parent->m_worldMatrix : identity;
-				m_editNode->m_localMatrix = inverse(parentWorld) * childWorld;
+				parentWorld = m_editNode->m_parent ? m_editNode->m_parent->getWorldMatrix() : identity;
+				m_editNode->setLocalMatrix(inverse(parentWorld) * childWorld);
 			}
 			ImGui::SameLine();
 			if (m_editNode->getParent()) {
@@ -878,11 +1741,10 @@ void Scene::editNodes()
 				ImGui::Text("--");
 			}
 
-			if (!m_editNode->m_children.empty()) {
+			if (m_editNode->m_firstChild) {
 				ImGui::Spacing();
 				if (ImGui::TreeNode("Children")) {
-					for (auto it = m_editNode->m_children.begin(); it != m_editNode->m_children.end(); ++it) {
-						Node* child = *it;
+					for (Node* child = m_editNode->m_firstChild; child; child = child->m_nextSibling) {
 						ImGui::Text("%s %s", kNodeTypeIconStr[child->getType()], child->getName());
 						if (ImGui::IsItemClicked()) {
 							newEditNode = child;
@@ -896,16 +1758,19 @@ void Scene::editNodes()
 
 			if (ImGui::TreeNode("Local Matrix")) {
 			 // hierarchical update - modify the world space node and transform back into parent space
-				mat4 parentWorld = m_editNode->m_parent ? m_editNode->m_parent->m_worldMatrix : identity;
-				mat4 childWorld = parentWorld * m_editNode->m_localMatrix;
+				mat4 parentWorld = m_editNode->m_parent ? m_editNode->m_parent->getWorldMatrix() : identity;
+				mat4 localMatrix = m_editNode->getLocalMatrix();
+				mat4 childWorld = parentWorld * localMatrix;
 				if (Im3d::Gizmo("GizmoNodeLocal", (float*)&childWorld)) {
-					m_editNode->m_localMatrix = inverse(parentWorld) * childWorld;
+					m_editNode->setLocalMatrix(inverse(parentWorld) * childWorld);
 					Node::Update(m_editNode, 0.0f, Node::State_Any); // force node update
 				}
 
-				vec3 position = GetTranslation(m_editNode->m_localMatrix);
-				vec3 rotation = ToEulerXYZ(GetRotation(m_editNode->m_localMatrix));
-				vec3 scale    = GetScale(m_editNode->m_localMatrix);
+				localMatrix = m_editNode->getLocalMatrix();
+				vec3 position = GetTranslation(localMatrix);
+				vec3 rotation = ToEulerXYZ(GetRotation(localMatrix));
+				vec3 scale    = GetScale(localMatrix);
+				ImGui::Text("Storage:  %s", m_editNode->isLocalCompact() ? "TRS" : "Matrix");
 				ImGui::Text("Position: %.3f, %.3f, %.3f", position.x, position.y, position.z);
 				ImGui::Text("Rotation: %.3f, %.3f, %.3f", Degrees(rotation.x), Degrees(position.y), Degrees(position.z));
 				ImGui::Text("Scale:    %.3f, %.3f, %.3f", scale.x, scale.y, scale.z);
@@ -937,21 +1802,23 @@ void Scene::editNodes()
 					}
 				}
 
-				if (!m_editNode->m_xforms.empty()) {
+				if (m_editNode->m_firstXForm) {
 				 // build list for xform stack
 					const char* xformList[64];
-					APT_ASSERT(m_editNode->m_xforms.size() <= 64);
+					XForm* xforms[64];
+					APT_ASSERT(m_editNode->m_xformCount <= 64);
 					int selectedXForm = 0;
-					for (int i = 0; i < (int)m_editNode->m_xforms.size(); ++i) {
-						XForm* xform = m_editNode->m_xforms[i];
+					int i = 0;
+					for (XForm* xform = m_editNode->m_firstXForm; xform; xform = xform->getNext(), ++i) {
 						if (xform == m_editXForm) {
 							selectedXForm = i;
 						}
+						xforms[i] = xform;
 						xformList[i] = xform->getName();
 					}
 					ImGui::Spacing();
-					if (ImGui::ListBox("##XForms", &selectedXForm, xformList, (int)m_editNode->m_xforms.size())) {
-						newEditXForm = m_editNode->m_xforms[selectedXForm];
+					if (ImGui::ListBox("##XForms", &selectedXForm, xformList, i)) {
+						newEditXForm = xforms[selectedXForm];
 					}
 
 					if (m_editXForm) {
@@ -1092,7 +1959,7 @@ void Scene::editCameras()
 			static Node::NameStr s_nameBuf;
 			s_nameBuf.set((const char*)m_editCamera->m_parent->m_name);
 			if (ImGui::InputText("Name", (char*)s_nameBuf, s_nameBuf.getCapacity(), ImGuiInputTextFlags_AutoSelectAll | ImGuiInputTextFlags_CharsNoBlank | ImGuiInputTextFlags_EnterReturnsTrue)) {
-				m_editCamera->m_parent->m_name.set((const char*)s_nameBuf);
+				m_editCamera->m_parent->setName((const char*)s_nameBuf);
 			}
 
 			m_editCamera->edit();
@@ -1162,7 +2029,7 @@ void Scene::editLights()
 			static Node::NameStr s_nameBuf;
 			s_nameBuf.set((const char*)m_editLight->m_parent->m_name);
 			if (ImGui::InputText("Name", (char*)s_nameBuf, s_nameBuf.getCapacity(), ImGuiInputTextFlags_AutoSelectAll | ImGuiInputTextFlags_CharsNoBlank | ImGuiInputTextFlags_EnterReturnsTrue)) {
-				m_editLight->m_parent->m_name.set((const char*)s_nameBuf);
+				m_editLight->m_parent->setName((const char*)s_nameBuf);
 			}
 
 			m_editLight->edit();
@@ -1348,8 +2215,8 @@ void Scene::drawHierarchy(Node* _node)
 		ImGui::Text((const char*)tmp);
 	} else {
 		if (ImGui::TreeNode((const char*)tmp)) {
-			for (int i = 0; i < _node->getChildCount(); ++i) {
-				drawHierarchy(_node->getChild(i));
+			for (Node* child = _node->getFirstChild(); child; child = child->getNextSibling()) {
+				drawHierarchy(child);
 			}
 			ImGui::TreePop();
 		}
@@ -3,6 +3,8 @@
 #define frm_Scene_h
 
 #include <frm/def.h>
+#include <frm/AabbTree.h>
+#include <frm/geom.h>
 #include <frm/math.h>
 
 #include <apt/Pool.h>
@@ -24,6 +26,7 @@ class Node
 {
 	friend class apt::Pool<Node>;
 	friend class Scene;
+	friend void swap(Scene& _a, Scene& _b);
 public:
 	typedef apt::String<24> NameStr;
 	typedef uint64 Id;
@@ -50,18 +53,18 @@ public:
 
 	Id           getId() const                       { return m_id; }
 	const char*  getName() const                     { return (const char*)m_name; }
-	void         setName(const char* _name)          { m_name.set(_name); }
+	void         setName(const char* _name);
 	void         setNamef(const char* _fmt, ...);
 
 	Type         getType() const                     { return (Type)m_type; }
 	void         setType(Type _type)                 { m_type = _type; }
 	
 	uint8        getStateMask() const                { return m_state; }
-	void         setStateMask(uint8 _mask)           { m_state = _mask; }
+	void         setStateMask(uint8 _mask)           { m_state = _mask; m_dirty = true; }
 	bool         isActive() const                    { return (m_state & State_Active) != 0; }
-	void         setActive(bool _state)              { m_state = _state ? (m_state | State_Active) : (m_state & ~State_Active); }
+	void         setActive(bool _state)              { m_state = _state ? (m_state | State_Active) : (m_state & ~State_Active); m_dirty = true; }
 	bool         isDynamic() const                   { return (m_state & State_Dynamic) != 0; }
-	void         setDynamic(bool _state)             { m_state = _state ? (m_state | State_Dynamic) : (m_state & ~State_Dynamic); }
+	void         setDynamic(bool _state)             { m_state = _state ? (m_state | State_Dynamic) : (m_state & ~State_Dynamic); m_dirty = true; }
 	bool         isStatic() const                    { return !isDynamic(); }
 	void         setStatic(bool _state)              { setDynamic(!_state); }
 	bool         isSelected() const                  { return (m_state & State_Selected) != 0; }
@@ -75,27 +78,53 @@ public:
 	Light*       getSceneDataLight() const           { APT_ASSERT(m_type == Type_Light); return (Light*)m_sceneData;   }
 	Scene*       getSceneDataScene() const           { APT_ASSERT(m_type == Type_Root); return (Scene*)m_sceneData;    }
 
-	const mat4&  getLocalMatrix() const              { return m_localMatrix; }
-	void         setLocalMatrix(const mat4& _mat)    { m_localMatrix = _mat; }
-	vec3         getLocalPosition() const            { return m_localMatrix[3].xyz(); }
-	void         setLocalPosition(const vec3& _p)    { m_localMatrix[3] = vec4(_p, 1.0f); }
+	// Setting the local/world matrix marks the node dirty; static nodes are only updated by Scene::update() if they
+	// are dirty or their parent's world matrix changed.
+	// The local matrix is stored compactly as position/orientation/uniform scale if setLocalMatrix() can decompose it
+	// exactly (the recomposed matrix is identical), else as a full matrix in the scene. getLocalMatrix() composes the
+	// matrix on demand, the update composes it directly into the world matrix.
+	mat4         getLocalMatrix() const;
+	void         setLocalMatrix(const mat4& _mat);
+	void         setLocalTRS(const vec3& _position, const quat& _orientation, float _scale = 1.0f);
+	bool         isLocalCompact() const              { return m_localMatrixIndex == ~0u; }
+	vec3         getLocalPosition() const;
+	void         setLocalPosition(const vec3& _p);
 	
-	const mat4&  getWorldMatrix() const              { return m_worldMatrix; }
-	void         setWorldMatrix(const mat4& _mat)    { m_worldMatrix = _mat; }
-	vec3         getWorldPosition() const            { return m_worldMatrix[3].xyz(); }
-	void         setWorldPosition(const vec3& _p)    { m_worldMatrix[3] = vec4(_p, 1.0f); }
+	// The world matrix is stored by the scene (see Scene::getWorldMatrices()), references are invalidated by node
+	// creation and by Scene::update() after a hierarchy change.
+	const mat4&  getWorldMatrix() const;
+	void         setWorldMatrix(const mat4& _mat);
+	vec3         getWorldPosition() const            { return getWorldMatrix()[3].xyz(); }
+	void         setWorldPosition(const vec3& _p);
+	bool         isDirty() const                     { return m_dirty; }
+	void         setDirty()                          { m_dirty = true; }
+	// Index of the node's world matrix in Scene::getWorldMatrices(), the hierarchy order is restored by
+	// Scene::update().
+	uint32       getWorldMatrixIndex() const         { return m_worldMatrixIndex; }
+
+	// Bounds are set via Scene::setNodeBounds(); the world bounds are updated by Scene::update().
+	bool              hasBounds() const              { return m_aabbTreeProxy != AabbTree::kInvalidProxy; }
+	const AlignedBox& getLocalBounds() const         { return m_localBounds; }
+	const AlignedBox& getWorldBounds() const         { return m_worldBounds; }
 	
 	
+	// XForms and children are stored as intrusive lists; getXForm()/getChild() are O(_i), prefer iterating via
+	// getFirstXForm()/XForm::getNext() and getFirstChild()/getNextSibling().
 	void         addXForm(XForm* _xform);
 	void         removeXForm(XForm* _xform);
-	int          getXFormCount() const               { return (int)m_xforms.size(); }
-	XForm*       getXForm(int _i)                    { return m_xforms[_i]; }
+	int          getXFormCount() const               { return (int)m_xformCount; }
+	XForm*       getXForm(int _i);
+	XForm*       getFirstXForm() const               { return m_firstXForm; }
 	void         moveXForm(const XForm* _xform, int _dir);
 
 	Node*        getParent()                         { return m_parent; }
 	void         setParent(Node* _node);
-	int          getChildCount() const               { return (int)m_children.size(); }
-	Node*        getChild(int _i)                    { return m_children[_i]; }
+	int          getChildCount() const               { return (int)m_childCount; }
+	Node*        getChild(int _i);
+	Node*        getFirstChild() const               { return m_firstChild; }
+	Node*        getLastChild() const                { return m_lastChild; }
+	Node*        getNextSibling() const              { return m_nextSibling; }
+	Node*        getPrevSibling() const              { return m_prevSibling; }
 	void         addChild(Node* _node);
 	void         removeChild(Node* _node);
 
@@ -111,19 +140,41 @@ private:
 	uint64                m_sceneData;   // Scene-defined data.
 
  // spatial
-	mat4                  m_localMatrix; // Initial (local) transformation.
-	mat4                  m_worldMatrix; // Final transformation with any XForms applied.
-	eastl::vector<XForm*> m_xforms;      // XForm list (applied in order).
+	vec3                  m_localPosition;    // Initial (local) transformation, if compact.
+	float                 m_localScale;
+	quat                  m_localOrientation;
+	uint32                m_localMatrixIndex; // Index into Scene::m_localMatrices if not compact, else ~0.
+	uint32                m_worldMatrixIndex; // Index into Scene::m_worldMatrices (final transformation with any XForms applied).
+	Scene*                m_scene;            // Scene which stores the matrices, set by Scene::allocNode().
+	XForm*                m_firstXForm;  // XForm list (applied in order), linked via XForm::m_next.
+	uint32                m_xformCount;
+	bool                  m_dirty;       // Local/world matrix or parent changed since the last Scene::update().
+
+ // bounds
+	AlignedBox            m_localBounds;
+	AlignedBox            m_worldBounds;   // m_localBounds transformed by the world matrix.
+	AabbTree::ProxyId     m_aabbTreeProxy; // Proxy in the scene AabbTree, kInvalidProxy if the node has no bounds.
+	bool                  m_boundsDirty;   // World matrix changed during Update(), world bounds need refitting.
 
  // hierarchy
 	Node*                 m_parent;
-	eastl::vector<Node*>  m_children;
+	Node*                 m_firstChild;
+	Node*                 m_lastChild;
+	Node*                 m_prevSibling;
+	Node*                 m_nextSibling;
+	uint32                m_childCount;
 
 	// Auto name based on type, e.g. Camera_001, Object_123
 	static void AutoName(Node::Type _type, Node::NameStr& out_);
 	
-	// Recursively update _node_, apply xforms.
-	static void Update(Node* _node_, float _dt, uint8 _stateMask);
+	// Recursively update _node_, apply xforms. Nodes whose world matrix changed are appended to changedNodes_ (if not
+	// nullptr).
+	static void Update(Node* _node_, float _dt, uint8 _stateMask, eastl::vector<Node*>* changedNodes_ = nullptr);
+
+	// Update _node_ only (not its children): apply xforms, move to parent space. _parentWorldMatrix is nullptr for the root.
+	// If _prevWorldMatrix is not nullptr the xforms were already applied to the world matrix (see Scene::applyXFormBatches())
+	// and _prevWorldMatrix is the world matrix from the previous update. Return true if the world matrix changed.
+	static bool UpdateSingle(Node* _node_, float _dt, const mat4* _parentWorldMatrix, const mat4* _prevWorldMatrix = nullptr);
 
 	Node();
 	Node(Type _type, Id _id, uint8 _state, const char* _name = nullptr);
@@ -131,14 +182,27 @@ private:
 	// Maintains traversability by reparenting child nodes to m_parent.	
 	~Node();
 
+	mat4& worldMatrix();
+	// Compose the local matrix into out_, premultiplied by _parentWorldMatrix if not nullptr.
+	void composeLocalMatrix(const mat4* _parentWorldMatrix, mat4& out_) const;
+
 	// Move _ith XForm within the stack; _dir is an offset from the current index. Return new index.
 	int moveXForm(int _i, int _dir);
 
+	// Append _node to the child list without updating it (_node must not have a parent).
+	void linkChild(Node* _node);
+	// Insert _xform into the xform list at index _i (clamped), or remove it. Don't modify _xform->m_node.
+	void linkXForm(XForm* _xform, int _i);
+	void unlinkXForm(XForm* _xform);
+
 
 	void setSceneDataCamera(Camera* _camera) { APT_ASSERT(m_type == Type_Camera); m_sceneData = (uint64)_camera; }
 	void setSceneDataLight(Light* _light)    { APT_ASSERT(m_type == Type_Light);  m_sceneData = (uint64)_light;  }
 	void setSceneDataScene(Scene* _scene)    { APT_ASSERT(m_type == Type_Root);   m_sceneData = (uint64)_scene;  }
 
+	// Increment the hierarchy version of m_scene, call when a parent/child link or the xform list changes.
+	void   hierarchyChanged();
+
 }; // class Node
 
 
@@ -147,6 +211,8 @@ private:
 ////////////////////////////////////////////////////////////////////////////////
 class Scene
 {
+	friend class Node;
+	friend class SceneStreamer;
 public:
 	typedef bool (OnVisit)(Node* _node_);
 
@@ -156,19 +222,39 @@ public:
 	static Camera* GetDrawCamera()                   { return s_currentScene->getDrawCamera(); }
 	static Camera* GetCullCamera()                   { return s_currentScene->getCullCamera(); }
 
-	// Load scene from path, swap with scene_ if successful & return true.
+	// Load scene from path, swap with scene_ if successful & return true. Paths with the extension 'scnb' are read
+	// as binary (see Scene_bin.cpp), else as JSON.
 	static bool Load(const char* _path, Scene& scene_);
 
-	// Save scene to path, return true if successful.
+	// Save scene to path, return true if successful. The format is chosen by extension as for Load().
 	static bool Save(const char* _path, Scene& _scene);
 
+	// Convert a scene file between the JSON and binary formats (chosen by extension), return true if successful.
+	static bool Convert(const char* _srcPath, const char* _dstPath);
+
 	Scene();
 	~Scene();
 
 	// Update all nodes matching _stateMask. If a node does not match _stateMask 
 	// then none of its children are updated.
+	// Nodes are updated in a single linear pass over a flattened copy of the 
+	// hierarchy (parents before children), rebuilt when the hierarchy changes.
+	// Static nodes without xforms are skipped unless they are dirty or their
+	// parent's world matrix changed (camera nodes are always updated).
+	// Subtrees under the root are updated in parallel via the JobSystem (see
+	// setParallelUpdate()); xforms must therefore only modify their own node.
+	// Subtrees containing cameras or xforms which read other nodes (see
+	// XForm::isIndependent()) are updated serially afterwards, such that the
+	// result is identical to the serial update.
+	// Xforms of nodes with only independent xforms are applied beforehand in
+	// batches per class and position in the node's xform list (see
+	// XForm::getApplyBatch(), setBatchXForms()), hence the order of xforms on
+	// each node is preserved.
 	void update(float _dt, uint8 _stateMask = Node::State_Active | Node::State_Dynamic);
 
+	// As update(), but recursively traverse the node graph (reference implementation).
+	void updateRecursive(float _dt, uint8 _stateMask = Node::State_Active | Node::State_Dynamic);
+
 	// Pre-order traversal of the node graph starting at _root_, calling _callback 
 	// at every node which matches _stateMask. The callback should return false if 
 	// the traversal should stop.
@@ -176,12 +262,48 @@ public:
 
 	Node*   createNode(Node::Type _type, Node* _parent = nullptr);
 	void    destroyNode(Node*& _node_);
+	// Find a node by id or name via hash maps, _typeHint is used to choose between nodes with the same name.
 	Node*   findNode(Node::Id _id, Node::Type _typeHint = Node::Type_Count);
 	Node*   findNode(const char* _name, Node::Type _typeHint = Node::Type_Count);
 	int     getNodeCount(Node::Type _type) const    { return (int)m_nodes[_type].size(); }
 	Node*   getNode(Node::Type _type, int _i) const { return m_nodes[_type][_i]; }
 	Node*   getRoot()                               { return m_root; }
 
+	// Nodes whose world matrix changed during the last update() or updateRecursive(), in hierarchy order. Use for incremental updates of
+	// downstream data (culling structures, GPU instance data, etc.).
+	const eastl::vector<Node*>& getChangedNodes() const { return m_changedNodes; }
+
+	// World matrices of all nodes (see Node::getWorldMatrixIndex()), this is the only copy. After update() the array
+	// is in hierarchy order (nodes which aren't reachable from the root follow) and tightly packed, hence it can be
+	// uploaded directly as a GPU instance buffer. The version changes when the hierarchy changes (and hence the node
+	// indices).
+	const mat4* getWorldMatrices() const            { return m_worldMatrices.data(); }
+	uint32      getWorldMatrixCount() const         { return (uint32)m_worldMatrices.size(); }
+	uint32      getWorldMatrixVersion() const       { return m_flatVersion; }
+
+	// Approximate memory used by the nodes and per-node scene data (matrices, flattened hierarchy, node maps), in
+	// bytes. Excludes cameras, lights, xforms and pool overhead.
+	size_t      getNodeMemoryUsage() const;
+
+	// Enable/disable the parallel update of subtrees in update().
+	void    setParallelUpdate(bool _enable)         { m_parallelUpdate = _enable; }
+	bool    getParallelUpdate() const               { return m_parallelUpdate; }
+	// Enable/disable the batched application of xforms in update().
+	void    setBatchXForms(bool _enable)            { m_batchXForms = _enable; m_flatNodes.clear(); } // force a rebuild
+	bool    getBatchXForms() const                  { return m_batchXForms; }
+
+	// Insert _node_ into the scene AabbTree (or update its local bounds). Bounded nodes are refit after update()
+	// if their world matrix changed; small movements are absorbed by the tree's fat boxes.
+	void    setNodeBounds(Node* _node_, const AlignedBox& _localBounds);
+	void    clearNodeBounds(Node* _node_);
+	const AabbTree& getAabbTree() const             { return m_aabbTree; }
+
+	// Spatial queries on bounded nodes, tested against the world bounds.
+	void    findNodes(const Frustum& _frustum, eastl::vector<Node*>& results_) const;
+	void    findNodes(const Sphere& _sphere, eastl::vector<Node*>& results_) const;
+	// Return the bounded node closest to the ray origin, or nullptr. t_ is the distance to the node's world bounds.
+	Node*   findNode(const Ray& _ray, float* t_ = nullptr) const;
+
 	// Create a camera with parameters from _copyFrom, plus a new camera node.
 	Camera* createCamera(const Camera& _copyFrom, Node* _parent = nullptr);
 	void    destroyCamera(Camera*& _camera_);
@@ -221,6 +343,97 @@ private:
 	eastl::vector<Node*>    m_nodes[Node::Type_Count];  // Nodes binned by type.
 	apt::Pool<Node>         m_nodePool;
 
+	// Open addressing (linear probing) map from a 64 bit key to nodes, keys needn't be unique.
+	class NodeMap
+	{
+	public:
+		void  insert(uint64 _key, Node* _node);
+		void  remove(uint64 _key, Node* _node);
+		void  clear();
+		size_t getMemoryUsage() const                   { return m_slots.capacity() * sizeof(Slot); }
+
+		// Call _callback(Node*) for each node with _key until it returns true.
+		template <typename tCallback>
+		void  find(uint64 _key, tCallback _callback) const
+		{
+			if (m_slots.empty()) {
+				return;
+			}
+			uint32 mask = (uint32)m_slots.size() - 1;
+			for (uint32 i = Hash(_key) & mask; m_slots[i].m_node; i = (i + 1) & mask) {
+				if (m_slots[i].m_key == _key && _callback(m_slots[i].m_node)) {
+					return;
+				}
+			}
+		}
+
+	private:
+		struct Slot
+		{
+			uint64 m_key;
+			Node*  m_node;                              // nullptr if the slot is empty.
+		};
+		eastl::vector<Slot> m_slots;                    // Size is a power of 2.
+		uint32              m_count = 0;
+
+		static uint32 Hash(uint64 _key)
+		{
+			_key ^= _key >> 33;
+			_key *= 0xff51afd7ed558ccdull;
+			_key ^= _key >> 33;
+			return (uint32)_key;
+		}
+		void  rehash(uint32 _size);
+	};
+	NodeMap                 m_nodesById;
+	NodeMap                 m_nodesByName;              // Keyed by HashString<uint64>() of the name.
+
+ // node matrices
+	eastl::vector<mat4>     m_worldMatrices;            // Per node, see Node::getWorldMatrixIndex().
+	eastl::vector<uint32>   m_freeWorldMatrices;        // Slots of destroyed nodes, reused until the next rebuild of the flattened hierarchy.
+	eastl::vector<mat4>     m_localMatrices;            // Local matrices of nodes which aren't compact.
+	eastl::vector<uint32>   m_freeLocalMatrices;
+
+ // flattened hierarchy, pre-order such that parents precede children
+	enum FlatState
+	{
+		FlatState_Skipped,                              // Node (and hence its children) didn't match the state mask.
+		FlatState_Unchanged,
+		FlatState_Changed                               // World matrix changed, children must be updated.
+	};
+	struct FlatRange
+	{
+		uint32 m_first, m_last;                         // [m_first, m_last) in m_flatNodes.
+	};
+	eastl::vector<Node*>    m_flatNodes;
+	eastl::vector<uint32>   m_flatParents;              // Index into m_flatNodes, ~0 for the root.
+	eastl::vector<uint8>    m_flatState;                // Per-node FlatState_* for the current update().
+	eastl::vector<FlatRange> m_flatSubtrees;            // Subtrees under the root, updated in parallel.
+	eastl::vector<FlatRange> m_flatDependentSubtrees;   // Subtrees containing cameras or dependent xforms, updated serially.
+	uint32                  m_flatVersion;              // Hierarchy version at the last rebuild.
+	uint32                  m_hierarchyVersion;         // Incremented by Node::hierarchyChanged(), see updateFlatHierarchy().
+	bool                    m_parallelUpdate;
+
+ // xform batches, rebuilt with the flattened hierarchy
+	struct XFormBatch
+	{
+		const void*            m_class;                 // XForm::ClassRef.
+		uint32                 m_slot;                  // Index in the node's xform list, batches are applied in slot order.
+		eastl::vector<XForm*>  m_xforms;                // Sorted by address.
+		eastl::vector<uint32>  m_flatIndices;           // Index into m_flatNodes per xform.
+	};
+	eastl::vector<XFormBatch> m_xformBatches;
+	eastl::vector<uint32>   m_flatBatchedNodes;         // Index into m_flatNodes of nodes whose xforms are batched.
+	eastl::vector<uint32>   m_flatBatchIndices;         // Per node, index into m_flatBatchedNodes or ~0 if the node's xforms aren't batched.
+	eastl::vector<mat4>     m_batchPrevWorldMatrices;   // Per batched node, the world matrix before applyXFormBatches().
+	eastl::vector<XForm*>   m_xformBatchScratch;
+	bool                    m_batchXForms;
+	eastl::vector<Node*>    m_changedNodes;             // See getChangedNodes().
+
+ // spatial index
+	AabbTree                m_aabbTree;
+	eastl::vector<Node*>    m_boundedNodes;
+
  // cameras
 	Camera*                 m_drawCamera;
 	Camera*                 m_cullCamera;
@@ -231,6 +444,45 @@ private:
 	eastl::vector<Light*>   m_lights;
 	apt::Pool<Light>        m_lightPool;
 
+	// Binary scene format, see Scene_bin.cpp. Reading is split such that the file IO and decoding (ReadBinary()) don't
+	// access any scene and may happen on any thread, while the nodes are instantiated incrementally on the main thread
+	// (instantiateBinary()).
+	struct BinaryScene;
+	// Return nullptr on failure, in which case err_ describes the error (nothing is logged).
+	static BinaryScene* ReadBinary(const char* _path, const char*& err_);
+	static void         DestroyBinary(BinaryScene*& _bin_);
+	// Instantiate up to _maxNodes nodes from _bin_, return true when all nodes were instantiated. Node 0 maps to _root_;
+	// if _root_ is the scene root its metadata and xforms plus the draw/cull cameras are also read.
+	bool                instantiateBinary(BinaryScene& _bin_, Node* _root_, uint32 _maxNodes);
+	// Write the subtree under _root (the scene root to write the whole scene); _root is written as the root node.
+	static bool         WriteBinary(Scene& _scene, Node* _root, eastl::vector<char>& dst_);
+
+	// Allocate a copy of _node from m_nodePool plus a world matrix slot, all nodes must be allocated this way.
+	Node*   allocNode(const Node& _node);
+	// Allocate a slot in m_localMatrices.
+	uint32  allocLocalMatrix();
+	// Add _node_ to m_nodes and the node maps.
+	void    addNode(Node* _node_);
+	// Rebuild the node maps from m_nodes.
+	void    rebuildNodeMaps();
+	// Set the name of _node_, update m_nodesByName.
+	void    renameNode(Node* _node_, const char* _name);
+	// Set the draw/cull cameras from the camera node ids after loading; the cull camera defaults to the draw camera.
+	void    resolveCameras(Node::Id _drawCameraId, Node::Id _cullCameraId);
+
+	// Rebuild the flattened hierarchy if the node graph changed since the last call.
+	void    updateFlatHierarchy();
+
+	// Apply the xform batches for nodes which match _stateMask (and whose parents match _stateMask), reset the world
+	// matrix of the batched nodes beforehand.
+	void    applyXFormBatches(float _dt, uint8 _stateMask);
+
+	// Update the flattened nodes in [_first, _last). Parents outside the range must already have been updated.
+	void    updateFlatRange(uint32 _first, uint32 _last, float _dt, uint8 _stateMask);
+
+	// Refit the world bounds of bounded nodes whose world matrix changed.
+	void    updateAabbTree();
+
 #ifdef frm_Scene_ENABLE_EDIT
 	bool      m_showNodeGraph3d;
 	Node*     m_editNode;
@@ -256,6 +508,11 @@ private:
 
 }; // class Scene
 
+inline const mat4& Node::getWorldMatrix() const  { return m_scene->m_worldMatrices[m_worldMatrixIndex]; }
+inline void Node::setWorldMatrix(const mat4& _mat) { worldMatrix() = _mat; m_dirty = true; }
+inline void Node::setWorldPosition(const vec3& _p) { worldMatrix()[3] = vec4(_p, 1.0f); m_dirty = true; }
+inline mat4& Node::worldMatrix()                 { return m_scene->m_worldMatrices[m_worldMatrixIndex]; }
+
 } // namespace frm
 
 #endif // frm_Scene_h
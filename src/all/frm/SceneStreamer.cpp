@@ -0,0 +1,329 @@
+#include <frm/SceneStreamer.h>
+
+#include <frm/Camera.h>
+#include <frm/Light.h>
+#include <frm/Profiler.h>
+
+#include <apt/File.h>
+#include <apt/FileSystem.h>
+#include <apt/log.h>
+#include <apt/Time.h>
+
+using namespace frm;
+using namespace apt;
+
+/*******************************************************************************
+
+                                SceneStreamer
+
+*******************************************************************************/
+
+// Nodes instantiated/destroyed between checks of the frame budget.
+static const uint32 kNodesPerBatch = 64;
+
+// PUBLIC
+
+SceneStreamer::SceneStreamer(Scene* _scene_, int _threadCount)
+	: m_scene(_scene_)
+	, m_loadRadius(100.0f)
+	, m_unloadRadius(120.0f)
+	, m_frameBudgetMs(2.0f)
+	, m_quit(false)
+{
+	APT_ASSERT(_scene_);
+	_threadCount = APT_MAX(_threadCount, 1);
+	for (int i = 0; i < _threadCount; ++i) {
+		m_threads.push_back(new std::thread(&SceneStreamer::loaderMain, this));
+	}
+}
+
+SceneStreamer::~SceneStreamer()
+{
+	{	std::lock_guard<std::mutex> lock(m_mutex);
+		m_quit = true;
+	}
+	m_condition.notify_all();
+	for (std::thread* thread : m_threads) {
+		thread->join();
+		delete thread;
+	}
+
+ // partially instantiated chunks are left in the scene
+	for (Result& result : m_results) {
+		if (result.m_bin) {
+			Scene::DestroyBinary(result.m_bin);
+		}
+	}
+	for (Chunk& chunk : m_chunks) {
+		if (chunk.m_bin) {
+			Scene::DestroyBinary(chunk.m_bin);
+		}
+	}
+}
+
+SceneStreamer::ChunkId SceneStreamer::createChunk(Node* _node_, const AlignedBox& _localBounds, const char* _path)
+{
+	PROFILER_MARKER_CPU("#SceneStreamer::createChunk");
+
+	APT_ASSERT(_node_ && _node_ != m_scene->getRoot());
+	eastl::vector<char> data;
+	if (!Scene::WriteBinary(*m_scene, _node_, data)) {
+		return kInvalidChunk;
+	}
+	File f;
+	f.appendData(data.data(), data.size());
+	if (!FileSystem::Write(f, _path)) {
+		return kInvalidChunk;
+	}
+	destroySubtree(_node_, ~0u);
+	return addChunk(_node_, _localBounds, _path);
+}
+
+SceneStreamer::ChunkId SceneStreamer::addChunk(Node* _node_, const AlignedBox& _localBounds, const char* _path)
+{
+	APT_ASSERT(_node_ && _node_ != m_scene->getRoot());
+	APT_ASSERT(_node_->getChildCount() == 0);
+
+ // check here, loader threads can't log errors
+	if (!FileSystem::Exists(_path)) {
+		APT_LOG_ERR("SceneStreamer: '%s' not found", _path);
+		return kInvalidChunk;
+	}
+
+	m_scene->setNodeBounds(_node_, _localBounds);
+	Chunk chunk;
+	chunk.m_node     = _node_;
+	chunk.m_path.set(_path);
+	chunk.m_state    = State_Unloaded;
+	chunk.m_distance = FLT_MAX;
+	chunk.m_cancel   = false;
+	chunk.m_bin      = nullptr;
+	m_chunks.push_back(chunk);
+	return (ChunkId)m_chunks.size() - 1;
+}
+
+void SceneStreamer::update()
+{
+	PROFILER_MARKER_CPU("#SceneStreamer::update");
+
+	const Camera* camera = m_scene->getDrawCamera();
+	if (!camera) {
+		return;
+	}
+	updateRequests(camera->getPosition());
+	updateChunks(m_frameBudgetMs);
+}
+
+void SceneStreamer::flush()
+{
+	PROFILER_MARKER_CPU("#SceneStreamer::flush");
+
+	const Camera* camera = m_scene->getDrawCamera();
+	if (!camera) {
+		return;
+	}
+	for (;;) {
+		updateRequests(camera->getPosition());
+		if (updateChunks(-1.0f) && getChunkCount(State_Loading) == 0) {
+			break;
+		}
+		std::this_thread::yield();
+	}
+}
+
+int SceneStreamer::getChunkCount(State _state) const
+{
+	int ret = 0;
+	for (const Chunk& chunk : m_chunks) {
+		ret += chunk.m_state == _state ? 1 : 0;
+	}
+	return ret;
+}
+
+// PRIVATE
+
+void SceneStreamer::loaderMain()
+{
+	for (;;) {
+		Request request;
+		{	std::unique_lock<std::mutex> lock(m_mutex);
+			m_condition.wait(lock, [this] { return m_quit || !m_requests.empty(); });
+			if (m_quit) {
+				return;
+			}
+			auto nearest = m_requests.begin();
+			for (auto it = m_requests.begin(); it != m_requests.end(); ++it) {
+				if (it->m_distance < nearest->m_distance) {
+					nearest = it;
+				}
+			}
+			request = *nearest;
+			m_requests.erase(nearest);
+		}
+
+		Result result;
+		result.m_chunk = request.m_chunk;
+		result.m_err   = nullptr;
+		result.m_bin   = Scene::ReadBinary((const char*)request.m_path, result.m_err);
+
+		{	std::lock_guard<std::mutex> lock(m_mutex);
+			m_results.push_back(result);
+		}
+	}
+}
+
+bool SceneStreamer::instantiate(Chunk& _chunk_, uint32 _maxNodes)
+{
+	if (!m_scene->instantiateBinary(*_chunk_.m_bin, _chunk_.m_node, _maxNodes)) {
+		return false;
+	}
+	Scene::DestroyBinary(_chunk_.m_bin);
+	return true;
+}
+
+bool SceneStreamer::unload(Chunk& _chunk_, uint32 _maxNodes)
+{
+	if (_chunk_.m_bin) {
+		Scene::DestroyBinary(_chunk_.m_bin);
+	}
+	return destroySubtree(_chunk_.m_node, _maxNodes);
+}
+
+bool SceneStreamer::destroySubtree(Node* _node_, uint32 _maxNodes)
+{
+	for (uint32 i = 0; i < _maxNodes && _node_->getLastChild(); ++i) {
+	 // last leaf, i.e. reverse pre-order which is the reverse of the instantiation order
+		Node* node = _node_->getLastChild();
+		while (node->getLastChild()) {
+			node = node->getLastChild();
+		}
+		switch (node->getType()) {
+			case Node::Type_Camera: {
+				Camera* camera = node->getSceneDataCamera();
+				m_scene->destroyCamera(camera);
+				break;
+			}
+			case Node::Type_Light: {
+				Light* light = node->getSceneDataLight();
+				m_scene->destroyLight(light);
+				break;
+			}
+			default:
+				m_scene->destroyNode(node);
+				break;
+		};
+	}
+	return _node_->getChildCount() == 0;
+}
+
+void SceneStreamer::updateRequests(const vec3& _cameraPosition)
+{
+	{	std::lock_guard<std::mutex> lock(m_mutex);
+		eastl::swap(m_resultScratch, m_results);
+	}
+	for (Result& result : m_resultScratch) {
+		Chunk& chunk = m_chunks[result.m_chunk];
+		APT_ASSERT(chunk.m_state == State_Loading);
+		if (!result.m_bin) {
+			APT_LOG_ERR("SceneStreamer: Error loading '%s' (%s)", (const char*)chunk.m_path, result.m_err);
+			chunk.m_state = State_Error;
+		} else if (chunk.m_cancel) {
+			Scene::DestroyBinary(result.m_bin);
+			chunk.m_state = State_Unloaded;
+		} else {
+			chunk.m_bin   = result.m_bin;
+			chunk.m_state = State_Instantiating;
+		}
+	}
+	m_resultScratch.clear(); // swapped back next frame, hence both vectors retain their capacity
+
+	for (Chunk& chunk : m_chunks) {
+		chunk.m_distance = Distance(chunk.m_node->getWorldBounds(), _cameraPosition);
+	}
+
+	bool notify = false;
+	{	std::lock_guard<std::mutex> lock(m_mutex);
+		for (ChunkId i = 0; i < (ChunkId)m_chunks.size(); ++i) {
+			Chunk& chunk = m_chunks[i];
+			bool inRange = chunk.m_distance <= m_unloadRadius;
+			switch (chunk.m_state) {
+				case State_Unloaded:
+					if (chunk.m_distance < m_loadRadius) {
+						Request request;
+						request.m_chunk    = i;
+						request.m_distance = chunk.m_distance;
+						request.m_path     = chunk.m_path;
+						m_requests.push_back(request);
+						chunk.m_state  = State_Loading;
+						chunk.m_cancel = false;
+						notify = true;
+					}
+					break;
+				case State_Loading: {
+				 // if the request is still queued update its priority or remove it, else it's being read by a loader thread
+					auto it = m_requests.begin();
+					for (; it != m_requests.end() && it->m_chunk != i; ++it);
+					if (it == m_requests.end()) {
+						chunk.m_cancel = !inRange;
+					} else if (inRange) {
+						it->m_distance = chunk.m_distance;
+					} else {
+						m_requests.erase(it);
+						chunk.m_state = State_Unloaded;
+					}
+					break;
+				}
+				case State_Instantiating:
+				case State_Loaded:
+					if (!inRange) {
+						chunk.m_state = State_Unloading;
+					}
+					break;
+				default:
+					break;
+			};
+		}
+	}
+	if (notify) {
+		m_condition.notify_all();
+	}
+}
+
+bool SceneStreamer::updateChunks(float _budgetMs)
+{
+	PROFILER_MARKER_CPU("#SceneStreamer::updateChunks");
+
+ // unloads first, then instantiate the nearest chunks
+	Timestamp start = Time::GetTimestamp();
+	for (int batch = 0; ; ++batch) {
+		if (_budgetMs >= 0.0f && batch > 0 && (Time::GetTimestamp() - start).asMilliseconds() >= _budgetMs) {
+			return false;
+		}
+
+		Chunk* next = nullptr;
+		float nextPriority = FLT_MAX;
+		for (Chunk& chunk : m_chunks) {
+			if (chunk.m_state != State_Unloading && chunk.m_state != State_Instantiating) {
+				continue;
+			}
+			float priority = chunk.m_state == State_Unloading ? -1.0f : chunk.m_distance;
+			if (!next || priority < nextPriority) {
+				next = &chunk;
+				nextPriority = priority;
+			}
+		}
+		if (!next) {
+			return true;
+		}
+
+		if (next->m_state == State_Unloading) {
+			if (unload(*next, kNodesPerBatch)) {
+				next->m_state = State_Unloaded;
+			}
+		} else {
+			if (instantiate(*next, kNodesPerBatch)) {
+				next->m_state = State_Loaded;
+			}
+		}
+	}
+}
@@ -0,0 +1,143 @@
+#pragma once
+#ifndef frm_SceneStreamer_h
+#define frm_SceneStreamer_h
+
+#include <frm/def.h>
+#include <frm/geom.h>
+#include <frm/Scene.h>
+
+#include <apt/String.h>
+
+#include <EASTL/vector.h>
+
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+namespace frm {
+
+////////////////////////////////////////////////////////////////////////////////
+// SceneStreamer
+// Streams subtrees of a scene in/out based on their distance to the draw
+// camera. A chunk is a node whose subtree is stored in a separate binary scene
+// file; the chunk node itself remains in the scene with bounds (see
+// Scene::setNodeBounds()) which are used for the distance test.
+//
+// File IO and decoding (incl. xform creation) happen on the streamer's loader
+// threads. Nodes are instantiated/destroyed incrementally on the main thread
+// during update() within a per-frame time budget, nearest chunks first.
+//
+// Chunk contents are not written by Scene::Save() unless they are loaded.
+// Destroy the streamer before destroying any chunk nodes.
+////////////////////////////////////////////////////////////////////////////////
+class SceneStreamer
+{
+public:
+	typedef uint32 ChunkId;
+	static const ChunkId kInvalidChunk = ~0u;
+
+	enum State
+	{
+		State_Unloaded,
+		State_Loading,       // Queued or being read by a loader thread.
+		State_Instantiating, // Nodes are being instantiated.
+		State_Loaded,
+		State_Unloading,     // Nodes are being destroyed.
+		State_Error,         // The chunk file couldn't be read, the chunk is ignored.
+
+		State_Count
+	};
+
+	SceneStreamer(Scene* _scene_, int _threadCount = 1);
+	~SceneStreamer();
+
+	// Write the subtree under _node_ to _path, destroy the subtree and add _node_ as a chunk. _localBounds are relative
+	// to _node_ and should contain the subtree. Return the chunk id, or kInvalidChunk on error.
+	ChunkId createChunk(Node* _node_, const AlignedBox& _localBounds, const char* _path);
+	// Add _node_ as a chunk whose subtree is stored in _path, e.g. created by a previous call to createChunk(). The
+	// chunk is initially unloaded, _node_ must not have any children. Return kInvalidChunk if _path doesn't exist.
+	ChunkId addChunk(Node* _node_, const AlignedBox& _localBounds, const char* _path);
+
+	// Queue loads/unloads based on the distance to the scene's draw camera, instantiate/destroy nodes within the frame
+	// budget. Call once per frame from the main thread before Scene::update().
+	void    update();
+
+	// Process all pending loads/unloads without a budget (e.g. after teleporting the camera).
+	void    flush();
+
+	// Chunks nearer than the load radius are loaded, chunks farther than the unload radius are unloaded. The unload
+	// radius should be larger than the load radius to prevent chunks on the boundary from being repeatedly reloaded.
+	void    setLoadRadius(float _radius)            { m_loadRadius = _radius; }
+	float   getLoadRadius() const                   { return m_loadRadius; }
+	void    setUnloadRadius(float _radius)          { m_unloadRadius = _radius; }
+	float   getUnloadRadius() const                 { return m_unloadRadius; }
+
+	// Max main thread time spent in update() instantiating/destroying nodes. At least one batch of nodes is processed
+	// per frame regardless, to guarantee progress.
+	void    setFrameBudget(float _ms)               { m_frameBudgetMs = _ms; }
+	float   getFrameBudget() const                  { return m_frameBudgetMs; }
+
+	int     getChunkCount() const                   { return (int)m_chunks.size(); }
+	Node*   getChunkNode(ChunkId _id) const         { return m_chunks[_id].m_node; }
+	State   getChunkState(ChunkId _id) const        { return m_chunks[_id].m_state; }
+	int     getChunkCount(State _state) const;
+
+private:
+	struct Chunk
+	{
+		Node*               m_node;
+		apt::PathStr        m_path;
+		State               m_state;
+		float               m_distance;  // To the draw camera, updated by update().
+		bool                m_cancel;    // Discard the load when it completes (went out of range while loading).
+		Scene::BinaryScene* m_bin;       // Valid while State_Instantiating.
+	};
+
+	struct Request
+	{
+		ChunkId             m_chunk;
+		float               m_distance;  // Nearest requests are processed first.
+		apt::PathStr        m_path;
+	};
+
+	struct Result
+	{
+		ChunkId             m_chunk;
+		Scene::BinaryScene* m_bin;       // nullptr on error.
+		const char*         m_err;
+	};
+
+	Scene*                      m_scene;
+	eastl::vector<Chunk>        m_chunks;
+	float                       m_loadRadius;
+	float                       m_unloadRadius;
+	float                       m_frameBudgetMs;
+
+ // loader threads, m_requests/m_results are protected by m_mutex
+	eastl::vector<std::thread*> m_threads;
+	std::mutex                  m_mutex;
+	std::condition_variable     m_condition;
+	eastl::vector<Request>      m_requests;
+	eastl::vector<Result>       m_results;
+	eastl::vector<Result>       m_resultScratch; // Swapped with m_results by updateRequests().
+	bool                        m_quit;
+
+	void    loaderMain();
+
+	// Process up to _maxNodes nodes for _chunk_, return true when complete.
+	bool    instantiate(Chunk& _chunk_, uint32 _maxNodes);
+	bool    unload(Chunk& _chunk_, uint32 _maxNodes);
+	// Destroy up to _maxNodes descendants of _node_ (leaves first, most recently created first), return true when
+	// _node_ has no children.
+	bool    destroySubtree(Node* _node_, uint32 _maxNodes);
+
+	// Move completed loads from m_results, update distances/states and the request queue.
+	void    updateRequests(const vec3& _cameraPosition);
+	// Instantiate/destroy nodes until _budgetMs elapses (< 0 for no budget), return true if all chunks are complete.
+	bool    updateChunks(float _budgetMs);
+
+}; // class SceneStreamer
+
+} // namespace frm
+
+#endif // frm_SceneStreamer_h
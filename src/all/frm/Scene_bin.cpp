@@ -0,0 +1,503 @@
+#include <frm/Scene.h>
+
+#include <frm/Camera.h>
+#include <frm/Light.h>
+#include <frm/Profiler.h>
+#include <frm/XForm.h>
+
+#include <apt/File.h>
+#include <apt/FileSystem.h>
+#include <apt/hash.h>
+#include <apt/log.h>
+#include <apt/memory.h>
+
+#include <EASTL/vector.h>
+
+#include <cstring>
+
+using namespace frm;
+using namespace apt;
+
+/*******************************************************************************
+
+                              Binary scene format
+
+  Position independent, all offsets are relative to the start of the file and
+  all sections are 16 byte aligned, hence the file can be used directly from
+  memory (or mapped). Loading is a single pass over the node table; nodes are
+  stored in pre-order such that parents precede their children.
+
+  Header
+  NodeRecord[m_nodeCount]      Node 0 is the root.
+  XFormRecord[m_xformCount]    Contiguous per node.
+  CameraRecord[m_cameraCount]
+  LightRecord[m_lightCount]
+  String table                 Null-terminated node names.
+  Blob data                    XForm data, see XForm::serializeBlob().
+
+*******************************************************************************/
+
+namespace {
+
+const uint32 kMagic   = 'S' | ('C' << 8) | ('N' << 16) | ('B' << 24);
+const uint32 kVersion = 1;
+const uint32 kNone    = ~0u;
+
+struct Header
+{
+	uint32  m_magic;
+	uint32  m_version;
+	uint32  m_fileSize;
+	uint32  m_nodeCount;
+	uint32  m_nodeOffset;
+	uint32  m_nodeCountByType[Node::Type_Count];
+	uint32  m_xformCount;
+	uint32  m_xformOffset;
+	uint32  m_cameraCount;
+	uint32  m_cameraOffset;
+	uint32  m_lightCount;
+	uint32  m_lightOffset;
+	uint32  m_stringOffset;
+	uint32  m_stringSize;
+	uint32  m_blobOffset;
+	uint32  m_blobSize;
+	uint64  m_drawCameraId;
+	uint64  m_cullCameraId;
+};
+
+struct NodeRecord
+{
+	mat4    m_localMatrix;
+	uint64  m_id;
+	uint64  m_userData;
+	uint32  m_name;        // Offset into the string table.
+	uint32  m_parent;      // Index into the node table, kNone for the root.
+	uint32  m_childCount;
+	uint32  m_firstXForm;  // Index into the xform table.
+	uint32  m_xformCount;
+	uint32  m_sceneData;   // Index into the camera/light table (depending on m_type), else kNone.
+	uint8   m_type;
+	uint8   m_state;
+	uint8   m_pad[6];
+};
+
+struct XFormRecord
+{
+	uint32  m_classHash;   // HashString<uint32>() of the factory class name.
+	uint32  m_blobOffset;  // Offset into the blob data.
+	uint32  m_blobSize;
+	uint32  m_pad;
+};
+
+struct CameraRecord
+{
+	mat4    m_world;
+	float   m_up, m_down, m_right, m_left, m_near, m_far;
+	uint32  m_projFlags;
+	uint32  m_hasGpuBuffer;
+};
+
+struct LightRecord
+{
+	uint32  m_type;        // Light has no serialized state yet.
+	uint32  m_pad[3];
+};
+
+APT_STATIC_ASSERT(sizeof(Header) % 8 == 0);
+APT_STATIC_ASSERT(sizeof(NodeRecord) == 112);
+APT_STATIC_ASSERT(sizeof(XFormRecord) == 16);
+APT_STATIC_ASSERT(sizeof(CameraRecord) == 96);
+APT_STATIC_ASSERT(sizeof(LightRecord) == 16);
+
+uint32 Align16(uint32 _offset)
+{
+	return (_offset + 15u) & ~15u;
+}
+
+template <typename tRecord>
+bool CheckSection(const Header& _header, uint32 _offset, uint32 _count)
+{
+	return _offset % 16 == 0 && (uint64)_offset + (uint64)_count * sizeof(tRecord) <= _header.m_fileSize;
+}
+
+} // namespace
+
+struct Scene::BinaryScene
+{
+	File                  m_file;
+	char*                 m_alignedData; // Copy of the file data if it isn't 16 byte aligned, else nullptr.
+	const Header*         m_header;
+	const NodeRecord*     m_nodeRecords;
+	const XFormRecord*    m_xformRecords;
+	const CameraRecord*   m_cameraRecords;
+	const char*           m_strings;
+	eastl::vector<XForm*> m_xforms;    // Per xform record, nullptr if the class is unknown. Owned until instantiated.
+	eastl::vector<Node*>  m_nodes;     // Per node record, set during instantiation.
+	uint32                m_nextNode;  // Next node record to instantiate.
+};
+
+// PRIVATE
+
+Scene::BinaryScene* Scene::ReadBinary(const char* _path, const char*& err_)
+{
+ // no logging or profiler markers, this may be called from any thread
+	BinaryScene* ret = new BinaryScene;
+	ret->m_alignedData = nullptr;
+	ret->m_nextNode = 0;
+	if (!FileSystem::Read(ret->m_file, _path)) {
+		err_ = "file not found";
+		DestroyBinary(ret);
+		return nullptr;
+	}
+	const char* data = ret->m_file.getData();
+	uint64 dataSize = ret->m_file.getDataSize();
+	if (((uintptr_t)data & 15) != 0) {
+	 // records are read in place, copy if the file data isn't aligned
+		ret->m_alignedData = (char*)APT_MALLOC_ALIGNED(dataSize, 16);
+		memcpy(ret->m_alignedData, data, dataSize);
+		data = ret->m_alignedData;
+	}
+
+ // validate
+	err_ = "corrupt";
+	if (dataSize < sizeof(Header)) {
+		DestroyBinary(ret);
+		return nullptr;
+	}
+	const Header& header = *(const Header*)data;
+	if (header.m_magic != kMagic) {
+		err_ = "not a binary scene file";
+		DestroyBinary(ret);
+		return nullptr;
+	}
+	if (header.m_version != kVersion) {
+		err_ = "unsupported version";
+		DestroyBinary(ret);
+		return nullptr;
+	}
+	if (header.m_fileSize > dataSize ||
+		header.m_nodeCount == 0 ||
+		!CheckSection<NodeRecord>(header,   header.m_nodeOffset,   header.m_nodeCount)   ||
+		!CheckSection<XFormRecord>(header,  header.m_xformOffset,  header.m_xformCount)  ||
+		!CheckSection<CameraRecord>(header, header.m_cameraOffset, header.m_cameraCount) ||
+		!CheckSection<LightRecord>(header,  header.m_lightOffset,  header.m_lightCount)  ||
+		!CheckSection<char>(header,         header.m_stringOffset, header.m_stringSize)  ||
+		!CheckSection<char>(header,         header.m_blobOffset,   header.m_blobSize)    ||
+		header.m_stringSize == 0 || data[header.m_stringOffset + header.m_stringSize - 1] != '\0'
+		) {
+		DestroyBinary(ret);
+		return nullptr;
+	}
+	ret->m_header        = &header;
+	ret->m_nodeRecords   = (const NodeRecord*)(data + header.m_nodeOffset);
+	ret->m_xformRecords  = (const XFormRecord*)(data + header.m_xformOffset);
+	ret->m_cameraRecords = (const CameraRecord*)(data + header.m_cameraOffset);
+	ret->m_strings       = data + header.m_stringOffset;
+
+ // validate the node table up front, instantiation can't fail
+	for (uint32 i = 0; i < header.m_nodeCount; ++i) {
+		const NodeRecord& rec = ret->m_nodeRecords[i];
+		bool valid = rec.m_type < Node::Type_Count && rec.m_name < header.m_stringSize
+			&& (i == 0) == (rec.m_type == Node::Type_Root)
+			&& (i == 0 ? rec.m_parent == kNone : rec.m_parent < i)
+			&& (uint64)rec.m_firstXForm + rec.m_xformCount <= header.m_xformCount
+			;
+		if (rec.m_type == Node::Type_Camera) {
+			valid = valid && rec.m_sceneData < header.m_cameraCount;
+		} else if (rec.m_type == Node::Type_Light) {
+			valid = valid && rec.m_sceneData < header.m_lightCount;
+		}
+		if (!valid) {
+			DestroyBinary(ret);
+			return nullptr;
+		}
+	}
+
+ // create xforms
+	const char* blobs = data + header.m_blobOffset;
+	ret->m_xforms.resize(header.m_xformCount, nullptr);
+	for (uint32 i = 0; i < header.m_xformCount; ++i) {
+		const XFormRecord& rec = ret->m_xformRecords[i];
+		if ((uint64)rec.m_blobOffset + rec.m_blobSize > header.m_blobSize) {
+			DestroyBinary(ret);
+			return nullptr;
+		}
+		for (int j = 0; j < XForm::GetClassRefCount(); ++j) {
+			const XForm::ClassRef* cref = XForm::GetClassRef(j);
+			if (HashString<uint32>(cref->getName()) == rec.m_classHash) {
+				XForm* xform = XForm::Create(cref);
+				XForm::Blob blob(blobs + rec.m_blobOffset, rec.m_blobSize);
+				if (xform->serializeBlob(blob)) {
+					ret->m_xforms[i] = xform;
+				} else {
+					XForm::Destroy(xform);
+				}
+				break;
+			}
+		}
+	}
+
+	ret->m_nodes.resize(header.m_nodeCount, nullptr);
+	err_ = nullptr;
+	return ret;
+}
+
+void Scene::DestroyBinary(BinaryScene*& _bin_)
+{
+	for (XForm* xform : _bin_->m_xforms) {
+		if (xform) {
+			XForm::Destroy(xform);
+		}
+	}
+	if (_bin_->m_alignedData) {
+		APT_FREE_ALIGNED(_bin_->m_alignedData);
+	}
+	delete _bin_;
+	_bin_ = nullptr;
+}
+
+bool Scene::instantiateBinary(BinaryScene& _bin_, Node* _root_, uint32 _maxNodes)
+{
+	PROFILER_MARKER_CPU("#Scene::instantiateBinary");
+
+	const Header& header = *_bin_.m_header;
+	bool isSceneRoot = _root_ == m_root;
+	if (_bin_.m_nextNode == 0) {
+		for (int i = 0; i < Node::Type_Count; ++i) {
+			m_nodes[i].reserve(m_nodes[i].size() + header.m_nodeCountByType[i]);
+		}
+		m_cameras.reserve(m_cameras.size() + header.m_cameraCount);
+		m_lights.reserve(m_lights.size() + header.m_lightCount);
+	}
+
+ // parents always precede children, hence nodes can be instantiated in order
+	uint32 end = (uint32)APT_MIN((uint64)_bin_.m_nextNode + _maxNodes, (uint64)header.m_nodeCount);
+	for (uint32 i = _bin_.m_nextNode; i < end; ++i) {
+		const NodeRecord& rec = _bin_.m_nodeRecords[i];
+		const char* name = _bin_.m_strings + rec.m_name;
+
+		Node* node;
+		if (i == 0) {
+			node = _root_;
+			if (!isSceneRoot) {
+			 // subtree root, the node already exists
+				_bin_.m_nodes[i] = node;
+				continue;
+			}
+			m_nodesById.remove(node->m_id, node);
+			node->m_id = rec.m_id;
+			m_nodesById.insert(node->m_id, node);
+			renameNode(node, name);
+			node->m_state = rec.m_state;
+		} else {
+			node = allocNode(Node((Node::Type)rec.m_type, rec.m_id, rec.m_state, name));
+		}
+		node->m_userData    = rec.m_userData;
+		node->setLocalMatrix(rec.m_localMatrix);
+		m_nextNodeId = APT_MAX(m_nextNodeId, rec.m_id + 1);
+
+		switch (rec.m_type) {
+			case Node::Type_Camera: {
+				const CameraRecord& camRec = _bin_.m_cameraRecords[rec.m_sceneData];
+				Camera* cam = m_cameraPool.alloc();
+				cam->m_parent      = node;
+				cam->m_world       = camRec.m_world;
+				cam->m_up          = camRec.m_up;
+				cam->m_down        = camRec.m_down;
+				cam->m_right       = camRec.m_right;
+				cam->m_left        = camRec.m_left;
+				cam->m_near        = camRec.m_near;
+				cam->m_far         = camRec.m_far;
+				cam->m_projFlags   = camRec.m_projFlags;
+				cam->m_aspectRatio = abs(cam->m_right - cam->m_left) / abs(cam->m_up - cam->m_down);
+				cam->m_projDirty   = true;
+				if (camRec.m_hasGpuBuffer) {
+					cam->updateGpuBuffer();
+				}
+				m_cameras.push_back(cam);
+				node->setSceneDataCamera(cam);
+				break;
+			}
+			case Node::Type_Light: {
+				Light* light = m_lightPool.alloc();
+				light->m_parent = node;
+				m_lights.push_back(light);
+				node->setSceneDataLight(light);
+				break;
+			}
+			default:
+				break;
+		};
+
+		for (uint32 j = rec.m_firstXForm, n = rec.m_firstXForm + rec.m_xformCount; j < n; ++j) {
+			XForm* xform = _bin_.m_xforms[j];
+			if (!xform) {
+				APT_LOG_ERR("Scene: Invalid xform (class hash 0x%08x), node '%s'", _bin_.m_xformRecords[j].m_classHash, name);
+				continue;
+			}
+			_bin_.m_xforms[j] = nullptr;
+			node->addXForm(xform);
+		}
+
+		if (i > 0) {
+			_bin_.m_nodes[rec.m_parent]->addChild(node);
+			addNode(node);
+		}
+		_bin_.m_nodes[i] = node;
+	}
+	_bin_.m_nextNode = end;
+
+	if (end < header.m_nodeCount) {
+		return false;
+	}
+	if (isSceneRoot) {
+		#ifdef frm_Scene_ENABLE_EDIT
+			m_editNode   = nullptr;
+			m_editXForm  = nullptr;
+			m_editCamera = nullptr;
+		#endif
+		resolveCameras(header.m_drawCameraId, header.m_cullCameraId);
+	}
+	return true;
+}
+
+bool Scene::WriteBinary(Scene& _scene, Node* _root, eastl::vector<char>& dst_)
+{
+	PROFILER_MARKER_CPU("#Scene::WriteBinary");
+
+	bool isSceneRoot = _root == _scene.m_root;
+
+	Header header;
+	memset(&header, 0, sizeof(Header));
+	header.m_magic   = kMagic;
+	header.m_version = kVersion;
+
+	eastl::vector<NodeRecord>   nodeRecords;
+	eastl::vector<XFormRecord>  xformRecords;
+	eastl::vector<CameraRecord> cameraRecords;
+	eastl::vector<LightRecord>  lightRecords;
+	eastl::vector<char>         strings;
+	eastl::vector<char>         blobs;
+
+ // pre-order traversal, '#' nodes (and their children) aren't written as for the JSON format
+	struct StackEntry { Node* m_node; uint32 m_parent; };
+	eastl::vector<StackEntry> stack;
+	StackEntry root = { _root, kNone };
+	stack.push_back(root);
+	while (!stack.empty()) {
+		Node*  node   = stack.back().m_node;
+		uint32 parent = stack.back().m_parent;
+		stack.pop_back();
+
+		uint32 index = (uint32)nodeRecords.size();
+		Node::Type type = index == 0 ? Node::Type_Root : node->m_type; // a subtree root is written as the root
+		nodeRecords.push_back();
+		NodeRecord& rec = nodeRecords.back();
+		memset(&rec, 0, sizeof(NodeRecord));
+		rec.m_localMatrix = node->getLocalMatrix();
+		rec.m_id          = node->m_id;
+		rec.m_userData    = node->m_userData;
+		rec.m_name        = (uint32)strings.size();
+		rec.m_parent      = parent;
+		rec.m_type        = (uint8)type;
+		rec.m_state       = node->m_state;
+		rec.m_sceneData   = kNone;
+		strings.insert(strings.end(), node->getName(), node->getName() + strlen(node->getName()) + 1);
+		++header.m_nodeCountByType[type];
+		if (parent != kNone) {
+			++nodeRecords[parent].m_childCount;
+		}
+
+		switch (type) {
+			case Node::Type_Camera: {
+				const Camera* cam = node->getSceneDataCamera();
+				rec.m_sceneData = (uint32)cameraRecords.size();
+				cameraRecords.push_back();
+				CameraRecord& camRec = cameraRecords.back();
+				camRec.m_world        = cam->m_world;
+				camRec.m_up           = cam->m_up;
+				camRec.m_down         = cam->m_down;
+				camRec.m_right        = cam->m_right;
+				camRec.m_left         = cam->m_left;
+				camRec.m_near         = cam->m_near;
+				camRec.m_far          = cam->m_far;
+				camRec.m_projFlags    = cam->m_projFlags;
+				camRec.m_hasGpuBuffer = cam->m_gpuBuffer != nullptr ? 1 : 0;
+				break;
+			}
+			case Node::Type_Light: {
+				rec.m_sceneData = (uint32)lightRecords.size();
+				lightRecords.push_back();
+				memset(&lightRecords.back(), 0, sizeof(LightRecord));
+				lightRecords.back().m_type = Light::Type_Direct;
+				break;
+			}
+			default:
+				break;
+		};
+
+		rec.m_firstXForm = (uint32)xformRecords.size();
+		for (XForm* xform = node->getFirstXForm(); xform; xform = xform->getNext()) {
+			if (index == 0 && !isSceneRoot) {
+				break; // a subtree root's xforms belong to the existing node
+			}
+			XFormRecord xformRec;
+			memset(&xformRec, 0, sizeof(XFormRecord));
+			xformRec.m_classHash  = HashString<uint32>(xform->getName());
+			xformRec.m_blobOffset = (uint32)blobs.size();
+			XForm::Blob blob(blobs);
+			if (!xform->serializeBlob(blob)) {
+				APT_LOG_ERR("Scene: '%s' doesn't support the binary format, not written", xform->getName());
+				blobs.resize(xformRec.m_blobOffset);
+				continue;
+			}
+			xformRec.m_blobSize = (uint32)blobs.size() - xformRec.m_blobOffset;
+			xformRecords.push_back(xformRec);
+			++rec.m_xformCount;
+		}
+
+		for (Node* child = node->getLastChild(); child; child = child->getPrevSibling()) {
+			if (child->getName()[0] != '#') {
+				StackEntry entry = { child, index };
+				stack.push_back(entry);
+			}
+		}
+	}
+
+	header.m_drawCameraId = Node::kInvalidId;
+	header.m_cullCameraId = Node::kInvalidId;
+	if (isSceneRoot && _scene.m_drawCamera && _scene.m_drawCamera->m_parent) {
+		header.m_drawCameraId = _scene.m_drawCamera->m_parent->getId();
+	}
+	if (isSceneRoot && _scene.m_cullCamera && _scene.m_cullCamera->m_parent) {
+		header.m_cullCameraId = _scene.m_cullCamera->m_parent->getId();
+	}
+
+ // layout
+	header.m_nodeCount    = (uint32)nodeRecords.size();
+	header.m_xformCount   = (uint32)xformRecords.size();
+	header.m_cameraCount  = (uint32)cameraRecords.size();
+	header.m_lightCount   = (uint32)lightRecords.size();
+	header.m_stringSize   = (uint32)strings.size();
+	header.m_blobSize     = (uint32)blobs.size();
+	header.m_nodeOffset   = Align16((uint32)sizeof(Header));
+	header.m_xformOffset  = Align16(header.m_nodeOffset   + header.m_nodeCount   * (uint32)sizeof(NodeRecord));
+	header.m_cameraOffset = Align16(header.m_xformOffset  + header.m_xformCount  * (uint32)sizeof(XFormRecord));
+	header.m_lightOffset  = Align16(header.m_cameraOffset + header.m_cameraCount * (uint32)sizeof(CameraRecord));
+	header.m_stringOffset = Align16(header.m_lightOffset  + header.m_lightCount  * (uint32)sizeof(LightRecord));
+	header.m_blobOffset   = Align16(header.m_stringOffset + header.m_stringSize);
+	header.m_fileSize     = Align16(header.m_blobOffset   + header.m_blobSize);
+
+	dst_.clear();
+	dst_.resize(header.m_fileSize, 0);
+	char* dst = dst_.data();
+	memcpy(dst, &header, sizeof(Header));
+	memcpy(dst + header.m_nodeOffset,   nodeRecords.data(),   nodeRecords.size()   * sizeof(NodeRecord));
+	memcpy(dst + header.m_xformOffset,  xformRecords.data(),  xformRecords.size()  * sizeof(XFormRecord));
+	memcpy(dst + header.m_cameraOffset, cameraRecords.data(), cameraRecords.size() * sizeof(CameraRecord));
+	memcpy(dst + header.m_lightOffset,  lightRecords.data(),  lightRecords.size()  * sizeof(LightRecord));
+	memcpy(dst + header.m_stringOffset, strings.data(),       strings.size());
+	memcpy(dst + header.m_blobOffset,   blobs.data(),         blobs.size());
+
+	return true;
+}
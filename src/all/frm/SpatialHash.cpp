@@ -0,0 +1,198 @@
+#include <frm/SpatialHash.h>
+
+#include <EASTL/utility.h> // eastl::swap
+
+using namespace frm;
+using namespace apt;
+
+/*******************************************************************************
+
+                                 SpatialHash
+
+*******************************************************************************/
+
+void frm::swap(SpatialHash& _a, SpatialHash& _b)
+{
+	eastl::swap(_a.m_entries,     _b.m_entries);
+	eastl::swap(_a.m_table,       _b.m_table);
+	eastl::swap(_a.m_freeList,    _b.m_freeList);
+	eastl::swap(_a.m_entryCount,  _b.m_entryCount);
+	eastl::swap(_a.m_cellCount,   _b.m_cellCount);
+	eastl::swap(_a.m_cellSize,    _b.m_cellSize);
+	eastl::swap(_a.m_rcpCellSize, _b.m_rcpCellSize);
+	eastl::swap(_a.m_maxRadius,   _b.m_maxRadius);
+}
+
+// PUBLIC
+
+SpatialHash::SpatialHash(float _cellSize, uint32 _capacity)
+	: m_freeList(kInvalidEntry)
+	, m_entryCount(0)
+	, m_cellCount(0)
+	, m_cellSize(_cellSize)
+	, m_rcpCellSize(1.0f / _cellSize)
+	, m_maxRadius(0.0f)
+{
+	APT_ASSERT(_cellSize > 0.0f);
+	m_entries.reserve(_capacity);
+	uint32 tableSize = 16;
+	while (tableSize < _capacity * 2) {
+		tableSize *= 2;
+	}
+	rehash(tableSize);
+}
+
+SpatialHash::EntryId SpatialHash::insert(const Sphere& _sphere, void* _userData)
+{
+	EntryId ret;
+	if (m_freeList != kInvalidEntry) {
+		ret = m_freeList;
+		m_freeList = m_entries[ret].m_next;
+	} else {
+		ret = (EntryId)m_entries.size();
+		m_entries.push_back();
+	}
+	Entry& entry = m_entries[ret];
+	entry.m_sphere   = _sphere;
+	entry.m_userData = _userData;
+	m_maxRadius = APT_MAX(m_maxRadius, _sphere.m_radius);
+	link(ret, findOrAddCell(toCell(_sphere.m_origin)));
+	++m_entryCount;
+	return ret;
+}
+
+void SpatialHash::remove(EntryId _id)
+{
+	APT_ASSERT(isEntry(_id));
+	unlink(_id);
+	Entry& entry = m_entries[_id];
+	entry.m_cell     = kInvalidEntry;
+	entry.m_userData = nullptr;
+	entry.m_next     = m_freeList;
+	m_freeList = _id;
+	--m_entryCount;
+}
+
+void SpatialHash::move(EntryId _id, const Sphere& _sphere)
+{
+	APT_ASSERT(isEntry(_id));
+	Entry& entry = m_entries[_id];
+	entry.m_sphere = _sphere;
+	m_maxRadius = APT_MAX(m_maxRadius, _sphere.m_radius);
+	ivec3 key = toCell(_sphere.m_origin);
+	if (m_table[entry.m_cell].m_key != key) {
+		unlink(_id);
+		link(_id, findOrAddCell(key));
+	}
+}
+
+void SpatialHash::clear()
+{
+	m_entries.clear();
+	for (auto& cell : m_table) {
+		cell.m_used = false;
+	}
+	m_freeList   = kInvalidEntry;
+	m_entryCount = 0;
+	m_cellCount  = 0;
+	m_maxRadius  = 0.0f;
+}
+
+// PRIVATE
+
+uint32 SpatialHash::findCell(const ivec3& _key) const
+{
+	uint32 mask = (uint32)m_table.size() - 1;
+	for (uint32 i = Hash(_key) & mask; m_table[i].m_used; i = (i + 1) & mask) {
+		if (m_table[i].m_key == _key) {
+			return i;
+		}
+	}
+	return kInvalidEntry;
+}
+
+uint32 SpatialHash::findOrAddCell(const ivec3& _key)
+{
+	uint32 mask = (uint32)m_table.size() - 1;
+	uint32 i = Hash(_key) & mask;
+	for (; m_table[i].m_used; i = (i + 1) & mask) {
+		if (m_table[i].m_key == _key) {
+			return i;
+		}
+	}
+
+ // keep the load factor <= 0.5, empty cells are discarded during rehash
+	if ((m_cellCount + 1) * 2 > (uint32)m_table.size()) {
+		uint32 occupied = 0;
+		for (auto& cell : m_table) {
+			occupied += (cell.m_used && cell.m_first != kInvalidEntry) ? 1 : 0;
+		}
+		uint32 tableSize = (uint32)m_table.size();
+		while ((occupied + 1) * 4 > tableSize) {
+			tableSize *= 2;
+		}
+		rehash(tableSize);
+		mask = tableSize - 1;
+		for (i = Hash(_key) & mask; m_table[i].m_used; i = (i + 1) & mask);
+	}
+
+	Cell& cell = m_table[i];
+	cell.m_key   = _key;
+	cell.m_first = kInvalidEntry;
+	cell.m_used  = true;
+	++m_cellCount;
+	return i;
+}
+
+void SpatialHash::rehash(uint32 _size)
+{
+	APT_ASSERT((_size & (_size - 1)) == 0); // must be a power of 2
+	eastl::vector<Cell> table(_size);
+	for (auto& cell : table) {
+		cell.m_used = false;
+	}
+	eastl::swap(table, m_table);
+
+	uint32 mask = _size - 1;
+	m_cellCount = 0;
+	for (auto& cell : table) {
+		if (!cell.m_used || cell.m_first == kInvalidEntry) {
+			continue;
+		}
+		uint32 i = Hash(cell.m_key) & mask;
+		while (m_table[i].m_used) {
+			i = (i + 1) & mask;
+		}
+		m_table[i] = cell;
+		++m_cellCount;
+		for (uint32 j = cell.m_first; j != kInvalidEntry; j = m_entries[j].m_next) {
+			m_entries[j].m_cell = i;
+		}
+	}
+}
+
+void SpatialHash::link(EntryId _id, uint32 _cell)
+{
+	Entry& entry = m_entries[_id];
+	Cell& cell = m_table[_cell];
+	entry.m_cell = _cell;
+	entry.m_prev = kInvalidEntry;
+	entry.m_next = cell.m_first;
+	if (cell.m_first != kInvalidEntry) {
+		m_entries[cell.m_first].m_prev = _id;
+	}
+	cell.m_first = _id;
+}
+
+void SpatialHash::unlink(EntryId _id)
+{
+	Entry& entry = m_entries[_id];
+	if (entry.m_prev != kInvalidEntry) {
+		m_entries[entry.m_prev].m_next = entry.m_next;
+	} else {
+		m_table[entry.m_cell].m_first = entry.m_next;
+	}
+	if (entry.m_next != kInvalidEntry) {
+		m_entries[entry.m_next].m_prev = entry.m_prev;
+	}
+}
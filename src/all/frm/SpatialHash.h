@@ -0,0 +1,144 @@
+#pragma once
+#ifndef frm_SpatialHash_h
+#define frm_SpatialHash_h
+
+#include <frm/def.h>
+#include <frm/geom.h>
+#include <frm/math.h>
+
+#include <EASTL/vector.h>
+
+namespace frm {
+
+////////////////////////////////////////////////////////////////////////////////
+// SpatialHash
+// Uniform grid for proximity queries on large sets of dynamic points/spheres.
+// Only occupied cells are stored, in an open addressing hash table keyed on
+// the integer cell coordinates. Each entry is linked into the cell containing
+// its center; queries are expanded by the largest radius inserted so far,
+// hence the cell size should be chosen to be larger than the typical radius
+// and close to the typical query radius.
+//
+// Queries don't allocate. Callback signature is void(EntryId _id).
+////////////////////////////////////////////////////////////////////////////////
+class SpatialHash
+{
+public:
+	typedef uint32 EntryId;
+	static const EntryId kInvalidEntry = ~0u;
+
+	SpatialHash(float _cellSize = 1.0f, uint32 _capacity = 1024);
+
+	EntryId insert(const Sphere& _sphere, void* _userData);
+	void    remove(EntryId _id);
+	void    move(EntryId _id, const Sphere& _sphere);
+	void    clear();
+
+	// Find all entries which intersect _sphere/_box.
+	template <typename tCallback>
+	void    findIntersecting(const Sphere& _sphere, tCallback _callback) const;
+	template <typename tCallback>
+	void    findIntersecting(const AlignedBox& _box, tCallback _callback) const;
+
+	void*         getUserData(EntryId _id) const { APT_ASSERT(isEntry(_id)); return m_entries[_id].m_userData; }
+	const Sphere& getSphere(EntryId _id) const   { APT_ASSERT(isEntry(_id)); return m_entries[_id].m_sphere; }
+	uint32        getEntryCount() const          { return m_entryCount; }
+	uint32        getCellCount() const           { return m_cellCount; } // occupied + empty cells in the table
+	float         getCellSize() const            { return m_cellSize; }
+	float         getMaxRadius() const           { return m_maxRadius; }
+
+	friend void swap(SpatialHash& _a, SpatialHash& _b);
+
+private:
+	struct Entry
+	{
+		Sphere  m_sphere;
+		void*   m_userData;
+		uint32  m_cell;     // table index, kInvalidEntry if free
+		uint32  m_prev;     // previous entry in the cell
+		uint32  m_next;     // next entry in the cell, or next free entry
+	};
+
+	struct Cell
+	{
+		ivec3   m_key;
+		uint32  m_first;    // first entry, kInvalidEntry if the cell is empty
+		bool    m_used;     // false if the slot is unoccupied
+	};
+
+	eastl::vector<Entry> m_entries;
+	eastl::vector<Cell>  m_table;       // size is a power of 2
+	uint32               m_freeList;
+	uint32               m_entryCount;
+	uint32               m_cellCount;   // used slots in m_table
+	float                m_cellSize;
+	float                m_rcpCellSize;
+	float                m_maxRadius;
+
+	bool   isEntry(EntryId _id) const { return _id < m_entries.size() && m_entries[_id].m_cell != kInvalidEntry; }
+
+	ivec3  toCell(const vec3& _p) const { return ivec3(floor(_p * m_rcpCellSize)); }
+
+	static uint32 Hash(const ivec3& _key)
+	{
+		return ((uint32)_key.x * 73856093u) ^ ((uint32)_key.y * 19349663u) ^ ((uint32)_key.z * 83492791u);
+	}
+
+	// Return the table index for _key, or kInvalidEntry if not found.
+	uint32 findCell(const ivec3& _key) const;
+	// Return the table index for _key, add it if not found (may rehash).
+	uint32 findOrAddCell(const ivec3& _key);
+	void   rehash(uint32 _size);
+
+	void   link(EntryId _id, uint32 _cell);
+	void   unlink(EntryId _id);
+
+	template <typename tTest, typename tCallback>
+	void   find(const ivec3& _cellMin, const ivec3& _cellMax, tTest _test, tCallback _callback) const;
+
+}; // class SpatialHash
+
+
+template <typename tTest, typename tCallback>
+inline void SpatialHash::find(const ivec3& _cellMin, const ivec3& _cellMax, tTest _test, tCallback _callback) const
+{
+	for (int z = _cellMin.z; z <= _cellMax.z; ++z) {
+		for (int y = _cellMin.y; y <= _cellMax.y; ++y) {
+			for (int x = _cellMin.x; x <= _cellMax.x; ++x) {
+				uint32 cell = findCell(ivec3(x, y, z));
+				if (cell == kInvalidEntry) {
+					continue;
+				}
+				for (uint32 i = m_table[cell].m_first; i != kInvalidEntry; i = m_entries[i].m_next) {
+					if (_test(m_entries[i].m_sphere)) {
+						_callback((EntryId)i);
+					}
+				}
+			}
+		}
+	}
+}
+
+template <typename tCallback>
+inline void SpatialHash::findIntersecting(const Sphere& _sphere, tCallback _callback) const
+{
+	vec3 r = vec3(_sphere.m_radius + m_maxRadius);
+	find(toCell(_sphere.m_origin - r), toCell(_sphere.m_origin + r),
+		[&_sphere](const Sphere& _entry) { return Intersects(_sphere, _entry); },
+		_callback
+		);
+}
+
+template <typename tCallback>
+inline void SpatialHash::findIntersecting(const AlignedBox& _box, tCallback _callback) const
+{
+	vec3 r = vec3(m_maxRadius);
+	find(toCell(_box.m_min - r), toCell(_box.m_max + r),
+		[&_box](const Sphere& _entry) { return Intersects(_entry, _box); },
+		_callback
+		);
+}
+
+} // namespace frm
+
+#endif // frm_SpatialHash_h
@@ -0,0 +1,190 @@
+#include <frm/SweepAndPrune.h>
+
+#include <frm/Profiler.h>
+
+#include <EASTL/sort.h>
+#include <EASTL/utility.h> // eastl::swap
+
+using namespace frm;
+using namespace apt;
+
+/*******************************************************************************
+
+                                SweepAndPrune
+
+*******************************************************************************/
+
+void frm::swap(SweepAndPrune& _a, SweepAndPrune& _b)
+{
+	eastl::swap(_a.m_proxies,    _b.m_proxies);
+	eastl::swap(_a.m_sorted,     _b.m_sorted);
+	eastl::swap(_a.m_freeList,   _b.m_freeList);
+	eastl::swap(_a.m_proxyCount, _b.m_proxyCount);
+	eastl::swap(_a.m_axis,       _b.m_axis);
+	eastl::swap(_a.m_swapCount,  _b.m_swapCount);
+	eastl::swap(_a.m_resort,     _b.m_resort);
+}
+
+// PUBLIC
+
+SweepAndPrune::SweepAndPrune(uint32 _capacity)
+	: m_freeList(kInvalidProxy)
+	, m_proxyCount(0)
+	, m_axis(0)
+	, m_swapCount(0)
+	, m_resort(false)
+{
+	m_proxies.reserve(_capacity);
+	m_sorted.reserve(_capacity);
+}
+
+SweepAndPrune::ProxyId SweepAndPrune::insert(const AlignedBox& _box, void* _userData)
+{
+	ProxyId ret;
+	if (m_freeList != kInvalidProxy) {
+		ret = m_freeList;
+		m_freeList = m_proxies[ret].m_nextFree;
+	} else {
+		ret = (ProxyId)m_proxies.size();
+		m_proxies.push_back();
+	}
+	Proxy& proxy = m_proxies[ret];
+	proxy.m_box      = _box;
+	proxy.m_userData = _userData;
+	proxy.m_nextFree = kInvalidProxy;
+	proxy.m_inUse    = true;
+
+	Entry entry;
+	entry.m_box   = _box;
+	entry.m_proxy = ret;
+	m_sorted.push_back(entry);
+	m_resort = true;
+	++m_proxyCount;
+	return ret;
+}
+
+void SweepAndPrune::remove(ProxyId _id)
+{
+	APT_ASSERT(isProxy(_id));
+ // the id is released during update(), when the sorted entry is removed
+	m_proxies[_id].m_inUse    = false;
+	m_proxies[_id].m_userData = nullptr;
+	m_resort = true;
+	--m_proxyCount;
+}
+
+void SweepAndPrune::move(ProxyId _id, const AlignedBox& _box)
+{
+	APT_ASSERT(isProxy(_id));
+	m_proxies[_id].m_box = _box;
+}
+
+void SweepAndPrune::clear()
+{
+	m_proxies.clear();
+	m_sorted.clear();
+	m_freeList   = kInvalidProxy;
+	m_proxyCount = 0;
+	m_swapCount  = 0;
+	m_resort     = false;
+}
+
+void SweepAndPrune::findPairs(eastl::vector<Pair>& pairs_)
+{
+	PROFILER_MARKER_CPU("#SweepAndPrune::findPairs");
+
+	update();
+	pairs_.clear();
+	sweep(0, (uint32)m_sorted.size(), pairs_);
+}
+
+void SweepAndPrune::update()
+{
+	PROFILER_MARKER_CPU("#SweepAndPrune::update");
+
+ // remove dead entries, release their ids
+	if (m_resort) {
+		uint32 n = 0;
+		for (uint32 i = 0, count = (uint32)m_sorted.size(); i < count; ++i) {
+			ProxyId id = m_sorted[i].m_proxy;
+			if (m_proxies[id].m_inUse) {
+				m_sorted[n++] = m_sorted[i];
+			} else {
+				m_proxies[id].m_nextFree = m_freeList;
+				m_freeList = id;
+			}
+		}
+		m_sorted.resize(n);
+	}
+
+ // refresh the boxes, find the axis of greatest variance
+	vec3 sum(0.0f);
+	vec3 sum2(0.0f);
+	for (auto& entry : m_sorted) {
+		entry.m_box = m_proxies[entry.m_proxy].m_box;
+		vec3 c = entry.m_box.m_min + entry.m_box.m_max;
+		sum  += c;
+		sum2 += c * c;
+	}
+	vec3 variance = sum2 - sum * sum / APT_MAX((float)m_sorted.size(), 1.0f);
+	int axis = m_axis;
+	for (int i = 0; i < 3; ++i) {
+	 // bias towards the current axis to avoid flip-flopping
+		if (variance[i] > variance[axis] * 1.5f) {
+			axis = i;
+		}
+	}
+
+	m_swapCount = 0;
+	if (m_resort || axis != m_axis) {
+		m_axis = axis;
+		eastl::sort(m_sorted.begin(), m_sorted.end(), [axis](const Entry& _a, const Entry& _b) {
+				return _a.m_box.m_min[axis] < _b.m_box.m_min[axis];
+			});
+		m_resort = false;
+		return;
+	}
+
+ // insertion sort, ~O(n) for coherent movement
+	for (uint32 i = 1, n = (uint32)m_sorted.size(); i < n; ++i) {
+		Entry entry = m_sorted[i];
+		float key = entry.m_box.m_min[axis];
+		uint32 j = i;
+		while (j > 0 && m_sorted[j - 1].m_box.m_min[axis] > key) {
+			m_sorted[j] = m_sorted[j - 1];
+			--j;
+		}
+		m_swapCount += i - j;
+		m_sorted[j] = entry;
+	}
+}
+
+void SweepAndPrune::sweep(uint32 _first, uint32 _count, eastl::vector<Pair>& pairs_) const
+{
+	APT_ASSERT(!m_resort); // call update() first
+	const int axis  = m_axis;
+	const int axis1 = (axis + 1) % 3;
+	const int axis2 = (axis + 2) % 3;
+	const uint32 n    = (uint32)m_sorted.size();
+	const uint32 last = APT_MIN(_first + _count, n);
+	for (uint32 i = _first; i < last; ++i) {
+		const Entry& a = m_sorted[i];
+		float amax = a.m_box.m_max[axis];
+		for (uint32 j = i + 1; j < n; ++j) {
+			const Entry& b = m_sorted[j];
+			if (b.m_box.m_min[axis] > amax) {
+				break;
+			}
+			if (a.m_box.m_min[axis1] > b.m_box.m_max[axis1] || b.m_box.m_min[axis1] > a.m_box.m_max[axis1]) {
+				continue;
+			}
+			if (a.m_box.m_min[axis2] > b.m_box.m_max[axis2] || b.m_box.m_min[axis2] > a.m_box.m_max[axis2]) {
+				continue;
+			}
+			Pair pair;
+			pair.m_a = APT_MIN(a.m_proxy, b.m_proxy);
+			pair.m_b = APT_MAX(a.m_proxy, b.m_proxy);
+			pairs_.push_back(pair);
+		}
+	}
+}
@@ -0,0 +1,96 @@
+#pragma once
+#ifndef frm_SweepAndPrune_h
+#define frm_SweepAndPrune_h
+
+#include <frm/def.h>
+#include <frm/geom.h>
+#include <frm/math.h>
+
+#include <EASTL/vector.h>
+
+namespace frm {
+
+////////////////////////////////////////////////////////////////////////////////
+// SweepAndPrune
+// Broad phase overlap detection for sets of moving boxes. Boxes are kept
+// sorted by their min endpoint on a sweep axis; since the order is mostly
+// coherent between frames an insertion sort is used to update it. The sweep
+// then only tests pairs whose intervals overlap on the sweep axis.
+//
+// The sweep axis is chosen as the axis of greatest variance of the box
+// centers (re-evaluated on each update(), a full sort happens if it changes).
+//
+// Usage:
+//   sap.move(id, box); // for each moving proxy
+//   sap.findPairs(pairs); // pairs is reused between frames
+//
+// For large counts update() may be called once, then sweep() called for
+// disjoint ranges of the sorted list on separate threads.
+////////////////////////////////////////////////////////////////////////////////
+class SweepAndPrune
+{
+public:
+	typedef uint32 ProxyId;
+	static const ProxyId kInvalidProxy = ~0u;
+
+	struct Pair
+	{
+		ProxyId m_a; // m_a < m_b
+		ProxyId m_b;
+	};
+
+	SweepAndPrune(uint32 _capacity = 64);
+
+	ProxyId insert(const AlignedBox& _box, void* _userData);
+	void    remove(ProxyId _id);
+	void    move(ProxyId _id, const AlignedBox& _box);
+	void    clear();
+
+	// Update the sorted list and find all overlapping pairs. pairs_ is cleared first.
+	void    findPairs(eastl::vector<Pair>& pairs_);
+
+	// Update the sorted list. Call before sweep().
+	void    update();
+	// Append to pairs_ the overlapping pairs whose first element is in the sorted range [_first, _first + _count).
+	// Const, hence safe to call concurrently for disjoint ranges with different output vectors.
+	void    sweep(uint32 _first, uint32 _count, eastl::vector<Pair>& pairs_) const;
+
+	void*             getUserData(ProxyId _id) const { APT_ASSERT(isProxy(_id)); return m_proxies[_id].m_userData; }
+	const AlignedBox& getBox(ProxyId _id) const      { APT_ASSERT(isProxy(_id)); return m_proxies[_id].m_box; }
+	uint32            getProxyCount() const          { return m_proxyCount; }
+	uint32            getSortedCount() const         { return (uint32)m_sorted.size(); } // valid after update()
+	int               getSweepAxis() const           { return m_axis; }
+	uint32            getSwapCount() const           { return m_swapCount; } // insertion sort swaps during the last update()
+
+	friend void swap(SweepAndPrune& _a, SweepAndPrune& _b);
+
+private:
+	struct Proxy
+	{
+		AlignedBox m_box;
+		void*      m_userData;
+		uint32     m_nextFree; // kInvalidProxy if in use
+		bool       m_inUse;
+	};
+
+	struct Entry
+	{
+		AlignedBox m_box;      // copied from the proxy to keep the sweep cache friendly
+		ProxyId    m_proxy;
+	};
+
+	eastl::vector<Proxy>  m_proxies;
+	eastl::vector<Entry>  m_sorted;
+	uint32                m_freeList;
+	uint32                m_proxyCount;
+	int                   m_axis;
+	uint32                m_swapCount;
+	bool                  m_resort;     // proxies were inserted/removed since the last update()
+
+	bool isProxy(ProxyId _id) const { return _id < m_proxies.size() && m_proxies[_id].m_inUse; }
+
+}; // class SweepAndPrune
+
+} // namespace frm
+
+#endif // frm_SweepAndPrune_h
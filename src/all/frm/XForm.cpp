@@ -4,12 +4,19 @@
 #include <frm/Scene.h>
 #include <frm/Spline.h>
 
+#include <apt/hash.h>
 #include <apt/log.h>
+#include <apt/memory.h>
 #include <apt/Serializer.h>
 
 #include <imgui/imgui.h>
 #include <im3d/im3d.h>
 
+#include <EASTL/algorithm.h>
+#include <EASTL/sort.h>
+
+#include <mutex>
+
 using namespace frm;
 using namespace apt;
 
@@ -23,6 +30,182 @@ APT_FACTORY_DEFINE(XForm);
 
 eastl::vector<const XForm::Callback*> XForm::s_callbackRegistry;
 
+// Fixed size slots are allocated from blocks per size class, freed slots are reused via a free list. Blocks are
+// aligned to their size such that the block containing a slot can be found by masking the address, trim() releases
+// blocks whose slots are all free. XForms may be created on SceneStreamer loader threads, hence the mutex.
+namespace {
+
+class XFormSlab
+{
+public:
+	static const uint32 kSlotAlignment = 16;
+	static const uint32 kMaxSlotSize   = 256; // Larger allocations go to the system allocator.
+	static const uint32 kClassCount    = kMaxSlotSize / kSlotAlignment;
+	static const uint32 kBlockSize     = 64 * 1024;
+
+	static XFormSlab& Get()
+	{
+		static XFormSlab s_slab;
+		return s_slab;
+	}
+
+	void* allocate(size_t _size)
+	{
+		if (_size > kMaxSlotSize) {
+			return APT_MALLOC_ALIGNED(_size, kSlotAlignment);
+		}
+		std::lock_guard<std::mutex> lock(m_mutex);
+		SizeClass& sc = m_classes[GetClassIndex(_size)];
+		if (sc.m_free) {
+			FreeSlot* ret = sc.m_free;
+			sc.m_free = ret->m_next;
+			return ret;
+		}
+		uint32 slotSize = (GetClassIndex(_size) + 1) * kSlotAlignment;
+		if (!sc.m_block || sc.m_blockOffset + slotSize > kBlockSize) {
+			sc.m_block = (char*)APT_MALLOC_ALIGNED(kBlockSize, kBlockSize);
+			sc.m_blockOffset = 0;
+			sc.m_blocks.push_back(sc.m_block);
+			m_totalBytes += kBlockSize;
+		}
+		void* ret = sc.m_block + sc.m_blockOffset;
+		sc.m_blockOffset += slotSize;
+		return ret;
+	}
+
+	void deallocate(void* _ptr, size_t _size)
+	{
+		if (_size > kMaxSlotSize) {
+			APT_FREE_ALIGNED(_ptr);
+			return;
+		}
+		std::lock_guard<std::mutex> lock(m_mutex);
+		SizeClass& sc = m_classes[GetClassIndex(_size)];
+		FreeSlot* slot = (FreeSlot*)_ptr;
+		slot->m_next = sc.m_free;
+		sc.m_free = slot;
+	}
+
+	size_t getTotalBytes()
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		return m_totalBytes;
+	}
+
+	void trim()
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		for (uint32 i = 0; i < kClassCount; ++i) {
+			SizeClass& sc = m_classes[i];
+			if (sc.m_blocks.empty()) {
+				continue;
+			}
+			uint32 slotSize = (i + 1) * kSlotAlignment;
+
+		 // count free slots per block
+			eastl::sort(sc.m_blocks.begin(), sc.m_blocks.end());
+			eastl::vector<uint32> freeCounts(sc.m_blocks.size(), 0);
+			for (FreeSlot* slot = sc.m_free; slot; slot = slot->m_next) {
+				++freeCounts[FindBlock(sc, slot)];
+			}
+
+		 // a block can be released if all of its allocated slots are free (the current block is partially allocated)
+			eastl::vector<uint8> release(sc.m_blocks.size(), 0);
+			bool releaseAny = false;
+			for (uint32 j = 0; j < (uint32)sc.m_blocks.size(); ++j) {
+				uint32 allocatedCount = sc.m_blocks[j] == sc.m_block ? sc.m_blockOffset / slotSize : kBlockSize / slotSize;
+				release[j] = freeCounts[j] == allocatedCount ? 1 : 0;
+				releaseAny |= release[j] != 0;
+			}
+			if (!releaseAny) {
+				continue;
+			}
+
+		 // unlink the slots of released blocks from the free list, then free the blocks
+			for (FreeSlot** link = &sc.m_free; *link; ) {
+				if (release[FindBlock(sc, *link)]) {
+					*link = (*link)->m_next;
+				} else {
+					link = &(*link)->m_next;
+				}
+			}
+			for (uint32 j = (uint32)sc.m_blocks.size(); j > 0; --j) {
+				if (!release[j - 1]) {
+					continue;
+				}
+				if (sc.m_blocks[j - 1] == sc.m_block) {
+					sc.m_block = nullptr;
+					sc.m_blockOffset = 0;
+				}
+				APT_FREE_ALIGNED(sc.m_blocks[j - 1]);
+				sc.m_blocks.erase(sc.m_blocks.begin() + (j - 1));
+				m_totalBytes -= kBlockSize;
+			}
+		}
+	}
+
+private:
+	struct FreeSlot
+	{
+		FreeSlot* m_next;
+	};
+
+	struct SizeClass
+	{
+		FreeSlot*            m_free        = nullptr;
+		char*                m_block       = nullptr; // Current block, slots are allocated linearly from m_blockOffset.
+		uint32               m_blockOffset = 0;
+		eastl::vector<char*> m_blocks;                // All blocks, sorted by trim().
+	};
+
+	std::mutex m_mutex;
+	SizeClass  m_classes[kClassCount];
+	size_t     m_totalBytes;
+
+	XFormSlab()
+		: m_totalBytes(0)
+	{
+	}
+
+	static uint32 GetClassIndex(size_t _size)
+	{
+		return (uint32)((APT_MAX(_size, (size_t)1) + kSlotAlignment - 1) / kSlotAlignment) - 1;
+	}
+
+	// Index in _sc.m_blocks (which must be sorted) of the block containing _slot.
+	static uint32 FindBlock(const SizeClass& _sc, const void* _slot)
+	{
+		char* block = (char*)((uintptr_t)_slot & ~(uintptr_t)(kBlockSize - 1));
+		auto it = eastl::lower_bound(_sc.m_blocks.begin(), _sc.m_blocks.end(), block);
+		APT_ASSERT(it != _sc.m_blocks.end() && *it == block);
+		return (uint32)(it - _sc.m_blocks.begin());
+	}
+};
+
+} // namespace
+
+void* XForm::operator new(size_t _size)
+{
+	return XFormSlab::Get().allocate(_size);
+}
+
+void XForm::operator delete(void* _ptr, size_t _size)
+{
+	if (_ptr) {
+		XFormSlab::Get().deallocate(_ptr, _size);
+	}
+}
+
+size_t XForm::GetSlabBytes()
+{
+	return XFormSlab::Get().getTotalBytes();
+}
+
+void XForm::TrimSlabs()
+{
+	XFormSlab::Get().trim();
+}
+
 XForm::Callback::Callback(const char* _name, OnComplete* _callback)
 	: m_callback(_callback)
 	, m_name(_name)
@@ -86,6 +269,57 @@ bool XForm::SerializeCallback(Serializer& _serializer_, OnComplete*& _callback,
 }
 
 
+bool XForm::Blob::bytes(void* _data_, uint32 _size)
+{
+	if (isReading()) {
+		if (m_srcOffset + _size > m_srcSize) {
+			return false;
+		}
+		memcpy(_data_, m_src + m_srcOffset, _size);
+		m_srcOffset += _size;
+	} else {
+		m_dst->insert(m_dst->end(), (const char*)_data_, (const char*)_data_ + _size);
+	}
+	return true;
+}
+
+bool XForm::Blob::callback(OnComplete*& _callback_)
+{
+	uint32 nameHash = 0;
+	if (!isReading() && _callback_) {
+		nameHash = HashString<uint32>(FindCallback(_callback_)->m_name);
+	}
+	if (!value(nameHash)) {
+		return false;
+	}
+	if (isReading()) {
+		_callback_ = nullptr;
+		if (nameHash != 0) {
+			for (auto& cbk : s_callbackRegistry) {
+				if (HashString<uint32>(cbk->m_name) == nameHash) {
+					_callback_ = cbk->m_callback;
+					break;
+				}
+			}
+			if (!_callback_) {
+				APT_LOG_ERR("XForm: Invalid callback hash 0x%08x", nameHash);
+				return false;
+			}
+		}
+	}
+	return true;
+}
+
+// PROTECTED
+
+void XForm::ApplyBatch(XForm* const* _xforms, uint32 _count, float _dt)
+{
+	for (uint32 i = 0; i < _count; ++i) {
+		_xforms[i]->apply(_dt);
+	}
+}
+
+
 /*******************************************************************************
 
                         XForm_PositionOrientationScale
@@ -129,6 +363,15 @@ bool XForm_PositionOrientationScale::serialize(Serializer& _serializer_)
 	return ret;
 }
 
+bool XForm_PositionOrientationScale::serializeBlob(Blob& _blob_)
+{
+	bool ret = true;
+	ret &= _blob_.value(m_position);
+	ret &= _blob_.value(m_orientation);
+	ret &= _blob_.value(m_scale);
+	return ret;
+}
+
 /*******************************************************************************
 
                                 XForm_FreeCamera
@@ -224,7 +467,7 @@ void XForm_FreeCamera::apply(float _dt)
 	m_orientation   = qmul(qmul(qmul(qyaw, qpitch), qroll), m_orientation);
 	m_pitchYawRoll *= powf(m_rotationDamp, _dt);
 
-	m_node->setLocalMatrix(TransformationMatrix(m_position, m_orientation));
+	m_node->setLocalTRS(m_position, m_orientation);
 	
 }
 
@@ -260,6 +503,19 @@ bool XForm_FreeCamera::serialize(Serializer& _serializer_)
 	return ret;
 }
 
+bool XForm_FreeCamera::serializeBlob(Blob& _blob_)
+{
+	bool ret = true;
+	ret &= _blob_.value(m_position);
+	ret &= _blob_.value(m_orientation);
+	ret &= _blob_.value(m_maxSpeed);
+	ret &= _blob_.value(m_maxSpeedMul);
+	ret &= _blob_.value(m_accelTime);
+	ret &= _blob_.value(m_rotationInputMul);
+	ret &= _blob_.value(m_rotationDamp);
+	return ret;
+}
+
 /*******************************************************************************
 
                                  XForm_LookAt
@@ -309,6 +565,14 @@ bool XForm_LookAt::serialize(Serializer& _serializer_)
 	return ret;
 }
 
+bool XForm_LookAt::serializeBlob(Blob& _blob_)
+{
+	bool ret = true;
+	ret &= _blob_.value(m_offset);
+	ret &= _blob_.value(m_targetId);
+	return ret;
+}
+
 /*******************************************************************************
 
                                 XForm_Spin
@@ -348,6 +612,14 @@ bool XForm_Spin::serialize(Serializer& _serializer_)
 	return ret;
 }
 
+bool XForm_Spin::serializeBlob(Blob& _blob_)
+{
+	bool ret = true;
+	ret &= _blob_.value(m_axis);
+	ret &= _blob_.value(m_rate);
+	return ret;
+}
+
 /*******************************************************************************
 
                               XForm_PositionTarget
@@ -410,6 +682,16 @@ bool XForm_PositionTarget::serialize(Serializer& _serializer_)
 	return ret;
 }
 
+bool XForm_PositionTarget::serializeBlob(Blob& _blob_)
+{
+	bool ret = true;
+	ret &= _blob_.value(m_start);
+	ret &= _blob_.value(m_end);
+	ret &= _blob_.value(m_duration);
+	ret &= _blob_.callback(m_onComplete);
+	return ret;
+}
+
 void XForm_PositionTarget::reset()
 {
 	m_currentTime = 0.0f;
@@ -468,6 +750,14 @@ bool XForm_SplinePath::serialize(Serializer& _serializer_)
 	return ret;
 }
 
+bool XForm_SplinePath::serializeBlob(Blob& _blob_)
+{
+	bool ret = true;
+	ret &= _blob_.value(m_duration);
+	ret &= _blob_.callback(m_onComplete);
+	return ret;
+}
+
 void XForm_SplinePath::reset()
 {
 	m_currentTime = 0.0f;
@@ -556,6 +846,17 @@ bool XForm_OrbitalPath::serialize(Serializer& _serializer_)
 	return ret;
 }
 
+bool XForm_OrbitalPath::serializeBlob(Blob& _blob_)
+{
+	bool ret = true;
+	ret &= _blob_.value(m_azimuth);
+	ret &= _blob_.value(m_elevation);
+	ret &= _blob_.value(m_theta);
+	ret &= _blob_.value(m_radius);
+	ret &= _blob_.value(m_speed);
+	return ret;
+}
+
 void XForm_OrbitalPath::reset()
 {
 	m_theta = 0.0f;
@@ -650,6 +951,19 @@ struct XForm_VRGamepad: public XForm
 		return ret;
 	}
 
+	bool serializeBlob(Blob& _blob_)
+	{
+		bool ret = true;
+		ret &= _blob_.value(m_position);
+		ret &= _blob_.value(m_orientation);
+		ret &= _blob_.value(m_maxSpeed);
+		ret &= _blob_.value(m_maxSpeedMul);
+		ret &= _blob_.value(m_accelTime);
+		ret &= _blob_.value(m_rotationInputMul);
+		ret &= _blob_.value(m_rotationDamp);
+		return ret;
+	}
+
 }; // struct XForm_VRGamepad
 APT_FACTORY_REGISTER_DEFAULT(XForm, XForm_VRGamepad);
 
@@ -23,6 +23,7 @@ class Node;
 ////////////////////////////////////////////////////////////////////////////////
 class XForm: public apt::Factory<XForm>
 {
+	friend class Node;
 public:
 	typedef void (OnComplete)(XForm* _xform_);
 	struct Callback
@@ -39,6 +40,30 @@ public:
 	static const Callback* FindCallback(OnComplete* _callback);
 	static bool            SerializeCallback(apt::Serializer& _serializer_, OnComplete*& _callback, const char* _name);
 
+	// Binary stream for the binary scene format. Values are read/written in order, hence serializeBlob() must be
+	// symmetric (as serialize()). Only trivially copyable types may be passed to value().
+	class Blob
+	{
+	public:
+		Blob(eastl::vector<char>& dst_): m_dst(&dst_), m_src(nullptr), m_srcSize(0), m_srcOffset(0) {}
+		Blob(const char* _src, uint32 _srcSize): m_dst(nullptr), m_src(_src), m_srcSize(_srcSize), m_srcOffset(0) {}
+
+		bool isReading() const { return m_src != nullptr; }
+
+		template <typename tType>
+		bool value(tType& _value_)                  { return bytes(&_value_, (uint32)sizeof(tType)); }
+		bool bytes(void* _data_, uint32 _size);
+
+		// Callbacks are stored as a hash of the registered name.
+		bool callback(OnComplete*& _callback_);
+
+	private:
+		eastl::vector<char>* m_dst;
+		const char*          m_src;
+		uint32               m_srcSize;
+		uint32               m_srcOffset;
+	};
+
 	// Reset initial state.
 	virtual void reset() {}
 	static  void Reset(XForm* _xform_)         { _xform_->reset(); }
@@ -54,10 +79,33 @@ public:
 	const char*  getName() const               { return getClassRef()->getName(); }	
 	Node*        getNode() const               { return m_node; }
 	void         setNode(Node* _node)          { m_node = _node; }
+	// Next xform in the node's xform list (see Node::getFirstXForm()).
+	XForm*       getNext() const               { return m_next; }
+
+	// XForms are allocated from slabs (one per 16 byte size class) such that instances of the same class are packed
+	// together in memory. Freed slab memory is retained for reuse until TrimSlabs() is called.
+	static void* operator new(size_t _size);
+	static void  operator delete(void* _ptr, size_t _size);
+	// Total size of the slabs in bytes.
+	static size_t GetSlabBytes();
+	// Return slab blocks which contain no xforms to the system, e.g. after unloading a scene.
+	static void   TrimSlabs();
 
 	virtual void apply(float _dt) = 0;	
 	virtual void edit() = 0;
+	// Return false if apply() reads nodes other than m_node, in which case Scene::update() won't update the node's
+	// subtree in parallel. Scene caches the result when the node's xform list or the hierarchy changes.
+	virtual bool isIndependent() const         { return true; }
+
+	// Apply _count xforms of the same class. Scene::update() applies independent xforms in per-class batches before
+	// the transform propagation. Batches are arrays of pointers to the xforms (the state isn't copied), sorted by
+	// address such that the slabs are traversed in order. The default calls apply() per xform; derived classes should
+	// return ApplyBatchT<> (non-virtual calls to apply()), including any classes derived from those.
+	typedef void (ApplyBatchFunc)(XForm* const* _xforms, uint32 _count, float _dt);
+	virtual ApplyBatchFunc* getApplyBatch() const { return &ApplyBatch; }
 	virtual bool serialize(apt::Serializer& _serializer_) = 0;
+	// Return false if the binary format isn't supported (the xform isn't written).
+	virtual bool serializeBlob(Blob& _blob_)   { APT_UNUSED(_blob_); return false; }
 	friend bool Serialize(apt::Serializer& _serializer_, XForm& _xform_)
 	{
 		return _xform_.serialize(_serializer_);
@@ -66,9 +114,20 @@ public:
 protected:
 	static eastl::vector<const Callback*> s_callbackRegistry;
 
-	XForm(): m_node(nullptr)      {}
+	XForm(): m_node(nullptr), m_next(nullptr) {}
+
+	static void ApplyBatch(XForm* const* _xforms, uint32 _count, float _dt);
+
+	template <typename tXForm>
+	static void ApplyBatchT(XForm* const* _xforms, uint32 _count, float _dt)
+	{
+		for (uint32 i = 0; i < _count; ++i) {
+			static_cast<tXForm*>(_xforms[i])->tXForm::apply(_dt);
+		}
+	}
 
-	Node* m_node;
+	Node*  m_node;
+	XForm* m_next;
 
 }; // class XForm
 
@@ -85,8 +144,10 @@ struct XForm_PositionOrientationScale: public XForm
 	vec3  m_scale         = vec3(1.0f);
 	
 	virtual void apply(float _dt) override;
+	virtual ApplyBatchFunc* getApplyBatch() const override { return &ApplyBatchT<XForm_PositionOrientationScale>; }
 	virtual void edit() override;
 	virtual bool serialize(apt::Serializer& _serializer_) override;
+	virtual bool serializeBlob(Blob& _blob_) override;
 	
 };
 
@@ -123,6 +184,7 @@ struct XForm_FreeCamera: public XForm
 	virtual void apply(float _dt) override;
 	virtual void edit() override;
 	virtual bool serialize(apt::Serializer& _serializer_) override;
+	virtual bool serializeBlob(Blob& _blob_) override;
 };
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -137,7 +199,9 @@ struct XForm_LookAt: public XForm
 
 	virtual void apply(float _dt) override;
 	virtual void edit() override;
+	virtual bool isIndependent() const override { return false; } // reads the target's world matrix
 	virtual bool serialize(apt::Serializer& _serializer_) override;
+	virtual bool serializeBlob(Blob& _blob_) override;
 };
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -151,8 +215,10 @@ struct XForm_Spin: public XForm
 	float m_rotation   = 0.0f;
 	
 	virtual void apply(float _dt) override;
+	virtual ApplyBatchFunc* getApplyBatch() const override { return &ApplyBatchT<XForm_Spin>; }
 	virtual void edit() override;
 	virtual bool serialize(apt::Serializer& _serializer_) override;
+	virtual bool serializeBlob(Blob& _blob_) override;
 };
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -167,11 +233,14 @@ struct XForm_PositionTarget: public XForm
 	float m_duration          = 1.0f;
 	float m_currentTime       = 0.0f;
 
-	OnComplete* m_onComplete;
+	OnComplete* m_onComplete  = nullptr;  // Set before adding the xform to a node, see isIndependent().
 	
 	virtual void apply(float _dt) override;
+	virtual ApplyBatchFunc* getApplyBatch() const override { return &ApplyBatchT<XForm_PositionTarget>; }
 	virtual void edit() override;
+	virtual bool isIndependent() const override { return m_onComplete == nullptr; } // the callback may access other nodes
 	virtual bool serialize(apt::Serializer& _serializer_) override;
+	virtual bool serializeBlob(Blob& _blob_) override;
 
 	virtual void reset() override;
 	virtual void relativeReset() override;
@@ -188,11 +257,14 @@ struct XForm_SplinePath: public XForm
 	float       m_duration      = 1.0f;
 	float       m_currentTime   = 0.0f;
 
-	OnComplete* m_onComplete;
+	OnComplete* m_onComplete    = nullptr; // Set before adding the xform to a node, see isIndependent().
 
 	virtual void apply(float _dt) override;
+	virtual ApplyBatchFunc* getApplyBatch() const override { return &ApplyBatchT<XForm_SplinePath>; }
 	virtual void edit() override;
+	virtual bool isIndependent() const override { return m_onComplete == nullptr; } // the callback may access other nodes
 	virtual bool serialize(apt::Serializer& _serializer_) override;
+	virtual bool serializeBlob(Blob& _blob_) override;
 
 	virtual void reset() override;
 	virtual void reverse() override;
@@ -214,8 +286,10 @@ struct XForm_OrbitalPath: public XForm
 	vec4  m_displayColor    = vec4(1.0f, 1.0f, 0.0f, 1.0f);
 
 	virtual void apply(float _dt) override;
+	virtual ApplyBatchFunc* getApplyBatch() const override { return &ApplyBatchT<XForm_OrbitalPath>; }
 	virtual void edit() override;
 	virtual bool serialize(apt::Serializer& _serializer_) override;
+	virtual bool serializeBlob(Blob& _blob_) override;
 
 	virtual void reset() override;
 };
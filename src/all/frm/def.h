@@ -29,10 +29,12 @@ namespace frm {
 	using apt::float64;
 
  // forward declarations
+	class  AabbTree;
 	class  App;
 	class  AppSample;
 	class  AppSample3d;
 	class  Buffer;
+	class  Bvh;
 	class  Camera;
 	class  Curve;
 	class  CurveEditor;
@@ -42,6 +44,7 @@ namespace frm {
 	class  Gamepad;
 	class  GlContext;
 	class  GradientEditor;
+	class  JobSystem;
 	class  Keyboard;
 	class  Light;
 	class  LuaScript;
@@ -51,6 +54,7 @@ namespace frm {
 	class  MeshDesc;
 	class  Mouse;
 	class  Node;
+	class  OcclusionBuffer;
 	class  Property;
 	class  PropertyGroup;
 	class  Properties;
@@ -59,12 +63,15 @@ namespace frm {
 	class  ProxyKeyboard;
 	class  ProxyMouse;
 	class  Scene;
+	class  SceneStreamer;
 	class  Shader;
 	class  ShaderDesc;
 	class  Skeleton;
 	class  SkeletonAnimation;
 	class  SkeletonAnimationTrack;
+	class  SpatialHash;
 	class  SplinePath;
+	class  SweepAndPrune;
 	class  Texture;
 	class  TextureAtlas;
 	struct TextureView;
@@ -81,6 +88,7 @@ namespace frm {
 	struct Frustum;
 	struct Line;
 	struct LineSegment;
+	struct OrientedBox;
 	struct Plane;
 	struct Ray;
 	struct Sphere;
@@ -3,12 +3,24 @@
 #include <frm/math.h>
 #include <frm/interpolation.h>
 
+#include <EASTL/utility.h>
+#include <EASTL/vector.h>
+
 #define geom_debug
 #ifdef geom_debug
 	#include <imgui/imgui.h>
 	#include <im3d/im3d.h>
 #endif
 
+#if defined(_M_X64) || defined(__SSE2__)
+	#define geom_sse
+	#include <emmintrin.h>
+#endif
+#if defined(__AVX__)
+	#define geom_avx
+	#include <immintrin.h>
+#endif
+
 using namespace frm;
 using namespace apt;
 
@@ -94,6 +106,165 @@ Sphere::Sphere(const AlignedBox& _box)
 {
 }
 
+static inline bool SphereContains(const Sphere& _sphere, const vec3& _point)
+{
+	float r2 = _sphere.m_radius * _sphere.m_radius;
+	return length2(_point - _sphere.m_origin) <= r2 + r2 * 1e-5f;
+}
+
+// Expand _sphere_ to contain _point, keeping the opposite side fixed (Ritter).
+static inline void SphereGrow(Sphere& _sphere_, const vec3& _point)
+{
+	vec3  d  = _point - _sphere_.m_origin;
+	float d2 = length2(d);
+	if (d2 > _sphere_.m_radius * _sphere_.m_radius) {
+		float dlen = sqrt(d2);
+		float r = (_sphere_.m_radius + dlen) * 0.5f;
+		_sphere_.m_origin += d * ((r - _sphere_.m_radius) / dlen);
+		_sphere_.m_radius = r;
+	}
+}
+
+static Sphere SphereFrom2(const vec3& _a, const vec3& _b)
+{
+	return Sphere((_a + _b) * 0.5f, length(_b - _a) * 0.5f);
+}
+
+// Smallest sphere with _a, _b, _c on the boundary (circumcircle).
+static Sphere SphereFrom3(const vec3& _a, const vec3& _b, const vec3& _c)
+{
+	vec3 ab = _b - _a;
+	vec3 ac = _c - _a;
+	vec3 n  = cross(ab, ac);
+	float denom = 2.0f * length2(n);
+	if (denom < 1e-12f) {
+	 // collinear, use the farthest pair
+		Sphere ret = SphereFrom2(_a, _b);
+		SphereGrow(ret, _c);
+		return ret;
+	}
+	vec3 o = (cross(n, ab) * length2(ac) + cross(ac, n) * length2(ab)) / denom;
+	return Sphere(_a + o, length(o));
+}
+
+// Sphere with _a, _b, _c, _d on the boundary (circumsphere).
+static Sphere SphereFrom4(const vec3& _a, const vec3& _b, const vec3& _c, const vec3& _d)
+{
+	vec3 ab = _b - _a;
+	vec3 ac = _c - _a;
+	vec3 ad = _d - _a;
+	float denom = 2.0f * dot(ab, cross(ac, ad));
+	if (fabs(denom) < 1e-12f) {
+	 // coplanar
+		Sphere ret = SphereFrom3(_a, _b, _c);
+		SphereGrow(ret, _d);
+		return ret;
+	}
+	vec3 o = (cross(ac, ad) * length2(ab) + cross(ad, ab) * length2(ac) + cross(ab, ac) * length2(ad)) / denom;
+	return Sphere(_a + o, length(o));
+}
+
+// Welzl's algorithm, unrolled into nested loops (each level fixes one more boundary point). Expected linear time if
+// _points is randomly ordered.
+static Sphere SphereWelzl(const vec3* _points, uint _count)
+{
+	Sphere ret(_points[0], 0.0f);
+	for (uint i = 1; i < _count; ++i) {
+		if (SphereContains(ret, _points[i])) {
+			continue;
+		}
+		ret = Sphere(_points[i], 0.0f);
+		for (uint j = 0; j < i; ++j) {
+			if (SphereContains(ret, _points[j])) {
+				continue;
+			}
+			ret = SphereFrom2(_points[i], _points[j]);
+			for (uint k = 0; k < j; ++k) {
+				if (SphereContains(ret, _points[k])) {
+					continue;
+				}
+				ret = SphereFrom3(_points[i], _points[j], _points[k]);
+				for (uint l = 0; l < k; ++l) {
+					if (!SphereContains(ret, _points[l])) {
+						ret = SphereFrom4(_points[i], _points[j], _points[k], _points[l]);
+					}
+				}
+			}
+		}
+	}
+	return ret;
+}
+
+Sphere::Sphere(const vec3* _points, uint _count, uint _stride, bool _exact)
+{
+	APT_ASSERT(_count > 0);
+	const char* src = (const char*)_points;
+	#define Sphere_POINT(_i) (*(const vec3*)(src + (_i) * _stride))
+
+	Sphere ret;
+	if (_exact) {
+		eastl::vector<vec3> points(_count);
+		for (uint i = 0; i < _count; ++i) {
+			points[i] = Sphere_POINT(i);
+		}
+	 // shuffle (deterministic) to avoid worst case behavior for ordered input
+		uint32 rnd = 0x9e3779b9u;
+		for (uint i = _count - 1; i > 0; --i) {
+			rnd = rnd * 1664525u + 1013904223u;
+			eastl::swap(points[i], points[(rnd >> 8) % (i + 1)]);
+		}
+		ret = SphereWelzl(points.data(), _count);
+
+	} else {
+	 // EPOS-14: find the min/max points along 7 directions, compute the exact sphere of those
+		static const vec3 kDirections[7] = {
+			vec3(1.0f, 0.0f, 0.0f), vec3(0.0f, 1.0f, 0.0f), vec3(0.0f, 0.0f, 1.0f),
+			vec3(1.0f, 1.0f, 1.0f), vec3(1.0f, 1.0f, -1.0f), vec3(1.0f, -1.0f, 1.0f), vec3(1.0f, -1.0f, -1.0f)
+		};
+		float dmin[7], dmax[7];
+		uint  imin[7], imax[7];
+		for (int j = 0; j < 7; ++j) {
+			dmin[j] = dmax[j] = dot(Sphere_POINT(0), kDirections[j]);
+			imin[j] = imax[j] = 0;
+		}
+		for (uint i = 1; i < _count; ++i) {
+			const vec3& p = Sphere_POINT(i);
+			for (int j = 0; j < 7; ++j) {
+				float d = dot(p, kDirections[j]);
+				if (d < dmin[j]) {
+					dmin[j] = d;
+					imin[j] = i;
+				}
+				if (d > dmax[j]) {
+					dmax[j] = d;
+					imax[j] = i;
+				}
+			}
+		}
+		vec3 extremal[14];
+		for (int j = 0; j < 7; ++j) {
+			extremal[j * 2 + 0] = Sphere_POINT(imin[j]);
+			extremal[j * 2 + 1] = Sphere_POINT(imax[j]);
+		}
+		ret = SphereWelzl(extremal, 14);
+
+	 // grow to contain the remaining points
+		for (uint i = 0; i < _count; ++i) {
+			SphereGrow(ret, Sphere_POINT(i));
+		}
+	}
+
+ // the result may be off by some epsilon, set the radius to the farthest point to guarantee containment
+	float r2 = 0.0f;
+	for (uint i = 0; i < _count; ++i) {
+		r2 = APT_MAX(r2, length2(Sphere_POINT(i) - ret.m_origin));
+	}
+	m_origin = ret.m_origin;
+	m_radius = sqrt(r2);
+
+	#undef Sphere_POINT
+}
+
 void Sphere::transform(const mat4& _mat)
 {
 	float maxScale = GetMaxScale(_mat);	
@@ -219,6 +390,169 @@ void AlignedBox::getVertices(vec3* out_) const
 	out_[7] = vec3(m_min.x, m_max.y, m_max.z);
 }
 
+/*******************************************************************************
+
+                               OrientedBox
+
+*******************************************************************************/
+
+// Jacobi eigenvalue iteration for a symmetric 3x3 matrix. The columns of eigenvectors_ are the (unit length)
+// eigenvectors.
+static void EigenSymmetric(const float _m[3][3], mat3& eigenvectors_, vec3& eigenvalues_)
+{
+	float a[3][3];
+	float v[3][3] = { { 1.0f, 0.0f, 0.0f }, { 0.0f, 1.0f, 0.0f }, { 0.0f, 0.0f, 1.0f } };
+	memcpy(a, _m, sizeof(a));
+
+	for (int sweep = 0; sweep < 16; ++sweep) {
+		float off = fabs(a[0][1]) + fabs(a[0][2]) + fabs(a[1][2]);
+		if (off < 1e-12f) {
+			break;
+		}
+		for (int p = 0; p < 2; ++p) {
+			for (int q = p + 1; q < 3; ++q) {
+				if (fabs(a[p][q]) < 1e-20f) {
+					continue;
+				}
+			 // rotate in the pq plane to zero a[p][q]
+				float theta = (a[q][q] - a[p][p]) / (2.0f * a[p][q]);
+				float t = (theta >= 0.0f ? 1.0f : -1.0f) / (fabs(theta) + sqrt(theta * theta + 1.0f));
+				float c = 1.0f / sqrt(t * t + 1.0f);
+				float s = t * c;
+				for (int k = 0; k < 3; ++k) {
+					float akp = a[k][p];
+					float akq = a[k][q];
+					a[k][p] = c * akp - s * akq;
+					a[k][q] = s * akp + c * akq;
+				}
+				for (int k = 0; k < 3; ++k) {
+					float apk = a[p][k];
+					float aqk = a[q][k];
+					a[p][k] = c * apk - s * aqk;
+					a[q][k] = s * apk + c * aqk;
+				}
+				for (int k = 0; k < 3; ++k) {
+					float vkp = v[k][p];
+					float vkq = v[k][q];
+					v[k][p] = c * vkp - s * vkq;
+					v[k][q] = s * vkp + c * vkq;
+				}
+			}
+		}
+	}
+
+	for (int i = 0; i < 3; ++i) {
+		eigenvalues_[i] = a[i][i];
+		eigenvectors_[i] = vec3(v[0][i], v[1][i], v[2][i]);
+	}
+}
+
+OrientedBox::OrientedBox(const vec3& _origin, const vec3& _halfExtents, const mat3& _basis)
+	: m_origin(_origin)
+	, m_halfExtents(_halfExtents)
+	, m_basis(_basis)
+{
+}
+
+OrientedBox::OrientedBox(const AlignedBox& _box)
+	: m_origin(_box.getOrigin())
+	, m_halfExtents((_box.m_max - _box.m_min) * 0.5f)
+	, m_basis(identity)
+{
+}
+
+OrientedBox::OrientedBox(const vec3* _points, uint _count, uint _stride)
+{
+	APT_ASSERT(_count > 0);
+	const char* src = (const char*)_points;
+
+ // mean + aligned box
+	vec3 mean(0.0f);
+	vec3 bmin(FLT_MAX);
+	vec3 bmax(-FLT_MAX);
+	for (uint i = 0; i < _count; ++i) {
+		const vec3& p = *(const vec3*)(src + i * _stride);
+		mean += p;
+		bmin = APT_MIN(bmin, p);
+		bmax = APT_MAX(bmax, p);
+	}
+	mean /= (float)_count;
+
+ // covariance
+	float cov[3][3] = {};
+	for (uint i = 0; i < _count; ++i) {
+		vec3 d = *(const vec3*)(src + i * _stride) - mean;
+		cov[0][0] += d.x * d.x;
+		cov[0][1] += d.x * d.y;
+		cov[0][2] += d.x * d.z;
+		cov[1][1] += d.y * d.y;
+		cov[1][2] += d.y * d.z;
+		cov[2][2] += d.z * d.z;
+	}
+	cov[1][0] = cov[0][1];
+	cov[2][0] = cov[0][2];
+	cov[2][1] = cov[1][2];
+
+ // the eigenvectors of the covariance matrix are the box axes
+	vec3 eigenvalues;
+	EigenSymmetric(cov, m_basis, eigenvalues);
+	m_basis[2] = cross(m_basis[0], m_basis[1]); // ensure right-handed
+
+	vec3 pmin(FLT_MAX);
+	vec3 pmax(-FLT_MAX);
+	mat3 toLocal = transpose(m_basis);
+	for (uint i = 0; i < _count; ++i) {
+		vec3 p = toLocal * *(const vec3*)(src + i * _stride);
+		pmin = APT_MIN(pmin, p);
+		pmax = APT_MAX(pmax, p);
+	}
+	m_origin = m_basis * ((pmin + pmax) * 0.5f);
+	m_halfExtents = (pmax - pmin) * 0.5f;
+
+ // PCA isn't optimal (e.g. for a cube the axes are arbitrary), use the aligned box if it's smaller
+	vec3 e = bmax - bmin;
+	if (e.x * e.y * e.z <= getVolume()) {
+		*this = OrientedBox(AlignedBox(bmin, bmax));
+	}
+}
+
+void OrientedBox::transform(const mat4& _mat)
+{
+	m_origin = TransformPosition(_mat, m_origin);
+	mat3 m = mat3(_mat);
+	for (int i = 0; i < 3; ++i) {
+		vec3 axis = m * m_basis[i];
+		float len = length(axis);
+		m_basis[i] = axis / len;
+		m_halfExtents[i] *= len;
+	}
+}
+
+vec3 OrientedBox::getOrigin() const
+{
+	return m_origin;
+}
+
+float OrientedBox::getVolume() const
+{
+	return 8.0f * m_halfExtents.x * m_halfExtents.y * m_halfExtents.z;
+}
+
+void OrientedBox::getVertices(vec3* out_) const
+{
+	vec3 x = m_basis[0] * m_halfExtents.x;
+	vec3 y = m_basis[1] * m_halfExtents.y;
+	vec3 z = m_basis[2] * m_halfExtents.z;
+	out_[0] = m_origin - x - y - z;
+	out_[1] = m_origin + x - y - z;
+	out_[2] = m_origin + x - y + z;
+	out_[3] = m_origin - x - y + z;
+	out_[4] = m_origin - x + y - z;
+	out_[5] = m_origin + x + y - z;
+	out_[6] = m_origin + x + y + z;
+	out_[7] = m_origin - x + y + z;
+}
+
 /*******************************************************************************
 
                                  Cylinder
@@ -433,6 +767,193 @@ bool Frustum::inside(const AlignedBox& _box) const
 #endif
 }
 
+bool Frustum::inside(const AlignedBox& _box, uint32& planeMask_) const
+{
+	for (int i = 0; i < Plane_Count; ++i) {
+		uint32 bit = 1u << i;
+		if ((planeMask_ & bit) == 0) {
+			continue;
+		}
+		const vec3& n = m_planes[i].m_normal;
+		vec3 a = _box.m_min * n;
+		vec3 b = _box.m_max * n;
+		vec3 pmax = APT_MAX(a, b);
+		if (pmax.x + pmax.y + pmax.z - m_planes[i].m_offset < 0.0f) {
+			return false;
+		}
+		vec3 pmin = APT_MIN(a, b);
+		if (pmin.x + pmin.y + pmin.z - m_planes[i].m_offset >= 0.0f) {
+			planeMask_ &= ~bit;
+		}
+	}
+	return true;
+}
+
+bool Frustum::inside(const OrientedBox& _box) const
+{
+	for (int i = 0; i < Plane_Count; ++i) {
+		const vec3& n = m_planes[i].m_normal;
+		float r = 
+			fabs(dot(n, _box.m_basis[0])) * _box.m_halfExtents.x +
+			fabs(dot(n, _box.m_basis[1])) * _box.m_halfExtents.y +
+			fabs(dot(n, _box.m_basis[2])) * _box.m_halfExtents.z
+			;
+		if (Distance(m_planes[i], _box.m_origin) < -r) {
+			return false;
+		}
+	}
+	return true;
+}
+
+// Batch culling processes 8 objects per iteration with AVX, then 4 with SSE and the remainder with the
+// scalar path. Visibility bits are OR'd into the mask, hence clear it first.
+static void ClearMask(int _count, uint32* visibleMask_)
+{
+	memset(visibleMask_, 0, sizeof(uint32) * ((_count + 31) / 32));
+}
+static inline void SetMaskBits(int _i, uint32 _bits, uint32* visibleMask_)
+{
+	visibleMask_[_i >> 5] |= _bits << (_i & 31);
+}
+
+void Frustum::cull(const float* _cx, const float* _cy, const float* _cz, const float* _r, int _count, uint32* visibleMask_) const
+{
+	ClearMask(_count, visibleMask_);
+	int i = 0;
+
+	#ifdef geom_avx
+	__m256 nx8[Plane_Count], ny8[Plane_Count], nz8[Plane_Count], no8[Plane_Count];
+	for (int j = 0; j < Plane_Count; ++j) {
+		nx8[j] = _mm256_set1_ps(m_planes[j].m_normal.x);
+		ny8[j] = _mm256_set1_ps(m_planes[j].m_normal.y);
+		nz8[j] = _mm256_set1_ps(m_planes[j].m_normal.z);
+		no8[j] = _mm256_set1_ps(m_planes[j].m_offset);
+	}
+	for (; i + 8 <= _count; i += 8) {
+		__m256 cx = _mm256_loadu_ps(_cx + i);
+		__m256 cy = _mm256_loadu_ps(_cy + i);
+		__m256 cz = _mm256_loadu_ps(_cz + i);
+		__m256 nr = _mm256_sub_ps(_mm256_setzero_ps(), _mm256_loadu_ps(_r + i));
+		__m256 in = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+		for (int j = 0; j < Plane_Count; ++j) {
+			__m256 d = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(nx8[j], cx), _mm256_mul_ps(ny8[j], cy)), _mm256_mul_ps(nz8[j], cz));
+			d = _mm256_sub_ps(d, no8[j]);
+			in = _mm256_and_ps(in, _mm256_cmp_ps(d, nr, _CMP_GE_OQ));
+		}
+		SetMaskBits(i, (uint32)_mm256_movemask_ps(in), visibleMask_);
+	}
+	#endif
+
+	#ifdef geom_sse
+	__m128 nx4[Plane_Count], ny4[Plane_Count], nz4[Plane_Count], no4[Plane_Count];
+	for (int j = 0; j < Plane_Count; ++j) {
+		nx4[j] = _mm_set1_ps(m_planes[j].m_normal.x);
+		ny4[j] = _mm_set1_ps(m_planes[j].m_normal.y);
+		nz4[j] = _mm_set1_ps(m_planes[j].m_normal.z);
+		no4[j] = _mm_set1_ps(m_planes[j].m_offset);
+	}
+	for (; i + 4 <= _count; i += 4) {
+		__m128 cx = _mm_loadu_ps(_cx + i);
+		__m128 cy = _mm_loadu_ps(_cy + i);
+		__m128 cz = _mm_loadu_ps(_cz + i);
+		__m128 nr = _mm_sub_ps(_mm_setzero_ps(), _mm_loadu_ps(_r + i));
+		__m128 in = _mm_castsi128_ps(_mm_set1_epi32(-1));
+		for (int j = 0; j < Plane_Count; ++j) {
+			__m128 d = _mm_add_ps(_mm_add_ps(_mm_mul_ps(nx4[j], cx), _mm_mul_ps(ny4[j], cy)), _mm_mul_ps(nz4[j], cz));
+			d = _mm_sub_ps(d, no4[j]);
+			in = _mm_and_ps(in, _mm_cmpge_ps(d, nr));
+		}
+		SetMaskBits(i, (uint32)_mm_movemask_ps(in), visibleMask_);
+	}
+	#endif
+
+	for (; i < _count; ++i) {
+		bool in = true;
+		for (int j = 0; j < Plane_Count; ++j) {
+			const Plane& p = m_planes[j];
+			float d = p.m_normal.x * _cx[i] + p.m_normal.y * _cy[i] + p.m_normal.z * _cz[i] - p.m_offset;
+			in &= d >= -_r[i];
+		}
+		SetMaskBits(i, in ? 1u : 0u, visibleMask_);
+	}
+}
+
+void Frustum::cull(const float* _minX, const float* _minY, const float* _minZ, const float* _maxX, const float* _maxY, const float* _maxZ, int _count, uint32* visibleMask_) const
+{
+ // same as inside(AlignedBox), test the box vertex furthest along each plane normal
+	ClearMask(_count, visibleMask_);
+	int i = 0;
+
+	#ifdef geom_avx
+	__m256 nx8[Plane_Count], ny8[Plane_Count], nz8[Plane_Count], no8[Plane_Count];
+	for (int j = 0; j < Plane_Count; ++j) {
+		nx8[j] = _mm256_set1_ps(m_planes[j].m_normal.x);
+		ny8[j] = _mm256_set1_ps(m_planes[j].m_normal.y);
+		nz8[j] = _mm256_set1_ps(m_planes[j].m_normal.z);
+		no8[j] = _mm256_set1_ps(m_planes[j].m_offset);
+	}
+	for (; i + 8 <= _count; i += 8) {
+		__m256 x0 = _mm256_loadu_ps(_minX + i);
+		__m256 y0 = _mm256_loadu_ps(_minY + i);
+		__m256 z0 = _mm256_loadu_ps(_minZ + i);
+		__m256 x1 = _mm256_loadu_ps(_maxX + i);
+		__m256 y1 = _mm256_loadu_ps(_maxY + i);
+		__m256 z1 = _mm256_loadu_ps(_maxZ + i);
+		__m256 in = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+		for (int j = 0; j < Plane_Count; ++j) {
+			__m256 dx = _mm256_max_ps(_mm256_mul_ps(x0, nx8[j]), _mm256_mul_ps(x1, nx8[j]));
+			__m256 dy = _mm256_max_ps(_mm256_mul_ps(y0, ny8[j]), _mm256_mul_ps(y1, ny8[j]));
+			__m256 dz = _mm256_max_ps(_mm256_mul_ps(z0, nz8[j]), _mm256_mul_ps(z1, nz8[j]));
+			__m256 d  = _mm256_sub_ps(_mm256_add_ps(_mm256_add_ps(dx, dy), dz), no8[j]);
+			in = _mm256_and_ps(in, _mm256_cmp_ps(d, _mm256_setzero_ps(), _CMP_GE_OQ));
+		}
+		SetMaskBits(i, (uint32)_mm256_movemask_ps(in), visibleMask_);
+	}
+	#endif
+
+	#ifdef geom_sse
+	__m128 nx4[Plane_Count], ny4[Plane_Count], nz4[Plane_Count], no4[Plane_Count];
+	for (int j = 0; j < Plane_Count; ++j) {
+		nx4[j] = _mm_set1_ps(m_planes[j].m_normal.x);
+		ny4[j] = _mm_set1_ps(m_planes[j].m_normal.y);
+		nz4[j] = _mm_set1_ps(m_planes[j].m_normal.z);
+		no4[j] = _mm_set1_ps(m_planes[j].m_offset);
+	}
+	for (; i + 4 <= _count; i += 4) {
+		__m128 x0 = _mm_loadu_ps(_minX + i);
+		__m128 y0 = _mm_loadu_ps(_minY + i);
+		__m128 z0 = _mm_loadu_ps(_minZ + i);
+		__m128 x1 = _mm_loadu_ps(_maxX + i);
+		__m128 y1 = _mm_loadu_ps(_maxY + i);
+		__m128 z1 = _mm_loadu_ps(_maxZ + i);
+		__m128 in = _mm_castsi128_ps(_mm_set1_epi32(-1));
+		for (int j = 0; j < Plane_Count; ++j) {
+			__m128 dx = _mm_max_ps(_mm_mul_ps(x0, nx4[j]), _mm_mul_ps(x1, nx4[j]));
+			__m128 dy = _mm_max_ps(_mm_mul_ps(y0, ny4[j]), _mm_mul_ps(y1, ny4[j]));
+			__m128 dz = _mm_max_ps(_mm_mul_ps(z0, nz4[j]), _mm_mul_ps(z1, nz4[j]));
+			__m128 d  = _mm_sub_ps(_mm_add_ps(_mm_add_ps(dx, dy), dz), no4[j]);
+			in = _mm_and_ps(in, _mm_cmpge_ps(d, _mm_setzero_ps()));
+		}
+		SetMaskBits(i, (uint32)_mm_movemask_ps(in), visibleMask_);
+	}
+	#endif
+
+	for (; i < _count; ++i) {
+		bool in = true;
+		for (int j = 0; j < Plane_Count; ++j) {
+			const vec3& n = m_planes[j].m_normal;
+			float d = 
+				APT_MAX(_minX[i] * n.x, _maxX[i] * n.x) +
+				APT_MAX(_minY[i] * n.y, _maxY[i] * n.y) +
+				APT_MAX(_minZ[i] * n.z, _maxZ[i] * n.z) -
+				m_planes[j].m_offset
+				;
+			in &= d >= 0.0f;
+		}
+		SetMaskBits(i, in ? 1u : 0u, visibleMask_);
+	}
+}
+
 void Frustum::setVertices(const vec3 _vertices[8])
 {
 	memcpy(m_vertices, _vertices, sizeof(m_vertices));
@@ -949,6 +1470,18 @@ bool frm::Intersect(const Ray& _ray, const AlignedBox& _box, float& t0_, float&
 	}
 	return true;
 }
+bool frm::Intersects(const Ray& _ray, const OrientedBox& _box)
+{
+	float t0, t1;
+	return Intersect(_ray, _box, t0, t1);
+}
+bool frm::Intersect(const Ray& _ray, const OrientedBox& _box, float& t0_, float& t1_)
+{
+ // test in the box space
+	mat3 toLocal = transpose(_box.m_basis);
+	Ray ray(toLocal * (_ray.m_origin - _box.m_origin), toLocal * _ray.m_direction);
+	return Intersect(ray, AlignedBox(-_box.m_halfExtents, _box.m_halfExtents), t0_, t1_);
+}
 bool frm::Intersects(const Ray& _ray, const Capsule& _capsule)
 {
 	float c2 = _capsule.m_radius * _capsule.m_radius;
@@ -983,6 +1516,42 @@ bool frm::Intersect(const Ray& _ray, const Cylinder& _cylinder, float& t0_, floa
 	return true;
 }
 
+bool frm::Intersects(const Ray& _ray, const vec3& _v0, const vec3& _v1, const vec3& _v2, bool _cullBackface)
+{
+	float t, u, v;
+	return Intersect(_ray, _v0, _v1, _v2, t, u, v, _cullBackface);
+}
+bool frm::Intersect(const Ray& _ray, const vec3& _v0, const vec3& _v1, const vec3& _v2, float& t_, float& u_, float& v_, bool _cullBackface)
+{
+	const float kEpsilon = 1e-8f;
+	vec3 e1 = _v1 - _v0;
+	vec3 e2 = _v2 - _v0;
+	vec3 p = cross(_ray.m_direction, e2);
+	float det = dot(e1, p); // > 0 if the triangle is front facing
+	if (_cullBackface ? (det < kEpsilon) : (fabs(det) < kEpsilon)) {
+		return false;
+	}
+	float rcpDet = 1.0f / det;
+	vec3 s = _ray.m_origin - _v0;
+	float u = dot(s, p) * rcpDet;
+	if (u < 0.0f || u > 1.0f) {
+		return false;
+	}
+	vec3 q = cross(s, e1);
+	float v = dot(_ray.m_direction, q) * rcpDet;
+	if (v < 0.0f || u + v > 1.0f) {
+		return false;
+	}
+	float t = dot(e2, q) * rcpDet;
+	if (t < 0.0f) { // triangle behind ray origin
+		return false;
+	}
+	t_ = t;
+	u_ = u;
+	v_ = v;
+	return true;
+}
+
 
 // Primitive-primitive intersection
 
@@ -1037,3 +1606,54 @@ bool frm::Intersects(const AlignedBox& _box, const Plane& _plane)
 
 	return false;
 }
+
+bool frm::Intersects(const OrientedBox& _box0, const OrientedBox& _box1)
+{
+ // see Ericson, Real-Time Collision Detection, 4.4.1
+	const float kEpsilon = 1e-6f; // counteract arithmetic errors when two edges are parallel
+
+ // express _box1 in the space of _box0
+	float R[3][3], absR[3][3];
+	for (int i = 0; i < 3; ++i) {
+		for (int j = 0; j < 3; ++j) {
+			R[i][j] = dot(_box0.m_basis[i], _box1.m_basis[j]);
+			absR[i][j] = fabs(R[i][j]) + kEpsilon;
+		}
+	}
+	vec3 tw = _box1.m_origin - _box0.m_origin;
+	vec3 t = vec3(dot(tw, _box0.m_basis[0]), dot(tw, _box0.m_basis[1]), dot(tw, _box0.m_basis[2]));
+	const vec3& e0 = _box0.m_halfExtents;
+	const vec3& e1 = _box1.m_halfExtents;
+
+ // _box0 axes
+	for (int i = 0; i < 3; ++i) {
+		float r0 = e0[i];
+		float r1 = e1[0] * absR[i][0] + e1[1] * absR[i][1] + e1[2] * absR[i][2];
+		if (fabs(t[i]) > r0 + r1) {
+			return false;
+		}
+	}
+ // _box1 axes
+	for (int i = 0; i < 3; ++i) {
+		float r0 = e0[0] * absR[0][i] + e0[1] * absR[1][i] + e0[2] * absR[2][i];
+		float r1 = e1[i];
+		if (fabs(t[0] * R[0][i] + t[1] * R[1][i] + t[2] * R[2][i]) > r0 + r1) {
+			return false;
+		}
+	}
+ // cross products of each pair of axes
+	for (int i = 0; i < 3; ++i) {
+		int i1 = (i + 1) % 3;
+		int i2 = (i + 2) % 3;
+		for (int j = 0; j < 3; ++j) {
+			int j1 = (j + 1) % 3;
+			int j2 = (j + 2) % 3;
+			float r0 = e0[i1] * absR[i2][j] + e0[i2] * absR[i1][j];
+			float r1 = e1[j1] * absR[i][j2] + e1[j2] * absR[i][j1];
+			if (fabs(t[i2] * R[i1][j] - t[i1] * R[i2][j]) > r0 + r1) {
+				return false;
+			}
+		}
+	}
+	return true;
+}
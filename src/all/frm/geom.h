@@ -69,6 +69,10 @@ struct Sphere
 	Sphere() {}
 	Sphere(const vec3& _origin, float _radius);
 	Sphere(const AlignedBox& _box);
+	// Bound _count points (_stride in bytes). The default is EPOS-14 (the exact sphere of the extremal points along 7
+	// directions) followed by a Ritter growing pass, typically within a few % of optimal. If _exact, use Welzl's
+	// algorithm (slower, allocates).
+	Sphere(const vec3* _points, uint _count, uint _stride = sizeof(vec3), bool _exact = false);
 
 	void transform(const mat4& _mat);
 	
@@ -128,6 +132,37 @@ struct AlignedBox
 }; // struct AlignedBox
 
 
+////////////////////////////////////////////////////////////////////////////////
+// OrientedBox
+// Box with an arbitrary orientation. The columns of m_basis are the box axes
+// (orthonormal), m_halfExtents are the extents along each axis.
+////////////////////////////////////////////////////////////////////////////////
+struct OrientedBox
+{
+	vec3 m_origin;
+	vec3 m_halfExtents;
+	mat3 m_basis;
+
+	OrientedBox() {}
+	OrientedBox(const vec3& _origin, const vec3& _halfExtents, const mat3& _basis);
+	OrientedBox(const AlignedBox& _box);
+
+	// Fit to _count points using the principal axes of the point covariance. _stride is the offset between
+	// points in bytes (e.g. the vertex size for interleaved vertex data). If the aligned box is smaller it is
+	// returned instead.
+	OrientedBox(const vec3* _points, uint _count, uint _stride = sizeof(vec3));
+
+	// Non-uniform scaling is only exact if the scale axes are aligned with the box axes.
+	void  transform(const mat4& _mat);
+	vec3  getOrigin() const;
+	float getVolume() const;
+
+	// Generate 8 vertices, write to out_.
+	void  getVertices(vec3* out_) const;
+
+}; // struct OrientedBox
+
+
 ////////////////////////////////////////////////////////////////////////////////
 // Cylinder
 ////////////////////////////////////////////////////////////////////////////////
@@ -224,9 +259,19 @@ struct Frustum
 
 	bool inside(const Sphere& _sphere) const;
 	bool inside(const AlignedBox& _box) const;
+	// Only test planes whose bit is set in planeMask_ and clear the bits for planes which fully contain _box
+	// (for hierarchical culling, children of a node which is fully inside a plane needn't test that plane).
+	bool inside(const AlignedBox& _box, uint32& planeMask_) const;
+	bool inside(const OrientedBox& _box) const;
 	
 	bool insideIgnoreNear(const Sphere& _sphere) const;
 
+	// Batch cull _count spheres stored as separate center/radius arrays. Bit i of visibleMask_ is set if
+	// sphere i is inside, else cleared; visibleMask_ must have space for (_count + 31) / 32 words.
+	void cull(const float* _cx, const float* _cy, const float* _cz, const float* _r, int _count, uint32* visibleMask_) const;
+	// Batch cull _count boxes stored as separate min/max arrays. Output as above.
+	void cull(const float* _minX, const float* _minY, const float* _minZ, const float* _maxX, const float* _maxY, const float* _maxZ, int _count, uint32* visibleMask_) const;
+
 	void setVertices(const vec3 _vertices[8]);
 
 private:
@@ -287,6 +332,8 @@ bool Intersects(const Ray& _ray, const Sphere& _sphere);
 bool Intersect (const Ray& _ray, const Sphere& _sphere, float& t0_, float& t1_);
 bool Intersects(const Ray& _ray, const AlignedBox& _box);
 bool Intersect (const Ray& _ray, const AlignedBox& _box, float& t0_, float& t1_);
+bool Intersects(const Ray& _ray, const OrientedBox& _box);
+bool Intersect (const Ray& _ray, const OrientedBox& _box, float& t0_, float& t1_);
 bool Intersects(const Ray& _ray, const Plane& _plane);
 bool Intersect (const Ray& _ray, const Plane& _plane, float& t0_);
 bool Intersects(const Ray& _ray, const Capsule& _capsule);
@@ -294,12 +341,20 @@ bool Intersect (const Ray& _ray, const Capsule& _capsule, float& t0_, float& t1_
 bool Intersects(const Ray& _ray, const Cylinder& _cylinder);
 bool Intersect (const Ray& _ray, const Cylinder& _cylinder, float& t0_, float& t1_);
 
+// Ray-triangle intersection (Moller-Trumbore). t_ returns the distance along the ray, u_/v_ the barycentrics
+// of the hit point such that p = _v0 * (1 - u_ - v_) + _v1 * u_ + _v2 * v_. If _cullBackface, triangles which
+// appear clockwise from the ray origin are ignored.
+bool Intersects(const Ray& _ray, const vec3& _v0, const vec3& _v1, const vec3& _v2, bool _cullBackface = false);
+bool Intersect (const Ray& _ray, const vec3& _v0, const vec3& _v1, const vec3& _v2, float& t_, float& u_, float& v_, bool _cullBackface = false);
+
 // Primitive-primitive intersection.
 bool Intersects(const Sphere& _sphere0, const Sphere& _sphere1);
 bool Intersects(const Sphere& _sphere, const Plane& _plane);
 bool Intersects(const Sphere& _sphere,  const AlignedBox& _box);
 bool Intersects(const AlignedBox& _box0, const AlignedBox& _box1);
 bool Intersects(const AlignedBox& _box, const Plane& _plane);
+// Separating axis test.
+bool Intersects(const OrientedBox& _box0, const OrientedBox& _box1);
 
 
 } // namespace frm
@@ -2,19 +2,27 @@
 
 #include <frm/interpolation.h>
 #include <frm/gl.h>
+#include <frm/AabbTree.h>
 #include <frm/AppSample3d.h>
 #include <frm/Buffer.h>
+#include <frm/Bvh.h>
 #include <frm/Curve.h>
 #include <frm/Framebuffer.h>
 #include <frm/GlContext.h>
 #include <frm/Input.h>
+#include <frm/JobSystem.h>
 #include <frm/Mesh.h>
 #include <frm/MeshData.h>
+#include <frm/OcclusionBuffer.h>
 #include <frm/Profiler.h>
 #include <frm/Property.h>
+#include <frm/RayPacket.h>
+#include <frm/SceneStreamer.h>
 #include <frm/Shader.h>
 #include <frm/SkeletonAnimation.h>
+#include <frm/SpatialHash.h>
 #include <frm/Spline.h>
+#include <frm/SweepAndPrune.h>
 #include <frm/Texture.h>
 #include <frm/Window.h>
 #include <frm/XForm.h>
@@ -27,6 +35,7 @@
 #include <imgui/imgui.h>
 #include <imgui/imgui_ext.h>
 
+#include <EASTL/utility.h>
 #include <EASTL/vector.h>
 
 using namespace frm;
@@ -337,6 +346,1533 @@ public:
 
 			ImGui::TreePop();
 		}
+
+		//ImGui::SetNextTreeNodeOpen(true, ImGuiCond_Once);
+		if (ImGui::TreeNode("Frustum Cull")) {
+			static int   objectCount = 50000;
+			static float volumeSize  = 200.0f;
+			static bool  useBoxes    = false;
+			static eastl::vector<float>  cx, cy, cz, r;
+			static eastl::vector<float>  minX, minY, minZ, maxX, maxY, maxZ;
+			static eastl::vector<uint32> visibleMask;
+			bool regen = cx.empty();
+			regen |= ImGui::SliderInt("Object Count", &objectCount, 1, 200000);
+			regen |= ImGui::SliderFloat("Volume Size", &volumeSize, 1.0f, 1000.0f);
+			ImGui::Checkbox("Boxes", &useBoxes);
+			if (regen) {
+				eastl::vector<float>* arrays[] = { &cx, &cy, &cz, &r, &minX, &minY, &minZ, &maxX, &maxY, &maxZ };
+				for (auto v : arrays) {
+					v->resize(objectCount);
+				}
+				visibleMask.resize((objectCount + 31) / 32);
+				for (int i = 0; i < objectCount; ++i) {
+					vec3 p = (vec3((float)rand(), (float)rand(), (float)rand()) / (float)RAND_MAX - 0.5f) * volumeSize;
+					vec3 e = vec3((float)rand(), (float)rand(), (float)rand()) / (float)RAND_MAX * 2.0f + 0.1f;
+					cx[i] = p.x; cy[i] = p.y; cz[i] = p.z;
+					r[i] = length(e);
+					minX[i] = p.x - e.x; minY[i] = p.y - e.y; minZ[i] = p.z - e.z;
+					maxX[i] = p.x + e.x; maxY[i] = p.y + e.y; maxZ[i] = p.z + e.z;
+				}
+			}
+
+			const Frustum& frustum = Scene::GetCullCamera()->m_worldFrustum;
+			int visibleScalar = 0;
+			Timestamp t = Time::GetTimestamp();
+			if (useBoxes) {
+				for (int i = 0; i < objectCount; ++i) {
+					visibleScalar += frustum.inside(AlignedBox(vec3(minX[i], minY[i], minZ[i]), vec3(maxX[i], maxY[i], maxZ[i]))) ? 1 : 0;
+				}
+			} else {
+				for (int i = 0; i < objectCount; ++i) {
+					visibleScalar += frustum.inside(Sphere(vec3(cx[i], cy[i], cz[i]), r[i])) ? 1 : 0;
+				}
+			}
+			double scalarUs = (Time::GetTimestamp() - t).asMicroseconds();
+			
+			t = Time::GetTimestamp();
+			if (useBoxes) {
+				frustum.cull(minX.data(), minY.data(), minZ.data(), maxX.data(), maxY.data(), maxZ.data(), objectCount, visibleMask.data());
+			} else {
+				frustum.cull(cx.data(), cy.data(), cz.data(), r.data(), objectCount, visibleMask.data());
+			}
+			double batchUs = (Time::GetTimestamp() - t).asMicroseconds();
+			int visibleBatch = 0;
+			for (uint32 word : visibleMask) {
+				for (; word != 0; word &= word - 1) {
+					++visibleBatch;
+				}
+			}
+
+			ImGui::Text("Per object: %.3fms (%d visible)", (float)(scalarUs / 1000.0), visibleScalar);
+			ImGui::Text("Batch:      %.3fms (%d visible)", (float)(batchUs / 1000.0), visibleBatch);
+			ImGui::Text("Speedup:    %.2fx", (float)(scalarUs / APT_MAX(batchUs, 1e-3)));
+
+			ImGui::TreePop();
+		}
+
+		//ImGui::SetNextTreeNodeOpen(true, ImGuiCond_Once);
+		if (ImGui::TreeNode("Bvh")) {
+			static int    boxCount    = 100000;
+			static int    maxLeafSize = 4;
+			static int    rayCount    = 1000;
+			static float  volumeSize  = 200.0f;
+			static Bvh    bvh;
+			static double buildMs     = 0.0;
+			static eastl::vector<AlignedBox> boxes;
+			bool rebuild = boxes.empty();
+			rebuild |= ImGui::SliderInt("Box Count", &boxCount, 1, 1000000);
+			rebuild |= ImGui::SliderInt("Max Leaf Size", &maxLeafSize, 1, 16);
+			rebuild |= ImGui::Button("Rebuild");
+			ImGui::SliderInt("Ray Count", &rayCount, 1, 10000);
+			if (rebuild) {
+				boxes.resize(boxCount);
+				for (auto& box : boxes) {
+					vec3 p = (vec3((float)rand(), (float)rand(), (float)rand()) / (float)RAND_MAX - 0.5f) * volumeSize;
+					vec3 e = vec3((float)rand(), (float)rand(), (float)rand()) / (float)RAND_MAX + 0.1f;
+					box = AlignedBox(p - e, p + e);
+				}
+				Timestamp t = Time::GetTimestamp();
+				bvh.build(boxes.data(), (uint32)boxes.size(), (uint32)maxLeafSize);
+				buildMs = (Time::GetTimestamp() - t).asMilliseconds();
+			}
+			ImGui::Text("Build:    %.2fms (%u nodes, depth %d)", (float)buildMs, bvh.getNodeCount(), bvh.getDepth());
+
+		 // random rays from the cull camera position
+			vec3 origin = Scene::GetCullCamera()->getPosition();
+			eastl::vector<Ray> rays(rayCount);
+			for (auto& ray : rays) {
+				vec3 d = vec3((float)rand(), (float)rand(), (float)rand()) / (float)RAND_MAX - 0.5f;
+				ray = Ray(origin, normalize(d));
+			}
+			int hitCount = 0;
+			Timestamp t = Time::GetTimestamp();
+			for (auto& ray : rays) {
+				uint32 index;
+				float tnear;
+				hitCount += bvh.findClosest(ray, index, tnear) ? 1 : 0;
+			}
+			double closestUs = (Time::GetTimestamp() - t).asMicroseconds();
+			t = Time::GetTimestamp();
+			for (auto& ray : rays) {
+				hitCount -= bvh.findAny(ray) ? 1 : 0;
+			}
+			double anyUs = (Time::GetTimestamp() - t).asMicroseconds();
+			ImGui::Text("Closest:  %.3fus/ray", (float)(closestUs / rayCount));
+			ImGui::Text("Any:      %.3fus/ray", (float)(anyUs / rayCount));
+			if (hitCount != 0) {
+				ImGui::TextColored(ImColor(1.0f, 0.0f, 0.0f), "Closest/any hit count mismatch");
+			}
+
+			static bool bruteForce = false;
+			ImGui::Checkbox("Brute Force", &bruteForce);
+			if (bruteForce) {
+				t = Time::GetTimestamp();
+				for (auto& ray : rays) {
+					float tnear = FLT_MAX;
+					for (auto& box : boxes) {
+						float t0, t1;
+						if (Intersect(ray, box, t0, t1)) {
+							tnear = APT_MIN(tnear, t0);
+						}
+					}
+				}
+				double bruteUs = (Time::GetTimestamp() - t).asMicroseconds();
+				ImGui::Text("Brute:    %.3fus/ray", (float)(bruteUs / rayCount));
+			}
+
+			eastl::vector<uint32> results;
+			results.reserve(boxes.size());
+			t = Time::GetTimestamp();
+			bvh.findInside(Scene::GetCullCamera()->m_worldFrustum, results);
+			double frustumUs = (Time::GetTimestamp() - t).asMicroseconds();
+			ImGui::Text("Frustum:  %.3fms (%u inside)", (float)(frustumUs / 1000.0), (uint32)results.size());
+			results.clear();
+			t = Time::GetTimestamp();
+			bvh.findIntersecting(AlignedBox(origin - vec3(10.0f), origin + vec3(10.0f)), results);
+			double boxUs = (Time::GetTimestamp() - t).asMicroseconds();
+			ImGui::Text("Box:      %.3fus (%u intersecting)", (float)boxUs, (uint32)results.size());
+
+			ImGui::TreePop();
+		}
+
+		//ImGui::SetNextTreeNodeOpen(true, ImGuiCond_Once);
+		if (ImGui::TreeNode("Ray Packets")) {
+			static int   rayCount   = 4096;
+			static int   primCount  = 256;
+			static float coneAngle  = 10.0f;
+			static bool  useSpheres = false;
+			ImGui::SliderInt("Ray Count", &rayCount, 8, 65536);
+			ImGui::SliderInt("Prim Count", &primCount, 1, 1024);
+			ImGui::SliderFloat("Cone Angle", &coneAngle, 0.0f, 90.0f);
+			ImGui::Checkbox("Spheres", &useSpheres);
+			rayCount &= ~7;
+
+		 // coherent rays within a cone around the cull camera view vector
+			const Camera* camera = Scene::GetCullCamera();
+			eastl::vector<Ray> rays(rayCount);
+			for (auto& ray : rays) {
+				vec3 jitter = (vec3((float)rand(), (float)rand(), (float)rand()) / (float)RAND_MAX - 0.5f) * tanf(Radians(coneAngle));
+				ray = Ray(camera->getPosition(), normalize(camera->getViewVector() + jitter));
+			}
+			eastl::vector<RayPacket4> packets4(rayCount / 4);
+			eastl::vector<RayPacket8> packets8(rayCount / 8);
+			for (int i = 0; i < rayCount; ++i) {
+				packets4[i / 4].set(i % 4, rays[i]);
+				packets8[i / 8].set(i % 8, rays[i]);
+			}
+			eastl::vector<AlignedBox> boxes(primCount);
+			eastl::vector<Sphere> spheres(primCount);
+			for (int i = 0; i < primCount; ++i) {
+				vec3 p = camera->getPosition() + camera->getViewVector() * 50.0f + (vec3((float)rand(), (float)rand(), (float)rand()) / (float)RAND_MAX - 0.5f) * 50.0f;
+				boxes[i]   = AlignedBox(p - vec3(1.0f), p + vec3(1.0f));
+				spheres[i] = Sphere(p, 1.0f);
+			}
+
+			int hitCount[3] = {};
+			float t0[8], t1[8];
+			Timestamp t = Time::GetTimestamp();
+			for (auto& ray : rays) {
+				for (int i = 0; i < primCount; ++i) {
+					hitCount[0] += (useSpheres ? Intersect(ray, spheres[i], t0[0], t1[0]) : Intersect(ray, boxes[i], t0[0], t1[0])) ? 1 : 0;
+				}
+			}
+			double scalarUs = (Time::GetTimestamp() - t).asMicroseconds();
+			t = Time::GetTimestamp();
+			for (auto& packet : packets4) {
+				for (int i = 0; i < primCount; ++i) {
+					uint32 mask = useSpheres ? Intersect(packet, spheres[i], t0, t1) : Intersect(packet, boxes[i], t0, t1);
+					for (; mask != 0; mask &= mask - 1) {
+						++hitCount[1];
+					}
+				}
+			}
+			double packet4Us = (Time::GetTimestamp() - t).asMicroseconds();
+			t = Time::GetTimestamp();
+			for (auto& packet : packets8) {
+				for (int i = 0; i < primCount; ++i) {
+					uint32 mask = useSpheres ? Intersect(packet, spheres[i], t0, t1) : Intersect(packet, boxes[i], t0, t1);
+					for (; mask != 0; mask &= mask - 1) {
+						++hitCount[2];
+					}
+				}
+			}
+			double packet8Us = (Time::GetTimestamp() - t).asMicroseconds();
+
+			double testCount = (double)rayCount * (double)primCount;
+			ImGui::Text("Scalar:   %.2f Mtests/s (%d hits)", (float)(testCount / scalarUs),  hitCount[0]);
+			ImGui::Text("Packet4:  %.2f Mtests/s (%d hits)", (float)(testCount / packet4Us), hitCount[1]);
+			ImGui::Text("Packet8:  %.2f Mtests/s (%d hits)", (float)(testCount / packet8Us), hitCount[2]);
+
+			ImGui::TreePop();
+		}
+
+		//ImGui::SetNextTreeNodeOpen(true, ImGuiCond_Once);
+		if (ImGui::TreeNode("Mesh Picking")) {
+			static MeshData* meshData = nullptr;
+			static double    buildMs  = 0.0;
+			APT_ONCE {
+				meshData = MeshData::Create("models/teapot.obj");
+				if (meshData) {
+					Timestamp t = Time::GetTimestamp();
+					meshData->buildTriangleBvh();
+					buildMs = (Time::GetTimestamp() - t).asMilliseconds();
+				}
+			}
+			if (meshData) {
+				ImGui::Text("Build:    %.2fms (%u triangles, %u nodes)", (float)buildMs, meshData->getIndexCount() / 3, meshData->getTriangleBvh()->getNodeCount());
+
+				Ray ray = getCursorRayW();
+				MeshData::RayHit hit;
+				Timestamp t = Time::GetTimestamp();
+				bool isHit = Intersect(ray, *meshData, hit);
+				double pickUs = (Time::GetTimestamp() - t).asMicroseconds();
+				ImGui::Text("Pick:     %.3fus", (float)pickUs);
+				if (isHit) {
+					ImGui::Text("Triangle: %u (t = %.3f, uv = %.3f, %.3f)", hit.m_triangle, hit.m_t, hit.m_barycentrics.x, hit.m_barycentrics.y);
+					Im3d::PushDrawState();
+						Im3d::BeginPoints();
+							Im3d::Vertex(ray.m_origin + ray.m_direction * hit.m_t, 8.0f, Im3d::Color_Magenta);
+						Im3d::End();
+					Im3d::PopDrawState();
+				}
+			}
+
+			ImGui::TreePop();
+		}
+
+		//ImGui::SetNextTreeNodeOpen(true, ImGuiCond_Once);
+		if (ImGui::TreeNode("Aabb Tree")) {
+			static int    nodeCount  = 10000;
+			static float  volumeSize = 200.0f;
+			static float  speed      = 5.0f;
+			static bool   animate    = true;
+			static Scene  scene;
+			static eastl::vector<Node*> nodes;
+			static eastl::vector<vec3>  velocities;
+			bool rebuild = nodes.empty();
+			rebuild |= ImGui::SliderInt("Node Count", &nodeCount, 1, 100000);
+			ImGui::SliderFloat("Speed", &speed, 0.0f, 50.0f);
+			ImGui::Checkbox("Animate", &animate);
+			if (rebuild) {
+				while (!nodes.empty()) {
+					scene.destroyNode(nodes.back());
+					nodes.pop_back();
+				}
+				velocities.resize(nodeCount);
+				for (int i = 0; i < nodeCount; ++i) {
+					Node* node = scene.createNode(Node::Type_Object);
+					node->setDynamic(true);
+					node->setLocalPosition((vec3((float)rand(), (float)rand(), (float)rand()) / (float)RAND_MAX - 0.5f) * volumeSize);
+					vec3 e = vec3((float)rand(), (float)rand(), (float)rand()) / (float)RAND_MAX + 0.1f;
+					scene.setNodeBounds(node, AlignedBox(-e, e));
+					nodes.push_back(node);
+					velocities[i] = normalize(vec3((float)rand(), (float)rand(), (float)rand()) / (float)RAND_MAX - 0.5f);
+				}
+			}
+
+			if (animate) {
+				float dt = (float)getDeltaTime();
+				for (int i = 0; i < nodeCount; ++i) {
+					vec3 p = nodes[i]->getLocalPosition() + velocities[i] * speed * dt;
+					for (int j = 0; j < 3; ++j) {
+						if (fabs(p[j]) > volumeSize * 0.5f) {
+							velocities[i][j] = -velocities[i][j];
+						}
+					}
+					nodes[i]->setLocalPosition(p);
+				}
+			}
+			Timestamp t = Time::GetTimestamp();
+			scene.update((float)getDeltaTime());
+			double updateUs = (Time::GetTimestamp() - t).asMicroseconds();
+			const AabbTree& tree = scene.getAabbTree();
+			ImGui::Text("Update:   %.3fms (height %d, area ratio %.2f)", (float)(updateUs / 1000.0), tree.getHeight(), tree.getAreaRatio());
+
+			eastl::vector<Node*> results;
+			results.reserve(nodeCount);
+			const Frustum& frustum = Scene::GetCullCamera()->m_worldFrustum;
+			t = Time::GetTimestamp();
+			scene.findNodes(frustum, results);
+			double frustumUs = (Time::GetTimestamp() - t).asMicroseconds();
+			ImGui::Text("Frustum:  %.3fms (%u inside)", (float)(frustumUs / 1000.0), (uint32)results.size());
+
+			static bool bruteForce = false;
+			ImGui::Checkbox("Brute Force", &bruteForce);
+			if (bruteForce) {
+				uint32 insideCount = 0;
+				t = Time::GetTimestamp();
+				for (auto node : nodes) {
+					insideCount += frustum.inside(node->getWorldBounds()) ? 1 : 0;
+				}
+				double bruteUs = (Time::GetTimestamp() - t).asMicroseconds();
+				ImGui::Text("Brute:    %.3fms (%u inside)", (float)(bruteUs / 1000.0), insideCount);
+				if (insideCount != (uint32)results.size()) {
+					ImGui::TextColored(ImColor(1.0f, 0.0f, 0.0f), "Frustum result mismatch");
+				}
+			}
+
+			results.clear();
+			vec3 origin = Scene::GetCullCamera()->getPosition();
+			t = Time::GetTimestamp();
+			scene.findNodes(Sphere(origin, 10.0f), results);
+			double sphereUs = (Time::GetTimestamp() - t).asMicroseconds();
+			ImGui::Text("Sphere:   %.3fus (%u intersecting)", (float)sphereUs, (uint32)results.size());
+
+			Ray ray = getCursorRayW();
+			float tnear;
+			t = Time::GetTimestamp();
+			Node* picked = scene.findNode(ray, &tnear);
+			double rayUs = (Time::GetTimestamp() - t).asMicroseconds();
+			ImGui::Text("Ray:      %.3fus", (float)rayUs);
+			if (picked) {
+				ImGui::Text("Picked:   %s (t = %.3f)", picked->getName(), tnear);
+				Im3d::PushDrawState();
+					Im3d::SetColor(Im3d::Color_Magenta);
+					Im3d::DrawAlignedBox(picked->getWorldBounds().m_min, picked->getWorldBounds().m_max);
+				Im3d::PopDrawState();
+			}
+
+			ImGui::TreePop();
+		}
+
+		//ImGui::SetNextTreeNodeOpen(true, ImGuiCond_Once);
+		if (ImGui::TreeNode("Occlusion Culling")) {
+			static OcclusionBuffer occlusionBuffer;
+			static OcclusionBuffer::Occluder* boxOccluder    = nullptr;
+			static OcclusionBuffer::Occluder* teapotOccluder = nullptr;
+			static int   resolution[2] = { occlusionBuffer.getWidth(), occlusionBuffer.getHeight() };
+			static int   gridSize      = 32;
+			static bool  showBoxes     = false;
+			APT_ONCE {
+				MeshData* meshData = MeshData::Create("models/box.obj");
+				if (meshData) {
+					boxOccluder = new OcclusionBuffer::Occluder(*meshData);
+					MeshData::Destroy(meshData);
+				}
+				meshData = MeshData::Create("models/teapot.obj");
+				if (meshData) {
+					teapotOccluder = new OcclusionBuffer::Occluder(*meshData);
+					MeshData::Destroy(meshData);
+				}
+			}
+			if (ImGui::SliderInt2("Resolution", resolution, 16, 1024)) {
+				occlusionBuffer.setResolution(resolution[0], resolution[1]);
+			}
+			ImGui::SliderInt("Grid Size", &gridSize, 1, 128);
+			ImGui::Checkbox("Show Boxes", &showBoxes);
+
+			if (boxOccluder && teapotOccluder) {
+			 // occluders: a few walls plus a row of large teapots, occludees: a grid of teapots behind
+				eastl::vector<mat4> occluders;
+				for (int i = -2; i <= 2; ++i) {
+					occluders.push_back(TransformationMatrix(vec3(i * 24.0f, 4.0f, -20.0f), quat(1.0f, 0.0f, 0.0f, 0.0f), vec3(16.0f, 8.0f, 1.0f)));
+				}
+				eastl::vector<mat4> teapots;
+				for (int i = -2; i <= 2; ++i) {
+					teapots.push_back(TransformationMatrix(vec3(i * 24.0f + 12.0f, 0.0f, -24.0f), quat(1.0f, 0.0f, 0.0f, 0.0f), vec3(2.0f)));
+				}
+				eastl::vector<AlignedBox> occludees;
+				for (int z = 0; z < gridSize; ++z) {
+					for (int x = 0; x < gridSize; ++x) {
+						AlignedBox box = teapotOccluder->m_boundingBox;
+						box.transform(TranslationMatrix(vec3((x - gridSize / 2) * 4.0f, 0.0f, -30.0f - z * 4.0f)));
+						occludees.push_back(box);
+					}
+				}
+
+				Timestamp t = Time::GetTimestamp();
+				occlusionBuffer.begin(*Scene::GetCullCamera());
+				for (auto& world : occluders) {
+					occlusionBuffer.rasterize(*boxOccluder, world);
+				}
+				for (auto& world : teapots) {
+					occlusionBuffer.rasterize(*teapotOccluder, world);
+				}
+				double rasterUs = (Time::GetTimestamp() - t).asMicroseconds();
+				t = Time::GetTimestamp();
+				occlusionBuffer.end();
+				double pyramidUs = (Time::GetTimestamp() - t).asMicroseconds();
+				int occludedCount = 0;
+				t = Time::GetTimestamp();
+				eastl::vector<bool> occluded(occludees.size());
+				for (size_t i = 0; i < occludees.size(); ++i) {
+					occluded[i] = occlusionBuffer.isOccluded(occludees[i]);
+					occludedCount += occluded[i] ? 1 : 0;
+				}
+				double testUs = (Time::GetTimestamp() - t).asMicroseconds();
+
+				ImGui::Text("Rasterize: %.3fms (%u triangles)", (float)(rasterUs / 1000.0), occlusionBuffer.getTriangleCount());
+				ImGui::Text("Pyramid:   %.3fms (%d levels)", (float)(pyramidUs / 1000.0), occlusionBuffer.getLevelCount());
+				ImGui::Text("Test:      %.3fus/box (%d/%d occluded)", (float)(testUs / occludees.size()), occludedCount, (int)occludees.size());
+
+				if (showBoxes) {
+					Im3d::PushDrawState();
+						for (size_t i = 0; i < occludees.size(); ++i) {
+							Im3d::SetColor(occluded[i] ? Im3d::Color_Red : Im3d::Color_Green);
+							Im3d::DrawAlignedBox(occludees[i].m_min, occludees[i].m_max);
+						}
+						Im3d::SetColor(Im3d::Color_Yellow);
+						for (auto& world : occluders) {
+							AlignedBox box = boxOccluder->m_boundingBox;
+							box.transform(world);
+							Im3d::DrawAlignedBox(box.m_min, box.m_max);
+						}
+					Im3d::PopDrawState();
+				}
+			}
+
+			ImGui::TreePop();
+		}
+
+		//ImGui::SetNextTreeNodeOpen(true, ImGuiCond_Once);
+		if (ImGui::TreeNode("Oriented Box")) {
+		 // known answer checks
+			const float kEpsilon = 1e-3f;
+			const mat3 rotZ45 = GetRotation(RotationMatrix(vec3(0.0f, 0.0f, 1.0f), Radians(45.0f)));
+			const mat3 rotY45 = GetRotation(RotationMatrix(vec3(0.0f, 1.0f, 0.0f), Radians(45.0f)));
+			const OrientedBox unitBox(vec3(0.0f), vec3(1.0f), identity);
+			auto Check = [](const char* _name, bool _pass) {
+				ImGui::TextColored(_pass ? ImColor(0.0f, 1.0f, 0.0f) : ImColor(1.0f, 0.0f, 0.0f), "%s %s", _pass ? "PASS" : "FAIL", _name);
+			};
+
+		 // fit to the corners of a rotated box, the fit should recover the box
+			{	const OrientedBox src(vec3(3.0f, 0.0f, 0.0f), vec3(2.0f, 1.0f, 0.5f), GetRotation(RotationMatrix(vec3(0.0f, 0.0f, 1.0f), Radians(30.0f))));
+				vec3 corners[8];
+				src.getVertices(corners);
+				OrientedBox fit(corners, 8);
+				Check("Fit rotated box volume", fabs(fit.getVolume() - src.getVolume()) < kEpsilon);
+				Check("Fit rotated box origin", length(fit.getOrigin() - src.getOrigin()) < kEpsilon);
+			}
+			{	const OrientedBox src(vec3(0.0f), vec3(2.0f, 1.0f, 0.5f), identity);
+				vec3 corners[8];
+				src.getVertices(corners);
+				OrientedBox fit(corners, 8);
+				Check("Fit aligned box volume", fabs(fit.getVolume() - src.getVolume()) < kEpsilon);
+			}
+
+		 // SAT, B's extent along x is sqrt(2) when rotated 45 degrees about z
+			Check("SAT overlapping",         Intersects(unitBox, OrientedBox(vec3(1.5f, 0.0f, 0.0f), vec3(1.0f), identity)));
+			Check("SAT separated",          !Intersects(unitBox, OrientedBox(vec3(3.0f, 0.0f, 0.0f), vec3(1.0f), identity)));
+			Check("SAT rotated overlapping", Intersects(unitBox, OrientedBox(vec3(2.3f, 0.0f, 0.0f), vec3(1.0f), rotZ45)));
+			Check("SAT rotated separated",  !Intersects(unitBox, OrientedBox(vec3(2.5f, 0.0f, 0.0f), vec3(1.0f), rotZ45)));
+			Check("SAT contained",           Intersects(unitBox, OrientedBox(vec3(0.0f), vec3(0.5f), rotZ45)));
+
+		 // ray, hits the rotated box's corner at x = -sqrt(2)
+			{	const OrientedBox box(vec3(0.0f), vec3(1.0f), rotZ45);
+				float t0, t1;
+				bool hit = Intersect(Ray(vec3(-5.0f, 0.0f, 0.0f), vec3(1.0f, 0.0f, 0.0f)), box, t0, t1);
+				Check("Ray hit", hit && fabs(t0 - (5.0f - sqrtf(2.0f))) < kEpsilon && fabs(t1 - (5.0f + sqrtf(2.0f))) < kEpsilon);
+				Check("Ray miss (offset)",  !Intersects(Ray(vec3(-5.0f, 1.5f, 0.0f), vec3(1.0f, 0.0f, 0.0f)), box));
+				Check("Ray miss (behind)",  !Intersects(Ray(vec3(-5.0f, 0.0f, 0.0f), vec3(-1.0f, 0.0f, 0.0f)), box));
+			}
+
+		 // frustum (up/down/right/left tan), 90 degree fov looking down -z; the box at x = 11.8 straddles the right plane unless rotated to align with it
+			{	const Frustum frustum(1.0f, -1.0f, 1.0f, -1.0f, 1.0f, 100.0f, false);
+				Check("Frustum inside",           frustum.inside(OrientedBox(vec3(0.0f, 0.0f, -10.0f), vec3(1.0f), rotZ45)));
+				Check("Frustum behind",          !frustum.inside(OrientedBox(vec3(0.0f, 0.0f,  10.0f), vec3(1.0f), rotZ45)));
+				Check("Frustum straddling",       frustum.inside(OrientedBox(vec3(11.8f, 0.0f, -10.0f), vec3(1.0f), identity)));
+				Check("Frustum rotated outside", !frustum.inside(OrientedBox(vec3(11.8f, 0.0f, -10.0f), vec3(1.0f), rotY45)));
+			}
+
+			ImGui::TreePop();
+		}
+
+		//ImGui::SetNextTreeNodeOpen(true, ImGuiCond_Once);
+		if (ImGui::TreeNode("Bounding Spheres")) {
+			static const char* kModels[] = { "models/box.obj", "models/teapot.obj" };
+			static eastl::vector<vec3> positions[APT_ARRAY_COUNT(kModels)];
+			static int  instanceCount = 10000;
+			static bool showSpheres   = false;
+			APT_ONCE {
+				for (int i = 0; i < (int)APT_ARRAY_COUNT(kModels); ++i) {
+					MeshData* meshData = MeshData::Create(kModels[i]);
+					if (!meshData) {
+						continue;
+					}
+					const MeshDesc& desc = meshData->getDesc();
+					const VertexAttr* posAttr = desc.findVertexAttr(VertexAttr::Semantic_Positions);
+					positions[i].resize(meshData->getVertexCount(), vec3(0.0f));
+					const char* src = (const char*)meshData->getVertexData() + posAttr->getOffset();
+					for (auto& p : positions[i]) {
+						DataTypeConvert(posAttr->getDataType(), DataType_Float32, src, &p, APT_MIN((uint)posAttr->getCount(), 3u));
+						src += desc.getVertexSize();
+					}
+					MeshData::Destroy(meshData);
+				}
+			}
+			ImGui::SliderInt("Instance Count", &instanceCount, 1, 100000);
+			ImGui::Checkbox("Show Spheres", &showSpheres);
+
+			const Frustum& frustum = Scene::GetCullCamera()->m_worldFrustum;
+			for (int i = 0; i < (int)APT_ARRAY_COUNT(kModels); ++i) {
+				const eastl::vector<vec3>& points = positions[i];
+				if (points.empty()) {
+					continue;
+				}
+				AlignedBox box(vec3(FLT_MAX), vec3(-FLT_MAX));
+				for (auto& p : points) {
+					box.m_min = min(box.m_min, p);
+					box.m_max = max(box.m_max, p);
+				}
+				Sphere boxSphere(box);
+				Timestamp t = Time::GetTimestamp();
+				Sphere eposSphere(points.data(), (uint)points.size());
+				double eposUs = (Time::GetTimestamp() - t).asMicroseconds();
+				t = Time::GetTimestamp();
+				Sphere exactSphere(points.data(), (uint)points.size(), sizeof(vec3), true);
+				double exactUs = (Time::GetTimestamp() - t).asMicroseconds();
+
+			 // scatter instances in front of the cull camera, count the number which pass the frustum test
+				srand(i);
+				int insideCount[3] = {};
+				const Sphere* spheres[3] = { &boxSphere, &eposSphere, &exactSphere };
+				for (int j = 0; j < instanceCount; ++j) {
+					vec3 p = (vec3((float)rand(), (float)rand(), (float)rand()) / (float)RAND_MAX - 0.5f) * vec3(400.0f, 100.0f, 400.0f);
+					vec3 axis = normalize(vec3((float)rand(), (float)rand(), (float)rand()) / (float)RAND_MAX - 0.5f + vec3(1e-4f));
+					float angle = (float)rand() / (float)RAND_MAX * 2.0f * kPi;
+					float scale = 1.0f + (float)rand() / (float)RAND_MAX * 4.0f;
+					mat4 world = TransformationMatrix(p, RotationQuaternion(axis, angle), vec3(scale));
+					for (int k = 0; k < 3; ++k) {
+						Sphere sphere = *spheres[k];
+						sphere.transform(world);
+						insideCount[k] += frustum.inside(sphere) ? 1 : 0;
+					}
+				}
+
+				float boxVolume = boxSphere.m_radius * boxSphere.m_radius * boxSphere.m_radius;
+				ImGui::Text("%s (%u vertices):", kModels[i], (uint32)points.size());
+				ImGui::Text("   Box:   r = %.3f                        %d inside", boxSphere.m_radius, insideCount[0]);
+				ImGui::Text("   EPOS:  r = %.3f (volume %.1f%%) %8.3fus %d inside", eposSphere.m_radius, eposSphere.m_radius * eposSphere.m_radius * eposSphere.m_radius / boxVolume * 100.0f, (float)eposUs, insideCount[1]);
+				ImGui::Text("   Exact: r = %.3f (volume %.1f%%) %8.3fus %d inside", exactSphere.m_radius, exactSphere.m_radius * exactSphere.m_radius * exactSphere.m_radius / boxVolume * 100.0f, (float)exactUs, insideCount[2]);
+
+				if (showSpheres) {
+					Im3d::PushDrawState();
+						Im3d::PushMatrix(TranslationMatrix(vec3(i * 4.0f, 0.0f, 0.0f)));
+						Im3d::SetColor(Im3d::Color_Red);
+						Im3d::DrawSphere(boxSphere.m_origin, boxSphere.m_radius);
+						Im3d::SetColor(Im3d::Color_Green);
+						Im3d::DrawSphere(eposSphere.m_origin, eposSphere.m_radius);
+						Im3d::SetColor(Im3d::Color_Yellow);
+						Im3d::DrawAlignedBox(box.m_min, box.m_max);
+						Im3d::PopMatrix();
+					Im3d::PopDrawState();
+				}
+			}
+
+			ImGui::TreePop();
+		}
+
+		//ImGui::SetNextTreeNodeOpen(true, ImGuiCond_Once);
+		if (ImGui::TreeNode("Sweep and Prune")) {
+			static int    boxCount   = 10000;
+			static float  volumeSize = 200.0f;
+			static float  speed      = 5.0f;
+			static bool   animate    = true;
+			static bool   bruteForce = false;
+			static bool   showPairs  = false;
+			static SweepAndPrune sap;
+			static eastl::vector<SweepAndPrune::ProxyId> ids;
+			static eastl::vector<AlignedBox> boxes;
+			static eastl::vector<vec3> velocities;
+			static eastl::vector<SweepAndPrune::Pair> pairs;
+			bool rebuild = ids.empty();
+			rebuild |= ImGui::SliderInt("Box Count", &boxCount, 2, 100000);
+			ImGui::SliderFloat("Speed", &speed, 0.0f, 50.0f);
+			ImGui::Checkbox("Animate", &animate);
+			ImGui::Checkbox("Brute Force", &bruteForce);
+			ImGui::Checkbox("Show Pairs", &showPairs);
+			if (rebuild) {
+				sap.clear();
+				ids.clear();
+				boxes.resize(boxCount);
+				velocities.resize(boxCount);
+				for (int i = 0; i < boxCount; ++i) {
+					vec3 p = (vec3((float)rand(), (float)rand(), (float)rand()) / (float)RAND_MAX - 0.5f) * volumeSize;
+					vec3 e = vec3((float)rand(), (float)rand(), (float)rand()) / (float)RAND_MAX + 0.1f;
+					boxes[i] = AlignedBox(p - e, p + e);
+					velocities[i] = normalize(vec3((float)rand(), (float)rand(), (float)rand()) / (float)RAND_MAX - 0.5f);
+					ids.push_back(sap.insert(boxes[i], nullptr));
+				}
+			}
+
+			if (animate) {
+				float dt = (float)getDeltaTime();
+				for (int i = 0; i < boxCount; ++i) {
+					vec3 d = velocities[i] * speed * dt;
+					vec3 p = boxes[i].getOrigin() + d;
+					for (int j = 0; j < 3; ++j) {
+						if (fabs(p[j]) > volumeSize * 0.5f) {
+							velocities[i][j] = -velocities[i][j];
+						}
+					}
+					boxes[i].m_min += d;
+					boxes[i].m_max += d;
+					sap.move(ids[i], boxes[i]);
+				}
+			}
+
+			Timestamp t = Time::GetTimestamp();
+			sap.update();
+			double updateUs = (Time::GetTimestamp() - t).asMicroseconds();
+			pairs.clear();
+			t = Time::GetTimestamp();
+			sap.sweep(0, sap.getSortedCount(), pairs);
+			double sweepUs = (Time::GetTimestamp() - t).asMicroseconds();
+			ImGui::Text("Update:   %.3fms (axis %d, %u swaps)", (float)(updateUs / 1000.0), sap.getSweepAxis(), sap.getSwapCount());
+			ImGui::Text("Sweep:    %.3fms (%u pairs)", (float)(sweepUs / 1000.0), (uint32)pairs.size());
+
+			if (bruteForce) {
+				uint32 pairCount = 0;
+				t = Time::GetTimestamp();
+				for (int i = 0; i < boxCount; ++i) {
+					for (int j = i + 1; j < boxCount; ++j) {
+						pairCount += Intersects(boxes[i], boxes[j]) ? 1 : 0;
+					}
+				}
+				double bruteUs = (Time::GetTimestamp() - t).asMicroseconds();
+				ImGui::Text("Brute:    %.3fms (%u pairs)", (float)(bruteUs / 1000.0), pairCount);
+				if (pairCount != (uint32)pairs.size()) {
+					ImGui::TextColored(ImColor(1.0f, 0.0f, 0.0f), "Pair count mismatch");
+				}
+			}
+
+			if (showPairs) {
+				Im3d::PushDrawState();
+					Im3d::SetColor(Im3d::Color_Red);
+					for (auto& pair : pairs) {
+						const AlignedBox& a = sap.getBox(pair.m_a);
+						const AlignedBox& b = sap.getBox(pair.m_b);
+						Im3d::DrawAlignedBox(a.m_min, a.m_max);
+						Im3d::DrawAlignedBox(b.m_min, b.m_max);
+					}
+				Im3d::PopDrawState();
+			}
+
+			ImGui::TreePop();
+		}
+
+		//ImGui::SetNextTreeNodeOpen(true, ImGuiCond_Once);
+		if (ImGui::TreeNode("Spatial Hash")) {
+			static int    entryCount  = 1000000;
+			static float  volumeSize  = 1000.0f;
+			static float  cellSize    = 4.0f;
+			static float  queryRadius = 10.0f;
+			static float  speed       = 5.0f;
+			static bool   animate     = false;
+			static bool   bruteForce  = false;
+			static double insertMs    = 0.0;
+			static SpatialHash* hash  = nullptr;
+			static eastl::vector<SpatialHash::EntryId> ids;
+			static eastl::vector<Sphere> spheres;
+			bool rebuild = hash == nullptr;
+			rebuild |= ImGui::SliderInt("Entry Count", &entryCount, 1, 2000000);
+			rebuild |= ImGui::SliderFloat("Cell Size", &cellSize, 0.5f, 64.0f);
+			ImGui::SliderFloat("Query Radius", &queryRadius, 0.0f, 100.0f);
+			ImGui::SliderFloat("Speed", &speed, 0.0f, 50.0f);
+			ImGui::Checkbox("Animate", &animate);
+			ImGui::Checkbox("Brute Force", &bruteForce);
+			if (rebuild) {
+				delete hash;
+				hash = new SpatialHash(cellSize, (uint32)entryCount);
+				ids.clear();
+				spheres.resize(entryCount);
+				Timestamp t = Time::GetTimestamp();
+				for (int i = 0; i < entryCount; ++i) {
+					vec3 p = (vec3((float)rand(), (float)rand(), (float)rand()) / (float)RAND_MAX - 0.5f) * volumeSize;
+					spheres[i] = Sphere(p, (float)rand() / (float)RAND_MAX);
+					ids.push_back(hash->insert(spheres[i], nullptr));
+				}
+				insertMs = (Time::GetTimestamp() - t).asMilliseconds();
+			}
+
+			if (animate) {
+				float dt = (float)getDeltaTime();
+				Timestamp t = Time::GetTimestamp();
+				for (int i = 0; i < entryCount; ++i) {
+					vec3 d = vec3((float)rand(), (float)rand(), (float)rand()) / (float)RAND_MAX - 0.5f;
+					spheres[i].m_origin += d * speed * dt;
+					hash->move(ids[i], spheres[i]);
+				}
+				double moveUs = (Time::GetTimestamp() - t).asMicroseconds();
+				ImGui::Text("Move:     %.3fms", (float)(moveUs / 1000.0));
+			}
+			ImGui::Text("Insert:   %.3fms (%u cells, max radius %.3f)", (float)insertMs, hash->getCellCount(), hash->getMaxRadius());
+
+			Sphere query(Scene::GetCullCamera()->getPosition(), queryRadius);
+			uint32 sphereCount = 0;
+			Timestamp t = Time::GetTimestamp();
+			hash->findIntersecting(query, [&sphereCount](SpatialHash::EntryId) { ++sphereCount; });
+			double sphereUs = (Time::GetTimestamp() - t).asMicroseconds();
+			ImGui::Text("Sphere:   %.3fus (%u intersecting)", (float)sphereUs, sphereCount);
+
+			AlignedBox box(query.m_origin - vec3(queryRadius), query.m_origin + vec3(queryRadius));
+			uint32 boxCount = 0;
+			t = Time::GetTimestamp();
+			hash->findIntersecting(box, [&boxCount](SpatialHash::EntryId) { ++boxCount; });
+			double boxUs = (Time::GetTimestamp() - t).asMicroseconds();
+			ImGui::Text("Box:      %.3fus (%u intersecting)", (float)boxUs, boxCount);
+
+			if (bruteForce) {
+				uint32 bruteCount = 0;
+				t = Time::GetTimestamp();
+				for (auto& sphere : spheres) {
+					float r = sphere.m_radius + queryRadius;
+					bruteCount += length2(sphere.m_origin - query.m_origin) <= r * r ? 1 : 0;
+				}
+				double bruteUs = (Time::GetTimestamp() - t).asMicroseconds();
+				ImGui::Text("Brute:    %.3fms (%u intersecting)", (float)(bruteUs / 1000.0), bruteCount);
+			}
+
+			Im3d::PushDrawState();
+				Im3d::SetColor(Im3d::Color_Magenta);
+				Im3d::DrawSphere(query.m_origin, query.m_radius);
+			Im3d::PopDrawState();
+
+			ImGui::TreePop();
+		}
+
+		//ImGui::SetNextTreeNodeOpen(true, ImGuiCond_Once);
+		if (ImGui::TreeNode("Scene Update")) {
+			static const int kNodeCounts[] = { 10000, 100000, 1000000 };
+			static int    nodeCountIndex = 0;
+			static int    branching      = 4;
+			static int    rootChildren   = 256;
+			static bool   dynamic        = false;
+			static float  movingPercent  = 1.0f;
+			static bool   parallel       = true;
+			static bool   recursive      = false;
+			static bool   compareSerial  = false;
+			static Scene* scene          = nullptr;
+			static Scene* serialScene    = nullptr; // identical to scene, updated serially
+			static eastl::vector<Node*> nodes;
+			static eastl::vector<Node*> serialNodes;
+			static double flatMs         = 0.0;
+			static double recursiveMs    = 0.0;
+			static eastl::vector<mat4> flatWorldMatrices;
+			bool rebuild = scene == nullptr;
+			rebuild |= ImGui::Combo("Node Count", &nodeCountIndex, "10k\0100k\01M\0");
+			rebuild |= ImGui::SliderInt("Branching", &branching, 1, 16);
+			rebuild |= ImGui::SliderInt("Root Children", &rootChildren, 1, 1024); // = number of subtrees for the parallel update
+			rebuild |= ImGui::Checkbox("Dynamic", &dynamic);
+			ImGui::SliderFloat("Moving %", &movingPercent, 0.0f, 100.0f);
+			ImGui::Checkbox("Parallel", &parallel);
+			ImGui::Checkbox("Compare Recursive", &recursive); // note that the recursive update leaves all nodes dirty
+			rebuild |= ImGui::Checkbox("Compare Serial", &compareSerial);
+			if (rebuild) {
+				auto build = [](Scene*& scene_, eastl::vector<Node*>& nodes_) {
+					delete scene_;
+					scene_ = new Scene;
+					nodes_.clear();
+					nodes_.reserve(kNodeCounts[nodeCountIndex]);
+					for (int i = 0; i < kNodeCounts[nodeCountIndex]; ++i) {
+						Node* parent = i < rootChildren ? nullptr : nodes_[(i - rootChildren) / branching];
+						Node* node = scene_->createNode(Node::Type_Object, parent);
+						node->setDynamic(dynamic);
+						node->setLocalMatrix(TransformationMatrix(vec3((float)(i % branching), 1.0f, 0.0f), quat(1.0f, 0.0f, 0.0f, 0.0f), vec3(0.99f)));
+						nodes_.push_back(node);
+					}
+					scene_->update(0.0f); // build the flattened hierarchy
+				};
+				build(scene, nodes);
+				if (compareSerial) {
+					build(serialScene, serialNodes);
+				} else {
+					delete serialScene;
+					serialScene = nullptr;
+					serialNodes.clear();
+				}
+			}
+
+		 // move a random subset of the nodes (marks them dirty)
+			int movingCount = (int)(nodes.size() * movingPercent / 100.0f);
+			for (int i = 0; i < movingCount; ++i) {
+				int j = rand() % (int)nodes.size();
+				nodes[j]->setLocalPosition(nodes[j]->getLocalPosition() + vec3(0.0f, 0.0f, 1e-3f));
+				if (serialScene) {
+					serialNodes[j]->setLocalPosition(serialNodes[j]->getLocalPosition() + vec3(0.0f, 0.0f, 1e-3f));
+				}
+			}
+
+			float dt = (float)getDeltaTime();
+			scene->setParallelUpdate(parallel);
+			Timestamp t = Time::GetTimestamp();
+			scene->update(dt);
+			flatMs = flatMs * 0.9 + (Time::GetTimestamp() - t).asMilliseconds() * 0.1;
+			ImGui::Text("Flat:      %.3fms (%u changed)", (float)flatMs, (uint32)scene->getChangedNodes().size());
+			if (serialScene) {
+			 // the parallel update must produce the same world matrices as the serial update
+				serialScene->setParallelUpdate(false);
+				serialScene->update(dt);
+				APT_ASSERT(serialScene->getWorldMatrixCount() == scene->getWorldMatrixCount());
+				const mat4* worldMatrices = scene->getWorldMatrices();
+				const mat4* serialWorldMatrices = serialScene->getWorldMatrices();
+				uint32 mismatchCount = 0;
+				for (uint32 i = 0, n = scene->getWorldMatrixCount(); i < n; ++i) {
+					if (worldMatrices[i] != serialWorldMatrices[i]) {
+						++mismatchCount;
+					}
+				}
+				if (mismatchCount > 0) {
+					ImGui::TextColored(ImColor(1.0f, 0.0f, 0.0f), "Serial: %u world matrices differ from the %s update", mismatchCount, parallel ? "parallel" : "flat");
+				}
+			}
+			if (recursive) {
+				flatWorldMatrices.assign(scene->getWorldMatrices(), scene->getWorldMatrices() + scene->getWorldMatrixCount());
+				t = Time::GetTimestamp();
+				scene->updateRecursive(dt);
+				recursiveMs = recursiveMs * 0.9 + (Time::GetTimestamp() - t).asMilliseconds() * 0.1;
+				ImGui::Text("Recursive: %.3fms (%.2fx)", (float)recursiveMs, (float)(recursiveMs / APT_MAX(flatMs, 1e-6)));
+
+			 // the recursive update must produce the same world matrices as the flat update
+				uint32 mismatchCount = 0;
+				for (Node* node : nodes) {
+					if (node->getWorldMatrix() != flatWorldMatrices[node->getWorldMatrixIndex()]) {
+						++mismatchCount;
+					}
+				}
+				if (mismatchCount > 0) {
+					ImGui::TextColored(ImColor(1.0f, 0.0f, 0.0f), "Recursive: %u world matrices differ from the flat update", mismatchCount);
+				}
+			}
+
+			ImGui::TreePop();
+		}
+
+		//ImGui::SetNextTreeNodeOpen(true, ImGuiCond_Once);
+		if (ImGui::TreeNode("Job System")) {
+			static int    itemCount   = 1000000;
+			static int    grainSize   = 4096;
+			static int    iterations  = 16;
+			static double serialMs    = 0.0;
+			static double parallelMs  = 0.0;
+			static eastl::vector<float> data;
+			ImGui::Text("%d threads", JobSystem::GetThreadCount());
+			ImGui::SliderInt("Item Count", &itemCount, 1, 10000000);
+			ImGui::SliderInt("Grain Size", &grainSize, 1, 65536);
+			ImGui::SliderInt("Iterations", &iterations, 1, 64); // work per item
+			data.resize(itemCount);
+
+			auto work = [](uint32 _begin, uint32 _end) {
+				for (uint32 i = _begin; i < _end; ++i) {
+					float x = (float)i;
+					for (int j = 0; j < iterations; ++j) {
+						x = sqrtf(x + (float)j);
+					}
+					data[i] = x;
+				}
+			};
+
+			Timestamp t = Time::GetTimestamp();
+			work(0, (uint32)itemCount);
+			serialMs = serialMs * 0.9 + (Time::GetTimestamp() - t).asMilliseconds() * 0.1;
+
+			t = Time::GetTimestamp();
+			JobSystem::ParallelFor((uint32)itemCount, (uint32)grainSize, work);
+			parallelMs = parallelMs * 0.9 + (Time::GetTimestamp() - t).asMilliseconds() * 0.1;
+
+			ImGui::Text("Serial:   %.3fms", (float)serialMs);
+			ImGui::Text("Parallel: %.3fms (%.2fx)", (float)parallelMs, (float)(serialMs / APT_MAX(parallelMs, 1e-6)));
+
+			ImGui::TreePop();
+		}
+
+		//ImGui::SetNextTreeNodeOpen(true, ImGuiCond_Once);
+		if (ImGui::TreeNode("Scene Load")) {
+			static int    nodeCount     = 50000;
+			static int    branching     = 8;
+			static float  lookAtPercent = 1.0f;
+			static double saveMs        = 0.0;
+			static double loadMs        = 0.0;
+			static double resolveMs     = 0.0;
+			static double findIdMs      = 0.0;
+			static double findNameMs    = 0.0;
+			static Scene* scene         = nullptr;
+			static bool   binary        = false;
+			static int    roundTripErrors = -1; // -1 = not run
+			const char*   path          = binary ? "SceneLoadTest.scnb" : "SceneLoadTest.json";
+			ImGui::SliderInt("Node Count", &nodeCount, 1, 100000);
+			ImGui::SliderInt("Branching", &branching, 1, 16);
+			ImGui::SliderFloat("LookAt %", &lookAtPercent, 0.0f, 100.0f); // XForm_LookAt resolves its target via findNode() during the first update
+			ImGui::Checkbox("Binary", &binary);
+
+			if (ImGui::Button("Save")) {
+				Scene tmp;
+				tmp.setDrawCamera(tmp.createCamera(*Scene::GetDrawCamera()));
+				eastl::vector<Node*> nodes;
+				nodes.reserve(nodeCount);
+				for (int i = 0; i < nodeCount; ++i) {
+					Node* parent = i == 0 ? nullptr : nodes[(i - 1) / branching];
+					Node* node = tmp.createNode(Node::Type_Object, parent);
+					node->setNamef("Object_%06d", i);
+					node->setLocalMatrix(TransformationMatrix(vec3((float)(i % branching), 1.0f, 0.0f), RotationQuaternion(vec3(0.0f, 1.0f, 0.0f), (float)i * 0.1f), vec3(0.99f)));
+					nodes.push_back(node);
+				}
+				int lookAtCount = (int)(nodeCount * lookAtPercent / 100.0f);
+				for (int i = 0; i < lookAtCount; ++i) {
+					XForm_LookAt* lookAt = (XForm_LookAt*)XForm::Create("XForm_LookAt");
+					lookAt->m_targetId = nodes[rand() % nodeCount]->getId();
+					nodes[rand() % nodeCount]->addXForm(lookAt);
+				}
+				Timestamp t = Time::GetTimestamp();
+				Scene::Save(path, tmp);
+				saveMs = (Time::GetTimestamp() - t).asMilliseconds();
+			}
+			ImGui::SameLine();
+			if (ImGui::Button("Load")) {
+				delete scene;
+				scene = new Scene;
+				Timestamp t = Time::GetTimestamp();
+				Scene::Load(path, *scene);
+				loadMs = (Time::GetTimestamp() - t).asMilliseconds();
+
+				Scene* current = Scene::GetCurrent();
+				Scene::SetCurrent(scene);
+				t = Time::GetTimestamp();
+				scene->update(0.0f);
+				resolveMs = (Time::GetTimestamp() - t).asMilliseconds();
+				Scene::SetCurrent(current);
+
+				int count = scene->getNodeCount(Node::Type_Object);
+				t = Time::GetTimestamp();
+				for (int i = 0; i < count; ++i) {
+					APT_VERIFY(scene->findNode(scene->getNode(Node::Type_Object, i)->getId()));
+				}
+				findIdMs = (Time::GetTimestamp() - t).asMilliseconds();
+				t = Time::GetTimestamp();
+				for (int i = 0; i < count; ++i) {
+					APT_VERIFY(scene->findNode(scene->getNode(Node::Type_Object, i)->getName(), Node::Type_Object));
+				}
+				findNameMs = (Time::GetTimestamp() - t).asMilliseconds();
+			}
+			ImGui::SameLine();
+			if (ImGui::Button("Round Trip")) {
+			 // JSON -> binary -> load, compare against the JSON scene
+				Scene jsonScene, binScene;
+				roundTripErrors = 0;
+				if (!Scene::Load("SceneLoadTest.json", jsonScene) || !Scene::Convert("SceneLoadTest.json", "SceneLoadTest.scnb") || !Scene::Load("SceneLoadTest.scnb", binScene)) {
+					roundTripErrors = 1;
+				} else {
+					for (int i = 0; i < Node::Type_Count; ++i) {
+						roundTripErrors += jsonScene.getNodeCount((Node::Type)i) != binScene.getNodeCount((Node::Type)i) ? 1 : 0;
+					}
+				 // traverse both hierarchies in parallel
+					eastl::vector<eastl::pair<Node*, Node*> > stack;
+					stack.push_back(eastl::make_pair(jsonScene.getRoot(), binScene.getRoot()));
+					while (!stack.empty()) {
+						Node* a = stack.back().first;
+						Node* b = stack.back().second;
+						stack.pop_back();
+						bool match = a->getId() == b->getId()
+							&& strcmp(a->getName(), b->getName()) == 0
+							&& a->getType() == b->getType()
+							&& a->getChildCount() == b->getChildCount()
+							&& a->getXFormCount() == b->getXFormCount()
+							&& (a->getParent() ? a->getParent()->getId() : Node::kInvalidId) == (b->getParent() ? b->getParent()->getId() : Node::kInvalidId)
+							;
+						mat4 localA = a->getLocalMatrix();
+						mat4 localB = b->getLocalMatrix();
+						for (int i = 0; i < 4; ++i) {
+							match &= !any(greaterThan(abs(localA[i] - localB[i]), vec4(1e-5f)));
+						}
+						if (!match) {
+							++roundTripErrors;
+							continue;
+						}
+						for (Node* childA = a->getFirstChild(), *childB = b->getFirstChild(); childA && childB; childA = childA->getNextSibling(), childB = childB->getNextSibling()) {
+							stack.push_back(eastl::make_pair(childA, childB));
+						}
+					}
+					roundTripErrors += jsonScene.getDrawCamera()->m_parent->getId() != binScene.getDrawCamera()->m_parent->getId() ? 1 : 0;
+					roundTripErrors += jsonScene.getCullCamera()->m_parent->getId() != binScene.getCullCamera()->m_parent->getId() ? 1 : 0;
+				}
+			}
+			if (roundTripErrors >= 0) {
+				ImGui::TextColored(roundTripErrors == 0 ? ImColor(0.0f, 1.0f, 0.0f) : ImColor(1.0f, 0.0f, 0.0f), "Round Trip:   %s (%d errors)", roundTripErrors == 0 ? "PASS" : "FAIL", roundTripErrors);
+			}
+			ImGui::Text("Save:         %.3fms", (float)saveMs);
+			ImGui::Text("Load:         %.3fms", (float)loadMs);
+			ImGui::Text("First Update: %.3fms", (float)resolveMs);
+			ImGui::Text("Find Id:      %.3fms", (float)findIdMs);
+			ImGui::Text("Find Name:    %.3fms", (float)findNameMs);
+
+			ImGui::TreePop();
+		}
+
+		//ImGui::SetNextTreeNodeOpen(true, ImGuiCond_Once);
+		if (ImGui::TreeNode("Scene Streaming")) {
+			static int            gridSize      = 8;
+			static int            nodesPerChunk = 2000;
+			static float          chunkSize     = 50.0f;
+			static float          loadRadius    = 75.0f;
+			static float          budgetMs      = 2.0f;
+			static float          cameraSpeed   = 20.0f;
+			static float          cameraTime    = 0.0f;
+			static Scene*         scene         = nullptr;
+			static SceneStreamer* streamer      = nullptr;
+			static double         updateMs      = 0.0;
+			static double         maxUpdateMs   = 0.0;
+			ImGui::SliderInt("Grid Size", &gridSize, 1, 32);
+			ImGui::SliderInt("Nodes/Chunk", &nodesPerChunk, 1, 20000);
+			ImGui::SliderFloat("Load Radius", &loadRadius, 0.0f, 500.0f);
+			ImGui::SliderFloat("Frame Budget (ms)", &budgetMs, 0.0f, 16.0f);
+			ImGui::SliderFloat("Camera Speed", &cameraSpeed, 0.0f, 200.0f);
+
+			if (ImGui::Button("Create")) {
+				delete streamer;
+				delete scene;
+				scene = new Scene;
+				scene->createCamera(*Scene::GetDrawCamera());
+				streamer = new SceneStreamer(scene, 2);
+				for (int z = 0; z < gridSize; ++z) {
+					for (int x = 0; x < gridSize; ++x) {
+						Node* chunkNode = scene->createNode(Node::Type_Object);
+						chunkNode->setNamef("Chunk_%02d_%02d", x, z);
+						chunkNode->setLocalPosition(vec3((float)x, 0.0f, (float)z) * chunkSize);
+						for (int i = 0; i < nodesPerChunk; ++i) {
+							Node* node = scene->createNode(Node::Type_Object, chunkNode);
+							node->setLocalPosition(vec3(rand() % 1000, 0.0f, rand() % 1000) / 1000.0f * chunkSize);
+						}
+						String<64> path;
+						path.setf("SceneStreamingTest_%02d_%02d.scnb", x, z);
+						APT_VERIFY(streamer->createChunk(chunkNode, AlignedBox(vec3(0.0f), vec3(chunkSize, 1.0f, chunkSize)), path) != SceneStreamer::kInvalidChunk);
+					}
+				}
+				scene->update(0.0f);
+				maxUpdateMs = 0.0;
+			}
+
+			if (streamer) {
+				streamer->setLoadRadius(loadRadius);
+				streamer->setUnloadRadius(loadRadius * 1.25f);
+				streamer->setFrameBudget(budgetMs);
+
+			 // sweep the camera across the grid
+				cameraTime += (float)getDeltaTime() * cameraSpeed;
+				float extent = gridSize * chunkSize;
+				float cameraX = fmod(cameraTime, extent * 2.0f);
+				cameraX = cameraX > extent ? extent * 2.0f - cameraX : cameraX;
+				scene->getDrawCamera()->m_parent->setLocalPosition(vec3(cameraX, 10.0f, extent * 0.5f)); // camera world matrix is updated by Scene::update()
+
+				Timestamp t = Time::GetTimestamp();
+				streamer->update();
+				double ms = (Time::GetTimestamp() - t).asMilliseconds();
+				updateMs = updateMs * 0.9 + ms * 0.1;
+				maxUpdateMs = APT_MAX(maxUpdateMs, ms);
+				scene->update((float)getDeltaTime());
+
+				ImGui::Text("Update:    %.3fms (max %.3fms)", (float)updateMs, (float)maxUpdateMs);
+				ImGui::Text("Nodes:     %d", scene->getNodeCount(Node::Type_Object));
+				ImGui::Text("Unloaded:  %d", streamer->getChunkCount(SceneStreamer::State_Unloaded));
+				ImGui::Text("Loading:   %d", streamer->getChunkCount(SceneStreamer::State_Loading) + streamer->getChunkCount(SceneStreamer::State_Instantiating));
+				ImGui::Text("Loaded:    %d", streamer->getChunkCount(SceneStreamer::State_Loaded));
+				ImGui::Text("Unloading: %d", streamer->getChunkCount(SceneStreamer::State_Unloading));
+			}
+
+			ImGui::TreePop();
+		}
+
+		//ImGui::SetNextTreeNodeOpen(true, ImGuiCond_Once);
+		if (ImGui::TreeNode("XForm Batches")) {
+			static int    nodeCount    = 100000;
+			static int    orbitPercent = 0;
+			static bool   batched      = true;
+			static bool   parallel     = false;
+			static Scene* scene        = nullptr;
+			static double updateMs     = 0.0;
+			bool rebuild = scene == nullptr;
+			rebuild |= ImGui::SliderInt("Node Count", &nodeCount, 1, 1000000);
+			rebuild |= ImGui::SliderInt("Orbit %", &orbitPercent, 0, 100); // nodes with XForm_OrbitalPath + XForm_Spin, else XForm_Spin only
+			ImGui::Checkbox("Batched", &batched);
+			ImGui::Checkbox("Parallel", &parallel);
+			if (rebuild) {
+				delete scene;
+				scene = new Scene;
+				for (int i = 0; i < nodeCount; ++i) {
+					Node* node = scene->createNode(Node::Type_Object);
+					node->setDynamic(true);
+					node->setLocalPosition(vec3((float)(i % 1000), 0.0f, (float)(i / 1000)));
+					if (rand() % 100 < orbitPercent) {
+						XForm_OrbitalPath* orbit = (XForm_OrbitalPath*)XForm::Create("XForm_OrbitalPath");
+						orbit->m_speed = 0.1f;
+						node->addXForm(orbit);
+					}
+					XForm_Spin* spin = (XForm_Spin*)XForm::Create("XForm_Spin");
+					spin->m_axis = normalize(vec3(rand() % 100, rand() % 100, rand() % 100) + vec3(1.0f));
+					spin->m_rate = (float)(rand() % 100) / 10.0f;
+					node->addXForm(spin);
+				}
+				updateMs = 0.0;
+			}
+
+			if (scene->getBatchXForms() != batched) {
+				scene->setBatchXForms(batched);
+			}
+			scene->setParallelUpdate(parallel);
+			Timestamp t = Time::GetTimestamp();
+			scene->update((float)getDeltaTime());
+			updateMs = updateMs * 0.9 + (Time::GetTimestamp() - t).asMilliseconds() * 0.1;
+			ImGui::Text("Update: %.3fms", (float)updateMs);
+
+			ImGui::TreePop();
+		}
+
+		//ImGui::SetNextTreeNodeOpen(true, ImGuiCond_Once);
+		if (ImGui::TreeNode("Scene Hierarchy")) {
+			static int    nodeCount   = 100000;
+			static int    fanout      = 8;
+			static int    fullPercent = 10; // nodes with a non-uniform scale, stored as a full local matrix
+			static Scene* scene       = nullptr;
+			static double traverseMs  = 0.0;
+			static double getChildMs  = 0.0;
+			static int    localMismatches = 0; // setLocalMatrix()/getLocalMatrix() must round trip exactly
+			bool rebuild = scene == nullptr;
+			rebuild |= ImGui::SliderInt("Node Count", &nodeCount, 1, 1000000);
+			rebuild |= ImGui::SliderInt("Fanout", &fanout, 1, 64);
+			rebuild |= ImGui::SliderInt("Full Local %", &fullPercent, 0, 100);
+			if (rebuild) {
+				delete scene;
+				scene = new Scene;
+				eastl::vector<Node*> nodes;
+				nodes.reserve(nodeCount);
+				localMismatches = 0;
+				for (int i = 0; i < nodeCount; ++i) {
+					Node* parent = i < fanout ? scene->getRoot() : nodes[i / fanout - 1];
+					Node* node = scene->createNode(Node::Type_Object, parent);
+					vec3 position = vec3((float)(i % 100), 0.0f, (float)(i / 100 % 100));
+					quat orientation = RotationQuaternion(vec3(0.0f, 1.0f, 0.0f), Radians((float)(i % 360)));
+					if (rand() % 100 < fullPercent) {
+						mat4 localMatrix = TransformationMatrix(position, orientation, vec3(1.0f, 2.0f, 1.0f));
+						node->setLocalMatrix(localMatrix);
+						localMismatches += node->getLocalMatrix() != localMatrix ? 1 : 0;
+					} else {
+						node->setLocalTRS(position, orientation);
+					}
+					node->addXForm(XForm::Create("XForm_Spin"));
+					nodes.push_back(node);
+				}
+				scene->update(0.0f);
+				traverseMs = getChildMs = 0.0;
+			}
+
+		 // first child/next sibling links vs. indexed access (O(i) per call)
+			static int visited;
+			visited = 0;
+			Timestamp t = Time::GetTimestamp();
+			scene->traverse(scene->getRoot(), Node::State_Any, [](Node* _node_) { ++visited; return true; });
+			traverseMs = traverseMs * 0.9 + (Time::GetTimestamp() - t).asMilliseconds() * 0.1;
+			int visitedIndexed = 0;
+			t = Time::GetTimestamp();
+			eastl::vector<Node*> stack;
+			stack.push_back(scene->getRoot());
+			while (!stack.empty()) {
+				Node* node = stack.back();
+				stack.pop_back();
+				++visitedIndexed;
+				for (int i = 0; i < node->getChildCount(); ++i) {
+					stack.push_back(node->getChild(i));
+				}
+			}
+			getChildMs = getChildMs * 0.9 + (Time::GetTimestamp() - t).asMilliseconds() * 0.1;
+			APT_ASSERT(visited == visitedIndexed);
+
+			int compactCount = 0;
+			for (int i = 0; i < scene->getNodeCount(Node::Type_Object); ++i) {
+				compactCount += scene->getNode(Node::Type_Object, i)->isLocalCompact() ? 1 : 0;
+			}
+
+			int totalCount = 0;
+			for (int i = 0; i < Node::Type_Count; ++i) {
+				totalCount += scene->getNodeCount((Node::Type)i);
+			}
+			size_t nodeBytes = scene->getNodeMemoryUsage();
+
+			ImGui::Text("sizeof(Node):  %u bytes", (unsigned)sizeof(Node));
+			ImGui::Text("Node memory:   %.2f kb (%.1f bytes/node)", (float)nodeBytes / 1024.0f, (float)nodeBytes / (float)totalCount);
+			ImGui::Text("Compact local: %d/%d", compactCount, scene->getNodeCount(Node::Type_Object));
+			if (localMismatches > 0) {
+				ImGui::TextColored(ImColor(1.0f, 0.0f, 0.0f), "Local matrix mismatches: %d", localMismatches);
+			}
+			ImGui::Text("World matrices: %u (%.2f kb)", scene->getWorldMatrixCount(), (float)(scene->getWorldMatrixCount() * sizeof(mat4)) / 1024.0f);
+			ImGui::Text("XForm slabs:   %.2f kb", (float)XForm::GetSlabBytes() / 1024.0f);
+			ImGui::SameLine();
+			if (ImGui::SmallButton("Trim")) {
+				XForm::TrimSlabs();
+			}
+			ImGui::Text("Traverse:      %.3fms", (float)traverseMs);
+			ImGui::Text("getChild(i):   %.3fms", (float)getChildMs);
+
+			ImGui::TreePop();
+		}
+
+		//ImGui::SetNextTreeNodeOpen(true, ImGuiCond_Once);
+		if (ImGui::TreeNode("Vertex Cache")) {
+			static int    gridSize  = 100;
+			static bool   shuffle   = true;
+			static int    cacheSize = 16;
+			static MeshBuilder::VertexCacheStats before, after;
+			static double optimizeMs = 0.0;
+			bool rebuild = optimizeMs == 0.0;
+			rebuild |= ImGui::SliderInt("Grid Size", &gridSize, 1, 1000);
+			rebuild |= ImGui::Checkbox("Shuffle", &shuffle); // else row order
+			rebuild |= ImGui::SliderInt("Cache Size", &cacheSize, 4, 64);
+			if (rebuild) {
+				MeshBuilder mesh;
+				for (int y = 0; y <= gridSize; ++y) {
+					for (int x = 0; x <= gridSize; ++x) {
+						MeshBuilder::Vertex v = {};
+						v.m_position = vec3((float)x, 0.0f, (float)y);
+						mesh.addVertex(v);
+					}
+				}
+				for (int y = 0; y < gridSize; ++y) {
+					for (int x = 0; x < gridSize; ++x) {
+						uint32 a = y * (gridSize + 1) + x;
+						uint32 b = a + gridSize + 1;
+						mesh.addTriangle(a, b, a + 1);
+						mesh.addTriangle(a + 1, b, b + 1);
+					}
+				}
+				if (shuffle) {
+					for (uint32 i = mesh.getTriangleCount() - 1; i > 0; --i) {
+						eastl::swap(mesh.getTriangle(i), mesh.getTriangle(rand() % (i + 1)));
+					}
+				}
+				before = mesh.analyzeVertexCache(cacheSize);
+				Timestamp t = Time::GetTimestamp();
+				mesh.optimizeVertexCache();
+				optimizeMs = APT_MAX((Time::GetTimestamp() - t).asMilliseconds(), 1e-6);
+				after = mesh.analyzeVertexCache(cacheSize);
+			}
+			ImGui::Text("ACMR: %.3f -> %.3f", before.m_acmr, after.m_acmr);
+			ImGui::Text("ATVR: %.3f -> %.3f", before.m_atvr, after.m_atvr);
+			ImGui::Text("Optimize: %.3fms", (float)optimizeMs);
+
+			ImGui::TreePop();
+		}
+
+		//ImGui::SetNextTreeNodeOpen(true, ImGuiCond_Once);
+		if (ImGui::TreeNode("Mesh Optimization")) {
+			static const char* kModels[] = {
+				"models/box.obj",
+				"models/teapot.obj",
+				"models/md5/bob_lamp_update.md5mesh",
+			};
+			static const int kModelCount = (int)APT_ARRAY_COUNT(kModels);
+			struct Stats
+			{
+				float m_acmr;
+				float m_overdraw;   // software raster from 6 axis views
+				float m_fetchBytes; // per unique vertex
+			};
+			static Stats  before[kModelCount], after[kModelCount], meshData[kModelCount]; // meshData is measured on the MeshData created from the optimized builder
+			static uint32 vertexSizes[kModelCount];
+			static double optimizeMs[kModelCount];
+			static bool   loaded[kModelCount];
+			static float  threshold = 1.05f;
+			static bool   run       = true;
+			run |= ImGui::SliderFloat("Threshold", &threshold, 1.0f, 2.0f);
+			run |= ImGui::Button("Run");
+			if (run) {
+				run = false;
+				for (int i = 0; i < kModelCount; ++i) {
+					loaded[i] = false;
+					MeshData* md = MeshData::Create(kModels[i]);
+					if (!md) {
+						continue;
+					}
+					MeshBuilder mesh;
+					mesh.addVertexData(md->getDesc(), md->getVertexData(), md->getVertexCount());
+					mesh.addIndexData(md->getIndexDataType(), md->getIndexData(), md->getIndexCount());
+					vertexSizes[i] = md->getDesc().getVertexSize();
+					MeshDesc desc = md->getDesc();
+					MeshData::Destroy(md);
+
+					before[i].m_acmr       = mesh.analyzeVertexCache().m_acmr;
+					before[i].m_overdraw   = mesh.analyzeOverdraw();
+					before[i].m_fetchBytes = mesh.analyzeVertexFetch(vertexSizes[i]).m_bytesPerVertex;
+					Timestamp t = Time::GetTimestamp();
+					mesh.optimizeOverdraw(threshold);
+					mesh.optimizeVertexFetch();
+					optimizeMs[i] = (Time::GetTimestamp() - t).asMilliseconds();
+					after[i].m_acmr        = mesh.analyzeVertexCache().m_acmr;
+					after[i].m_overdraw    = mesh.analyzeOverdraw();
+					after[i].m_fetchBytes  = mesh.analyzeVertexFetch(vertexSizes[i]).m_bytesPerVertex;
+
+				 // the orderings must survive MeshData creation
+					md = MeshData::Create(desc, mesh);
+					MeshBuilder result;
+					result.addVertexData(md->getDesc(), md->getVertexData(), md->getVertexCount());
+					result.addIndexData(md->getIndexDataType(), md->getIndexData(), md->getIndexCount());
+					MeshData::Destroy(md);
+					meshData[i].m_acmr       = result.analyzeVertexCache().m_acmr;
+					meshData[i].m_overdraw   = result.analyzeOverdraw();
+					meshData[i].m_fetchBytes = result.analyzeVertexFetch(vertexSizes[i]).m_bytesPerVertex;
+					loaded[i] = true;
+				}
+			}
+			for (int i = 0; i < kModelCount; ++i) {
+				ImGui::Text(kModels[i]);
+				if (!loaded[i]) {
+					ImGui::TextColored(ImColor(1.0f, 0.0f, 0.0f), "Load error");
+					continue;
+				}
+				ImGui::Text("  ACMR:     %.3f -> %.3f", before[i].m_acmr, after[i].m_acmr);
+				ImGui::Text("  Overdraw: %.3f -> %.3f", before[i].m_overdraw, after[i].m_overdraw);
+				ImGui::Text("  Fetch:    %.1f -> %.1f bytes/vertex (vertex size %u)", before[i].m_fetchBytes, after[i].m_fetchBytes, vertexSizes[i]);
+				ImGui::Text("  Optimize: %.3fms", (float)optimizeMs[i]);
+				bool preserved = meshData[i].m_acmr == after[i].m_acmr && meshData[i].m_fetchBytes == after[i].m_fetchBytes;
+				ImGui::TextColored(preserved ? ImColor(1.0f, 1.0f, 1.0f) : ImColor(1.0f, 0.0f, 0.0f), "  MeshData: ACMR %.3f, overdraw %.3f, fetch %.1f bytes/vertex", meshData[i].m_acmr, meshData[i].m_overdraw, meshData[i].m_fetchBytes);
+			}
+
+			ImGui::TreePop();
+		}
+
+		//ImGui::SetNextTreeNodeOpen(true, ImGuiCond_Once);
+		if (ImGui::TreeNode("Meshlets")) {
+			static const char* kModels[] = { "models/teapot.obj", "models/md5/bob_lamp_update.md5mesh" };
+			static MeshData* meshData     = nullptr;
+			static int       model        = 0;
+			static float     scale        = 1.0f;
+			static bool      showMeshlets = false;
+			static double    buildMs      = 0.0;
+			static eastl::vector<MeshData::DrawCommand> commands;
+			bool reload = !meshData;
+			reload |= ImGui::Combo("Model", &model, kModels, (int)APT_ARRAY_COUNT(kModels));
+			if (reload) {
+				MeshData::Destroy(meshData);
+				meshData = MeshData::Create(kModels[model]);
+				if (meshData) {
+					Timestamp t = Time::GetTimestamp();
+					meshData->buildMeshlets();
+					buildMs = (Time::GetTimestamp() - t).asMilliseconds();
+				}
+			}
+			ImGui::SliderFloat("Scale", &scale, 0.1f, 10.0f);
+			ImGui::Checkbox("Show Meshlets", &showMeshlets);
+			if (meshData) {
+				uint32 meshletCount = meshData->getMeshletCount();
+				uint32 coneCount = 0;
+				uint32 triangleCount = 0;
+				for (uint32 i = 0; i < meshletCount; ++i) {
+					coneCount += meshData->getMeshlet(i).m_coneCutoff < 1.0f ? 1 : 0;
+					triangleCount += meshData->getMeshlet(i).m_indexCount / 3;
+				}
+
+				mat4 world = identity;
+				world[0][0] = world[1][1] = world[2][2] = scale;
+				commands.clear();
+				Timestamp t = Time::GetTimestamp();
+				uint32 visibleCount = meshData->cullMeshlets(*Scene::GetCullCamera(), commands, world);
+				double cullMs = (Time::GetTimestamp() - t).asMilliseconds();
+				uint32 visibleTriangles = 0;
+				for (auto& cmd : commands) {
+					visibleTriangles += cmd.m_indexCount / 3;
+				}
+
+				ImGui::Text("Meshlets:  %u (%.1f triangles avg, %u with cones)", meshletCount, (float)triangleCount / (float)APT_MAX(meshletCount, 1u), coneCount);
+				ImGui::Text("Build:     %.3fms", (float)buildMs);
+				ImGui::Text("Visible:   %u meshlets, %u/%u triangles (%.1f%%)", visibleCount, visibleTriangles, triangleCount, (float)visibleTriangles / (float)APT_MAX(triangleCount, 1u) * 100.0f);
+				ImGui::Text("Cull:      %.3fms", (float)cullMs);
+
+				if (showMeshlets) {
+					Im3d::PushDrawState();
+					Im3d::PushMatrix(world);
+					Im3d::SetSize(1.0f);
+					for (auto& cmd : commands) {
+						const MeshData::Meshlet& meshlet = meshData->getMeshlet(cmd.m_baseInstance);
+						Im3d::SetColor(Im3d::Color_Green);
+						Im3d::DrawSphere(meshlet.m_boundingSphere.m_origin, meshlet.m_boundingSphere.m_radius);
+						if (meshlet.m_coneCutoff < 1.0f) {
+							Im3d::SetColor(Im3d::Color_Yellow);
+							Im3d::DrawArrow(meshlet.m_boundingSphere.m_origin, meshlet.m_boundingSphere.m_origin + meshlet.m_coneAxis * meshlet.m_boundingSphere.m_radius);
+						}
+					}
+					Im3d::PopMatrix();
+					Im3d::PopDrawState();
+				}
+			}
+
+			ImGui::TreePop();
+		}
+
+		//ImGui::SetNextTreeNodeOpen(true, ImGuiCond_Once);
+		if (ImGui::TreeNode("LOD Generation")) {
+			static const char* kModels[] = { "Sphere", "models/teapot.obj", "models/md5/bob_lamp_update.md5mesh" };
+			static MeshData* meshData = nullptr;
+			static int       model    = 0;
+			static int       lodCount = MeshData::kMaxLods;
+			static float     ratio    = 0.5f;
+			static float     distance = 10.0f;
+			static float     maxError = 1.0f;   // pixels
+			static double    createMs = 0.0;
+			bool reload = !meshData;
+			reload |= ImGui::Combo("Model", &model, kModels, (int)APT_ARRAY_COUNT(kModels));
+			reload |= ImGui::SliderInt("LOD Count", &lodCount, 1, MeshData::kMaxLods);
+			reload |= ImGui::SliderFloat("Ratio", &ratio, 0.1f, 0.9f);
+			if (reload) {
+				MeshData::Destroy(meshData);
+				if (model == 0) {
+					MeshDesc desc(MeshDesc::Primitive_Triangles);
+					desc.addVertexAttr(VertexAttr::Semantic_Positions, DataType_Float32, 3);
+					desc.addVertexAttr(VertexAttr::Semantic_Normals,   DataType_Float32, 3);
+					desc.addVertexAttr(VertexAttr::Semantic_Texcoords, DataType_Float32, 2);
+					meshData = MeshData::CreateSphere(desc, 1.0f, 128, 128);
+				} else {
+					meshData = MeshData::Create(kModels[model]);
+				}
+				if (meshData) {
+					Timestamp t = Time::GetTimestamp();
+					meshData->createLods(lodCount, ratio);
+					createMs = (Time::GetTimestamp() - t).asMilliseconds();
+				}
+			}
+			ImGui::SliderFloat("Distance", &distance, 1.0f, 1000.0f);
+			ImGui::SliderFloat("Max Error (pixels)", &maxError, 0.5f, 8.0f);
+			if (meshData) {
+				const MeshData::Submesh& submesh = meshData->getSubmesh(0);
+				ImGui::Text("Create:    %.3fms", (float)createMs);
+				ImGui::Text("LODs:      %u", APT_MAX(submesh.m_lodCount, 1u));
+				for (uint i = 0; i < APT_MAX(submesh.m_lodCount, 1u); ++i) {
+					const MeshData::Lod& lod = submesh.m_lods[i];
+					uint triangleCount = (i == 0 ? submesh.m_indexCount : lod.m_indexCount) / 3;
+					ImGui::Text("  %u: %6u triangles (%5.1f%%), error %.5f", i, triangleCount, (float)triangleCount / (float)(submesh.m_indexCount / 3) * 100.0f, lod.m_error);
+				}
+
+			 // LOD selected for the mesh placed along the cull camera's view vector at distance
+				const Camera& camera = *Scene::GetCullCamera();
+				Sphere sphere = submesh.m_boundingSphere;
+				sphere.m_origin = camera.getPosition() + camera.getViewVector() * distance;
+				const float kViewportHeight = 1080.0f;
+				int lod = MeshData::SelectLod(submesh, sphere, camera, maxError / kViewportHeight);
+				ImGui::Text("Selected:  LOD %d at %.1f (%.0f pixels error at %.0fp)", lod, distance, maxError, kViewportHeight);
+			}
+
+			ImGui::TreePop();
+		}
+
+		//ImGui::SetNextTreeNodeOpen(true, ImGuiCond_Once);
+		if (ImGui::TreeNode("Vertex Welding")) {
+		 // models are welded on import, unweld to a triangle soup (as per a naive exporter) and weld again
+			static const char* kModels[] = {
+				"models/box.obj",
+				"models/teapot.obj",
+				"models/md5/bob_lamp_update.md5mesh",
+			};
+			static const int kModelCount = (int)APT_ARRAY_COUNT(kModels);
+			static uint32 importedCounts[kModelCount], soupCounts[kModelCount], weldedCounts[kModelCount];
+			static uint32 vertexSizes[kModelCount];
+			static double weldMs[kModelCount];
+			static bool   loaded[kModelCount];
+			static float  epsilon = 0.0f;
+			static bool   run     = true;
+			run |= ImGui::SliderFloat("Epsilon", &epsilon, 0.0f, 0.01f, "%.5f");
+			run |= ImGui::Button("Run");
+			if (run) {
+				run = false;
+				for (int i = 0; i < kModelCount; ++i) {
+					loaded[i] = false;
+					MeshData* md = MeshData::Create(kModels[i]);
+					if (!md) {
+						continue;
+					}
+					MeshBuilder mesh;
+					mesh.addVertexData(md->getDesc(), md->getVertexData(), md->getVertexCount());
+					mesh.addIndexData(md->getIndexDataType(), md->getIndexData(), md->getIndexCount());
+					importedCounts[i] = md->getVertexCount();
+					vertexSizes[i]    = md->getDesc().getVertexSize();
+					MeshData::Destroy(md);
+
+					MeshBuilder soup;
+					for (uint32 j = 0; j < mesh.getTriangleCount(); ++j) {
+						const MeshBuilder::Triangle& tri = mesh.getTriangle(j);
+						uint32 a = soup.addVertex(mesh.getVertex(tri.a));
+						uint32 b = soup.addVertex(mesh.getVertex(tri.b));
+						uint32 c = soup.addVertex(mesh.getVertex(tri.c));
+						soup.addTriangle(a, b, c);
+					}
+					soupCounts[i] = soup.getVertexCount();
+					Timestamp t = Time::GetTimestamp();
+					soup.weld(epsilon);
+					weldMs[i] = (Time::GetTimestamp() - t).asMilliseconds();
+					weldedCounts[i] = soup.getVertexCount();
+					loaded[i] = true;
+				}
+			}
+			for (int i = 0; i < kModelCount; ++i) {
+				ImGui::Text(kModels[i]);
+				if (!loaded[i]) {
+					ImGui::TextColored(ImColor(1.0f, 0.0f, 0.0f), "Load error");
+					continue;
+				}
+				ImGui::Text("  Imported: %u vertices", importedCounts[i]);
+				ImGui::Text("  Welded:   %u -> %u vertices (%.1f%%)", soupCounts[i], weldedCounts[i], (float)weldedCounts[i] / (float)APT_MAX(soupCounts[i], 1u) * 100.0f);
+				ImGui::Text("  Memory:   %.1fkb -> %.1fkb (vertex size %u)", (float)(soupCounts[i] * vertexSizes[i]) / 1024.0f, (float)(weldedCounts[i] * vertexSizes[i]) / 1024.0f, vertexSizes[i]);
+				ImGui::Text("  Weld:     %.3fms", (float)weldMs[i]);
+			}
+
+			ImGui::TreePop();
+		}
+
 		return true;
 	}
 